@@ -45,7 +45,14 @@ class MemArena {
 	u8 *Find4GBBase();
 	bool NeedsProbing();
 
+	// Asks for huge pages to back the views, to cut down on TLB misses. Call before GrabMemSpace().
+	// Only does anything on Linux, and only if the kernel allows it. Returns whether they'll be used.
+	bool SetHugePages(bool enable);
+	bool UsesHugePages() const { return hugePages_; }
+
 private:
+	bool hugePages_ = false;
+
 #ifdef _WIN32
 	HANDLE hMemoryMapping;
 	SYSTEM_INFO sysInfo;
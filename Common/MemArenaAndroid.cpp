@@ -41,6 +41,10 @@ bool MemArena::NeedsProbing() {
 	return false;
 }
 
+bool MemArena::SetHugePages(bool enable) {
+	return false;
+}
+
 // ashmem_create_region - creates a new ashmem region and returns the file
 // descriptor, or <0 on error
 // This function is defined in much later version of the ndk, so we can only access it via dlopen().
@@ -93,6 +93,10 @@ bool MemArena::NeedsProbing() {
 #endif
 }
 
+bool MemArena::SetHugePages(bool enable) {
+	return false;
+}
+
 u8* MemArena::Find4GBBase() {
 #if PPSSPP_PLATFORM(IOS) && PPSSPP_ARCH(64BIT)
 	// The caller will need to do probing, like on 32-bit Windows.
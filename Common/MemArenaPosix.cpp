@@ -36,6 +36,7 @@
 #include "Common/File/FileUtil.h"
 #include "Common/MemoryUtil.h"
 #include "Common/MemArena.h"
+#include "Common/StringUtils.h"
 
 static const std::string tmpfs_location = "/dev/shm";
 static const std::string tmpfs_ram_temp_file = "/dev/shm/gc_mem.tmp";
@@ -43,7 +44,18 @@ static const std::string tmpfs_ram_temp_file = "/dev/shm/gc_mem.tmp";
 // do not make this "static"
 std::string ram_temp_file = "/tmp/gc_mem.tmp";
 
+#if defined(__linux__) && defined(MFD_CLOEXEC) && defined(MADV_HUGEPAGE)
+#define HAVE_SHMEM_HUGEPAGES 1
+#else
+#define HAVE_SHMEM_HUGEPAGES 0
+#endif
+
+static const size_t HUGE_PAGE_SIZE = 0x00200000;
+
 size_t MemArena::roundup(size_t x) {
+	// Each view starts at a huge page in the file, so that it lines up with the (aligned) address it's mapped at.
+	if (hugePages_)
+		return (x + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
 	return x;
 }
 
@@ -51,9 +63,48 @@ bool MemArena::NeedsProbing() {
 	return false;
 }
 
+bool MemArena::SetHugePages(bool enable) {
+	hugePages_ = false;
+#if HAVE_SHMEM_HUGEPAGES
+	if (!enable)
+		return false;
+
+	// Explicit hugetlbfs pages (MFD_HUGETLB) can't work: the scratchpad and the last MB of RAM are mapped
+	// at addresses that aren't 2MB aligned. Transparent huge pages in shmem can, if the kernel allows madvise.
+	std::string setting;
+	if (!File::ReadFileToString(true, Path("/sys/kernel/mm/transparent_hugepage/shmem_enabled"), setting)) {
+		WARN_LOG(MEMMAP, "Huge pages requested, but transparent huge pages are not available");
+		return false;
+	}
+	if (setting.find("[never]") != setting.npos || setting.find("[deny]") != setting.npos) {
+		WARN_LOG(MEMMAP, "Huge pages requested, but shmem_enabled is %s", StripSpaces(setting).c_str());
+		return false;
+	}
+	hugePages_ = true;
+#endif
+	return hugePages_;
+}
+
 bool MemArena::GrabMemSpace(size_t size) {
 	constexpr mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
 
+#if HAVE_SHMEM_HUGEPAGES
+	// shm_open() goes through /dev/shm, which is usually mounted without huge pages.
+	// memfd follows shmem_enabled instead, so madvise() can ask for them.
+	if (hugePages_) {
+		fd = memfd_create("ppsspp_ram", MFD_CLOEXEC);
+		if (fd >= 0 && ftruncate(fd, size) == 0) {
+			INFO_LOG(MEMMAP, "Got memfd for huge pages, size %08x", (int)size);
+			return true;
+		}
+		WARN_LOG(MEMMAP, "Failed to create memfd for huge pages (%s), falling back", strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		fd = -1;
+		// roundup() has already been used, so hugePages_ stays on. The views are still mapped aligned.
+	}
+#endif
+
 	// Try a few times in case multiple instances are started near each other.
 	char ram_temp_filename[128]{};
 	bool is_shm = false;
@@ -118,6 +169,12 @@ void *MemArena::CreateView(s64 offset, size_t size, void *base)
 		NOTICE_LOG(MEMMAP, "mmap on %s (fd: %d) failed: %s", ram_temp_file.c_str(), (int)fd, strerror(errno));
 		return 0;
 	}
+#if HAVE_SHMEM_HUGEPAGES
+	// Smaller views can't use them anyway. This is only a hint, normal pages still work if it fails.
+	if (hugePages_ && size >= HUGE_PAGE_SIZE && madvise(retval, size, MADV_HUGEPAGE) != 0) {
+		WARN_LOG(MEMMAP, "madvise(MADV_HUGEPAGE) failed: %s", strerror(errno));
+	}
+#endif
 	return retval;
 }
 
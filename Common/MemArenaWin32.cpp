@@ -69,6 +69,10 @@ bool MemArena::NeedsProbing() {
 #endif
 }
 
+bool MemArena::SetHugePages(bool enable) {
+	return false;
+}
+
 u8* MemArena::Find4GBBase() {
 	// Now, create views in high memory where there's plenty of space.
 #if PPSSPP_ARCH(32BIT)
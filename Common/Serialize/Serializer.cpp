@@ -15,15 +15,25 @@
 // Official SVN repository and contact information can be found at
 // http://code.google.com/p/dolphin-emu/
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <snappy-c.h>
 #include <zstd.h>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
 
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
 #include "Common/File/FileUtil.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ParallelLoop.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Common/TimeUtil.h"
 
 enum class SerializeCompressType {
 	NONE = 0,
@@ -33,6 +43,171 @@ enum class SerializeCompressType {
 
 static constexpr SerializeCompressType SAVE_TYPE = SerializeCompressType::ZSTD;
 
+// ZSTD states are written as a series of independent frames, so they can be compressed and decompressed in parallel.
+// A series of frames is still a single valid zstd stream, so older versions can load them just fine.
+static const size_t SAVE_CHUNK_SIZE = 4 * 1024 * 1024;
+
+struct ZstdChunkCompressor {
+	const u8 *src;
+	size_t srcSize;
+	u8 *dst;
+	size_t dstChunkSize;
+	int numChunks;
+
+	std::atomic<int> nextChunk{};
+	std::atomic<bool> abort{};
+	std::mutex lock;
+	std::condition_variable cond;
+	// Compressed size of each chunk, or a zstd error code. Zero until done, a frame is never empty.
+	std::vector<size_t> results;
+	int activeWorkers = 0;
+
+	// Workers take chunks in order, so the writer can usually start on the first one right away.
+	void Work() {
+		ZSTD_CCtx *ctx = ZSTD_createCCtx();
+		if (ctx) {
+			ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT);
+			ZSTD_CCtx_setParameter(ctx, ZSTD_c_checksumFlag, 1);
+		}
+
+		int chunk;
+		while (!abort && (chunk = nextChunk++) < numChunks) {
+			size_t offset = (size_t)chunk * SAVE_CHUNK_SIZE;
+			size_t size = std::min(SAVE_CHUNK_SIZE, srcSize - offset);
+			// The content size gets written to each frame, which is what allows decompressing in parallel.
+			// (size_t)-1 counts as a zstd error code.
+			size_t result = ctx ? ZSTD_compress2(ctx, dst + chunk * dstChunkSize, dstChunkSize, src + offset, size) : (size_t)-1;
+
+			std::lock_guard<std::mutex> guard(lock);
+			results[chunk] = result;
+			cond.notify_all();
+		}
+
+		ZSTD_freeCCtx(ctx);
+		std::lock_guard<std::mutex> guard(lock);
+		activeWorkers--;
+		cond.notify_all();
+	}
+};
+
+class ZstdChunkTask : public Task {
+public:
+	ZstdChunkTask(ZstdChunkCompressor *compressor) : compressor_(compressor) {}
+
+	TaskType Type() const override {
+		return TaskType::CPU_COMPUTE;
+	}
+
+	void Run() override {
+		compressor_->Work();
+	}
+
+private:
+	ZstdChunkCompressor *compressor_;
+};
+
+enum class ChunkWriteResult {
+	SUCCESS,
+	COMPRESS_FAILED,
+	WRITE_FAILED,
+};
+
+// Writes each chunk as soon as it (and all before it) are compressed.
+static ChunkWriteResult WriteZstdChunks(File::IOFile &pFile, const u8 *buffer, size_t sz, std::vector<u8> &compressBuffer, size_t *written) {
+	ZstdChunkCompressor compressor;
+	compressor.src = buffer;
+	compressor.srcSize = sz;
+	compressor.numChunks = (int)((sz + SAVE_CHUNK_SIZE - 1) / SAVE_CHUNK_SIZE);
+	compressor.dstChunkSize = ZSTD_compressBound(SAVE_CHUNK_SIZE);
+	compressor.results.resize(compressor.numChunks, 0);
+
+	compressBuffer.resize(compressor.dstChunkSize * compressor.numChunks);
+	compressor.dst = compressBuffer.data();
+
+	int numWorkers = 1;
+	if (g_threadManager.IsInitialized())
+		numWorkers = std::max(1, std::min(compressor.numChunks, g_threadManager.GetNumLooperThreads()));
+	compressor.activeWorkers = numWorkers;
+	if (numWorkers == 1) {
+		// Not worth the threading, just compress everything up front.
+		compressor.Work();
+	} else {
+		for (int i = 0; i < numWorkers; ++i)
+			g_threadManager.EnqueueTask(new ZstdChunkTask(&compressor));
+	}
+
+	ChunkWriteResult result = ChunkWriteResult::SUCCESS;
+	*written = 0;
+	std::unique_lock<std::mutex> guard(compressor.lock);
+	for (int i = 0; i < compressor.numChunks; ++i) {
+		compressor.cond.wait(guard, [&] { return compressor.results[i] != 0; });
+		size_t len = compressor.results[i];
+		if (ZSTD_isError(len)) {
+			result = ChunkWriteResult::COMPRESS_FAILED;
+			break;
+		}
+
+		guard.unlock();
+		bool success = pFile.WriteBytes(compressor.dst + i * compressor.dstChunkSize, len);
+		guard.lock();
+		if (!success) {
+			result = ChunkWriteResult::WRITE_FAILED;
+			break;
+		}
+		*written += len;
+	}
+
+	// The workers point at our stack, so they must be done before returning, even on failure.
+	compressor.abort = true;
+	compressor.cond.wait(guard, [&] { return compressor.activeWorkers == 0; });
+	return result;
+}
+
+// Decompresses straight into dst, each frame on its own thread if there are several.
+static bool DecompressZstdChunks(const u8 *src, size_t srcSize, u8 *dst, size_t dstSize) {
+	struct Frame {
+		size_t srcOffset;
+		size_t srcSize;
+		size_t dstOffset;
+		size_t dstSize;
+	};
+	std::vector<Frame> frames;
+
+	bool parallel = g_threadManager.IsInitialized();
+	size_t srcPos = 0;
+	size_t dstPos = 0;
+	while (parallel && srcPos < srcSize) {
+		size_t frameSize = ZSTD_findFrameCompressedSize(src + srcPos, srcSize - srcPos);
+		unsigned long long contentSize = ZSTD_getFrameContentSize(src + srcPos, srcSize - srcPos);
+		// Older states are a single frame, but might also not have a content size.
+		if (ZSTD_isError(frameSize) || contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize > dstSize - dstPos) {
+			parallel = false;
+			break;
+		}
+		frames.push_back({ srcPos, frameSize, dstPos, (size_t)contentSize });
+		srcPos += frameSize;
+		dstPos += (size_t)contentSize;
+	}
+
+	if (!parallel || frames.size() <= 1 || dstPos != dstSize) {
+		size_t status = ZSTD_decompress(dst, dstSize, src, srcSize);
+		return !ZSTD_isError(status) && status == dstSize;
+	}
+
+	std::atomic<bool> success{ true };
+	ParallelRangeLoop(&g_threadManager, [&](int l, int h) {
+		ZSTD_DCtx *ctx = ZSTD_createDCtx();
+		for (int i = l; i < h; ++i) {
+			const Frame &frame = frames[i];
+			size_t status = ctx ? ZSTD_decompressDCtx(ctx, dst + frame.dstOffset, frame.dstSize, src + frame.srcOffset, frame.srcSize) : (size_t)-1;
+			if (ZSTD_isError(status) || status != frame.dstSize)
+				success = false;
+		}
+		ZSTD_freeDCtx(ctx);
+	}, 0, (int)frames.size(), 1);
+	return success;
+}
+
 PointerWrapSection PointerWrap::Section(const char *title, int ver) {
 	return Section(title, ver, ver);
 }
@@ -41,6 +216,14 @@ PointerWrapSection PointerWrap::Section(const char *title, int minVer, int ver)
 	char marker[16] = {0};
 	int foundVersion = ver;
 
+	int statIndex = -1;
+	if (sectionStats_) {
+		statIndex = (int)sectionStats_->size();
+		// Until the section ends, bytes holds the start position.
+		sectionStats_->push_back({ title, sectionDepth_++, StatPosition(), 0.0 });
+		sectionStarts_.push_back(time_now_d());
+	}
+
 	// This is strncpy because we rely on its weird non-null-terminating zero-filling truncation behaviour.
 	// Can't replace it with the more sensible truncate_cpy because that would break savestates.
 	strncpy(marker, title, sizeof(marker));
@@ -62,9 +245,27 @@ PointerWrapSection PointerWrap::Section(const char *title, int minVer, int ver)
 		}
 		WARN_LOG(SAVESTATE, "Savestate failure: wrong version %d found for section '%s'", foundVersion, title);
 		SetError(ERROR_FAILURE);
-		return PointerWrapSection(*this, -1, title);
+		return PointerWrapSection(*this, -1, title, statIndex);
 	}
-	return PointerWrapSection(*this, foundVersion, title);
+	return PointerWrapSection(*this, foundVersion, title, statIndex);
+}
+
+void PointerWrap::EndSectionStat(int index) {
+	PointerWrapSectionStat &stat = (*sectionStats_)[index];
+	stat.bytes = StatPosition() - stat.bytes;
+	stat.seconds = time_now_d() - sectionStarts_.back();
+	sectionStarts_.pop_back();
+	sectionDepth_--;
+}
+
+void PointerWrap::Grow(size_t size) {
+	size_t offset = GetGrowOffset();
+	// Use up any capacity left over from a previous, larger save before reallocating.
+	size_t newSize = std::max(std::max(growBuffer_->capacity(), growBuffer_->size() * 2), (size_t)1024 * 1024);
+	while (newSize < offset + size)
+		newSize *= 2;
+	growBuffer_->resize(newSize);
+	growPtr_ = growBuffer_->data() + offset;
 }
 
 void PointerWrap::SetError(Error error_) {
@@ -78,6 +279,7 @@ void PointerWrap::SetError(Error error_) {
 }
 
 bool PointerWrap::ExpectVoid(void *data, int size) {
+	Reserve(size);
 	switch (mode) {
 	case MODE_READ:	if (memcmp(data, *ptr, size) != 0) return false; break;
 	case MODE_WRITE: memcpy(*ptr, data, size); break;
@@ -93,6 +295,7 @@ bool PointerWrap::ExpectVoid(void *data, int size) {
 }
 
 void PointerWrap::DoVoid(void *data, int size) {
+	Reserve(size);
 	switch (mode) {
 	case MODE_READ:	memcpy(data, *ptr, size); break;
 	case MODE_WRITE: memcpy(*ptr, data, size); break;
@@ -119,6 +322,7 @@ void Do(PointerWrap &p, std::string &x) {
 		return;
 	}
 
+	p.Reserve(stringLen);
 	switch (p.mode) {
 	case PointerWrap::MODE_READ: x = (char*)*p.ptr; break;
 	case PointerWrap::MODE_WRITE: memcpy(*p.ptr, x.c_str(), stringLen); break;
@@ -146,6 +350,7 @@ void Do(PointerWrap &p, std::wstring &x) {
 		return r;
 	};
 
+	p.Reserve(stringLen);
 	switch (p.mode) {
 	case PointerWrap::MODE_READ: x = read(); break;
 	case PointerWrap::MODE_WRITE: memcpy(*p.ptr, x.c_str(), stringLen); break;
@@ -173,6 +378,7 @@ void Do(PointerWrap &p, std::u16string &x) {
 		return r;
 	};
 
+	p.Reserve(stringLen);
 	switch (p.mode) {
 	case PointerWrap::MODE_READ: x = read(); break;
 	case PointerWrap::MODE_WRITE: memcpy(*p.ptr, x.c_str(), stringLen); break;
@@ -229,6 +435,9 @@ PointerWrapSection::~PointerWrapSection() {
 	if (ver_ > 0) {
 		p_.DoMarker(title_);
 	}
+	if (statIndex_ >= 0) {
+		p_.EndSectionStat(statIndex_);
+	}
 }
 
 CChunkFileReader::Error CChunkFileReader::LoadFileHeader(File::IOFile &pFile, SChunkHeader &header, std::string *title) {
@@ -290,7 +499,39 @@ CChunkFileReader::Error CChunkFileReader::GetFileTitle(const Path &filename, std
 	return LoadFileHeader(pFile, header, title);
 }
 
-CChunkFileReader::Error CChunkFileReader::LoadFile(const Path &filename, std::string *gitVersion, u8 *&_buffer, size_t &sz, std::string *failureReason) {
+// Maps a whole file read-only, so a state doesn't need to be read into a buffer first.
+// Returns nullptr where that isn't possible, like with some Android content URIs.
+static void *MapFileForRead(File::IOFile &pFile, size_t size) {
+#if !defined(_WIN32)
+	int fd = fileno(pFile.GetHandle());
+	if (fd < 0 || size == 0)
+		return nullptr;
+	void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (ptr == MAP_FAILED)
+		return nullptr;
+	// It's all read once, from start to end (or in chunks by a few threads.)
+	madvise(ptr, size, MADV_WILLNEED);
+	return ptr;
+#else
+	return nullptr;
+#endif
+}
+
+static void UnmapFile(void *ptr, size_t size) {
+#if !defined(_WIN32)
+	if (ptr)
+		munmap(ptr, size);
+#endif
+}
+
+CChunkFileReader::LoadedBuffer::~LoadedBuffer() {
+	if (mapping)
+		UnmapFile(mapping, mappingSize);
+	else
+		delete [] data;
+}
+
+CChunkFileReader::Error CChunkFileReader::LoadFile(const Path &filename, std::string *gitVersion, LoadedBuffer &_buffer, std::string *failureReason) {
 	if (!File::Exists(filename)) {
 		*failureReason = "LoadStateDoesntExist";
 		ERROR_LOG(SAVESTATE, "ChunkReader: File doesn't exist");
@@ -305,14 +546,30 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const Path &filename, std::st
 	}
 
 	// read the state
-	sz = header.ExpectedSize;
-	u8 *buffer = new u8[sz];
-	if (!pFile.ReadBytes(buffer, sz))
-	{
-		ERROR_LOG(SAVESTATE, "ChunkReader: Error reading file");
-		delete [] buffer;
-		return ERROR_BAD_FILE;
+	// Mapping the file saves a copy, and a buffer the size of the file. On devices short on memory, that matters.
+	size_t sz = header.ExpectedSize;
+	size_t dataOffset = (size_t)pFile.Tell();
+	size_t mappingSize = dataOffset + sz;
+	void *mapping = MapFileForRead(pFile, mappingSize);
+	u8 *buffer = nullptr;
+	if (mapping) {
+		buffer = (u8 *)mapping + dataOffset;
+	} else {
+		buffer = new u8[sz];
+		if (!pFile.ReadBytes(buffer, sz))
+		{
+			ERROR_LOG(SAVESTATE, "ChunkReader: Error reading file");
+			delete [] buffer;
+			return ERROR_BAD_FILE;
+		}
 	}
+	// Frees the compressed data once we're done with it.
+	auto freeBuffer = [&]() {
+		if (mapping)
+			UnmapFile(mapping, mappingSize);
+		else
+			delete [] buffer;
+	};
 
 	if (header.Compress) {
 		u8 *uncomp_buffer = new u8[header.UncompressedSize];
@@ -322,31 +579,30 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const Path &filename, std::st
 			auto status = snappy_uncompress((const char *)buffer, sz, (char *)uncomp_buffer, &uncomp_size);
 			success = status == SNAPPY_OK;
 		} else if (SerializeCompressType(header.Compress) == SerializeCompressType::ZSTD) {
-			size_t status = ZSTD_decompress((char *)uncomp_buffer, uncomp_size, (const char *)buffer, sz);
-			success = !ZSTD_isError(status);
-			if (success) {
-				uncomp_size = status;
-			}
+			// On failure, the size check below doesn't matter.
+			success = DecompressZstdChunks(buffer, sz, uncomp_buffer, uncomp_size);
 		} else {
 			ERROR_LOG(SAVESTATE, "ChunkReader: Unexpected compression type %d", header.Compress);
 		}
+		freeBuffer();
 		if (!success) {
 			ERROR_LOG(SAVESTATE, "ChunkReader: Failed to decompress file");
 			delete [] uncomp_buffer;
-			delete [] buffer;
 			return ERROR_BAD_FILE;
 		}
 		if ((u32)uncomp_size != header.UncompressedSize) {
 			ERROR_LOG(SAVESTATE, "Size mismatch: file: %u  calc: %u", header.UncompressedSize, (u32)uncomp_size);
 			delete [] uncomp_buffer;
-			delete [] buffer;
 			return ERROR_BAD_FILE;
 		}
-		_buffer = uncomp_buffer;
-		sz = uncomp_size;
-		delete [] buffer;
+		_buffer.data = uncomp_buffer;
+		_buffer.size = uncomp_size;
 	} else {
-		_buffer = buffer;
+		// RAM gets copied into place straight from the file's pages.
+		_buffer.data = buffer;
+		_buffer.size = sz;
+		_buffer.mapping = mapping;
+		_buffer.mappingSize = mappingSize;
 	}
 
 	if (header.GitVersion[31]) {
@@ -358,111 +614,101 @@ CChunkFileReader::Error CChunkFileReader::LoadFile(const Path &filename, std::st
 	return ERROR_NONE;
 }
 
-// Takes ownership of buffer.
-CChunkFileReader::Error CChunkFileReader::SaveFile(const Path &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz) {
+// Doesn't take ownership of buffer.
+CChunkFileReader::Error CChunkFileReader::SaveFile(const Path &filename, const std::string &title, const char *gitVersion, const u8 *buffer, size_t sz) {
 	INFO_LOG(SAVESTATE, "ChunkReader: Writing %s", filename.c_str());
+	// Owned by this save, so saves finishing in the background don't hold on to the peak size.
+	std::vector<u8> compressBuffer;
 
 	File::IOFile pFile(filename, "wb");
 	if (!pFile) {
 		ERROR_LOG(SAVESTATE, "ChunkReader: Error opening file for write");
-		free(buffer);
 		return ERROR_BAD_FILE;
 	}
 
-	// Make sure we can allocate a buffer to compress before compressing.
-	size_t write_len;
+	// Create header
+	SChunkHeader header{};
+	header.Compress = (int)SAVE_TYPE;
+	header.Revision = REVISION_CURRENT;
+	header.UncompressedSize = (u32)sz;
+	truncate_cpy(header.GitVersion, gitVersion);
+
+	// Setup the fixed-length title.
+	char titleFixed[128]{};
+	truncate_cpy(titleFixed, title.c_str());
+
 	SerializeCompressType usedType = SAVE_TYPE;
+	size_t write_len = sz;
+	const u8 *write_buffer = buffer;
+	bool streamed = false;
 	switch (usedType) {
 	case SerializeCompressType::NONE:
-		write_len = 0;
 		break;
 	case SerializeCompressType::SNAPPY:
 		write_len = snappy_max_compressed_length(sz);
-		break;
-	case SerializeCompressType::ZSTD:
-		write_len = ZSTD_compressBound(sz);
-		break;
-	}
-	u8 *compressed_buffer = write_len == 0 ? nullptr : (u8 *)malloc(write_len);
-	u8 *write_buffer = buffer;
-	if (!compressed_buffer) {
-		if (write_len != 0)
-			ERROR_LOG(SAVESTATE, "ChunkReader: Unable to allocate compressed buffer");
-		// We'll save uncompressed.  Better than not saving...
-		write_len = sz;
-		usedType = SerializeCompressType::NONE;
-	} else {
-		bool success = true;
-		switch (usedType) {
-		case SerializeCompressType::NONE:
-			_assert_(false);
-			break;
-		case SerializeCompressType::SNAPPY:
-			success = snappy_compress((const char *)buffer, sz, (char *)compressed_buffer, &write_len) == SNAPPY_OK;
-			break;
-		case SerializeCompressType::ZSTD:
-			{
-				auto ctx = ZSTD_createCCtx();
-				if (!ctx) {
-					success = false;
-				} else {
-					// TODO: If free disk space is low, we could max this out to 22?
-					ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT);
-					ZSTD_CCtx_setParameter(ctx, ZSTD_c_checksumFlag, 1);
-					ZSTD_CCtx_setPledgedSrcSize(ctx, sz);
-					write_len = ZSTD_compress2(ctx, compressed_buffer, write_len, buffer, sz);
-					success = !ZSTD_isError(write_len);
-				}
-				ZSTD_freeCCtx(ctx);
-			}
-			break;
-		}
-
-		if (success) {
-			free(buffer);
-			write_buffer = compressed_buffer;
+		compressBuffer.resize(write_len);
+		if (snappy_compress((const char *)buffer, sz, (char *)compressBuffer.data(), &write_len) == SNAPPY_OK) {
+			write_buffer = compressBuffer.data();
 		} else {
 			ERROR_LOG(SAVESTATE, "ChunkReader: Compression failed");
-			free(compressed_buffer);
-
 			// We can still save uncompressed.
 			write_len = sz;
 			usedType = SerializeCompressType::NONE;
 		}
+		break;
+	case SerializeCompressType::ZSTD:
+		{
+			// The data is written while compressing, so the header gets rewritten once we know the size.
+			if (!pFile.WriteArray(&header, 1) || !pFile.WriteArray(titleFixed, sizeof(titleFixed))) {
+				ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing header");
+				return ERROR_BAD_FILE;
+			}
+
+			ChunkWriteResult result = WriteZstdChunks(pFile, buffer, sz, compressBuffer, &write_len);
+			if (result == ChunkWriteResult::WRITE_FAILED) {
+				ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing compressed data");
+				return ERROR_BAD_FILE;
+			} else if (result == ChunkWriteResult::COMPRESS_FAILED) {
+				ERROR_LOG(SAVESTATE, "ChunkReader: Compression failed");
+				// We can still save uncompressed, but have to start over.
+				if (!pFile.Open(filename, "wb")) {
+					ERROR_LOG(SAVESTATE, "ChunkReader: Error opening file for write");
+					return ERROR_BAD_FILE;
+				}
+				write_len = sz;
+				usedType = SerializeCompressType::NONE;
+			} else {
+				streamed = true;
+			}
+		}
+		break;
 	}
 
-	// Create header
-	SChunkHeader header{};
 	header.Compress = (int)usedType;
-	header.Revision = REVISION_CURRENT;
 	header.ExpectedSize = (u32)write_len;
-	header.UncompressedSize = (u32)sz;
-	truncate_cpy(header.GitVersion, gitVersion);
-
-	// Setup the fixed-length title.
-	char titleFixed[128]{};
-	truncate_cpy(titleFixed, title.c_str());
 
 	// Now let's start writing out the file...
-	if (!pFile.WriteArray(&header, 1)) {
+	if (streamed && !pFile.Seek(0, SEEK_SET)) {
 		ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing header");
-		free(write_buffer);
 		return ERROR_BAD_FILE;
 	}
-	if (!pFile.WriteArray(titleFixed, sizeof(titleFixed))) {
-		ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing title");
-		free(write_buffer);
+	if (!pFile.WriteArray(&header, 1)) {
+		ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing header");
 		return ERROR_BAD_FILE;
 	}
-
-	if (!pFile.WriteBytes(write_buffer, write_len)) {
-		ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing compressed data");
-		free(write_buffer);
-		return ERROR_BAD_FILE;
-	} else if (sz != write_len) {
+	if (!streamed) {
+		if (!pFile.WriteArray(titleFixed, sizeof(titleFixed))) {
+			ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing title");
+			return ERROR_BAD_FILE;
+		}
+		if (!pFile.WriteBytes(write_buffer, write_len)) {
+			ERROR_LOG(SAVESTATE, "ChunkReader: Failed writing compressed data");
+			return ERROR_BAD_FILE;
+		}
+	}
+	if (sz != write_len) {
 		INFO_LOG(SAVESTATE, "Savestate: Compressed %i bytes into %i", (int)sz, (int)write_len);
 	}
-	free(write_buffer);
 
 	INFO_LOG(SAVESTATE, "ChunkReader: Done writing %s", filename.c_str());
 	return ERROR_NONE;
@@ -52,7 +52,7 @@ class PointerWrap;
 class PointerWrapSection
 {
 public:
-	PointerWrapSection(PointerWrap &p, int ver, const char *title) : p_(p), ver_(ver), title_(title) {
+	PointerWrapSection(PointerWrap &p, int ver, const char *title, int statIndex = -1) : p_(p), ver_(ver), title_(title), statIndex_(statIndex) {
 	}
 	~PointerWrapSection();
 	
@@ -71,6 +71,16 @@ class PointerWrapSection
 	PointerWrap &p_;
 	int ver_;
 	const char *title_;
+	int statIndex_;
+};
+
+// Sizes include nested sections. Depth is 0 for the outermost sections.
+struct PointerWrapSectionStat
+{
+	const char *title;
+	int depth;
+	size_t bytes;
+	double seconds;
 };
 
 // Wrapper class
@@ -96,6 +106,11 @@ class PointerWrap
 
 	PointerWrap(u8 **ptr_, Mode mode_) : ptr(ptr_), mode(mode_) {}
 	PointerWrap(unsigned char **ptr_, int mode_) : ptr((u8**)ptr_), mode((Mode)mode_) {}
+	// Writes in one pass, growing buffer as needed. It's never shrunk, so it can be reused for the next save.
+	PointerWrap(std::vector<u8> &buffer) : ptr(&growPtr_), mode(MODE_WRITE), growBuffer_(&buffer) {
+		growPtr_ = buffer.empty() ? nullptr : &buffer[0];
+	}
+	PointerWrap(const PointerWrap &) = delete;
 
 	PointerWrapSection Section(const char *title, int ver);
 
@@ -119,8 +134,35 @@ class PointerWrap
 
 	void DoMarker(const char *prevName, u32 arbitraryNumber = 0x42);
 
+	// Anything writing directly through ptr needs to call this first, in case it's writing to a growable buffer.
+	void Reserve(size_t size) {
+		if (growBuffer_ && mode == MODE_WRITE && (size_t)(growPtr_ - growBuffer_->data()) + size > growBuffer_->size())
+			Grow(size);
+	}
+	// Bytes written so far to a growable buffer.
+	size_t GetGrowOffset() const {
+		return growBuffer_ ? growPtr_ - growBuffer_->data() : 0;
+	}
+
+	// Records the size and time of each section, in the order they start.
+	void SetSectionStats(std::vector<PointerWrapSectionStat> *stats) {
+		sectionStats_ = stats;
+	}
+	void EndSectionStat(int index);
+
 private:
+	void Grow(size_t size);
+	// A growable buffer may move, so offsets are used there.
+	size_t StatPosition() const {
+		return growBuffer_ ? GetGrowOffset() : (size_t)(uintptr_t)*ptr;
+	}
+
 	const char *firstBadSectionTitle_ = nullptr;
+	std::vector<u8> *growBuffer_ = nullptr;
+	u8 *growPtr_ = nullptr;
+	std::vector<PointerWrapSectionStat> *sectionStats_ = nullptr;
+	std::vector<double> sectionStarts_;
+	int sectionDepth_ = 0;
 };
 
 class CChunkFileReader
@@ -179,13 +221,11 @@ class CChunkFileReader
 	{
 		*failureReason = "LoadStateWrongVersion";
 
-		u8 *ptr = nullptr;
-		size_t sz;
-		Error error = LoadFile(filename, gitVersion, ptr, sz, failureReason);
+		LoadedBuffer buffer;
+		Error error = LoadFile(filename, gitVersion, buffer, failureReason);
 		if (error == ERROR_NONE) {
 			failureReason->clear();
-			error = LoadPtr(ptr, _class, failureReason);
-			delete [] ptr;
+			error = LoadPtr(buffer.data, _class, failureReason);
 			INFO_LOG(SAVESTATE, "ChunkReader: Done loading '%s'", filename.c_str());
 		} else {
 			WARN_LOG(SAVESTATE, "ChunkReader: Error found during load of '%s'", filename.c_str());
@@ -193,20 +233,35 @@ class CChunkFileReader
 		return error;
 	}
 
+	// Writes the state in a single pass. buffer only grows, so reusing it avoids allocating.
+	// Its size may be larger than the state afterward, the state's size is returned in size.
+	// With stats, the size and time of each section are recorded too.
+	template<class T>
+	static Error SaveToBuffer(std::vector<u8> &buffer, T &_class, size_t *size, std::vector<PointerWrapSectionStat> *stats = nullptr)
+	{
+		PointerWrap p(buffer);
+		p.SetSectionStats(stats);
+		_class.DoState(p);
+		*size = p.GetGrowOffset();
+
+		if (p.error != p.ERROR_FAILURE) {
+			return ERROR_NONE;
+		} else {
+			return ERROR_BROKEN_STATE;
+		}
+	}
+
 	// Save file template
 	template<class T>
 	static Error Save(const Path &filename, const std::string &title, const char *gitVersion, T& _class)
 	{
-		// Get data
-		size_t const sz = MeasurePtr(_class);
-		u8 *buffer = (u8 *)malloc(sz);
-		if (!buffer)
-			return ERROR_BAD_ALLOC;
-		Error error = SavePtr(buffer, _class, sz);
-
-		// SaveFile takes ownership of buffer
+		// Not kept around after, saves to files are rare and this is as large as the state.
+		std::vector<u8> buffer;
+		size_t sz = 0;
+		Error error = SaveToBuffer(buffer, _class, &sz);
+
 		if (error == ERROR_NONE)
-			error = SaveFile(filename, title, gitVersion, buffer, sz);
+			error = SaveFile(filename, title, gitVersion, buffer.data(), sz);
 		return error;
 	}
 	
@@ -236,6 +291,9 @@ class CChunkFileReader
 
 	static Error GetFileTitle(const Path &filename, std::string *title);
 
+	// Compresses and writes a state from SaveToBuffer(). Safe to call from any thread.
+	static Error SaveFile(const Path &filename, const std::string &title, const char *gitVersion, const u8 *buffer, size_t sz);
+
 private:
 	struct SChunkHeader
 	{
@@ -252,7 +310,19 @@ class CChunkFileReader
 		REVISION_CURRENT = REVISION_TITLE,
 	};
 
-	static Error LoadFile(const Path &filename, std::string *gitVersion, u8 *&buffer, size_t &sz, std::string *failureReason);
-	static Error SaveFile(const Path &filename, const std::string &title, const char *gitVersion, u8 *buffer, size_t sz);
+	// A state loaded from a file. Uncompressed states are read straight from a mapping of the file, if possible.
+	struct LoadedBuffer
+	{
+		LoadedBuffer() {}
+		LoadedBuffer(const LoadedBuffer &) = delete;
+		~LoadedBuffer();
+
+		u8 *data = nullptr;
+		size_t size = 0;
+		void *mapping = nullptr;
+		size_t mappingSize = 0;
+	};
+
+	static Error LoadFile(const Path &filename, std::string *gitVersion, LoadedBuffer &buffer, std::string *failureReason);
 	static Error LoadFileHeader(File::IOFile &pFile, SChunkHeader &header, std::string *title);
 };
@@ -108,6 +108,7 @@ struct Config {
 	bool bIgnoreBadMemAccess;
 
 	bool bFastMemory;
+	bool bHugePageMemory;  // Linux: back PSP memory with transparent huge pages, if possible.
 	int iCpuCore;
 	bool bCheckForNewVersion;
 	bool bForceLagSync;
@@ -116,6 +117,8 @@ struct Config {
 	bool bHideStateWarnings;
 	bool bPreloadFunctions;
 	uint32_t uJitDisableFlags;
+	bool bBlockEntryCounters;
+	bool bIRHotBlockRecompile;  // Experimental, reruns hot IR blocks through the load/store passes.
 
 	bool bSeparateSASThread;
 	int iIOTimingMethod;
@@ -156,6 +159,10 @@ struct Config {
 
 	bool bSoftwareRendering;
 	bool bSoftwareRenderingJit;
+	bool bSoftwareRenderingThread;
+	bool bSoftwareRenderingCoarseDepth;
+	bool bSoftwareRenderingTextureCache;
+	bool bSoftwareRenderingAsyncJit;
 	bool bHardwareTransform; // only used in the GLES backend
 	bool bSoftwareSkinning;  // may speed up some games
 	bool bVendorBugChecksEnabled;
@@ -175,6 +182,7 @@ struct Config {
 	int iFrameSkipType;
 	int iFastForwardMode; // See FastForwardMode in ConfigValues.h.
 	bool bAutoFrameSkip;
+	int iRunAheadFrames;
 
 	bool bEnableCardboardVR; // Cardboard Master Switch
 	int iCardboardScreenSize; // Screen Size (in %)
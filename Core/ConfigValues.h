@@ -34,6 +34,8 @@ enum class CPUCore {
 	INTERPRETER = 0,
 	JIT = 1,
 	IR_JIT = 2,
+	// IR frontend with a native backend, where available (see IRToX86.)
+	JIT_IR = 3,
 };
 
 enum {
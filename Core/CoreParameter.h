@@ -84,6 +84,11 @@ struct CoreParameter {
 	bool freezeNext = false;
 	bool frozen = false;
 
+	// Run-ahead, see RunAhead.h. Set while running frames that will be rolled back, and while rolling back.
+	bool runningAhead = false;
+	// False for frames that shouldn't be shown, like the real frame while running ahead.
+	bool presentFrame = true;
+
 	FileLoader *mountIsoLoader = nullptr;
 
 	Compatibility compat;
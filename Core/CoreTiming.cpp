@@ -15,10 +15,12 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <mutex>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "Common/Profiler/Profiler.h"
@@ -60,16 +62,35 @@ struct BaseEvent {
 	int type;
 };
 
-typedef LinkedListItem<BaseEvent> Event;
+// Events scheduled from other threads wait in a plain list until MoveEvents().
+typedef LinkedListItem<BaseEvent> TsEvent;
+
+// The main queue is a binary min-heap, ordered by time and then by scheduling order.
+// The tie break keeps the firing order identical to a sorted list with FIFO inserts.
+struct Event : public BaseEvent {
+	u64 order;
+	int heapIndex;
+	// Other pending events with the same type and userdata. keyNext also links the free pool.
+	Event *keyNext;
+	Event *keyPrev;
+};
+
+struct EventTypeQueue {
+	// First pending event for each userdata.
+	std::unordered_map<u64, Event *> byUserdata;
+	int count = 0;
+};
+
+static std::vector<Event *> eventHeap;
+static std::vector<EventTypeQueue> eventsByType;
+static u64 nextEventOrder = 0;
 
-Event *first;
-Event *tsFirst;
-Event *tsLast;
+TsEvent *tsFirst;
+TsEvent *tsLast;
 
 // event pools
 Event *eventPool = 0;
-Event *eventTsPool = 0;
-int allocatedTsEvents = 0;
+TsEvent *eventTsPool = 0;
 // Optimization to skip MoveEvents when possible.
 std::atomic<u32> hasTsEvents;
 
@@ -136,33 +157,125 @@ Event* GetNewEvent()
 		return new Event;
 
 	Event* ev = eventPool;
-	eventPool = ev->next;
+	eventPool = ev->keyNext;
 	return ev;
 }
 
-Event* GetNewTsEvent()
+TsEvent* GetNewTsEvent()
 {
-	allocatedTsEvents++;
-
 	if(!eventTsPool)
-		return new Event;
+		return new TsEvent;
 
-	Event* ev = eventTsPool;
+	TsEvent* ev = eventTsPool;
 	eventTsPool = ev->next;
 	return ev;
 }
 
 void FreeEvent(Event* ev)
 {
-	ev->next = eventPool;
+	ev->keyNext = eventPool;
 	eventPool = ev;
 }
 
-void FreeTsEvent(Event* ev)
+void FreeTsEvent(TsEvent* ev)
 {
 	ev->next = eventTsPool;
 	eventTsPool = ev;
-	allocatedTsEvents--;
+}
+
+static inline bool EventBefore(const Event *a, const Event *b) {
+	if (a->time != b->time)
+		return a->time < b->time;
+	return a->order < b->order;
+}
+
+static void HeapSiftUp(int index) {
+	Event *ev = eventHeap[index];
+	while (index > 0) {
+		int parent = (index - 1) / 2;
+		if (!EventBefore(ev, eventHeap[parent]))
+			break;
+		eventHeap[index] = eventHeap[parent];
+		eventHeap[index]->heapIndex = index;
+		index = parent;
+	}
+	eventHeap[index] = ev;
+	ev->heapIndex = index;
+}
+
+static void HeapSiftDown(int index) {
+	Event *ev = eventHeap[index];
+	int size = (int)eventHeap.size();
+	while (true) {
+		int child = index * 2 + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && EventBefore(eventHeap[child + 1], eventHeap[child]))
+			child++;
+		if (!EventBefore(eventHeap[child], ev))
+			break;
+		eventHeap[index] = eventHeap[child];
+		eventHeap[index]->heapIndex = index;
+		index = child;
+	}
+	eventHeap[index] = ev;
+	ev->heapIndex = index;
+}
+
+static void HeapRemove(Event *ev) {
+	int index = ev->heapIndex;
+	Event *last = eventHeap.back();
+	eventHeap.pop_back();
+	if (last == ev)
+		return;
+
+	eventHeap[index] = last;
+	last->heapIndex = index;
+	if (index > 0 && EventBefore(last, eventHeap[(index - 1) / 2]))
+		HeapSiftUp(index);
+	else
+		HeapSiftDown(index);
+}
+
+static void KeyLink(Event *ev) {
+	if ((size_t)ev->type >= eventsByType.size())
+		eventsByType.resize(ev->type + 1);
+	EventTypeQueue &queue = eventsByType[ev->type];
+	Event *&head = queue.byUserdata[ev->userdata];
+	ev->keyPrev = nullptr;
+	ev->keyNext = head;
+	if (head)
+		head->keyPrev = ev;
+	head = ev;
+	queue.count++;
+}
+
+static void KeyUnlink(Event *ev) {
+	EventTypeQueue &queue = eventsByType[ev->type];
+	if (ev->keyNext)
+		ev->keyNext->keyPrev = ev->keyPrev;
+	if (ev->keyPrev) {
+		ev->keyPrev->keyNext = ev->keyNext;
+	} else if (ev->keyNext) {
+		queue.byUserdata[ev->userdata] = ev->keyNext;
+	} else {
+		queue.byUserdata.erase(ev->userdata);
+	}
+	queue.count--;
+}
+
+// Removes from the queue and returns the event to the pool.
+static void RemoveQueuedEvent(Event *ev) {
+	HeapRemove(ev);
+	KeyUnlink(ev);
+	FreeEvent(ev);
+}
+
+// Pending events in firing order, for save states and debugging.
+static std::vector<const Event *> GetSortedEvents() {
+	std::vector<const Event *> sorted(eventHeap.begin(), eventHeap.end());
+	std::sort(sorted.begin(), sorted.end(), &EventBefore);
+	return sorted;
 }
 
 int RegisterEvent(const char *name, TimedCallback callback) {
@@ -208,8 +321,9 @@ void RestoreRegisterEvent(int &event_type, const char *name, TimedCallback callb
 }
 
 void UnregisterAllEvents() {
-	_dbg_assert_msg_(first == nullptr, "Unregistering events with events pending - this isn't good.");
+	_dbg_assert_msg_(eventHeap.empty(), "Unregistering events with events pending - this isn't good.");
 	event_types.clear();
+	eventsByType.clear();
 	usedEventTypes.clear();
 	restoredEventTypes.clear();
 }
@@ -236,14 +350,16 @@ void Shutdown()
 	while(eventPool)
 	{
 		Event *ev = eventPool;
-		eventPool = ev->next;
+		eventPool = ev->keyNext;
 		delete ev;
 	}
+	eventHeap.clear();
+	eventHeap.shrink_to_fit();
 
 	std::lock_guard<std::mutex> lk(externalEventLock);
 	while(eventTsPool)
 	{
-		Event *ev = eventTsPool;
+		TsEvent *ev = eventTsPool;
 		eventTsPool = ev->next;
 		delete ev;
 	}
@@ -265,7 +381,7 @@ u64 GetIdleTicks()
 void ScheduleEvent_Threadsafe(s64 cyclesIntoFuture, int event_type, u64 userdata)
 {
 	std::lock_guard<std::mutex> lk(externalEventLock);
-	Event *ne = GetNewTsEvent();
+	TsEvent *ne = GetNewTsEvent();
 	ne->time = GetTicks() + cyclesIntoFuture;
 	ne->type = event_type;
 	ne->next = 0;
@@ -294,30 +410,27 @@ void ScheduleEvent_Threadsafe_Immediate(int event_type, u64 userdata)
 
 void ClearPendingEvents()
 {
-	while (first)
-	{
-		Event *e = first->next;
-		FreeEvent(first);
-		first = e;
+	for (Event *ev : eventHeap)
+		FreeEvent(ev);
+	eventHeap.clear();
+	for (EventTypeQueue &queue : eventsByType) {
+		queue.byUserdata.clear();
+		queue.count = 0;
 	}
 }
 
-void AddEventToQueue(Event* ne)
+void AddEventToQueue(s64 time, int event_type, u64 userdata)
 {
-	Event* prev = NULL;
-	Event** pNext = &first;
-	for(;;)
-	{
-		Event*& next = *pNext;
-		if(!next || ne->time < next->time)
-		{
-			ne->next = next;
-			next = ne;
-			break;
-		}
-		prev = next;
-		pNext = &prev->next;
-	}
+	_dbg_assert_msg_(event_type >= 0, "Invalid event type %d", event_type);
+	Event *ne = GetNewEvent();
+	ne->time = time;
+	ne->userdata = userdata;
+	ne->type = event_type;
+	ne->order = nextEventOrder++;
+	KeyLink(ne);
+
+	eventHeap.push_back(ne);
+	HeapSiftUp((int)eventHeap.size() - 1);
 }
 
 // This must be run ONLY from within the cpu thread
@@ -325,53 +438,37 @@ void AddEventToQueue(Event* ne)
 // than Advance
 void ScheduleEvent(s64 cyclesIntoFuture, int event_type, u64 userdata)
 {
-	Event *ne = GetNewEvent();
-	ne->userdata = userdata;
-	ne->type = event_type;
-	ne->time = GetTicks() + cyclesIntoFuture;
-	AddEventToQueue(ne);
+	AddEventToQueue(GetTicks() + cyclesIntoFuture, event_type, userdata);
 }
 
 // Returns cycles left in timer.
 s64 UnscheduleEvent(int event_type, u64 userdata)
 {
-	s64 result = 0;
-	if (!first)
-		return result;
-	while(first)
-	{
-		if (first->type == event_type && first->userdata == userdata)
-		{
-			result = first->time - GetTicks();
-
-			Event *next = first->next;
-			FreeEvent(first);
-			first = next;
-		}
-		else
-		{
-			break;
-		}
+	if (event_type < 0 || (size_t)event_type >= eventsByType.size())
+		return 0;
+	EventTypeQueue &queue = eventsByType[event_type];
+	auto it = queue.byUserdata.find(userdata);
+	if (it == queue.byUserdata.end())
+		return 0;
+
+	// If there are several, report the one that would've fired last.
+	const Event *lastEvent = nullptr;
+	Event *ptr = it->second;
+	while (ptr) {
+		if (!lastEvent || EventBefore(lastEvent, ptr))
+			lastEvent = ptr;
+		ptr = ptr->keyNext;
 	}
-	if (!first)
-		return result;
-	Event *prev = first;
-	Event *ptr = prev->next;
-	while (ptr)
-	{
-		if (ptr->type == event_type && ptr->userdata == userdata)
-		{
-			result = ptr->time - GetTicks();
+	s64 result = lastEvent->time - GetTicks();
 
-			prev->next = ptr->next;
-			FreeEvent(ptr);
-			ptr = prev->next;
-		}
-		else
-		{
-			prev = ptr;
-			ptr = ptr->next;
-		}
+	ptr = it->second;
+	queue.byUserdata.erase(it);
+	while (ptr) {
+		Event *next = ptr->keyNext;
+		HeapRemove(ptr);
+		FreeEvent(ptr);
+		queue.count--;
+		ptr = next;
 	}
 
 	return result;
@@ -389,7 +486,7 @@ s64 UnscheduleThreadsafeEvent(int event_type, u64 userdata)
 		{
 			result = tsFirst->time - GetTicks();
 
-			Event *next = tsFirst->next;
+			TsEvent *next = tsFirst->next;
 			FreeTsEvent(tsFirst);
 			tsFirst = next;
 		}
@@ -404,8 +501,8 @@ s64 UnscheduleThreadsafeEvent(int event_type, u64 userdata)
 		return result;
 	}
 
-	Event *prev = tsFirst;
-	Event *ptr = prev->next;
+	TsEvent *prev = tsFirst;
+	TsEvent *ptr = prev->next;
 	while (ptr)
 	{
 		if (ptr->type == event_type && ptr->userdata == userdata)
@@ -434,52 +531,27 @@ void RegisterMHzChangeCallback(MHzChangeCallback callback) {
 
 bool IsScheduled(int event_type)
 {
-	if (!first)
+	if (event_type < 0 || (size_t)event_type >= eventsByType.size())
 		return false;
-	Event *e = first;
-	while (e) {
-		if (e->type == event_type)
-			return true;
-		e = e->next;
-	}
-	return false;
+	return eventsByType[event_type].count != 0;
 }
 
 void RemoveEvent(int event_type)
 {
-	if (!first)
+	if (!IsScheduled(event_type))
 		return;
-	while(first)
-	{
-		if (first->type == event_type)
-		{
-			Event *next = first->next;
-			FreeEvent(first);
-			first = next;
-		}
-		else
-		{
-			break;
-		}
-	}
-	if (!first)
-		return;
-	Event *prev = first;
-	Event *ptr = prev->next;
-	while (ptr)
-	{
-		if (ptr->type == event_type)
-		{
-			prev->next = ptr->next;
+	EventTypeQueue &queue = eventsByType[event_type];
+	for (auto &it : queue.byUserdata) {
+		Event *ptr = it.second;
+		while (ptr) {
+			Event *next = ptr->keyNext;
+			HeapRemove(ptr);
 			FreeEvent(ptr);
-			ptr = prev->next;
-		}
-		else
-		{
-			prev = ptr;
-			ptr = ptr->next;
+			ptr = next;
 		}
 	}
+	queue.byUserdata.clear();
+	queue.count = 0;
 }
 
 void RemoveThreadsafeEvent(int event_type)
@@ -493,7 +565,7 @@ void RemoveThreadsafeEvent(int event_type)
 	{
 		if (tsFirst->type == event_type)
 		{
-			Event *next = tsFirst->next;
+			TsEvent *next = tsFirst->next;
 			FreeTsEvent(tsFirst);
 			tsFirst = next;
 		}
@@ -507,8 +579,8 @@ void RemoveThreadsafeEvent(int event_type)
 		tsLast = NULL;
 		return;
 	}
-	Event *prev = tsFirst;
-	Event *ptr = prev->next;
+	TsEvent *prev = tsFirst;
+	TsEvent *ptr = prev->next;
 	while (ptr)
 	{
 		if (ptr->type == event_type)
@@ -536,16 +608,15 @@ void RemoveAllEvents(int event_type)
 //This raise only the events required while the fifo is processing data
 void ProcessFifoWaitEvents()
 {
-	while (first)
+	while (!eventHeap.empty())
 	{
-		if (first->time <= (s64)GetTicks())
+		Event *evt = eventHeap[0];
+		if (evt->time <= (s64)GetTicks())
 		{
-//			LOG(CPU, "[Scheduler] %s		 (%lld, %lld) ",
-//				first->name ? first->name : "?", (u64)GetTicks(), (u64)first->time);
-			Event* evt = first;
-			first = first->next;
-			event_types[evt->type].callback(evt->userdata, (int)(GetTicks() - evt->time));
-			FreeEvent(evt);
+			// The callback may schedule or unschedule, so take it out of the queue first.
+			BaseEvent fired = *evt;
+			RemoveQueuedEvent(evt);
+			event_types[fired.type].callback(fired.userdata, (int)(GetTicks() - fired.time));
 		}
 		else
 		{
@@ -562,21 +633,12 @@ void MoveEvents()
 	// Move events from async queue into main queue
 	while (tsFirst)
 	{
-		Event *next = tsFirst->next;
-		AddEventToQueue(tsFirst);
+		TsEvent *next = tsFirst->next;
+		AddEventToQueue(tsFirst->time, tsFirst->type, tsFirst->userdata);
+		FreeTsEvent(tsFirst);
 		tsFirst = next;
 	}
 	tsLast = NULL;
-
-	// Move free events to threadsafe pool
-	while(allocatedTsEvents > 0 && eventPool)
-	{
-		Event *ev = eventPool;
-		eventPool = ev->next;
-		ev->next = eventTsPool;
-		eventTsPool = ev;
-		allocatedTsEvents--;
-	}
 }
 
 void ForceCheck()
@@ -603,7 +665,7 @@ void Advance() {
 		MoveEvents();
 	ProcessFifoWaitEvents();
 
-	if (!first) {
+	if (eventHeap.empty()) {
 		// This should never happen in PPSSPP.
 		// WARN_LOG_REPORT(TIME, "WARNING - no events in queue. Setting currentMIPS->downcount to 10000");
 		if (slicelength < 10000) {
@@ -612,7 +674,7 @@ void Advance() {
 		}
 	} else {
 		// Note that events can eat cycles as well.
-		int target = (int)(first->time - globalTimer);
+		int target = (int)(eventHeap[0]->time - globalTimer);
 		if (target > MAX_SLICE_LENGTH)
 			target = MAX_SLICE_LENGTH;
 
@@ -623,11 +685,8 @@ void Advance() {
 }
 
 void LogPendingEvents() {
-	Event *ptr = first;
-	while (ptr) {
-		//INFO_LOG(CPU, "PENDING: Now: %lld Pending: %lld Type: %d", globalTimer, ptr->time, ptr->type);
-		ptr = ptr->next;
-	}
+	//for (const Event *ptr : GetSortedEvents())
+	//	INFO_LOG(CPU, "PENDING: Now: %lld Pending: %lld Type: %d", globalTimer, ptr->time, ptr->type);
 }
 
 void Idle(int maxIdle) {
@@ -635,9 +694,9 @@ void Idle(int maxIdle) {
 	if (maxIdle != 0 && cyclesDown > maxIdle)
 		cyclesDown = maxIdle;
 
-	if (first && cyclesDown > 0) {
+	if (!eventHeap.empty() && cyclesDown > 0) {
 		int cyclesExecuted = slicelength - currentMIPS->downcount;
-		int cyclesNextEvent = (int) (first->time - globalTimer);
+		int cyclesNextEvent = (int) (eventHeap[0]->time - globalTimer);
 
 		if (cyclesNextEvent < cyclesExecuted + cyclesDown)
 			cyclesDown = cyclesNextEvent - cyclesExecuted;
@@ -656,14 +715,12 @@ void Idle(int maxIdle) {
 }
 
 std::string GetScheduledEventsSummary() {
-	Event *ptr = first;
 	std::string text = "Scheduled events\n";
 	text.reserve(1000);
-	while (ptr) {
+	for (const Event *ptr : GetSortedEvents()) {
 		unsigned int t = ptr->type;
 		if (t >= event_types.size()) {
 			_dbg_assert_msg_(false, "Invalid event type %d", t);
-			ptr = ptr->next;
 			continue;
 		}
 		const char *name = event_types[t].name;
@@ -672,7 +729,6 @@ std::string GetScheduledEventsSummary() {
 		char temp[512];
 		sprintf(temp, "%s : %i %08x%08x\n", name, (int)ptr->time, (u32)(ptr->userdata >> 32), (u32)(ptr->userdata));
 		text += temp;
-		ptr = ptr->next;
 	}
 	return text;
 }
@@ -692,6 +748,41 @@ void Event_DoStateOld(PointerWrap &p, BaseEvent *ev)
 	usedEventTypes.insert(ev->type);
 }
 
+// Same layout as DoLinkedList, so the queue is saved in firing order like the old list.
+template <void (*TDo)(PointerWrap &, BaseEvent *)>
+static void DoEventQueue(PointerWrap &p) {
+	if (p.mode == PointerWrap::MODE_READ) {
+		ClearPendingEvents();
+		while (true) {
+			u8 shouldExist = 0;
+			Do(p, shouldExist);
+			if (shouldExist != 1) {
+				if (shouldExist != 0) {
+					WARN_LOG(SAVESTATE, "Savestate failure: incorrect item marker %d", shouldExist);
+					p.SetError(p.ERROR_FAILURE);
+				}
+				break;
+			}
+
+			BaseEvent ev{};
+			TDo(p, &ev);
+			if (p.error == p.ERROR_FAILURE)
+				break;
+			AddEventToQueue(ev.time, ev.type, ev.userdata);
+		}
+		return;
+	}
+
+	for (const Event *ptr : GetSortedEvents()) {
+		u8 shouldExist = 1;
+		Do(p, shouldExist);
+		BaseEvent ev = *ptr;
+		TDo(p, &ev);
+	}
+	u8 shouldExist = 0;
+	Do(p, shouldExist);
+}
+
 void DoState(PointerWrap &p) {
 	std::lock_guard<std::mutex> lk(externalEventLock);
 
@@ -718,10 +809,10 @@ void DoState(PointerWrap &p) {
 	restoredEventTypes.clear();
 
 	if (s >= 3) {
-		DoLinkedList<BaseEvent, GetNewEvent, FreeEvent, Event_DoState>(p, first, (Event **) NULL);
+		DoEventQueue<Event_DoState>(p);
 		DoLinkedList<BaseEvent, GetNewTsEvent, FreeTsEvent, Event_DoState>(p, tsFirst, &tsLast);
 	} else {
-		DoLinkedList<BaseEvent, GetNewEvent, FreeEvent, Event_DoStateOld>(p, first, (Event **) NULL);
+		DoEventQueue<Event_DoStateOld>(p);
 		DoLinkedList<BaseEvent, GetNewTsEvent, FreeTsEvent, Event_DoStateOld>(p, tsFirst, &tsLast);
 	}
 
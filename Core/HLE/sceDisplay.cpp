@@ -39,6 +39,7 @@
 #include "Core/CoreParameter.h"
 #include "Core/Host.h"
 #include "Core/Reporting.h"
+#include "Core/RunAhead.h"
 #include "Core/Core.h"
 #include "Core/System.h"
 #include "Core/HLE/HLE.h"
@@ -526,17 +527,20 @@ double *__DisplayGetFrameTimes(int *out_valid, int *out_pos, double **out_sleep)
 void __DisplayGetDebugStats(char *stats, size_t bufsize) {
 	char statbuf[4096];
 	gpu->GetStats(statbuf, sizeof(statbuf));
+	char runAheadBuf[256] = "";
+	if (g_Config.iRunAheadFrames > 0)
+		RunAhead::GetDebugStats(runAheadBuf, sizeof(runAheadBuf));
 
 	snprintf(stats, bufsize,
 		"Kernel processing time: %0.2f ms\n"
 		"Slowest syscall: %s : %0.2f ms\n"
-		"Most active syscall: %s : %0.2f ms\n%s",
+		"Most active syscall: %s : %0.2f ms\n%s%s",
 		kernelStats.msInSyscalls * 1000.0f,
 		kernelStats.slowestSyscallName ? kernelStats.slowestSyscallName : "(none)",
 		kernelStats.slowestSyscallTime * 1000.0f,
 		kernelStats.summedSlowestSyscallName ? kernelStats.summedSlowestSyscallName : "(none)",
 		kernelStats.summedSlowestSyscallTime * 1000.0f,
-		statbuf);
+		runAheadBuf, statbuf);
 }
 
 
@@ -546,6 +550,9 @@ void __DisplaySetWasPaused() {
 }
 
 static int FrameTimingLimit() {
+	// Frames run ahead are extra work on top of the real one, which is the one that gets timed.
+	if (PSP_CoreParameter().runningAhead)
+		return 0;
 	if (PSP_CoreParameter().fpsLimit == FPSLimit::CUSTOM1)
 		return g_Config.iFpsLimit1;
 	if (PSP_CoreParameter().fpsLimit == FPSLimit::CUSTOM2)
@@ -774,8 +781,10 @@ void __DisplayFlip(int cyclesLate) {
 	const bool fbDirty = gpu->FramebufferDirty();
 
 	if (fbDirty || noRecentFlip || postEffectRequiresFlip) {
+		const bool runningAhead = PSP_CoreParameter().runningAhead;
 		int frameSleepPos = frameTimeHistoryPos;
-		CalculateFPS();
+		if (!runningAhead)
+			CalculateFPS();
 		DisplayFireFlip();
 
 		// Let the user know if we're running slow, so they know to adjust settings.
@@ -816,7 +825,7 @@ void __DisplayFlip(int cyclesLate) {
 		const bool fbReallyDirty = gpu->FramebufferReallyDirty();
 		if (fbReallyDirty || noRecentFlip || postEffectRequiresFlip) {
 			// Check first though, might've just quit / been paused.
-			if (!forceNoFlip && Core_NextFrame()) {
+			if (!forceNoFlip && Core_NextFrame() && PSP_CoreParameter().presentFrame) {
 				gpu->CopyDisplayToOutput(fbReallyDirty);
 				if (fbReallyDirty) {
 					actualFlips++;
@@ -828,8 +837,10 @@ void __DisplayFlip(int cyclesLate) {
 			gpuStats.numFlips++;
 		}
 
-		bool throttle, skipFrame;
-		DoFrameTiming(throttle, skipFrame, (float)numVBlanksSinceFlip * timePerVblank);
+		// RunAhead decides what to skip while running ahead, and the real frame already waited.
+		bool throttle = false, skipFrame = false;
+		if (!runningAhead)
+			DoFrameTiming(throttle, skipFrame, (float)numVBlanksSinceFlip * timePerVblank);
 
 		int maxFrameskip = 8;
 		int frameSkipNum = CalculateFrameSkip();
@@ -841,7 +852,9 @@ void __DisplayFlip(int cyclesLate) {
 			skipFrame = false;
 		}
 
-		if (skipFrame) {
+		if (runningAhead) {
+			// Leave it alone.
+		} else if (skipFrame) {
 			gstate_c.skipDrawReason |= SKIPDRAW_SKIPFRAME;
 			numSkippedFrames++;
 		} else {
@@ -110,6 +110,25 @@ namespace MIPSComp {
 		return true;
 	}
 
+	// For matrix ops that compute one column of d at a time: checks that writing each column
+	// can't clobber anything a later column still reads (all of s, and that column of t.)
+	static bool CanWriteMatrixColumns(int n, const u8 sregs[16], const u8 tregs[16], const u8 dregs[16]) {
+		for (int j = 0; j < n - 1; j++) {
+			for (int i = 0; i < n; i++) {
+				const u8 dreg = dregs[j * 4 + i];
+				for (int k = 0; k < n * 4; k++) {
+					if ((k & 3) < n && sregs[k] == dreg)
+						return false;
+				}
+				for (int k = (j + 1) * 4; k < n * 4; k++) {
+					if ((k & 3) < n && tregs[k] == dreg)
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
 	static bool IsPrefixWithinSize(u32 prefix, VectorSize sz) {
 		int n = GetNumVectorElements(sz);
 		for (int i = n; i < 4; i++) {
@@ -1278,8 +1297,13 @@ namespace MIPSComp {
 		GetMatrixRegs(tregs, sz, vt);
 		GetMatrixRegs(dregs, sz, vd);
 
-		if (soverlap || toverlap) {
-			DISABLE;
+		// When d overlaps, we compute a column at a time into temps. If even that's not safe,
+		// everything goes into temps first.
+		bool overlap = soverlap != OVERLAP_NONE || toverlap != OVERLAP_NONE;
+		if (overlap && !CanWriteMatrixColumns(n, sregs, tregs, dregs)) {
+			if (!CompVmmulStaged(sz, sregs, tregs, dregs))
+				DISABLE;
+			return;
 		}
 
 		// dregs are always consecutive, thanks to our transpose trick.
@@ -1323,13 +1347,60 @@ namespace MIPSComp {
 		int temp1 = IRVTEMP_0 + 1;
 		for (int a = 0; a < n; a++) {
 			for (int b = 0; b < n; b++) {
+				// With overlap, hold the column until it's complete.
+				int dest = overlap ? IRVTEMP_PFX_S + b : dregs[a * 4 + b];
 				ir.Write(IROp::FMul, temp0, sregs[b * 4], tregs[a * 4]);
 				for (int c = 1; c < n; c++) {
 					ir.Write(IROp::FMul, temp1, sregs[b * 4 + c], tregs[a * 4 + c]);
-					ir.Write(IROp::FAdd, (c == n - 1) ? dregs[a * 4 + b] : temp0, temp0, temp1);
+					ir.Write(IROp::FAdd, (c == n - 1) ? dest : temp0, temp0, temp1);
+				}
+			}
+			if (overlap) {
+				for (int b = 0; b < n; b++)
+					ir.Write(IROp::FMov, dregs[a * 4 + b], IRVTEMP_PFX_S + b);
+			}
+		}
+	}
+
+	// vmmul where d overlaps s or t so badly that the whole result has to be computed first.
+	// Uses all 16 vector temps for the result, so not usable with prefixes.
+	bool IRFrontend::CompVmmulStaged(MatrixSize sz, const u8 sregs[16], const u8 tregs[16], const u8 dregs[16]) {
+		int n = GetMatrixSide(sz);
+		const int result = IRVTEMP_PFX_S;
+
+		if (sz == M_4x4) {
+			// No spare temps, so only dots (which need no scratch) can do this.
+			if (!IsConsecutive4(sregs) || !IsConsecutive4(tregs))
+				return false;
+			for (int a = 0; a < 4; a++) {
+				for (int b = 0; b < 4; b++)
+					ir.Write(IROp::Vec4Dot, result + a * 4 + b, sregs[b * 4], tregs[a * 4]);
+			}
+		} else {
+			// At most 9 results, leaving IRVTEMP_0 for scratch.
+			int temp0 = IRVTEMP_0;
+			int temp1 = IRVTEMP_0 + 1;
+			for (int a = 0; a < n; a++) {
+				for (int b = 0; b < n; b++) {
+					ir.Write(IROp::FMul, temp0, sregs[b * 4], tregs[a * 4]);
+					for (int c = 1; c < n; c++) {
+						ir.Write(IROp::FMul, temp1, sregs[b * 4 + c], tregs[a * 4 + c]);
+						ir.Write(IROp::FAdd, (c == n - 1) ? result + a * n + b : temp0, temp0, temp1);
+					}
 				}
 			}
 		}
+
+		const int stride = sz == M_4x4 ? 4 : n;
+		for (int a = 0; a < n; a++) {
+			if (n == 4 && IsConsecutive4(&dregs[a * 4])) {
+				ir.Write(IROp::Vec4Mov, dregs[a * 4], result + a * stride);
+				continue;
+			}
+			for (int b = 0; b < n; b++)
+				ir.Write(IROp::FMov, dregs[a * 4 + b], result + a * stride + b);
+		}
+		return true;
 	}
 
 	void IRFrontend::Comp_Vtfm(MIPSOpcode op) {
@@ -1390,20 +1461,22 @@ namespace MIPSComp {
 			}
 			return;
 		} else if (msz == M_4x4 && IsConsecutive4(sregs)) {
-			// Consecutive, which is harder.
-			DISABLE;
+			// Consecutive rows, so each output is a dot with t.
 			int s0 = IRVTEMP_0;
-			int s1 = IRVTEMP_PFX_S;
-			// Doesn't make complete sense to me why this works.... (because it doesn't.)
-			ir.Write(IROp::Vec4Scale, s0, sregs[0], tregs[0]);
-			for (int i = 1; i < 4; i++) {
-				if (!homogenous || (i != n - 1)) {
-					ir.Write(IROp::Vec4Scale, s1, sregs[i], tregs[i]);
-					ir.Write(IROp::Vec4Add, s0, s0, s1);
-				} else {
-					ir.Write(IROp::Vec4Add, s0, s0, sregs[i]);
+			int t = tregs[0];
+			if (homogenous || !IsConsecutive4(tregs)) {
+				// The dots need t in consecutive regs, with the implied 1 for homogenous.
+				t = IRVTEMP_PFX_T;
+				for (int i = 0; i < 4; i++) {
+					if (homogenous && i == n - 1)
+						ir.Write(IROp::SetConstF, t + i, ir.AddConstantFloat(1.0f));
+					else
+						ir.Write(IROp::FMov, t + i, tregs[i]);
 				}
 			}
+			for (int i = 0; i < 4; i++) {
+				ir.Write(IROp::Vec4Dot, s0 + i, sregs[i * 4], t);
+			}
 			if (IsConsecutive4(dregs)) {
 				ir.Write(IROp::Vec4Mov, dregs[0], s0);
 			} else {
@@ -1449,7 +1522,33 @@ namespace MIPSComp {
 		// To do a full cross product: vcrs tmp1, s, t; vcrs tmp2 t, s; vsub d, tmp1, tmp2;
 		// (or just use vcrsp.)
 
-		DISABLE;
+		VectorSize sz = GetVecSize(op);
+		if (sz != V_Triple)
+			DISABLE;
+
+		u8 sregs[4], tregs[4], dregs[4];
+		GetVectorRegs(sregs, sz, _VS);
+		GetVectorRegs(tregs, sz, _VT);
+		GetVectorRegsPrefixD(dregs, sz, _VD);
+
+		u8 tempregs[4];
+		for (int i = 0; i < 3; ++i) {
+			if (!IsOverlapSafe(dregs[i], 3, sregs, 3, tregs)) {
+				tempregs[i] = IRVTEMP_0 + i;
+			} else {
+				tempregs[i] = dregs[i];
+			}
+		}
+
+		ir.Write(IROp::FMul, tempregs[0], sregs[1], tregs[2]);
+		ir.Write(IROp::FMul, tempregs[1], sregs[2], tregs[0]);
+		ir.Write(IROp::FMul, tempregs[2], sregs[0], tregs[1]);
+
+		for (int i = 0; i < 3; i++) {
+			if (tempregs[i] != dregs[i])
+				ir.Write(IROp::FMov, dregs[i], tempregs[i]);
+		}
+		ApplyPrefixD(dregs, sz);
 	}
 
 	void IRFrontend::Comp_VDet(MIPSOpcode op) {
@@ -1462,7 +1561,26 @@ namespace MIPSComp {
 		// d[0] = s[0]*t[1] - s[1]*t[0]
 		// Note: this operates on two vectors, not a 2x2 matrix.
 
-		DISABLE;
+		// The T prefix is rewritten to swap x and y, just handle the plain case.
+		VectorSize sz = GetVecSize(op);
+		if (sz != V_Pair || js.HasTPrefix())
+			DISABLE;
+
+		u8 sregs[4], tregs[4], dregs[1];
+		GetVectorRegsPrefixS(sregs, sz, _VS);
+		GetVectorRegs(tregs, sz, _VT);
+		GetVectorRegsPrefixD(dregs, V_Single, _VD);
+
+		int temp0 = IRVTEMP_0;
+		int temp1 = IRVTEMP_0 + 1;
+		ir.Write(IROp::FMul, temp0, sregs[0], tregs[1]);
+		ir.Write(IROp::FMul, temp1, sregs[1], tregs[0]);
+		ir.Write(IROp::FSub, temp0, temp0, temp1);
+		// The unused lanes add +0.0, which turns a -0.0 result positive.
+		ir.Write(IROp::SetConstF, temp1, ir.AddConstantFloat(0.0f));
+		ir.Write(IROp::FAdd, dregs[0], temp0, temp1);
+
+		ApplyPrefixD(dregs, V_Single);
 	}
 
 	void IRFrontend::Comp_Vi2x(MIPSOpcode op) {
@@ -1694,7 +1812,44 @@ namespace MIPSComp {
 			ir.Write(IROp::FMul, temp1, sregs[1], tregs[0]);
 			ir.Write(IROp::FSub, tempregs[2], temp0, temp1);
 		} else if (sz == V_Quad) {
-			DISABLE;
+			int temp0 = IRVTEMP_0;
+			int temp1 = IRVTEMP_0 + 1;
+			// Same evaluation order as the interpreter, so the rounding matches.
+			// d[0] = s0*t3 + s1*t2 - s2*t1 + s3*t0
+			ir.Write(IROp::FMul, temp0, sregs[0], tregs[3]);
+			ir.Write(IROp::FMul, temp1, sregs[1], tregs[2]);
+			ir.Write(IROp::FAdd, temp0, temp0, temp1);
+			ir.Write(IROp::FMul, temp1, sregs[2], tregs[1]);
+			ir.Write(IROp::FSub, temp0, temp0, temp1);
+			ir.Write(IROp::FMul, temp1, sregs[3], tregs[0]);
+			ir.Write(IROp::FAdd, tempregs[0], temp0, temp1);
+
+			// d[1] = -s0*t2 + s1*t3 + s2*t0 + s3*t1
+			ir.Write(IROp::FMul, temp0, sregs[1], tregs[3]);
+			ir.Write(IROp::FMul, temp1, sregs[0], tregs[2]);
+			ir.Write(IROp::FSub, temp0, temp0, temp1);
+			ir.Write(IROp::FMul, temp1, sregs[2], tregs[0]);
+			ir.Write(IROp::FAdd, temp0, temp0, temp1);
+			ir.Write(IROp::FMul, temp1, sregs[3], tregs[1]);
+			ir.Write(IROp::FAdd, tempregs[1], temp0, temp1);
+
+			// d[2] = s0*t1 - s1*t0 + s2*t3 + s3*t2
+			ir.Write(IROp::FMul, temp0, sregs[0], tregs[1]);
+			ir.Write(IROp::FMul, temp1, sregs[1], tregs[0]);
+			ir.Write(IROp::FSub, temp0, temp0, temp1);
+			ir.Write(IROp::FMul, temp1, sregs[2], tregs[3]);
+			ir.Write(IROp::FAdd, temp0, temp0, temp1);
+			ir.Write(IROp::FMul, temp1, sregs[3], tregs[2]);
+			ir.Write(IROp::FAdd, tempregs[2], temp0, temp1);
+
+			// d[3] = -s0*t0 - s1*t1 - s2*t2 + s3*t3
+			ir.Write(IROp::FMul, temp0, sregs[0], tregs[0]);
+			ir.Write(IROp::FMul, temp1, sregs[1], tregs[1]);
+			ir.Write(IROp::FAdd, temp0, temp0, temp1);
+			ir.Write(IROp::FMul, temp1, sregs[2], tregs[2]);
+			ir.Write(IROp::FAdd, temp0, temp0, temp1);
+			ir.Write(IROp::FMul, temp1, sregs[3], tregs[3]);
+			ir.Write(IROp::FSub, tempregs[3], temp1, temp0);
 		} else {
 			DISABLE;
 		}
@@ -41,6 +41,12 @@ IRFrontend::IRFrontend(bool startDefaultPrefix) {
 	CBreakPoints::SetSkipFirst(0);
 }
 
+IRFrontend::IRFrontend(const IRFrontend &other) : opts(other.opts) {
+	js.startDefaultPrefix = other.js.startDefaultPrefix;
+	js.hasSetRounding = other.js.hasSetRounding;
+	js.lastSetRounding = other.js.lastSetRounding;
+}
+
 void IRFrontend::DoState(PointerWrap &p) {
 	auto s = p.Section("Jit", 1, 2);
 	if (!s)
@@ -313,6 +319,42 @@ void IRFrontend::DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &m
 		dontLogBlocks--;
 }
 
+void IRFrontend::SimplifyTrace(std::vector<IRInst> &instructions) {
+	IRWriter stitched;
+	for (const IRInst &inst : instructions)
+		stitched.Write(inst);
+
+	static const IRPassFunc passes[] = {
+		&OptimizeFPMoves,
+		&PropagateConstants,
+		&PurgeTemps,
+	};
+	IRWriter simplified;
+	IRApplyPasses(passes, ARRAY_SIZE(passes), stitched, simplified, opts);
+	instructions = simplified.GetInstructions();
+}
+
+bool IRFrontend::OptimizeHotBlock(std::vector<IRInst> &instructions) {
+	IRWriter original;
+	for (const IRInst &inst : instructions)
+		original.Write(inst);
+
+	static const IRPassFunc passes[] = {
+		&ReorderLoadStore,
+		&MergeLoadStore,
+		&PropagateConstants,
+		&PurgeTemps,
+	};
+	IRWriter optimized;
+	IRApplyPasses(passes, ARRAY_SIZE(passes), original, optimized, opts);
+
+	const std::vector<IRInst> &result = optimized.GetInstructions();
+	if (result.size() == instructions.size() && (result.empty() || memcmp(&result[0], &instructions[0], sizeof(IRInst) * result.size()) == 0))
+		return false;
+	instructions = result;
+	return true;
+}
+
 void IRFrontend::Comp_RunBlock(MIPSOpcode op) {
 	// This shouldn't be necessary, the dispatcher should catch us before we get here.
 	ERROR_LOG(JIT, "Comp_RunBlock should never be reached!");
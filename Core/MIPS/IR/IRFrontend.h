@@ -11,6 +11,8 @@ namespace MIPSComp {
 class IRFrontend : public MIPSFrontendInterface {
 public:
 	IRFrontend(bool startDefaultPrefix);
+	// Starts out with the same assumptions and options, to translate on another thread.
+	IRFrontend(const IRFrontend &other);
 	void Comp_Generic(MIPSOpcode op) override;
 
 	void Comp_RunBlock(MIPSOpcode op) override;
@@ -87,8 +89,23 @@ class IRFrontend : public MIPSFrontendInterface {
 	int Replace_fabsf() override;
 	void DoState(PointerWrap &p);
 	bool CheckRounding(u32 blockAddress);  // returns true if we need a do-over
+	// True until the game sets a rounding mode or leaves a prefix at the end of a block.
+	bool IsInInitialState() const {
+		return js.startDefaultPrefix && !js.hasSetRounding;
+	}
+	bool HasSetRounding() const {
+		return js.hasSetRounding != 0;
+	}
+	// For a rounding mode change seen by a copy on another thread.
+	void SetHasSetRounding() {
+		js.hasSetRounding = 1;
+	}
 
 	void DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload);
+	// Reruns the cheap passes over blocks stitched into a trace.
+	void SimplifyTrace(std::vector<IRInst> &instructions);
+	// Runs the passes too expensive for every block. Returns false if nothing changed.
+	bool OptimizeHotBlock(std::vector<IRInst> &instructions);
 
 	void EatPrefix() override {
 		js.EatPrefix();
@@ -123,6 +140,7 @@ class IRFrontend : public MIPSFrontendInterface {
 	// Utilities to reduce duplicated code
 	void CompShiftImm(MIPSOpcode op, IROp shiftType, int sa);
 	void CompShiftVar(MIPSOpcode op, IROp shiftType);
+	bool CompVmmulStaged(MatrixSize sz, const u8 sregs[16], const u8 tregs[16], const u8 dregs[16]);
 
 	void ApplyPrefixST(u8 *vregs, u32 prefix, VectorSize sz, int tempReg);
 	void ApplyPrefixD(const u8 *vregs, VectorSize sz);
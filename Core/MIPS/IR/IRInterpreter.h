@@ -1,9 +1,9 @@
 #pragma once
 
 #include "Common/CommonTypes.h"
+#include "Core/MIPS/IR/IRInst.h"
 
 class MIPSState;
-struct IRInst;
 
 inline static u32 ReverseBits32(u32 v) {
 	// http://graphics.stanford.edu/~seander/bithacks.html#ReverseParallel
@@ -20,4 +20,24 @@ inline static u32 ReverseBits32(u32 v) {
 	return v;
 }
 
+// Used by Vec4Init, Vec4Neg and Vec4Abs, here and in native backends.
+alignas(16) extern const float vec4InitValues[8][4];
+alignas(16) extern const u32 signBits[4];
+alignas(16) extern const u32 noSignMask[4];
+
 u32 IRInterpret(MIPSState *ms, const IRInst *inst, int count);
+
+struct IRThreadedInst;
+// Runs one op and returns the next record, or nullptr once it has exited (with mips->pc set.)
+typedef const IRThreadedInst *(*IRThreadedFunc)(MIPSState *mips, const IRThreadedInst *t);
+
+// Lowered form of an IR block, with the handler for each op resolved ahead of time.
+struct IRThreadedInst {
+	IRThreadedFunc func;
+	IRInst inst;
+};
+
+// Fills count + 1 records, the last one catching blocks that don't exit.
+void IRLowerThreaded(const IRInst *inst, int count, IRThreadedInst *out);
+// Same result as IRInterpret(), but without going through the switch for each op.
+u32 IRInterpretThreaded(MIPSState *ms, const IRThreadedInst *inst);
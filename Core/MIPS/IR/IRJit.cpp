@@ -15,17 +15,24 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
+#include <atomic>
 #include <set>
 
 #include "ext/xxhash.h"
 #include "Common/Profiler/Profiler.h"
 
+#include "Common/File/FileUtil.h"
 #include "Common/Log.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ParallelLoop.h"
 
+#include "Core/Config.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
+#include "Core/Debugger/Breakpoints.h"
+#include "Core/ELF/ParamSFO.h"
 #include "Core/HLE/sceKernelMemory.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/MIPS.h"
@@ -38,9 +45,223 @@
 #include "Core/MIPS/IR/IRInterpreter.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/Reporting.h"
+#include "Core/System.h"
 
 namespace MIPSComp {
 
+#define IR_CACHE_HEADER_MAGIC 0x43425249
+// Bump when IROp values or the meaning of any IR changes.
+#define IR_CACHE_VERSION 1
+
+struct IRCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t disableFlags;
+	uint32_t numBlocks;
+	uint64_t buildHash;
+};
+
+struct IRCacheBlockHeader {
+	uint32_t address;
+	uint32_t size;
+	uint64_t hash;
+	uint32_t numInstructions;
+	uint32_t reserved;
+};
+
+static u64 HashCodeRange(u32 addr, u32 size) {
+	// This is unfortunate.  In case of emuhacks, we have to make a copy.
+	std::vector<u32> buffer;
+	buffer.resize(size / 4);
+	size_t pos = 0;
+	for (u32 off = 0; off < size; off += 4) {
+		// Let's actually hash the replacement, if any.
+		MIPSOpcode instr = Memory::ReadUnchecked_Instruction(addr + off, false);
+		buffer[pos++] = instr.encoding;
+	}
+
+	return XXH3_64bits(&buffer[0], size);
+}
+
+static IRDiskCache diskCache;
+// Per boot rather than per jit, which is recreated on savestate loads.
+static int coldCompiles = 0;
+static bool coldCompilesReported = false;
+
+u64 IRDiskCache::GetBuildHash() {
+	return XXH3_64bits(PPSSPP_GIT_VERSION, strlen(PPSSPP_GIT_VERSION));
+}
+
+void IRDiskCache::Load(const Path &filename, u32 disableFlags) {
+	Clear();
+	path_ = filename;
+	disableFlags_ = disableFlags;
+
+	std::string data;
+	if (!File::ReadFileToString(false, filename, data))
+		return;
+
+	if (!LoadFromString(data, disableFlags, GetBuildHash())) {
+		WARN_LOG(JIT, "Incompatible IR block cache - rebuilding.");
+		File::Delete(filename);
+	} else {
+		INFO_LOG(JIT, "Loaded IR block cache with %d blocks.", GetNumBlocks());
+	}
+}
+
+void IRDiskCache::Save() const {
+	if (!path_.Valid())
+		return;
+
+	if (!File::WriteStringToFile(false, SaveToString(disableFlags_, GetBuildHash()), path_)) {
+		ERROR_LOG(JIT, "Failed to write IR block cache, disk full?");
+		File::Delete(path_);
+	} else {
+		NOTICE_LOG(JIT, "Saved %d blocks to the IR block cache", GetNumBlocks());
+	}
+}
+
+void IRDiskCache::Clear() {
+	blocks_.clear();
+	path_ = Path();
+	disableFlags_ = 0;
+}
+
+bool IRDiskCache::LoadFromString(const std::string &data, u32 disableFlags, u64 buildHash) {
+	blocks_.clear();
+
+	size_t pos = 0;
+	auto read = [&](void *dest, size_t size) {
+		if (data.size() - pos < size)
+			return false;
+		memcpy(dest, data.data() + pos, size);
+		pos += size;
+		return true;
+	};
+
+	IRCacheHeader header{};
+	bool success = read(&header, sizeof(header));
+	success = success && header.magic == IR_CACHE_HEADER_MAGIC && header.version == IR_CACHE_VERSION;
+	// Changing these changes what the frontend generates.
+	success = success && header.disableFlags == disableFlags && header.buildHash == buildHash;
+
+	for (uint32_t i = 0; success && i < header.numBlocks; ++i) {
+		IRCacheBlockHeader blockHeader;
+		if (!read(&blockHeader, sizeof(blockHeader)) || blockHeader.numInstructions == 0 || blockHeader.numInstructions > 0xFFFF) {
+			success = false;
+			break;
+		}
+
+		Block block;
+		block.size = blockHeader.size;
+		block.hash = blockHeader.hash;
+		block.instructions.resize(blockHeader.numInstructions);
+		if (!read(&block.instructions[0], sizeof(IRInst) * blockHeader.numInstructions)) {
+			success = false;
+			break;
+		}
+		for (const IRInst &inst : block.instructions) {
+			if (!GetIRMeta(inst.op))
+				success = false;
+		}
+		std::vector<Block> &variants = blocks_[blockHeader.address];
+		if ((int)variants.size() < IR_DISK_CACHE_MAX_VARIANTS)
+			variants.push_back(std::move(block));
+	}
+
+	if (!success)
+		blocks_.clear();
+	return success;
+}
+
+std::string IRDiskCache::SaveToString(u32 disableFlags, u64 buildHash) const {
+	IRCacheHeader header{};
+	header.magic = IR_CACHE_HEADER_MAGIC;
+	header.version = IR_CACHE_VERSION;
+	header.disableFlags = disableFlags;
+	header.buildHash = buildHash;
+	header.numBlocks = (uint32_t)GetNumBlocks();
+
+	std::string data;
+	data.append((const char *)&header, sizeof(header));
+	for (const auto &it : blocks_) {
+		for (const Block &block : it.second) {
+			IRCacheBlockHeader blockHeader{};
+			blockHeader.address = it.first;
+			blockHeader.size = block.size;
+			blockHeader.hash = block.hash;
+			blockHeader.numInstructions = (uint32_t)block.instructions.size();
+			data.append((const char *)&blockHeader, sizeof(blockHeader));
+			data.append((const char *)&block.instructions[0], sizeof(IRInst) * block.instructions.size());
+		}
+	}
+	return data;
+}
+
+void IRDiskCache::Add(const IRBlock &b) {
+	u32 start, size;
+	b.GetRange(start, size);
+	std::vector<Block> &variants = blocks_[start];
+	for (size_t i = 0; i < variants.size(); ++i) {
+		if (variants[i].hash == b.GetHash() && variants[i].size == size) {
+			// Still in use, so it goes to the front.
+			std::rotate(variants.begin(), variants.begin() + i, variants.begin() + i + 1);
+			return;
+		}
+	}
+
+	Block block;
+	block.size = size;
+	block.hash = b.GetHash();
+	block.instructions.assign(b.GetInstructions(), b.GetInstructions() + b.GetNumInstructions());
+	// Newest first, the oldest variant is the most likely to be stale.
+	variants.insert(variants.begin(), std::move(block));
+	if ((int)variants.size() > IR_DISK_CACHE_MAX_VARIANTS)
+		variants.resize(IR_DISK_CACHE_MAX_VARIANTS);
+}
+
+bool IRDiskCache::Find(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes) const {
+	auto it = blocks_.find(em_address);
+	if (it == blocks_.end())
+		return false;
+
+	for (const Block &block : it->second) {
+		if (!Memory::IsValidRange(em_address, block.size))
+			continue;
+		// The frontend would've added breakpoint checks, which aren't in the cache.
+		if (CBreakPoints::RangeContainsBreakPoint(em_address, block.size) || CBreakPoints::HasMemChecks())
+			return false;
+		if (HashCodeRange(em_address, block.size) == block.hash) {
+			instructions = block.instructions;
+			mipsBytes = block.size;
+			return true;
+		}
+	}
+	return false;
+}
+
+int IRDiskCache::GetNumBlocks() const {
+	int count = 0;
+	for (const auto &it : blocks_)
+		count += (int)it.second.size();
+	return count;
+}
+
+void IRJitBoot(const std::string &discID) {
+	coldCompiles = 0;
+	coldCompilesReported = false;
+	diskCache.Clear();
+	if (!discID.empty() && !(g_Config.uJitDisableFlags & (uint32_t)JitDisable::IR_DISK_CACHE)) {
+		File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
+		diskCache.Load(GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".irblockcache"), g_Config.uJitDisableFlags);
+	}
+}
+
+void IRJitShutdown() {
+	diskCache.Save();
+	diskCache.Clear();
+}
+
 IRJit::IRJit(MIPSState *mipsState) : frontend_(mipsState->HasDefaultPrefix()), mips_(mipsState) {
 	// u32 size = 128 * 1024;
 	// blTrampolines_ = kernelMemory.Alloc(size, true, "trampoline");
@@ -50,9 +271,45 @@ IRJit::IRJit(MIPSState *mipsState) : frontend_(mipsState->HasDefaultPrefix()), m
 	opts.disableFlags = g_Config.uJitDisableFlags;
 	opts.unalignedLoadStore = opts.disableFlags & (uint32_t)JitDisable::LSU_UNALIGNED;
 	frontend_.SetOptions(opts);
+	useTraces_ = !jo.Disabled(JitDisable::IR_TRACES);
+	// Opt in, the load/store passes were off for a long time.
+	useTiering_ = g_Config.bIRHotBlockRecompile && !jo.Disabled(JitDisable::IR_TIERING);
+	useDiskCache_ = diskCache.IsEnabled() && diskCache.GetDisableFlags() == jo.disableFlags;
 }
 
 IRJit::~IRJit() {
+	// Only kept in memory here, this also happens on every savestate load.
+	if (useDiskCache_)
+		AddBlocksToDiskCache();
+}
+
+static bool IsCacheableBlock(const IRBlock &b) {
+	if (b.IsTrace() || b.GetNumInstructions() == 0)
+		return false;
+	for (int i = 0; i < b.GetNumInstructions(); ++i) {
+		IROp op = b.GetInstructions()[i].op;
+		// These depend on debugger state, not just the code.
+		if (op == IROp::Breakpoint || op == IROp::MemoryCheck)
+			return false;
+	}
+	return true;
+}
+
+void IRJit::AddBlocksToDiskCache() {
+	// Blocks were translated with assumptions about rounding and prefixes that might not hold next time.
+	if (!frontend_.IsInInitialState())
+		return;
+
+	blocks_.IterateValidBlocks([&](const IRBlock &b) {
+		if (IsCacheableBlock(b))
+			diskCache.Add(b);
+	});
+}
+
+bool IRJit::FindDiskCacheBlock(const IRFrontend &frontend, u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes) {
+	if (!useDiskCache_ || !frontend.IsInInitialState())
+		return false;
+	return diskCache.Find(em_address, instructions, mipsBytes);
 }
 
 void IRJit::DoState(PointerWrap &p) {
@@ -64,6 +321,8 @@ void IRJit::UpdateFCR31() {
 
 void IRJit::ClearCache() {
 	INFO_LOG(JIT, "IRJit: Clearing the cache!");
+	if (useDiskCache_)
+		AddBlocksToDiskCache();
 	blocks_.Clear();
 }
 
@@ -88,11 +347,21 @@ void IRJit::Compile(u32 em_address) {
 		}
 	}
 
+	// How well preloading works is measured by how many blocks still get compiled cold early on.
+	if (!coldCompilesReported) {
+		if (CoreTiming::GetGlobalTimeUs() < 60 * 1000 * 1000) {
+			coldCompiles++;
+		} else {
+			NOTICE_LOG(JIT, "IRJit: %d cold block compiles in the first 60 seconds", coldCompiles);
+			coldCompilesReported = true;
+		}
+	}
+
 	std::vector<IRInst> instructions;
 	u32 mipsBytes;
 	if (!CompileBlock(em_address, instructions, mipsBytes, false)) {
-		// Ran out of block numbers - need to reset.
-		ERROR_LOG(JIT, "Ran out of block numbers, clearing cache");
+		// Ran out of block numbers or code space - need to reset.
+		ERROR_LOG(JIT, "Ran out of block numbers or code space, clearing cache");
 		ClearCache();
 		CompileBlock(em_address, instructions, mipsBytes, false);
 	}
@@ -105,7 +374,12 @@ void IRJit::Compile(u32 em_address) {
 }
 
 bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload) {
-	frontend_.DoJit(em_address, instructions, mipsBytes, preload);
+	if (!FindDiskCacheBlock(frontend_, em_address, instructions, mipsBytes))
+		frontend_.DoJit(em_address, instructions, mipsBytes, preload);
+	return AddBlock(em_address, instructions, mipsBytes, preload);
+}
+
+bool IRJit::AddBlock(u32 em_address, const std::vector<IRInst> &instructions, u32 mipsBytes, bool preload) {
 	if (instructions.empty()) {
 		_dbg_assert_(preload);
 		// We return true when preloading so it doesn't abort.
@@ -121,11 +395,18 @@ bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32
 	IRBlock *b = blocks_.GetBlock(block_num);
 	b->SetInstructions(instructions);
 	b->SetOriginalSize(mipsBytes);
+	if (!CompileTargetBlock(b, block_num, preload)) {
+		// Out of code space.  Caller will handle.
+		return false;
+	}
 	if (preload) {
 		// Hash, then only update page stats, don't link yet.
 		b->UpdateHash();
 		blocks_.FinalizeBlock(block_num, true);
 	} else {
+		// The disk cache needs the hash from before the emuhack is written.
+		if (useDiskCache_)
+			b->UpdateHash();
 		// Overwrites the first instruction, and also updates stats.
 		// TODO: Should we always hash?  Then we can reuse blocks.
 		blocks_.FinalizeBlock(block_num);
@@ -139,7 +420,45 @@ void IRJit::CompileFunction(u32 start_address, u32 length) {
 
 	// Note: we don't actually write emuhacks yet, so we can validate hashes.
 	// This way, if the game changes the code afterward, we'll catch even without icache invalidation.
+	std::vector<TranslatedBlock> translated;
+	TranslateFunction(frontend_, start_address, length, translated);
+	AddFunctionBlocks(translated);
+}
+
+void IRJit::CompileFunctions(const std::vector<std::pair<u32, u32>> &ranges, const std::function<void(int, int)> &progress) {
+	PROFILE_THIS_SCOPE("jitc");
 
+	const int count = (int)ranges.size();
+	std::vector<std::vector<TranslatedBlock>> translated(count);
+	std::atomic<int> done{};
+
+	// Translation and the IR passes only read PSP memory and the block cache, which stay put while we wait.
+	// Each chunk gets its own frontend, since it keeps state while compiling.
+	std::atomic<bool> sawRounding{};
+	ParallelRangeLoop(&g_threadManager, [&](int l, int h) {
+		IRFrontend frontend(frontend_);
+		for (int i = l; i < h; ++i) {
+			TranslateFunction(frontend, ranges[i].first, ranges[i].second, translated[i]);
+			int n = ++done;
+			if (progress && (n & 63) == 0)
+				progress(n, count);
+		}
+		if (frontend.HasSetRounding())
+			sawRounding = true;
+	}, 0, count, 16);
+	if (sawRounding)
+		frontend_.SetHasSetRounding();
+
+	// Allocating blocks and emitting code stays in order, same as compiling one function at a time.
+	for (int i = 0; i < count; ++i) {
+		if (!AddFunctionBlocks(translated[i]))
+			break;
+	}
+	if (progress)
+		progress(count, count);
+}
+
+void IRJit::TranslateFunction(IRFrontend &frontend, u32 start_address, u32 length, std::vector<TranslatedBlock> &blocks) {
 	// We may go up and down from branches, so track all block starts done here.
 	std::set<u32> doneAddresses;
 	std::vector<u32> pendingAddresses;
@@ -155,18 +474,13 @@ void IRJit::CompileFunction(u32 start_address, u32 length) {
 			continue;
 		}
 
-		std::vector<IRInst> instructions;
-		u32 mipsBytes;
-		if (!CompileBlock(em_address, instructions, mipsBytes, true)) {
-			// Ran out of block numbers - let's hope there's no more code it needs to run.
-			// Will flush when actually compiling.
-			ERROR_LOG(JIT, "Ran out of block numbers while compiling function");
-			return;
-		}
-
+		TranslatedBlock block;
+		block.em_address = em_address;
+		if (!FindDiskCacheBlock(frontend, em_address, block.instructions, block.mipsBytes))
+			frontend.DoJit(em_address, block.instructions, block.mipsBytes, true);
 		doneAddresses.insert(em_address);
 
-		for (const IRInst &inst : instructions) {
+		for (const IRInst &inst : block.instructions) {
 			u32 exit = 0;
 
 			switch (inst.op) {
@@ -201,10 +515,23 @@ void IRJit::CompileFunction(u32 start_address, u32 length) {
 		}
 
 		// Also include after the block for jal returns.
-		if (em_address + mipsBytes < start_address + length) {
-			pendingAddresses.push_back(em_address + mipsBytes);
+		if (em_address + block.mipsBytes < start_address + length) {
+			pendingAddresses.push_back(em_address + block.mipsBytes);
+		}
+		blocks.push_back(std::move(block));
+	}
+}
+
+bool IRJit::AddFunctionBlocks(const std::vector<TranslatedBlock> &blocks) {
+	for (const TranslatedBlock &block : blocks) {
+		if (!AddBlock(block.em_address, block.instructions, block.mipsBytes, true)) {
+			// Ran out of block numbers or code space - let's hope there's no more code it needs to run.
+			// Will flush when actually compiling.
+			ERROR_LOG(JIT, "Ran out of block numbers or code space while compiling function");
+			return false;
 		}
 	}
+	return true;
 }
 
 void IRJit::RunLoopUntil(u64 globalticks) {
@@ -226,7 +553,13 @@ void IRJit::RunLoopUntil(u64 globalticks) {
 			if (opcode == MIPS_EMUHACK_OPCODE) {
 				u32 data = inst & 0xFFFFFF;
 				IRBlock *block = blocks_.GetBlock(data);
-				mips_->pc = IRInterpret(mips_, block->GetInstructions(), block->GetNumInstructions());
+				mips_->pc = IRInterpretThreaded(mips_, block->GetThreadedInstructions());
+				// Both of these may allocate blocks, so block can't be used after.
+				// Always counted, the stats use it to weigh blocks.
+				if (block->CountEntry() && useTiering_)
+					PromoteBlock(data);
+				else if (useTraces_ && block->RecordExit(mips_->pc))
+					BuildTrace(data);
 				if (!Memory::IsValidAddress(mips_->pc)) {
 					Core_ExecException(mips_->pc, mips_->pc, ExecExceptionType::JUMP);
 					break;
@@ -242,6 +575,139 @@ void IRJit::RunLoopUntil(u64 globalticks) {
 	// RestoreRoundingMode(true);
 }
 
+static bool IsTraceBarrier(IROp op) {
+	switch (op) {
+	case IROp::Syscall:
+	case IROp::CallReplacement:
+	case IROp::Break:
+	case IROp::Breakpoint:
+	case IROp::MemoryCheck:
+	case IROp::ExitToPC:
+	case IROp::ExitToReg:
+		// These may switch threads or stop the core, so the block must return to the dispatcher.
+		return true;
+	default:
+		return false;
+	}
+}
+
+static IROp InvertExitCondition(IROp op) {
+	switch (op) {
+	case IROp::ExitToConstIfEq: return IROp::ExitToConstIfNeq;
+	case IROp::ExitToConstIfNeq: return IROp::ExitToConstIfEq;
+	case IROp::ExitToConstIfGtZ: return IROp::ExitToConstIfLeZ;
+	case IROp::ExitToConstIfLeZ: return IROp::ExitToConstIfGtZ;
+	case IROp::ExitToConstIfGeZ: return IROp::ExitToConstIfLtZ;
+	case IROp::ExitToConstIfLtZ: return IROp::ExitToConstIfGeZ;
+	default: return IROp::Nop;
+	}
+}
+
+// Appends a block so that it falls through to next instead of exiting there.
+// Its other exits stay as side exits. Returns false (and appends nothing) if that isn't possible.
+static bool AppendFallthrough(const IRInst *insts, int count, u32 next, std::vector<IRInst> &out) {
+	if (count < 1 || insts[count - 1].op != IROp::ExitToConst)
+		return false;
+	for (int i = 0; i < count - 1; ++i) {
+		if (IsTraceBarrier(insts[i].op))
+			return false;
+	}
+
+	const IRInst &last = insts[count - 1];
+	if (last.constant == next) {
+		// Taken branch or jump, just drop the exit.
+		out.insert(out.end(), insts, insts + count - 1);
+		return true;
+	}
+
+	// A branch that's usually not taken looks like ExitToConstIfX next, ExitToConst target.
+	// Likely branches have the delay slot between, so they won't match.
+	if (count >= 2 && insts[count - 2].constant == next) {
+		IRInst cond = insts[count - 2];
+		IROp inverted = InvertExitCondition(cond.op);
+		if (inverted == IROp::Nop)
+			return false;
+		out.insert(out.end(), insts, insts + count - 2);
+		cond.op = inverted;
+		cond.constant = last.constant;
+		out.push_back(cond);
+		return true;
+	}
+	return false;
+}
+
+void IRJit::BuildTrace(int head_num) {
+	if (blocks_.GetBlock(head_num)->IsTrace())
+		return;
+	if (((blocks_.GetNumBlocks() + 1) & ~MIPS_EMUHACK_VALUE_MASK) != 0)
+		return;
+
+	std::vector<IRInst> instructions;
+	std::vector<int> chain;
+	int num = head_num;
+	while (num != -1) {
+		const IRBlock *b = blocks_.GetBlock(num);
+		chain.push_back(num);
+
+		int nextNum = -1;
+		u32 next = b->GetHotExit();
+		if (next != 0 && (int)chain.size() < IR_TRACE_MAX_BLOCKS && (int)instructions.size() + b->GetNumInstructions() < IR_TRACE_MAX_INSTS) {
+			nextNum = blocks_.GetBlockNumAt(next);
+			if (nextNum != -1 && (blocks_.GetBlock(nextNum)->IsTrace() || std::find(chain.begin(), chain.end(), nextNum) != chain.end()))
+				nextNum = -1;
+		}
+
+		if (nextNum == -1 || !AppendFallthrough(b->GetInstructions(), b->GetNumInstructions(), next, instructions)) {
+			// This is the last block in the trace, all its exits go back to the dispatcher.
+			instructions.insert(instructions.end(), b->GetInstructions(), b->GetInstructions() + b->GetNumInstructions());
+			nextNum = -1;
+		}
+		num = nextNum;
+	}
+
+	if (chain.size() < 2)
+		return;
+
+	// Now constants and temps can be tracked across the old block boundaries.
+	frontend_.SimplifyTrace(instructions);
+
+	u32 headStart, headSize;
+	blocks_.GetBlock(head_num)->GetRange(headStart, headSize);
+	int trace_num = blocks_.AllocateBlock(headStart);
+	IRBlock *trace = blocks_.GetBlock(trace_num);
+	trace->SetInstructions(instructions);
+	trace->SetOriginalSize(headSize);
+	trace->SetTraceHead(head_num);
+	for (size_t i = 1; i < chain.size(); ++i) {
+		u32 start, size;
+		blocks_.GetBlock(chain[i])->GetRange(start, size);
+		trace->AddTraceRange(start, size);
+	}
+	if (!CompileTargetBlock(trace, trace_num, false)) {
+		ERROR_LOG(JIT, "Ran out of code space building trace, clearing cache");
+		ClearCache();
+		return;
+	}
+
+	// Takes over the head block's emuhack. Its original op is still found through the head block.
+	blocks_.FinalizeBlock(trace_num);
+	DEBUG_LOG(JIT, "IRJit: Built trace %d at %08x from %d blocks, %d IR instructions", trace_num, headStart, (int)chain.size(), (int)instructions.size());
+}
+
+void IRJit::PromoteBlock(int block_num) {
+	IRBlock *b = blocks_.GetBlock(block_num);
+	std::vector<IRInst> instructions(b->GetInstructions(), b->GetInstructions() + b->GetNumInstructions());
+	if (!frontend_.OptimizeHotBlock(instructions))
+		return;
+
+	b->SetInstructions(instructions);
+	// The old native code (if any) is just abandoned, the cache is cleared when space runs out.
+	if (!CompileTargetBlock(b, block_num, false)) {
+		ERROR_LOG(JIT, "Ran out of code space recompiling a hot block, clearing cache");
+		ClearCache();
+	}
+}
+
 bool IRJit::DescribeCodePtr(const u8 *ptr, std::string &name) {
 	// Used in target disassembly viewer.
 	return false;
@@ -265,26 +731,25 @@ void IRBlockCache::Clear() {
 		blocks_[i].Destroy(i);
 	}
 	blocks_.clear();
-	byPage_.clear();
+	byPage_.Clear();
 }
 
 void IRBlockCache::InvalidateICache(u32 address, u32 length) {
-	u32 startPage = AddressToPage(address);
-	u32 endPage = AddressToPage(address + length);
-
-	for (u32 page = startPage; page <= endPage; ++page) {
-		const auto iter = byPage_.find(page);
-		if (iter == byPage_.end())
-			continue;
-
-		const std::vector<int> &blocksInPage = iter->second;
-		for (int i : blocksInPage) {
-			if (blocks_[i].OverlapsRange(address, length)) {
-				// Not removing from the page, hopefully doesn't build up with small recompiles.
-				blocks_[i].Destroy(i);
+	// Doesn't modify byPage_, so it's safe to destroy while visiting.
+	byPage_.ForEachInPages(address, address + length, [&](int i) {
+		if (blocks_[i].OverlapsRange(address, length)) {
+			bool wasLiveTrace = blocks_[i].IsTrace() && blocks_[i].IsValid();
+			// Not removing from the page, hopefully doesn't build up with small recompiles.
+			blocks_[i].Destroy(i);
+
+			int head = blocks_[i].GetTraceHead();
+			if (wasLiveTrace && blocks_[head].IsValid()) {
+				// The head block may still be fine, put it back and let it build a new trace.
+				blocks_[head].Finalize(head);
+				blocks_[head].ResetHotExit();
 			}
 		}
-	}
+	});
 }
 
 void IRBlockCache::FinalizeBlock(int i, bool preload) {
@@ -294,39 +759,45 @@ void IRBlockCache::FinalizeBlock(int i, bool preload) {
 
 	u32 startAddr, size;
 	blocks_[i].GetRange(startAddr, size);
-
-	u32 startPage = AddressToPage(startAddr);
-	u32 endPage = AddressToPage(startAddr + size);
-
-	for (u32 page = startPage; page <= endPage; ++page) {
-		byPage_[page].push_back(i);
+	AddToPages(i, startAddr, size);
+	for (const IRBlockRange &range : blocks_[i].GetTraceRanges()) {
+		AddToPages(i, range.start, range.size);
 	}
 }
 
-u32 IRBlockCache::AddressToPage(u32 addr) const {
-	// Use relatively small pages since basic blocks are typically small.
-	return (addr & 0x3FFFFFFF) >> 10;
+void IRBlockCache::AddToPages(int i, u32 startAddr, u32 size) {
+	// Includes the page of the end address, like the lookups do.
+	byPage_.Add(startAddr, size + 1, i);
 }
 
 int IRBlockCache::FindPreloadBlock(u32 em_address) {
-	u32 page = AddressToPage(em_address);
-	auto iter = byPage_.find(page);
-	if (iter == byPage_.end())
-		return -1;
-
-	const std::vector<int> &blocksInPage = iter->second;
-	for (int i : blocksInPage) {
+	int found = -1;
+	byPage_.ForEachInPages(em_address, em_address, [&](int i) {
+		if (found != -1)
+			return;
 		u32 start, mipsBytes;
 		blocks_[i].GetRange(start, mipsBytes);
 
 		if (start == em_address) {
 			if (blocks_[i].HashMatches()) {
-				return i;
+				found = i;
 			}
 		}
-	}
+	});
 
-	return -1;
+	return found;
+}
+
+int IRBlockCache::GetBlockNumAt(u32 em_address) const {
+	if (!Memory::IsValidAddress(em_address))
+		return -1;
+	u32 inst = Memory::ReadUnchecked_U32(em_address);
+	if ((inst & 0xFF000000) != MIPS_EMUHACK_OPCODE)
+		return -1;
+	int i = inst & 0xFFFFFF;
+	if (i >= (int)blocks_.size() || !blocks_[i].IsValid())
+		return -1;
+	return i;
 }
 
 std::vector<u32> IRBlockCache::SaveAndClearEmuHackOps() {
@@ -406,6 +877,17 @@ void IRBlockCache::ComputeStats(BlockCacheStats &bcStats) const {
 		}
 		totalBloat += bloat;
 		bcStats.bloatMap[bloat] = origAddr;
+		if (b.GetEntryCount() != 0 && b.IsValid())
+			AddHotBlockStat(bcStats, { origAddr, mipsBytes, b.GetEntryCount() });
+
+		const IRInst *instructions = b.GetInstructions();
+		for (int i = 0; i < b.GetNumInstructions(); ++i) {
+			if (instructions[i].op != IROp::Interpret)
+				continue;
+			BlockCacheFallbackStat &fallback = bcStats.fallbacks[MIPSGetName(MIPSOpcode(instructions[i].constant))];
+			fallback.sites++;
+			fallback.executions += b.GetEntryCount();
+		}
 	}
 	bcStats.numBlocks = (int)blocks_.size();
 	bcStats.minBloat = minBloat;
@@ -414,24 +896,18 @@ void IRBlockCache::ComputeStats(BlockCacheStats &bcStats) const {
 }
 
 int IRBlockCache::GetBlockNumberFromStartAddress(u32 em_address, bool realBlocksOnly) const {
-	u32 page = AddressToPage(em_address);
-
-	const auto iter = byPage_.find(page);
-	if (iter == byPage_.end())
-		return -1;
-
-	const std::vector<int> &blocksInPage = iter->second;
 	int best = -1;
-	for (int i : blocksInPage) {
+	bool bestValid = false;
+	byPage_.ForEachInPages(em_address, em_address, [&](int i) {
+		if (bestValid)
+			return;
 		uint32_t start, size;
 		blocks_[i].GetRange(start, size);
 		if (start == em_address) {
 			best = i;
-			if (blocks_[i].IsValid()) {
-				return i;
-			}
+			bestValid = blocks_[i].IsValid();
 		}
-	}
+	});
 	return best;
 }
 
@@ -471,17 +947,7 @@ void IRBlock::Destroy(int number) {
 
 u64 IRBlock::CalculateHash() const {
 	if (origAddr_) {
-		// This is unfortunate.  In case of emuhacks, we have to make a copy.
-		std::vector<u32> buffer;
-		buffer.resize(origSize_ / 4);
-		size_t pos = 0;
-		for (u32 off = 0; off < origSize_; off += 4) {
-			// Let's actually hash the replacement, if any.
-			MIPSOpcode instr = Memory::ReadUnchecked_Instruction(origAddr_ + off, false);
-			buffer[pos++] = instr.encoding;
-		}
-
-		return XXH3_64bits(&buffer[0], origSize_);
+		return HashCodeRange(origAddr_, origSize_);
 	}
 
 	return 0;
@@ -490,7 +956,14 @@ u64 IRBlock::CalculateHash() const {
 bool IRBlock::OverlapsRange(u32 addr, u32 size) const {
 	addr &= 0x3FFFFFFF;
 	u32 origAddr = origAddr_ & 0x3FFFFFFF;
-	return addr + size > origAddr && addr < origAddr + origSize_;
+	if (addr + size > origAddr && addr < origAddr + origSize_)
+		return true;
+	for (const IRBlockRange &range : traceRanges_) {
+		u32 start = range.start & 0x3FFFFFFF;
+		if (addr + size > start && addr < start + range.size)
+			return true;
+	}
+	return false;
 }
 
 MIPSOpcode IRJit::GetOriginalOp(MIPSOpcode op) {
@@ -22,10 +22,12 @@
 
 #include "Common/Common.h"
 #include "Common/CPUDetect.h"
+#include "Common/File/Path.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/IR/IRRegCache.h"
 #include "Core/MIPS/IR/IRInst.h"
+#include "Core/MIPS/IR/IRInterpreter.h"
 #include "Core/MIPS/IR/IRFrontend.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
 
@@ -35,6 +37,22 @@
 
 namespace MIPSComp {
 
+// Exits taken this many times (by majority vote) make a block the head of a trace.
+static const u32 IR_TRACE_THRESHOLD = 128;
+// Blocks further along need at least this much bias on their hot exit to be stitched in.
+static const u32 IR_TRACE_MIN_BIAS = 32;
+static const int IR_TRACE_MAX_BLOCKS = 8;
+static const int IR_TRACE_MAX_INSTS = 1024;
+// Blocks entered this many times get recompiled with the more expensive passes.
+static const u32 IR_TIER_THRESHOLD = 1000;
+// Overlays can put different code at the same address, but not without bound.
+static const int IR_DISK_CACHE_MAX_VARIANTS = 4;
+
+struct IRBlockRange {
+	u32 start;
+	u32 size;
+};
+
 // TODO : Use arena allocators. For now let's just malloc.
 class IRBlock {
 public:
@@ -42,27 +60,43 @@ class IRBlock {
 	IRBlock(u32 emAddr) : instr_(nullptr), numInstructions_(0), origAddr_(emAddr), origSize_(0) {}
 	IRBlock(IRBlock &&b) {
 		instr_ = b.instr_;
+		threaded_ = b.threaded_;
 		numInstructions_ = b.numInstructions_;
 		origAddr_ = b.origAddr_;
 		origSize_ = b.origSize_;
 		origFirstOpcode_ = b.origFirstOpcode_;
 		hash_ = b.hash_;
+		targetOffset_ = b.targetOffset_;
+		hotExit_ = b.hotExit_;
+		hotExitCount_ = b.hotExitCount_;
+		entryCount_ = b.entryCount_;
+		traceHead_ = b.traceHead_;
+		traceRanges_ = std::move(b.traceRanges_);
 		b.instr_ = nullptr;
+		b.threaded_ = nullptr;
 	}
 
 	~IRBlock() {
 		delete[] instr_;
+		delete[] threaded_;
 	}
 
 	void SetInstructions(const std::vector<IRInst> &inst) {
+		delete[] instr_;
+		delete[] threaded_;
 		instr_ = new IRInst[inst.size()];
 		numInstructions_ = (u16)inst.size();
 		if (!inst.empty()) {
 			memcpy(instr_, &inst[0], sizeof(IRInst) * inst.size());
 		}
+		threaded_ = new IRThreadedInst[inst.size() + 1];
+		IRLowerThreaded(instr_, numInstructions_, threaded_);
+		// Any native code was generated from the old instructions.
+		targetOffset_ = -1;
 	}
 
 	const IRInst *GetInstructions() const { return instr_; }
+	const IRThreadedInst *GetThreadedInstructions() const { return threaded_; }
 	int GetNumInstructions() const { return numInstructions_; }
 	MIPSOpcode GetOriginalFirstOp() const { return origFirstOpcode_; }
 	bool HasOriginalFirstOp() const;
@@ -74,6 +108,9 @@ class IRBlock {
 	void UpdateHash() {
 		hash_ = CalculateHash();
 	}
+	u64 GetHash() const {
+		return hash_;
+	}
 	bool HashMatches() const {
 		return origAddr_ && hash_ == CalculateHash();
 	}
@@ -84,6 +121,53 @@ class IRBlock {
 		size = origSize_;
 	}
 
+	// Returns true when the block just became hot enough to optimize further.
+	bool CountEntry() {
+		return ++entryCount_ == IR_TIER_THRESHOLD;
+	}
+	u32 GetEntryCount() const {
+		return entryCount_;
+	}
+
+	// Counts exits for trace building. Returns true once one exit has clearly won.
+	bool RecordExit(u32 pc) {
+		if (pc == hotExit_)
+			return ++hotExitCount_ == IR_TRACE_THRESHOLD;
+		if (hotExitCount_ == 0) {
+			hotExit_ = pc;
+			hotExitCount_ = 1;
+		} else {
+			hotExitCount_--;
+		}
+		return false;
+	}
+	u32 GetHotExit() const {
+		return hotExitCount_ >= IR_TRACE_MIN_BIAS ? hotExit_ : 0;
+	}
+	void ResetHotExit() {
+		hotExit_ = 0;
+		hotExitCount_ = 0;
+	}
+
+	// Superblocks cover the head block's range and the ranges of the blocks stitched after it.
+	bool IsTrace() const { return traceHead_ != -1; }
+	int GetTraceHead() const { return traceHead_; }
+	void SetTraceHead(int number) {
+		traceHead_ = number;
+	}
+	void AddTraceRange(u32 start, u32 size) {
+		traceRanges_.push_back({ start, size });
+	}
+	const std::vector<IRBlockRange> &GetTraceRanges() const { return traceRanges_; }
+
+	// Offset of native code generated from this block, if the backend has one.
+	void SetTargetOffset(int offset) {
+		targetOffset_ = offset;
+	}
+	int GetTargetOffset() const {
+		return targetOffset_;
+	}
+
 	void Finalize(int number);
 	void Destroy(int number);
 
@@ -91,10 +175,17 @@ class IRBlock {
 	u64 CalculateHash() const;
 
 	IRInst *instr_;
+	IRThreadedInst *threaded_ = nullptr;
 	u16 numInstructions_;
 	u32 origAddr_;
 	u32 origSize_;
 	u64 hash_ = 0;
+	int targetOffset_ = -1;
+	u32 hotExit_ = 0;
+	u32 hotExitCount_ = 0;
+	u32 entryCount_ = 0;
+	int traceHead_ = -1;
+	std::vector<IRBlockRange> traceRanges_;
 	MIPSOpcode origFirstOpcode_ = MIPSOpcode(0x68FFFFFF);
 };
 
@@ -118,21 +209,70 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 	}
 
 	int FindPreloadBlock(u32 em_address);
+	// Returns the block whose emuhack is currently at this address, if any.
+	int GetBlockNumAt(u32 em_address) const;
 
 	std::vector<u32> SaveAndClearEmuHackOps();
 	void RestoreSavedEmuHackOps(std::vector<u32> saved);
 
+	// Visits blocks that still match the code they were compiled from.
+	template <typename T>
+	void IterateValidBlocks(T func) const {
+		for (const IRBlock &b : blocks_) {
+			if (b.IsValid())
+				func(b);
+		}
+	}
+
 	JitBlockDebugInfo GetBlockDebugInfo(int blockNum) const override;
 	void ComputeStats(BlockCacheStats &bcStats) const override;
 	int GetBlockNumberFromStartAddress(u32 em_address, bool realBlocksOnly = true) const override;
 
 private:
-	u32 AddressToPage(u32 addr) const;
+	void AddToPages(int i, u32 startAddr, u32 size);
 
 	std::vector<IRBlock> blocks_;
-	std::unordered_map<u32, std::vector<int>> byPage_;
+	JitBlockPageMap byPage_;
 };
 
+// Translated blocks kept between runs of a game, by start address.  There can be several
+// variants per address, due to overlays.  MIPSState::Reset() recreates the jit on every
+// savestate load, so this lives outside it: loaded once at boot and saved at shutdown.
+class IRDiskCache {
+public:
+	bool IsEnabled() const { return path_.Valid(); }
+	u32 GetDisableFlags() const { return disableFlags_; }
+	// Keeps the path for Save() even if there's no file yet.
+	void Load(const Path &filename, u32 disableFlags);
+	void Save() const;
+	void Clear();
+
+	// The file contents.  Loading fails unless the build hash and disable flags match.
+	std::string SaveToString(u32 disableFlags, u64 buildHash) const;
+	bool LoadFromString(const std::string &data, u32 disableFlags, u64 buildHash);
+	static u64 GetBuildHash();
+
+	// The block must have been hashed.  Only the newest IR_DISK_CACHE_MAX_VARIANTS per address are kept.
+	void Add(const IRBlock &block);
+	// Doesn't modify the cache, so it's safe to call from several compile threads at once.
+	bool Find(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes) const;
+	int GetNumBlocks() const;
+
+private:
+	struct Block {
+		u32 size;
+		u64 hash;
+		std::vector<IRInst> instructions;
+	};
+	std::unordered_map<u32, std::vector<Block>> blocks_;
+	Path path_;
+	u32 disableFlags_ = 0;
+};
+
+// Called from CPU_Init() and CPU_Shutdown(), for what has to outlive each jit.
+void IRJitBoot(const std::string &discID);
+void IRJitShutdown();
+
 class IRJit : public JitInterface {
 public:
 	IRJit(MIPSState *mipsState);
@@ -146,6 +286,7 @@ class IRJit : public JitInterface {
 
 	void Compile(u32 em_address) override;	// Compiles a block at current MIPS PC
 	void CompileFunction(u32 start_address, u32 length) override;
+	void CompileFunctions(const std::vector<std::pair<u32, u32>> &ranges, const std::function<void(int, int)> &progress) override;
 
 	bool DescribeCodePtr(const u8 *ptr, std::string &name) override;
 	// Not using a regular block cache.
@@ -170,11 +311,35 @@ class IRJit : public JitInterface {
 	void LinkBlock(u8 *exitPoint, const u8 *checkedEntry) override;
 	void UnlinkBlock(u8 *checkedEntry, u32 originalAddress) override;
 
-private:
+protected:
+	struct TranslatedBlock {
+		u32 em_address;
+		u32 mipsBytes;
+		std::vector<IRInst> instructions;
+	};
+
 	bool CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload);
+	bool AddBlock(u32 em_address, const std::vector<IRInst> &instructions, u32 mipsBytes, bool preload);
+	// Finds and translates a function's blocks without touching the block cache, so it's safe on any thread.
+	void TranslateFunction(IRFrontend &frontend, u32 start_address, u32 length, std::vector<TranslatedBlock> &blocks);
+	bool AddFunctionBlocks(const std::vector<TranslatedBlock> &blocks);
+	// Lets a native backend generate code for a new block. Returning false clears the cache.
+	virtual bool CompileTargetBlock(IRBlock *block, int block_num, bool preload) { return true; }
 	bool ReplaceJalTo(u32 dest);
+	void BuildTrace(int head_num);
+	// Recompiles a hot block in place with the expensive passes.
+	void PromoteBlock(int block_num);
+
+	// Keeps the current blocks for the disk cache, before they're cleared.
+	void AddBlocksToDiskCache();
+	// Takes the frontend that would translate the block, since cached blocks assume its initial state.
+	bool FindDiskCacheBlock(const IRFrontend &frontend, u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes);
 
 	JitOptions jo;
+	bool useTraces_ = false;
+	bool useTiering_ = false;
+	// Whether the boot's disk cache was made with the same disable flags as this jit.
+	bool useDiskCache_ = false;
 
 	IRFrontend frontend_;
 	IRBlockCache blocks_;
@@ -971,6 +971,26 @@ bool ReduceLoads(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 	return logBlocks;
 }
 
+// Whether ops[j] partly overlaps any of the stores from start, all with the same op and base.
+// Stores to the same offset stay in order anyway, since the sort is stable.
+static bool StoresOverlap(const std::vector<IRInst> &ops, size_t start, size_t j) {
+	u32 size = 4;
+	switch (ops[j].op) {
+	case IROp::Store8: size = 1; break;
+	case IROp::Store16: size = 2; break;
+	case IROp::StoreVec4: size = 16; break;
+	default: break;
+	}
+
+	for (size_t k = start; k < j; ++k) {
+		// Offsets can be negative.
+		s32 diff = (s32)(ops[j].constant - ops[k].constant);
+		if (diff != 0 && (u32)abs(diff) < size)
+			return true;
+	}
+	return false;
+}
+
 static std::vector<IRInst> ReorderLoadStoreOps(std::vector<IRInst> &ops) {
 	if (ops.size() < 2) {
 		return ops;
@@ -1036,6 +1056,9 @@ static std::vector<IRInst> ReorderLoadStoreOps(std::vector<IRInst> &ops) {
 					break;
 				}
 				modifiedRegs[ops[j].dest] = true;
+			} else if (StoresOverlap(ops, start, j)) {
+				// Sorting would change which store wins.
+				break;
 			}
 
 			// Keep going, these operations are compatible.
@@ -1077,7 +1100,7 @@ bool ReorderLoadStore(const IRWriter &in, IRWriter &out, const IROptions &opts)
 
 		std::vector<IRInst> loadStoreUnsorted = loadStoreQueue;
 		std::vector<IRInst> loadStoreSorted = ReorderLoadStoreOps(loadStoreQueue);
-		if (memcmp(&loadStoreSorted[0], &loadStoreUnsorted[0], sizeof(IRInst) * loadStoreSorted.size()) != 0) {
+		if (!loadStoreSorted.empty() && memcmp(&loadStoreSorted[0], &loadStoreUnsorted[0], sizeof(IRInst) * loadStoreSorted.size()) != 0) {
 			logBlocks = true;
 		}
 
@@ -1331,7 +1354,7 @@ bool MergeLoadStore(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 			break;
 
 		case IROp::Load32:
-			if (prev.src1 == inst.src1 && prev.src2 == inst.src2) {
+			if (prev.src1 == inst.src1 && prev.constant == inst.constant) {
 				// A store and then an immediate load.  This is sadly common in minis.
 				if (prev.op == IROp::Store32 && prev.src3 == inst.dest) {
 					// Even the same reg, a volatile variable?  Skip it.
@@ -1355,7 +1378,7 @@ bool MergeLoadStore(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 			break;
 
 		case IROp::LoadFloat:
-			if (prev.src1 == inst.src1 && prev.src2 == inst.src2) {
+			if (prev.src1 == inst.src1 && prev.constant == inst.constant) {
 				// A store and then an immediate load, of a float.
 				if (prev.op == IROp::StoreFloat && prev.src3 == inst.dest) {
 					// Volatile float, I suppose?
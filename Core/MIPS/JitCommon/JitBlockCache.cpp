@@ -113,11 +113,11 @@ void JitBlockCache::Shutdown() {
 // This clears the JIT cache. It's called from JitCache.cpp when the JIT cache
 // is full and when saving and loading states.
 void JitBlockCache::Clear() {
-	block_map_.clear();
-	proxyBlockMap_.clear();
+	block_map_.Clear();
+	proxyBlockMap_.Clear();
 	for (int i = 0; i < num_blocks_; i++)
 		DestroyBlock(i, DestroyType::CLEAR);
-	links_to_.clear();
+	links_to_.Clear();
 	num_blocks_ = 0;
 
 	blockMemRanges_[JITBLOCK_RANGE_SCRATCH] = std::make_pair(0xFFFFFFFF, 0x00000000);
@@ -159,6 +159,7 @@ int JitBlockCache::AllocateBlock(u32 startAddress) {
 
 	b.invalid = false;
 	b.originalAddress = startAddress;
+	b.entryCount = 0;
 	for (int i = 0; i < MAX_JIT_BLOCK_EXITS; ++i) {
 		b.exitAddress[i] = INVALID_EXIT;
 		b.exitPtrs[i] = 0;
@@ -198,7 +199,7 @@ void JitBlockCache::ProxyBlock(u32 rootAddress, u32 startAddress, u32 size, cons
 	// Make binary searches and stuff work ok
 	b.normalEntry = codePtr;
 	b.checkedEntry = codePtr;
-	proxyBlockMap_.insert(std::make_pair(startAddress, num_blocks_));
+	proxyBlockMap_.Add(startAddress, 4, num_blocks_);
 	AddBlockMap(num_blocks_);
 
 	num_blocks_++; //commit the current block
@@ -206,10 +207,8 @@ void JitBlockCache::ProxyBlock(u32 rootAddress, u32 startAddress, u32 size, cons
 
 void JitBlockCache::AddBlockMap(int block_num) {
 	const JitBlock &b = blocks_[block_num];
-	// Convert the logical address to a physical address for the block map
-	// Yeah, this'll work fine for PSP too I think.
-	u32 pAddr = b.originalAddress & 0x1FFFFFFF;
-	block_map_[std::make_pair(pAddr + 4 * b.originalSize, pAddr)] = block_num;
+	// The page map works on physical addresses, so mirrors share pages.
+	block_map_.Add(b.originalAddress, 4 * b.originalSize, block_num);
 }
 
 void JitBlockCache::RemoveBlockMap(int block_num) {
@@ -218,19 +217,7 @@ void JitBlockCache::RemoveBlockMap(int block_num) {
 		return;
 	}
 
-	const u32 pAddr = b.originalAddress & 0x1FFFFFFF;
-	auto it = block_map_.find(std::make_pair(pAddr + 4 * b.originalSize, pAddr));
-	if (it != block_map_.end() && it->second == (u32)block_num) {
-		block_map_.erase(it);
-	} else {
-		// It wasn't in there, or it has the wrong key.  Let's search...
-		for (auto it = block_map_.begin(); it != block_map_.end(); ++it) {
-			if (it->second == (u32)block_num) {
-				block_map_.erase(it);
-				break;
-			}
-		}
-	}
+	block_map_.Remove(b.originalAddress, 4 * b.originalSize, block_num);
 }
 
 static void ExpandRange(std::pair<u32, u32> &range, u32 newStart, u32 newEnd) {
@@ -253,7 +240,7 @@ void JitBlockCache::FinalizeBlock(int block_num, bool block_link) {
 	if (block_link) {
 		for (int i = 0; i < MAX_JIT_BLOCK_EXITS; i++) {
 			if (b.exitAddress[i] != INVALID_EXIT) {
-				links_to_.insert(std::make_pair(b.exitAddress[i], block_num));
+				links_to_.Add(b.exitAddress[i], 4, block_num);
 			}
 		}
 
@@ -353,12 +340,13 @@ int JitBlockCache::GetBlockNumberFromStartAddress(u32 addr, bool realBlocksOnly)
 	if (bl < 0) {
 		if (!realBlocksOnly) {
 			// Wasn't an emu hack op, look through proxyBlockMap_.
-			auto range = proxyBlockMap_.equal_range(addr);
-			for (auto it = range.first; it != range.second; ++it) {
-				const int blockIndex = it->second;
-				if (blocks_[blockIndex].originalAddress == addr && !blocks_[blockIndex].proxyFor && !blocks_[blockIndex].invalid)
-					return blockIndex;
-			}
+			int found = -1;
+			proxyBlockMap_.ForEachInPages(addr, addr, [&](int blockIndex) {
+				if (found == -1 && blocks_[blockIndex].originalAddress == addr && !blocks_[blockIndex].proxyFor && !blocks_[blockIndex].invalid)
+					found = blockIndex;
+			});
+			if (found != -1)
+				return found;
 		}
 		return -1;
 	}
@@ -428,29 +416,27 @@ void JitBlockCache::LinkBlockExits(int i) {
 void JitBlockCache::LinkBlock(int i) {
 	LinkBlockExits(i);
 	JitBlock &b = blocks_[i];
-	// equal_range(b) returns pair<iterator,iterator> representing the range
-	// of element with key b
-	auto ppp = links_to_.equal_range(b.originalAddress);
-	if (ppp.first == ppp.second)
-		return;
-	for (auto iter = ppp.first; iter != ppp.second; ++iter) {
-		// INFO_LOG(JIT, "Linking block %i to block %i", iter->second, i);
-		LinkBlockExits(iter->second);
-	}
+	links_to_.ForEachInPages(b.originalAddress, b.originalAddress, [&](int sourceNum) {
+		const JitBlock &sourceBlock = blocks_[sourceNum];
+		for (int e = 0; e < MAX_JIT_BLOCK_EXITS; e++) {
+			if (sourceBlock.exitAddress[e] == b.originalAddress) {
+				// INFO_LOG(JIT, "Linking block %i to block %i", sourceNum, i);
+				LinkBlockExits(sourceNum);
+				break;
+			}
+		}
+	});
 }
 
 void JitBlockCache::UnlinkBlock(int i) {
 	JitBlock &b = blocks_[i];
-	auto ppp = links_to_.equal_range(b.originalAddress);
-	if (ppp.first == ppp.second)
-		return;
-	for (auto iter = ppp.first; iter != ppp.second; ++iter) {
-		JitBlock &sourceBlock = blocks_[iter->second];
+	links_to_.ForEachInPages(b.originalAddress, b.originalAddress, [&](int sourceNum) {
+		JitBlock &sourceBlock = blocks_[sourceNum];
 		for (int e = 0; e < MAX_JIT_BLOCK_EXITS; e++) {
 			if (sourceBlock.exitAddress[e] == b.originalAddress)
 				sourceBlock.linkStatus[e] = false;
 		}
-	}
+	});
 }
 
 std::vector<u32> JitBlockCache::SaveAndClearEmuHackOps() {
@@ -518,14 +504,7 @@ void JitBlockCache::DestroyBlock(int block_num, DestroyType type) {
 		delete b->proxyFor;
 		b->proxyFor = 0;
 	}
-	auto range = proxyBlockMap_.equal_range(b->originalAddress);
-	for (auto it = range.first; it != range.second; ++it) {
-		if (it->second == block_num) {
-			// Found it.  Delete and bail.
-			proxyBlockMap_.erase(it);
-			break;
-		}
-	}
+	proxyBlockMap_.Remove(b->originalAddress, 4, block_num);
 
 	// TODO: Handle the case when there's a proxy block and a regular JIT block at the same location.
 	// In this case we probably "leak" the proxy block currently (no memory leak but it'll stay enabled).
@@ -578,25 +557,28 @@ void JitBlockCache::InvalidateICache(u32 address, const u32 length) {
 		return;
 	}
 
-	// Blocks may start and end in overlapping ways, and destroying one invalidates iterators.
-	// So after destroying one, we start over.
-	do {
-	restart:
-		auto next = block_map_.lower_bound(std::make_pair(pAddr, 0));
-		auto last = block_map_.upper_bound(std::make_pair(pEnd + MAX_BLOCK_INSTRUCTIONS, 0));
-		// Note that if next is end(), last will be end() too (equal.)
-		for (; next != last; ++next) {
-			const u32 blockStart = next->first.second;
-			const u32 blockEnd = next->first.first;
-			if (blockStart < pEnd && blockEnd > pAddr) {
-				DestroyBlock(next->second, DestroyType::INVALIDATE);
-				// Our iterator is now invalid.  Break and search again.
-				// Most of the time there shouldn't be a bunch of matching blocks.
-				goto restart;
-			}
-		}
-		// We got here - it wasn't in the map at all (or anymore.)
-	} while (false);
+	if (length == 0)
+		return;
+
+	// Destroying a block can destroy others (proxies) and changes the map, so collect first.
+	std::vector<int> overlapping;
+	block_map_.ForEachInPages(pAddr, pEnd - 1, [&](int block_num) {
+		const JitBlock &b = blocks_[block_num];
+		const u32 blockStart = b.originalAddress & 0x1FFFFFFF;
+		const u32 blockEnd = blockStart + 4 * b.originalSize;
+		if (blockStart < pEnd && blockEnd > pAddr)
+			overlapping.push_back(block_num);
+	});
+	if (overlapping.empty())
+		return;
+	std::sort(overlapping.begin(), overlapping.end());
+	overlapping.erase(std::unique(overlapping.begin(), overlapping.end()), overlapping.end());
+
+	for (int block_num : overlapping) {
+		// Might've been taken out by an earlier one.
+		if (!blocks_[block_num].invalid)
+			DestroyBlock(block_num, DestroyType::INVALIDATE);
+	}
 }
 
 void JitBlockCache::InvalidateChangedBlocks() {
@@ -636,6 +618,102 @@ int JitBlockCache::GetBlockExitSize() {
 #endif
 }
 
+JitBlockPageMap::~JitBlockPageMap() {
+	Clear();
+}
+
+JitBlockPageMap::Chunk::~Chunk() {
+	for (Bucket &bucket : pages)
+		delete bucket.more;
+}
+
+void JitBlockPageMap::Clear() {
+	for (Chunk *&chunk : chunks_) {
+		delete chunk;
+		chunk = nullptr;
+	}
+	overflow_.clear();
+}
+
+void JitBlockPageMap::Bucket::Add(int block_num) {
+	for (int i = 0; i < count; ++i) {
+		if (Get(i) == block_num)
+			return;
+	}
+	if (count < INLINE_COUNT) {
+		inlineBlocks[count++] = block_num;
+		return;
+	}
+	if (!more)
+		more = new std::vector<int>();
+	more->push_back(block_num);
+	count++;
+}
+
+void JitBlockPageMap::Bucket::Remove(int block_num) {
+	for (int i = 0; i < count; ++i) {
+		if (Get(i) != block_num)
+			continue;
+
+		// Order doesn't matter, so just move the last one into the hole.
+		int last = Get(count - 1);
+		if (i < INLINE_COUNT)
+			inlineBlocks[i] = last;
+		else
+			(*more)[i - INLINE_COUNT] = last;
+		if (count > INLINE_COUNT)
+			more->pop_back();
+		count--;
+		return;
+	}
+}
+
+void JitBlockPageMap::Add(u32 startAddr, u32 size, int block_num) {
+	const u32 startPage = (startAddr & 0x1FFFFFFF) >> PAGE_SHIFT;
+	const u32 endPage = ((startAddr & 0x1FFFFFFF) + std::max(size, 1U) - 1) >> PAGE_SHIFT;
+	bool inOverflow = false;
+	for (u32 page = startPage; page <= endPage; ++page) {
+		int chunkIndex = ChunkIndex(page);
+		if (chunkIndex < 0) {
+			if (!inOverflow && std::find(overflow_.begin(), overflow_.end(), block_num) == overflow_.end())
+				overflow_.push_back(block_num);
+			inOverflow = true;
+			continue;
+		}
+		if (!chunks_[chunkIndex])
+			chunks_[chunkIndex] = new Chunk();
+		chunks_[chunkIndex]->pages[page & (PAGES_PER_CHUNK - 1)].Add(block_num);
+	}
+}
+
+void JitBlockPageMap::Remove(u32 startAddr, u32 size, int block_num) {
+	const u32 startPage = (startAddr & 0x1FFFFFFF) >> PAGE_SHIFT;
+	const u32 endPage = ((startAddr & 0x1FFFFFFF) + std::max(size, 1U) - 1) >> PAGE_SHIFT;
+	for (u32 page = startPage; page <= endPage; ++page) {
+		int chunkIndex = ChunkIndex(page);
+		if (chunkIndex < 0) {
+			auto it = std::find(overflow_.begin(), overflow_.end(), block_num);
+			if (it != overflow_.end())
+				overflow_.erase(it);
+		} else if (chunks_[chunkIndex]) {
+			chunks_[chunkIndex]->pages[page & (PAGES_PER_CHUNK - 1)].Remove(block_num);
+		}
+	}
+}
+
+void AddHotBlockStat(BlockCacheStats &bcStats, const BlockCacheHotBlock &block) {
+	std::vector<BlockCacheHotBlock> &hot = bcStats.hotBlocks;
+	if ((int)hot.size() >= BLOCK_STATS_MAX_HOT_BLOCKS && hot.back().entryCount >= block.entryCount)
+		return;
+
+	auto pos = std::upper_bound(hot.begin(), hot.end(), block, [](const BlockCacheHotBlock &a, const BlockCacheHotBlock &b) {
+		return a.entryCount > b.entryCount;
+	});
+	hot.insert(pos, block);
+	if ((int)hot.size() > BLOCK_STATS_MAX_HOT_BLOCKS)
+		hot.pop_back();
+}
+
 void JitBlockCache::ComputeStats(BlockCacheStats &bcStats) const {
 	double totalBloat = 0.0;
 	double maxBloat = 0.0;
@@ -657,6 +735,8 @@ void JitBlockCache::ComputeStats(BlockCacheStats &bcStats) const {
 		}
 		totalBloat += bloat;
 		bcStats.bloatMap[bloat] = b->originalAddress;
+		if (b->entryCount != 0 && !b->invalid)
+			AddHotBlockStat(bcStats, { b->originalAddress, 4 * (u32)b->originalSize, b->entryCount });
 	}
 	bcStats.numBlocks = num_blocks_;
 	bcStats.minBloat = minBloat;
@@ -35,6 +35,21 @@ const int MAX_JIT_BLOCK_EXITS = 2;
 const int MAX_JIT_BLOCK_EXITS = 8;
 #endif
 constexpr bool JIT_USE_COMPILEDHASH = true;
+// How many of the most entered blocks ComputeStats() reports.
+const int BLOCK_STATS_MAX_HOT_BLOCKS = 20;
+
+struct BlockCacheHotBlock {
+	u32 startAddress;
+	u32 size;  // In bytes of MIPS code.
+	u32 entryCount;
+};
+
+struct BlockCacheFallbackStat {
+	// Compiled instructions that call the interpreter.
+	int sites = 0;
+	// Entries into the blocks containing them, if the jit counts entries.
+	u64 executions = 0;
+};
 
 struct BlockCacheStats {
 	int numBlocks;
@@ -44,6 +59,103 @@ struct BlockCacheStats {
 	float maxBloat;
 	u32 maxBloatBlock;
 	std::map<float, u32> bloatMap;
+	// Hottest first. Empty if the jit doesn't count block entries.
+	std::vector<BlockCacheHotBlock> hotBlocks;
+	// Interpreter fallbacks by instruction name. Only the IR jit fills this in.
+	std::map<std::string, BlockCacheFallbackStat> fallbacks;
+};
+
+// Keeps the BLOCK_STATS_MAX_HOT_BLOCKS blocks with the most entries.
+void AddHotBlockStat(BlockCacheStats &bcStats, const BlockCacheHotBlock &block);
+
+// Page granular index from PSP addresses to block numbers, for invalidation and lookups.
+// Covers the scratchpad and main RAM with 1KB pages. The second level is only allocated for
+// 64KB chunks that actually get blocks, so untouched RAM costs nothing. Blocks anywhere else
+// (very rare, like code in VRAM) go in a single overflow list.
+// A block is listed on every page it touches, so visitors may see it more than once.
+class JitBlockPageMap {
+public:
+	JitBlockPageMap() {}
+	~JitBlockPageMap();
+
+	void Clear();
+	void Add(u32 startAddr, u32 size, int block_num);
+	void Remove(u32 startAddr, u32 size, int block_num);
+
+	// Visits blocks on the pages from startAddr to endAddr inclusive. The map must not be modified
+	// while visiting, collect the block numbers first if needed.
+	template <typename T>
+	void ForEachInPages(u32 startAddr, u32 endAddr, T func) const {
+		const u32 startPage = (startAddr & 0x1FFFFFFF) >> PAGE_SHIFT;
+		const u32 endPage = (endAddr & 0x1FFFFFFF) >> PAGE_SHIFT;
+		for (u32 page = startPage; page <= endPage; ++page) {
+			int chunkIndex = ChunkIndex(page);
+			if (chunkIndex < 0) {
+				for (int block_num : overflow_)
+					func(block_num);
+				// The overflow list has no pages, no need to visit it again.
+				page = NextCoveredPage(page);
+				continue;
+			}
+			const Chunk *chunk = chunks_[chunkIndex];
+			if (!chunk) {
+				page |= PAGES_PER_CHUNK - 1;
+				continue;
+			}
+			const Bucket &bucket = chunk->pages[page & (PAGES_PER_CHUNK - 1)];
+			for (int i = 0; i < bucket.count; ++i)
+				func(bucket.Get(i));
+		}
+	}
+
+private:
+	enum : u32 {
+		PAGE_SHIFT = 10,
+		PAGES_PER_CHUNK = 64,
+		CHUNK_SHIFT = 6,
+		// The scratchpad gets the first chunk, main RAM (up to 64MB) the rest.
+		SCRATCH_CHUNK_PAGE = 0x00010000 >> PAGE_SHIFT,
+		RAM_FIRST_PAGE = 0x08000000 >> PAGE_SHIFT,
+		RAM_END_PAGE = 0x0C000000 >> PAGE_SHIFT,
+		NUM_CHUNKS = 1 + ((RAM_END_PAGE - RAM_FIRST_PAGE) >> CHUNK_SHIFT),
+	};
+
+	// Small vector, without allocations for the usual handful of blocks per page.
+	struct Bucket {
+		int Get(int i) const {
+			return i < INLINE_COUNT ? inlineBlocks[i] : (*more)[i - INLINE_COUNT];
+		}
+		void Add(int block_num);
+		void Remove(int block_num);
+
+		enum { INLINE_COUNT = 3 };
+		int inlineBlocks[INLINE_COUNT];
+		int count = 0;
+		std::vector<int> *more = nullptr;
+	};
+	struct Chunk {
+		~Chunk();
+		Bucket pages[PAGES_PER_CHUNK];
+	};
+
+	static int ChunkIndex(u32 page) {
+		if ((page & ~(PAGES_PER_CHUNK - 1)) == SCRATCH_CHUNK_PAGE)
+			return 0;
+		if (page >= RAM_FIRST_PAGE && page < RAM_END_PAGE)
+			return 1 + ((page - RAM_FIRST_PAGE) >> CHUNK_SHIFT);
+		return -1;
+	}
+	// Last page before the next covered chunk, used to skip over uncovered space.
+	static u32 NextCoveredPage(u32 page) {
+		if (page < SCRATCH_CHUNK_PAGE)
+			return SCRATCH_CHUNK_PAGE - 1;
+		if (page < RAM_FIRST_PAGE)
+			return RAM_FIRST_PAGE - 1;
+		return 0xFFFFFFFF - 1;
+	}
+
+	Chunk *chunks_[NUM_CHUNKS]{};
+	std::vector<int> overflow_;
 };
 
 enum class DestroyType {
@@ -74,6 +186,8 @@ struct JitBlock {
 	u16 codeSize;
 	u16 originalSize;
 	u16 blockNum;
+	// Only updated if the jit was asked to count block entries.
+	u32 entryCount;
 
 	bool invalid;
 	bool linkStatus[MAX_JIT_BLOCK_EXITS];
@@ -184,11 +298,14 @@ class JitBlockCache : public JitBlockCacheDebugInterface {
 
 	CodeBlockCommon *codeBlock_;
 	JitBlock *blocks_;
-	std::unordered_multimap<u32, int> proxyBlockMap_;
+	// Pure proxy blocks by start address.
+	JitBlockPageMap proxyBlockMap_;
 
 	int num_blocks_;
-	std::unordered_multimap<u32, int> links_to_;
-	std::map<std::pair<u32,u32>, u32> block_map_; // (end_addr, start_addr) -> number
+	// Blocks by the addresses they exit to.
+	JitBlockPageMap links_to_;
+	// Blocks by the code they cover.
+	JitBlockPageMap block_map_;
 
 	enum {
 		JITBLOCK_RANGE_SCRATCH = 0,
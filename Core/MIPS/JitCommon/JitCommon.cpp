@@ -39,6 +39,7 @@
 #include "../ARM64/Arm64Jit.h"
 #elif PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
 #include "../x86/Jit.h"
+#include "../x86/IRToX86.h"
 #elif PPSSPP_ARCH(MIPS)
 #include "../MIPS/MipsJit.h"
 #else
@@ -81,6 +82,15 @@ namespace MIPSComp {
 #endif
 	}
 
+	JitInterface *CreateIRNativeJit(MIPSState *mipsState) {
+#if PPSSPP_ARCH(AMD64)
+		return new MIPSComp::X64IRJit(mipsState);
+#else
+		// No native backend yet, the IR interpreter is the next best thing.
+		return new MIPSComp::IRJit(mipsState);
+#endif
+	}
+
 }
 #if PPSSPP_PLATFORM(WINDOWS) && !defined(__LIBRETRO__)
 #define DISASM_ALL 1
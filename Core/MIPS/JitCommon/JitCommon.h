@@ -17,8 +17,10 @@
 
 #pragma once
 
+#include <functional>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Common/Common.h"
@@ -136,6 +138,14 @@ namespace MIPSComp {
 		virtual void RunLoopUntil(u64 globalticks) = 0;
 		virtual void Compile(u32 em_address) = 0;
 		virtual void CompileFunction(u32 start_address, u32 length) { }
+		// Ranges are (start, length.) A jit may translate them in parallel, and call progress(done, total) from any thread.
+		virtual void CompileFunctions(const std::vector<std::pair<u32, u32>> &ranges, const std::function<void(int, int)> &progress) {
+			for (size_t i = 0; i < ranges.size(); ++i) {
+				CompileFunction(ranges[i].first, ranges[i].second);
+				if (progress)
+					progress((int)i + 1, (int)ranges.size());
+			}
+		}
 		virtual void ClearCache() = 0;
 		virtual void UpdateFCR31() = 0;
 		virtual MIPSOpcode GetOriginalOp(MIPSOpcode op) = 0;
@@ -160,4 +170,5 @@ namespace MIPSComp {
 	void DoDummyJitState(PointerWrap &p);
 
 	JitInterface *CreateNativeJit(MIPSState *mipsState);
+	JitInterface *CreateIRNativeJit(MIPSState *mipsState);
 }
@@ -53,6 +53,7 @@ namespace MIPSComp {
 #else
 		enableBlocklink = !Disabled(JitDisable::BLOCKLINK);
 #endif
+		countBlockEntries = g_Config.bBlockEntryCounters;
 		immBranches = false;
 		continueBranches = false;
 		continueJumps = false;
@@ -201,6 +201,11 @@ namespace MIPSComp {
 		LSU_FPU = 0x4000,
 		LSU_VFPU = 0x8000,
 
+		IR_TRACES = 0x00010000,
+		IR_DISK_CACHE = 0x00020000,
+		IR_TIERING = 0x00040000,
+		IR_ASYNC_COMPILE = 0x00080000,
+
 		SIMD = 0x00100000,
 		BLOCKLINK = 0x00200000,
 		POINTERIFY = 0x00400000,
@@ -240,6 +245,7 @@ namespace MIPSComp {
 
 		// Common
 		bool enableBlocklink;
+		bool countBlockEntries;
 		bool immBranches;
 		bool continueBranches;
 		bool continueJumps;
@@ -32,6 +32,7 @@
 #include "Core/MIPS/MIPSVFPUUtils.h"
 #include "Core/MIPS/IR/IRJit.h"
 #include "Core/Reporting.h"
+#include "Core/RunAhead.h"
 #include "Core/System.h"
 #include "Core/HLE/sceDisplay.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
@@ -217,6 +218,8 @@ void MIPSState::Init() {
 		MIPSComp::jit = MIPSComp::CreateNativeJit(this);
 	} else if (PSP_CoreParameter().cpuCore == CPUCore::IR_JIT) {
 		MIPSComp::jit = new MIPSComp::IRJit(this);
+	} else if (PSP_CoreParameter().cpuCore == CPUCore::JIT_IR) {
+		MIPSComp::jit = MIPSComp::CreateIRNativeJit(this);
 	} else {
 		MIPSComp::jit = nullptr;
 	}
@@ -256,6 +259,16 @@ void MIPSState::UpdateCore(CPUCore desired) {
 		newjit = new MIPSComp::IRJit(this);
 		break;
 
+	case CPUCore::JIT_IR:
+		INFO_LOG(CPU, "Switching to IR JIT (native)");
+		if (oldjit) {
+			std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
+			MIPSComp::jit = nullptr;
+			delete oldjit;
+		}
+		newjit = MIPSComp::CreateIRNativeJit(this);
+		break;
+
 	case CPUCore::INTERPRETER:
 		INFO_LOG(CPU, "Switching to interpreter");
 		if (oldjit) {
@@ -275,8 +288,8 @@ void MIPSState::DoState(PointerWrap &p) {
 	if (!s)
 		return;
 
-	// Reset the jit if we're loading.
-	if (p.mode == p.MODE_READ)
+	// Reset the jit if we're loading. Run-ahead keeps it, see SaveStart::DoState().
+	if (p.mode == p.MODE_READ && !PSP_CoreParameter().runningAhead)
 		Reset();
 	// Assume we're not saving state during a CPU core reset, so no lock.
 	if (MIPSComp::jit)
@@ -331,6 +344,7 @@ int MIPSState::RunLoopUntil(u64 globalTicks) {
 	switch (PSP_CoreParameter().cpuCore) {
 	case CPUCore::JIT:
 	case CPUCore::IR_JIT:
+	case CPUCore::JIT_IR:
 		while (inDelaySlot) {
 			// We must get out of the delay slot before going into jit.
 			SingleStep();
@@ -349,6 +363,7 @@ void MIPSState::InvalidateICache(u32 address, int length) {
 	std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
 	if (MIPSComp::jit)
 		MIPSComp::jit->InvalidateCacheAt(address, length);
+	RunAhead::NotifyInvalidateICache(address, length);
 }
 
 void MIPSState::ClearJitCache() {
@@ -27,6 +27,7 @@
 
 #include "Common/File/FileUtil.h"
 #include "Common/Log.h"
+#include "Common/StringUtils.h"
 #include "Common/TimeUtil.h"
 #include "Core/Config.h"
 #include "Core/MemMap.h"
@@ -927,19 +928,30 @@ namespace MIPSAnalyst {
 		if (!g_Config.bPreloadFunctions) {
 			return;
 		}
-		std::lock_guard<std::recursive_mutex> guard(functions_lock);
 
 		// TODO: Load from cache file if available instead.
+		std::vector<std::pair<u32, u32>> ranges;
+		{
+			std::lock_guard<std::recursive_mutex> guard(functions_lock);
+			ranges.reserve(functions.size());
+			for (auto iter = functions.begin(), end = functions.end(); iter != end; iter++) {
+				const AnalyzedFunction &f = *iter;
+				ranges.push_back(std::make_pair(f.start, f.end - f.start + 4));
+			}
+		}
 
 		double st = time_now_d();
-		for (auto iter = functions.begin(), end = functions.end(); iter != end; iter++) {
-			const AnalyzedFunction &f = *iter;
-
-			PrecompileFunction(f.start, f.end - f.start + 4);
+		{
+			std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
+			if (MIPSComp::jit) {
+				MIPSComp::jit->CompileFunctions(ranges, [](int done, int total) {
+					PSP_SetLoading(StringFromFormat("Precompiling functions... %d / %d", done, total));
+				});
+			}
 		}
 		double et = time_now_d();
 
-		NOTICE_LOG(JIT, "Precompiled %d MIPS functions in %0.2f milliseconds", (int)functions.size(), (et - st) * 1000.0);
+		NOTICE_LOG(JIT, "Precompiled %d MIPS functions in %0.2f milliseconds", (int)ranges.size(), (et - st) * 1000.0);
 	}
 
 	static const char *DefaultFunctionName(char buffer[256], u32 startAddr) {
@@ -32,6 +32,7 @@
 #include "Core/MIPS/MIPSInt.h"
 #include "Core/MIPS/MIPSTables.h"
 #include "Core/Reporting.h"
+#include "Core/RunAhead.h"
 #include "Core/HLE/HLE.h"
 #include "Core/HLE/HLETables.h"
 #include "Core/HLE/ReplaceTables.h"
@@ -109,6 +110,7 @@ namespace MIPSInt
 			// We assume the CPU won't be reset during this, so no locking.
 			if (MIPSComp::jit) {
 				MIPSComp::jit->InvalidateCacheAt(addr, 0x40);
+				RunAhead::NotifyInvalidateICache(addr, 0x40);
 			}
 			break;
 
@@ -1,299 +1,947 @@
 #include "ppsspp_config.h"
-#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
-
+#if PPSSPP_ARCH(AMD64)
+
+#include <climits>
+#include <cstddef>
+#include <cstring>
+
+#include "Common/ABI.h"
+#include "Common/Log.h"
+#include "Common/MemoryUtil.h"
+#include "Common/Profiler/Profiler.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/IR/IRInterpreter.h"
 #include "Core/MIPS/x86/IRToX86.h"
+#include "Core/MIPS/x86/RegCache.h"
 
 namespace MIPSComp {
 
-// Initial attempt at converting IR directly to x86.
-// This is intended to be an easy way to benefit from the IR with the current infrastructure.
-// Later tries may go across multiple blocks and a different representation.
+using namespace Gen;
+using namespace X64JitConstants;
 
-struct GPRMapping {
-	Gen::OpArg dest;
-	Gen::OpArg src1;
-	Gen::OpArg src2;
-};
+// Converts the IR produced by IRFrontend (after the IRPassSimplify passes) to x86-64, one block at a time.
+// GPRs get a block-local register allocator, FPRs and Vec4s are operated on directly in MIPSState
+// through SSE, and anything else goes through the IR interpreter for just that instruction.
+//
+// RAX, RCX and RDX are scratch: variable shifts need CL and multiplies use RDX.
+// RBX (MEMBASEREG) and R14 (CTXREG) are fixed, same as the regular x86 jit.
 
-struct FPRMapping {
-	Gen::OpArg dest;
-	Gen::OpArg src1;
-	Gen::OpArg src2;
-};
+static const X64Reg allocationOrder[] = { RSI, RDI, R8, R9, R10, R11, R12, R13, R15 };
 
+// IR register numbers index MIPSState as an array of u32, and CTXREG points at f[0].
+static OpArg IRRegArg(int reg) {
+	return MDisp(CTXREG, reg * 4 - (int)offsetof(MIPSState, f[0]));
+}
 
-class GreedyRegallocGPR {
-public:
-	GPRMapping Map(IRInst inst, const IRMeta &meta);
+static OpArg FPRArg(int reg) {
+	return MDisp(CTXREG, reg * 4);
+}
 
-private:
-	
-};
+static bool IsTemp(int reg) {
+	return reg >= IRTEMP_0 && reg < IRTEMP_0 + 16;
+}
+
+static bool UsesGPR(const IRInst &inst, int reg) {
+	const IRMeta *meta = GetIRMeta(inst.op);
+	if (meta->types[0] == 'G' && inst.dest == reg)
+		return true;
+	if (meta->types[1] == 'G' && inst.src1 == reg)
+		return true;
+	if (meta->types[2] == 'G' && inst.src2 == reg)
+		return true;
+	return false;
+}
+
+// IRInterpret expects to run until an exit, so we terminate a copy with a zero exit.
+// Returns a non-zero PC if the instruction exited (break, breakpoint, etc.)
+static u32 InterpretSingleIR(const IRInst *inst) {
+	IRInst insts[2];
+	insts[0] = *inst;
+	memset(&insts[1], 0, sizeof(IRInst));
+	insts[1].op = IROp::ExitToConst;
+	insts[1].constant = 0;
+	return IRInterpret(currentMIPS, insts, 2);
+}
+
+void X64IRRegCache::Start(XEmitter *emit, const IRInst *instructions, int count) {
+	emit_ = emit;
+	instructions_ = instructions;
+	count_ = count;
+	instIndex_ = 0;
+	for (auto &hr : hostRegs_) {
+		hr = HostReg();
+	}
+	for (auto &reg : irToHost_) {
+		reg = INVALID_REG;
+	}
+}
+
+bool X64IRRegCache::IsMappable(int reg) {
+	// Other "GPRs" like lo/hi or fpcond are accessed in memory directly by some ops.
+	return reg < 32 || IsTemp(reg);
+}
+
+int X64IRRegCache::NextUse(int reg) const {
+	// Blocks are short enough that scanning forward is cheap.
+	for (int i = instIndex_ + 1; i < count_; ++i) {
+		if (UsesGPR(instructions_[i], reg))
+			return i;
+	}
+	return INT_MAX;
+}
+
+X64Reg X64IRRegCache::AllocHostReg() {
+	for (X64Reg reg : allocationOrder) {
+		if (hostRegs_[reg].irReg == -1)
+			return reg;
+	}
 
+	// Nothing free, spill whichever is needed furthest in the future.
+	X64Reg best = INVALID_REG;
+	int bestUse = -1;
+	for (X64Reg reg : allocationOrder) {
+		const HostReg &hr = hostRegs_[reg];
+		if (hr.locked)
+			continue;
+		int use = NextUse(hr.irReg);
+		if (use > bestUse) {
+			best = reg;
+			bestUse = use;
+		}
+	}
 
-GPRMapping GreedyRegallocGPR::Map(IRInst inst, const IRMeta &meta) {
-	GPRMapping mapping;
-	if (meta.types[0] == 'G') {
+	_assert_msg_(best != INVALID_REG, "IRToX86: out of host registers");
+	// A temp with no further use is dead, no need to store it.
+	Release(best, !(bestUse == INT_MAX && IsTemp(hostRegs_[best].irReg)));
+	return best;
+}
 
+void X64IRRegCache::Release(X64Reg hostReg, bool writeBack) {
+	HostReg &hr = hostRegs_[hostReg];
+	if (hr.irReg == -1)
+		return;
+	if (writeBack && hr.dirty)
+		emit_->MOV(32, IRRegArg(hr.irReg), R(hostReg));
+	irToHost_[hr.irReg] = INVALID_REG;
+	hr = HostReg();
+}
+
+X64Reg X64IRRegCache::Map(int reg, int flags) {
+	_dbg_assert_(IsMappable(reg));
+	X64Reg hostReg = irToHost_[reg];
+	if (hostReg == INVALID_REG) {
+		hostReg = AllocHostReg();
+		irToHost_[reg] = hostReg;
+		hostRegs_[hostReg].irReg = reg;
+		if (flags & MAP_READ)
+			emit_->MOV(32, R(hostReg), IRRegArg(reg));
 	}
-	// etc..
-	return mapping;
+
+	HostReg &hr = hostRegs_[hostReg];
+	hr.locked = true;
+	if (flags & MAP_WRITE)
+		hr.dirty = true;
+	return hostReg;
 }
 
-// Every 4 registers can also be mapped into an SSE register.
-// When changing from single to vec4 mapping, we'll just flush, for now.
-class GreedyRegallocFPR {
+void X64IRRegCache::ReleaseSpillLocks() {
+	for (auto &hr : hostRegs_) {
+		hr.locked = false;
+	}
+}
+
+void X64IRRegCache::WriteBackDirty(bool includeTemps) {
+	for (X64Reg reg : allocationOrder) {
+		const HostReg &hr = hostRegs_[reg];
+		if (hr.irReg != -1 && hr.dirty && (includeTemps || !IsTemp(hr.irReg)))
+			emit_->MOV(32, IRRegArg(hr.irReg), R(reg));
+	}
+}
+
+void X64IRRegCache::FlushAll(bool includeTemps) {
+	for (X64Reg reg : allocationOrder) {
+		const HostReg &hr = hostRegs_[reg];
+		Release(reg, includeTemps || !IsTemp(hr.irReg));
+	}
+}
+
+class X64IRCompileTask : public Task {
 public:
-	FPRMapping Map(IRInst inst, const IRMeta &meta);
+	X64IRCompileTask(X64IRJit *jit) : jit_(jit) {}
+
+	TaskType Type() const override {
+		return TaskType::CPU_COMPUTE;
+	}
+
+	void Run() override {
+		jit_->RunAsyncJobs();
+	}
+
+private:
+	X64IRJit *jit_;
 };
 
-FPRMapping GreedyRegallocFPR::Map(IRInst inst, const IRMeta &meta) {
-	FPRMapping mapping;
+X64IRJit::X64IRJit(MIPSState *mipsState) : IRJit(mipsState) {
+	AllocCodeSpace(1024 * 1024 * 16);
+	GenerateFixedCode();
 
-	return mapping;
+	// Can't write code while other code in the same space is running if W^X is enforced.
+	useAsyncCompile_ = !jo.Disabled(JitDisable::IR_ASYNC_COMPILE) && !PlatformIsWXExclusive() && g_threadManager.IsInitialized();
 }
 
+X64IRJit::~X64IRJit() {
+	CancelAsyncJobs();
+}
 
-// This requires that ThreeOpToTwoOp has been run as the last pass.
-void IRToX86::ConvertIRToNative(const IRInst *instructions, int count, const u32 *constants) {
-	// Set up regcaches
-	using namespace Gen;
+void X64IRJit::GenerateFixedCode() {
+	BeginWrite();
+
+	// Called from C++ with a block's code in ABI_PARAM1, returns the new PC.
+	enterCode_ = (EnterCodeFunc)AlignCode16();
+	ABI_PushAllCalleeSavedRegsAndAdjustStack();
+	MOV(64, R(MEMBASEREG), ImmPtr(Memory::base));
+	MOV(PTRBITS, R(CTXREG), ImmPtr(&mips_->f[0]));
+	JMPptr(R(ABI_PARAM1));
+
+	// Blocks jump here with the new PC in EAX.
+	exitCode_ = AlignCode16();
+	ABI_PopAllCalleeSavedRegsAndAdjustStack();
+	RET();
+
+	crashHandler_ = AlignCode16();
+	MOV(PTRBITS, R(RAX), ImmPtr((const void *)&coreState));
+	MOV(32, MatR(RAX), Imm32(CORE_RUNTIME_ERROR));
+	// Make sure RunLoopUntil drops back out to CoreTiming.
+	MOV(32, MIPSSTATE_VAR(downcount), Imm32(-1));
+	MOV(32, R(EAX), MIPSSTATE_VAR(pc));
+	JMP(exitCode_, true);
+
+	AlignCodePage();
+	EndWrite();
+}
 
-	GreedyRegallocGPR gprAlloc;
-	GreedyRegallocFPR fprAlloc;
+void X64IRJit::ClearCache() {
+	// The worker owns the emitter while it runs.
+	CancelAsyncJobs();
+	pendingTickets_.clear();
+	asyncInstructions_.clear();
 
-	// Loop through all the instructions, emitting code as we go.
-	// Note that we do need to implement them all - fallbacks are not permitted.
-	for (int i = 0; i < count; i++) {
-		const IRInst *inst = &instructions[i];
-		const IRMeta &meta = *GetIRMeta(inst->op);
-		GPRMapping gpr = gprAlloc.Map(*inst, meta);
-		FPRMapping fpr = fprAlloc.Map(*inst, meta);
+	IRJit::ClearCache();
+	ClearCodeSpace(0);
+	GenerateFixedCode();
+}
 
-		bool symmetric = false;
-		switch (inst->op) {
-		case IROp::Nop:
-			_assert_(false);
-			break;
+bool X64IRJit::DescribeCodePtr(const u8 *ptr, std::string &name) {
+	if (!IsInSpace(ptr))
+		return false;
+
+	if (ptr == (const u8 *)enterCode_)
+		name = "enterCode";
+	else if (ptr == exitCode_)
+		name = "exitCode";
+	else if (ptr == crashHandler_)
+		name = "crashHandler";
+	else
+		name = "IRToX86 block";
+	return true;
+}
 
-			// Output-only
-		case IROp::SetConst:
-			code_->MOV(32, gpr.dest, Imm32(constants[inst->src1]));
-			break;
-		case IROp::SetConstF:
-			code_->MOV(32, gpr.dest, Imm32(constants[inst->src1]));
-			break;
+void X64IRJit::RunLoopUntil(u64 globalticks) {
+	PROFILE_THIS_SCOPE("jit");
 
-			// Add gets to be special cased because we have LEA.
-		case IROp::Add:
-			if (gpr.dest.IsSimpleReg() && gpr.src1.IsSimpleReg() && gpr.src2.IsSimpleReg()) {
-				code_->LEA(32, gpr.dest.GetSimpleReg(), MRegSum(gpr.src1.GetSimpleReg(), gpr.src2.GetSimpleReg()));
-				break;
-			}
-			// Else fall through.
-			// 3-op arithmetic that directly corresponds to x86
-			// (often 2-op in practice if src1 == dst). x86 only does 2-op though so some of these will need splitting.
-		case IROp::Sub:
-		case IROp::And:
-		case IROp::Or:
-		case IROp::Xor:
-			if (inst->src1 != inst->dest) {
-				code_->MOV(32, gpr.dest, gpr.src1);
-			}
-			// Emit directly
-			switch (inst->op) {
-			case IROp::Add: code_->ADD(32, gpr.dest, gpr.src2); break;
-			case IROp::Sub: code_->SUB(32, gpr.dest, gpr.src2); break;
-			case IROp::And: code_->AND(32, gpr.dest, gpr.src2); break;
-			case IROp::Or: code_->OR(32, gpr.dest, gpr.src2); break;
-			case IROp::Xor: code_->XOR(32, gpr.dest, gpr.src2); break;
-			}
+	while (true) {
+		CoreTiming::Advance();
+		if (coreState != 0) {
 			break;
+		}
+		if (asyncDoneCount_.load(std::memory_order_relaxed) != 0)
+			PublishAsyncJobs();
+		while (mips_->downcount >= 0) {
+			u32 inst = Memory::ReadUnchecked_U32(mips_->pc);
+			u32 opcode = inst & 0xFF000000;
+			if (opcode == MIPS_EMUHACK_OPCODE) {
+				u32 data = inst & 0xFFFFFF;
+				IRBlock *block = blocks_.GetBlock(data);
+				int offset = block->GetTargetOffset();
+				if (offset >= 0) {
+					mips_->pc = enterCode_(GetBasePtr() + offset);
+				} else {
+					mips_->pc = IRInterpretThreaded(mips_, block->GetThreadedInstructions());
+				}
+				// Always counted, the stats use it to weigh blocks.
+				if (block->CountEntry() && useTiering_)
+					PromoteBlock(data);
+				else if (useTraces_ && block->RecordExit(mips_->pc))
+					BuildTrace(data);
+				if (!Memory::IsValidAddress(mips_->pc)) {
+					Core_ExecException(mips_->pc, mips_->pc, ExecExceptionType::JUMP);
+					break;
+				}
+			} else {
+				Compile(mips_->pc);
+			}
+		}
+	}
+}
 
-			// Variable shifts.
-		case IROp::Shl:
-		case IROp::Shr:
-		case IROp::Sar:
-		case IROp::Ror:
-
-		case IROp::Slt:
-		case IROp::SltU:
-		case IROp::MovZ:
-		case IROp::MovNZ:
-		case IROp::Max:
-		case IROp::Min:
-			break;
+bool X64IRJit::CompileTargetBlock(IRBlock *block, int block_num, bool preload) {
+	if (useAsyncCompile_) {
+		// The block runs on the IR interpreter meanwhile, that's always correct.
+		AsyncJob job;
+		job.blockNum = block_num;
+		job.ticket = ++nextTicket_;
+		job.instructions.assign(block->GetInstructions(), block->GetInstructions() + block->GetNumInstructions());
+		job.offset = -1;
+		pendingTickets_[block_num] = job.ticket;
+
+		std::lock_guard<std::mutex> guard(asyncLock_);
+		asyncQueue_.push_back(std::move(job));
+		if (!asyncRunning_) {
+			asyncRunning_ = true;
+			g_threadManager.EnqueueTask(new X64IRCompileTask(this));
+		}
+		return true;
+	}
 
-			// 2-op arithmetic with constant
-		case IROp::AddConst:
-		case IROp::SubConst:
-		case IROp::AndConst:
-		case IROp::OrConst:
-		case IROp::XorConst:
-		case IROp::SltConst:
-		case IROp::SltUConst:
-
-			// 2-op arithmetic with immediate
-		case IROp::ShlImm:
-		case IROp::ShrImm:
-		case IROp::SarImm:
-		case IROp::RorImm:
-
-			// 2-op arithmetic
-		case IROp::Mov:
-			code_->MOV(32, gpr.dest, gpr.src1);
-			break;
+	int offset = CompileInstructions(block->GetInstructions(), block->GetNumInstructions());
+	if (offset < 0) {
+		// The caller clears the cache, which resets the code space.
+		return false;
+	}
+	block->SetTargetOffset(offset);
+	return true;
+}
 
-		case IROp::Neg:
-		case IROp::Not:
-		case IROp::Ext8to32:
-		case IROp::Ext16to32:
-		case IROp::ReverseBits:
-		case IROp::BSwap16:
-		case IROp::BSwap32:
-		case IROp::Clz:
-			if (inst->dest != inst->src1) {
-				code_->NEG(32, gpr.dest); break;
-			}
-			break;
-				// Multiplier control
-		case IROp::MtLo:
-		case IROp::MtHi:
-		case IROp::MfLo:
-		case IROp::MfHi:
-		case IROp::Mult:
-		case IROp::MultU:
-		case IROp::Madd:
-		case IROp::MaddU:
-		case IROp::Msub:
-		case IROp::MsubU:
-		case IROp::Div:
-		case IROp::DivU:
-
-			// Memory access
-		case IROp::Load8:
-		case IROp::Load8Ext:
-		case IROp::Load16:
-		case IROp::Load16Ext:
-		case IROp::Load32:
-		case IROp::LoadFloat:
-		case IROp::Store8:
-		case IROp::Store16:
-		case IROp::Store32:
-		case IROp::StoreFloat:
-		case IROp::LoadVec4:
-		case IROp::StoreVec4:
-
-			// Output-only SIMD functions
-		case IROp::Vec4Init:
-		case IROp::Vec4Shuffle:
-
-			// 2-op SIMD functions
-		case IROp::Vec4Mov:
-			code_->MOVAPS(fpr.dest.GetSimpleReg(), fpr.src1);
-			break;
-		case IROp::Vec4Neg:
-		case IROp::Vec4Abs:
-			break;
-		case IROp::Vec4ClampToZero:
-			code_->PXOR(XMM0, R(XMM0));
-			code_->PMAXSW(XMM0, fpr.src1);
-			code_->MOVAPD(fpr.dest, XMM0);
-			break;
-		case IROp::Vec4DuplicateUpperBitsAndShift1:
-		case IROp::Vec2ClampToZero:
-
-			// 3-op SIMD functions
-		case IROp::Vec4Add:
-		case IROp::Vec4Sub:
-		case IROp::Vec4Mul:
-		case IROp::Vec4Div:
-
-		case IROp::Vec4Scale:
-		case IROp::Vec4Dot:
-
-			// Pack-unpack
-		case IROp::Vec2Unpack16To31:
-		case IROp::Vec2Unpack16To32:
-		case IROp::Vec4Unpack8To32:
-		case IROp::Vec2Pack32To16:
-		case IROp::Vec2Pack31To16:
-		case IROp::Vec4Pack32To8:
-		case IROp::Vec4Pack31To8:
-
-		case IROp::FCmpVfpuBit:
-		case IROp::FCmpVfpuAggregate:
-		case IROp::FCmovVfpuCC:
-
-			// Trancendental functions (non-simd)
-		case IROp::FSin:
-		case IROp::FCos:
-		case IROp::FRSqrt:
-		case IROp::FRecip:
-		case IROp::FAsin:
-
-			// 3-Op FP
-		case IROp::FAdd:
-		case IROp::FSub:
-		case IROp::FMul:
-		case IROp::FDiv:
-		case IROp::FMin:
-		case IROp::FMax:
-
-			// 2-Op FP
-		case IROp::FMov:
-		case IROp::FAbs:
-		case IROp::FSqrt:
-		case IROp::FNeg:
-		case IROp::FSat0_1:
-		case IROp::FSatMinus1_1:
-		case IROp::FSign:
-		case IROp::FCeil:
-		case IROp::FFloor:
-		case IROp::FCmp:
-		case IROp::FCvtSW:
-		case IROp::FCvtWS:
-		case IROp::FRound:
-		case IROp::FTrunc:
-
-			// Cross moves
-		case IROp::FMovFromGPR:
-		case IROp::FMovToGPR:
-		case IROp::FpCondToReg:
-		case IROp::VfpuCtrlToReg:
-
-			// VFPU flag/control
-		case IROp::SetCtrlVFPU:
-		case IROp::SetCtrlVFPUReg:
-		case IROp::SetCtrlVFPUFReg:
-		case IROp::ZeroFpCond:
-
-			// Block Exits
-		case IROp::ExitToConst:
-		case IROp::ExitToReg:
-		case IROp::ExitToConstIfEq:
-		case IROp::ExitToConstIfNeq:
-		case IROp::ExitToConstIfGtZ:
-		case IROp::ExitToConstIfGeZ:
-		case IROp::ExitToConstIfLtZ:
-		case IROp::ExitToConstIfLeZ:
-		case IROp::ExitToPC:
-
-			// Utilities
-		case IROp::Downcount:
-		case IROp::SetPC:
-		case IROp::SetPCConst:
-		case IROp::Syscall:
-		case IROp::Interpret:  // SLOW fallback. Can be made faster.
-		case IROp::CallReplacement:
-		case IROp::Break:
-		default:
-			break;
-			}
+const u8 *X64IRJit::CompileStandalone(const IRInst *instructions, int count) {
+	// The worker owns the emitter while it runs.
+	CancelAsyncJobs();
+	int offset = CompileInstructions(instructions, count);
+	return offset < 0 ? nullptr : GetBasePtr() + offset;
+}
+
+int X64IRJit::CompileInstructions(const IRInst *instructions, int count) {
+	// Generous, the largest case is a conditional exit that stores all registers.
+	const size_t sizeEstimate = 64 + count * 128;
+	if (GetSpaceLeft() < sizeEstimate) {
+		return -1;
+	}
+
+	BeginWrite(sizeEstimate);
+	const u8 *start = AlignCode16();
+	regs_.Start(this, instructions, count);
+	for (int i = 0; i < count; ++i) {
+		regs_.SetInstIndex(i);
+		CompileIRInst(instructions[i]);
+		regs_.ReleaseSpillLocks();
+	}
+
+	// Blocks always end in an exit, but just in case, don't run off into the next block.
+	regs_.FlushAll(false);
+	MOV(32, R(EAX), MIPSSTATE_VAR(pc));
+	WriteExitEAX();
+	EndWrite();
+
+	return (int)GetOffset(start);
+}
+
+void X64IRJit::RunAsyncJobs() {
+	std::unique_lock<std::mutex> guard(asyncLock_);
+	while (!asyncQueue_.empty()) {
+		AsyncJob job = std::move(asyncQueue_.front());
+		asyncQueue_.pop_front();
+
+		// Nothing else writes code while we're running, so the emitter is ours without the lock.
+		guard.unlock();
+		job.offset = CompileInstructions(job.instructions.data(), (int)job.instructions.size());
+		guard.lock();
+
+		// The mutex also makes the new code visible to the emu thread before it's published.
+		asyncDone_.push_back(std::move(job));
+		asyncDoneCount_.store((int)asyncDone_.size(), std::memory_order_relaxed);
+	}
+	asyncRunning_ = false;
+	asyncIdle_.notify_all();
+}
+
+void X64IRJit::PublishAsyncJobs() {
+	std::vector<AsyncJob> done;
+	{
+		std::lock_guard<std::mutex> guard(asyncLock_);
+		done.swap(asyncDone_);
+		asyncDoneCount_.store(0, std::memory_order_relaxed);
+	}
+
+	for (AsyncJob &job : done) {
+		auto it = pendingTickets_.find(job.blockNum);
+		// Superseded by a newer compile of the same block (e.g. a hot recompile.)
+		if (it == pendingTickets_.end() || it->second != job.ticket)
+			continue;
+		pendingTickets_.erase(it);
+
+		if (job.offset < 0) {
+			ERROR_LOG(JIT, "Ran out of code space compiling in the background, clearing cache");
+			ClearCache();
+			return;
+		}
+
+		// Invalidated blocks can't be entered anymore, so there's no harm in publishing those.
+		// The code matches the IR the block still has, so it's safe to swap in.
+		IRBlock *block = blocks_.GetBlock(job.blockNum);
+		if (block) {
+			block->SetTargetOffset(job.offset);
+			asyncInstructions_.push_back(std::move(job.instructions));
+		}
+	}
+}
+
+void X64IRJit::CancelAsyncJobs() {
+	std::unique_lock<std::mutex> guard(asyncLock_);
+	asyncQueue_.clear();
+	asyncIdle_.wait(guard, [&] { return !asyncRunning_; });
+	asyncDone_.clear();
+	asyncDoneCount_.store(0, std::memory_order_relaxed);
+}
+
+void X64IRJit::WriteExit(u32 pc) {
+	MOV(32, R(EAX), Imm32(pc));
+	JMP(exitCode_, true);
+}
+
+void X64IRJit::WriteExitEAX() {
+	JMP(exitCode_, true);
+}
+
+void X64IRJit::CompGeneric(const IRInst &inst) {
+	regs_.FlushAll(true);
+	ABI_CallFunctionP((const void *)&InterpretSingleIR, (void *)&inst);
+	if ((GetIRMeta(inst.op)->flags & IRFLAG_EXIT) != 0) {
+		TEST(32, R(EAX), R(EAX));
+		FixupBranch skip = J_CC(CC_Z);
+		WriteExitEAX();
+		SetJumpTarget(skip);
+	}
+}
+
+void X64IRJit::CompBinary(const IRInst &inst, void (XEmitter::*arith)(int, const OpArg &, const OpArg &), bool symmetric) {
+	X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+	X64Reg src2 = regs_.Map(inst.src2, X64IRRegCache::MAP_READ);
+	X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+	if (dest == src1) {
+		(this->*arith)(32, R(dest), R(src2));
+	} else if (dest == src2 && symmetric) {
+		(this->*arith)(32, R(dest), R(src1));
+	} else if (dest == src2) {
+		MOV(32, R(EAX), R(src1));
+		(this->*arith)(32, R(EAX), R(src2));
+		MOV(32, R(dest), R(EAX));
+	} else {
+		MOV(32, R(dest), R(src1));
+		(this->*arith)(32, R(dest), R(src2));
+	}
+}
+
+void X64IRJit::CompBinaryConst(const IRInst &inst, void (XEmitter::*arith)(int, const OpArg &, const OpArg &)) {
+	X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+	X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+	if (dest != src1)
+		MOV(32, R(dest), R(src1));
+	(this->*arith)(32, R(dest), Imm32(inst.constant));
+}
+
+void X64IRJit::CompShift(const IRInst &inst, void (XEmitter::*shift)(int, OpArg, OpArg)) {
+	X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+	X64Reg src2 = regs_.Map(inst.src2, X64IRRegCache::MAP_READ);
+	X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+	// x86 masks the count to 5 bits, just like MIPS.
+	MOV(32, R(ECX), R(src2));
+	if (dest != src1)
+		MOV(32, R(dest), R(src1));
+	(this->*shift)(32, R(dest), R(CL));
+}
+
+void X64IRJit::CompShiftImm(const IRInst &inst, void (XEmitter::*shift)(int, OpArg, OpArg)) {
+	X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+	X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+	if (dest != src1)
+		MOV(32, R(dest), R(src1));
+	if (inst.src2 != 0)
+		(this->*shift)(32, R(dest), Imm8(inst.src2));
+}
+
+void X64IRJit::CompCondExit(const IRInst &inst, CCFlags skipCC, bool compareReg) {
+	X64Reg lhs = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+	if (compareReg) {
+		X64Reg rhs = regs_.Map(inst.src2, X64IRRegCache::MAP_READ);
+		CMP(32, R(lhs), R(rhs));
+	} else {
+		CMP(32, R(lhs), Imm8(0));
+	}
+	FixupBranch skip = J_CC(skipCC, true);
+	regs_.WriteBackDirty(false);
+	WriteExit(inst.constant);
+	SetJumpTarget(skip);
+}
+
+void X64IRJit::EmitAddress(const IRInst &inst) {
+	X64Reg base = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+	if (inst.constant == 0)
+		MOV(32, R(EAX), R(base));
+	else
+		LEA(32, EAX, MDisp(base, (s32)inst.constant));
+#ifdef MASKED_PSP_MEMORY
+	AND(32, R(EAX), Imm32(Memory::MEMVIEW32_MASK));
+#endif
+}
+
+void X64IRJit::CompLoad(const IRInst &inst) {
+	EmitAddress(inst);
+	OpArg src = MComplex(MEMBASEREG, RAX, SCALE_1, 0);
+	X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+	switch (inst.op) {
+	case IROp::Load8: MOVZX(32, 8, dest, src); break;
+	case IROp::Load8Ext: MOVSX(32, 8, dest, src); break;
+	case IROp::Load16: MOVZX(32, 16, dest, src); break;
+	case IROp::Load16Ext: MOVSX(32, 16, dest, src); break;
+	case IROp::Load32: MOV(32, R(dest), src); break;
+	default:
+		_assert_(false);
+		break;
+	}
+}
+
+void X64IRJit::CompStore(const IRInst &inst) {
+	X64Reg value = regs_.Map(inst.src3, X64IRRegCache::MAP_READ);
+	EmitAddress(inst);
+	OpArg dest = MComplex(MEMBASEREG, RAX, SCALE_1, 0);
+	switch (inst.op) {
+	case IROp::Store8: MOV(8, dest, R(value)); break;
+	case IROp::Store16: MOV(16, dest, R(value)); break;
+	case IROp::Store32: MOV(32, dest, R(value)); break;
+	default:
+		_assert_(false);
+		break;
+	}
+}
+
+void X64IRJit::CompFPU3(const IRInst &inst, void (XEmitter::*arith)(X64Reg, OpArg)) {
+	MOVSS(XMM0, FPRArg(inst.src1));
+	(this->*arith)(XMM0, FPRArg(inst.src2));
+	MOVSS(FPRArg(inst.dest), XMM0);
+}
+
+void X64IRJit::CompVec4(const IRInst &inst, void (XEmitter::*arith)(X64Reg, OpArg)) {
+	MOVAPS(XMM0, FPRArg(inst.src1));
+	(this->*arith)(XMM0, FPRArg(inst.src2));
+	MOVAPS(FPRArg(inst.dest), XMM0);
+}
+
+void X64IRJit::CompMult(const IRInst &inst, bool isSigned, int accumulate) {
+	X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+	X64Reg src2 = regs_.Map(inst.src2, X64IRRegCache::MAP_READ);
+	// The low 64 bits of a 64-bit multiply are the full result of extended 32-bit inputs.
+	if (isSigned) {
+		MOVSX(64, 32, RAX, R(src1));
+		MOVSX(64, 32, RDX, R(src2));
+	} else {
+		MOV(32, R(EAX), R(src1));
+		MOV(32, R(EDX), R(src2));
+	}
+	IMUL(64, RAX, R(RDX));
+	// lo and hi are adjacent, so together they're a little endian 64-bit value.
+	if (accumulate > 0) {
+		ADD(64, MIPSSTATE_VAR(lo), R(RAX));
+	} else if (accumulate < 0) {
+		SUB(64, MIPSSTATE_VAR(lo), R(RAX));
+	} else {
+		MOV(64, MIPSSTATE_VAR(lo), R(RAX));
+	}
+}
+
+void X64IRJit::CompileIRInst(const IRInst &inst) {
+	const IRMeta *meta = GetIRMeta(inst.op);
+	for (int i = 0; i < 3; ++i) {
+		u8 reg = i == 0 ? inst.dest : (i == 1 ? inst.src1 : inst.src2);
+		if (meta->types[i] == 'G' && !X64IRRegCache::IsMappable(reg)) {
+			CompGeneric(inst);
+			return;
 		}
 	}
 
+	switch (inst.op) {
+	case IROp::Nop:
+		_assert_(false);
+		break;
+
+	case IROp::SetConst:
+	{
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		if (inst.constant == 0)
+			XOR(32, R(dest), R(dest));
+		else
+			MOV(32, R(dest), Imm32(inst.constant));
+		break;
+	}
+
+	case IROp::SetConstF:
+		MOV(32, FPRArg(inst.dest), Imm32(inst.constant));
+		break;
+
+	case IROp::Mov:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		if (dest != src1)
+			MOV(32, R(dest), R(src1));
+		break;
+	}
+
+	case IROp::Add:
+		if (inst.dest != inst.src1 && inst.dest != inst.src2) {
+			// Three operand add, LEA is perfect for this.
+			X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+			X64Reg src2 = regs_.Map(inst.src2, X64IRRegCache::MAP_READ);
+			X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+			LEA(32, dest, MRegSum(src1, src2));
+		} else {
+			CompBinary(inst, &XEmitter::ADD, true);
+		}
+		break;
+	case IROp::Sub: CompBinary(inst, &XEmitter::SUB, false); break;
+	case IROp::And: CompBinary(inst, &XEmitter::AND, true); break;
+	case IROp::Or: CompBinary(inst, &XEmitter::OR, true); break;
+	case IROp::Xor: CompBinary(inst, &XEmitter::XOR, true); break;
+
+	case IROp::AddConst:
+		if (inst.dest != inst.src1) {
+			X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+			X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+			LEA(32, dest, MDisp(src1, (s32)inst.constant));
+		} else {
+			CompBinaryConst(inst, &XEmitter::ADD);
+		}
+		break;
+	case IROp::SubConst: CompBinaryConst(inst, &XEmitter::SUB); break;
+	case IROp::AndConst: CompBinaryConst(inst, &XEmitter::AND); break;
+	case IROp::OrConst: CompBinaryConst(inst, &XEmitter::OR); break;
+	case IROp::XorConst: CompBinaryConst(inst, &XEmitter::XOR); break;
+
+	case IROp::Neg:
+	case IROp::Not:
+	case IROp::BSwap32:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		if (dest != src1)
+			MOV(32, R(dest), R(src1));
+		if (inst.op == IROp::Neg)
+			NEG(32, R(dest));
+		else if (inst.op == IROp::Not)
+			NOT(32, R(dest));
+		else
+			BSWAP(32, dest);
+		break;
+	}
+
+	case IROp::BSwap16:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		MOV(32, R(EAX), R(src1));
+		MOV(32, R(ECX), R(src1));
+		SHR(32, R(EAX), Imm8(8));
+		SHL(32, R(ECX), Imm8(8));
+		AND(32, R(EAX), Imm32(0x00FF00FF));
+		AND(32, R(ECX), Imm32(0xFF00FF00));
+		OR(32, R(EAX), R(ECX));
+		MOV(32, R(dest), R(EAX));
+		break;
+	}
+
+	case IROp::Ext8to32:
+	case IROp::Ext16to32:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		MOVSX(32, inst.op == IROp::Ext8to32 ? 8 : 16, dest, R(src1));
+		break;
+	}
+
+	case IROp::Shl: CompShift(inst, &XEmitter::SHL); break;
+	case IROp::Shr: CompShift(inst, &XEmitter::SHR); break;
+	case IROp::Sar: CompShift(inst, &XEmitter::SAR); break;
+	case IROp::Ror: CompShift(inst, &XEmitter::ROR); break;
+
+	case IROp::ShlImm: CompShiftImm(inst, &XEmitter::SHL); break;
+	case IROp::ShrImm: CompShiftImm(inst, &XEmitter::SHR); break;
+	case IROp::SarImm: CompShiftImm(inst, &XEmitter::SAR); break;
+	case IROp::RorImm: CompShiftImm(inst, &XEmitter::ROR); break;
+
+	case IROp::Slt:
+	case IROp::SltU:
+	case IROp::SltConst:
+	case IROp::SltUConst:
+	{
+		bool isConst = inst.op == IROp::SltConst || inst.op == IROp::SltUConst;
+		bool isUnsigned = inst.op == IROp::SltU || inst.op == IROp::SltUConst;
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		if (isConst) {
+			CMP(32, R(src1), Imm32(inst.constant));
+		} else {
+			X64Reg src2 = regs_.Map(inst.src2, X64IRRegCache::MAP_READ);
+			CMP(32, R(src1), R(src2));
+		}
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		SETcc(isUnsigned ? CC_B : CC_L, R(EAX));
+		MOVZX(32, 8, dest, R(EAX));
+		break;
+	}
+
+	case IROp::Clz:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		// BSR leaves the destination undefined for zero, so patch it to 63 (63 ^ 31 = 32.)
+		BSR(32, EAX, R(src1));
+		MOV(32, R(ECX), Imm32(63));
+		CMOVcc(32, EAX, R(ECX), CC_Z);
+		XOR(32, R(EAX), Imm8(31));
+		MOV(32, R(dest), R(EAX));
+		break;
+	}
+
+	case IROp::MovZ:
+	case IROp::MovNZ:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		X64Reg src2 = regs_.Map(inst.src2, X64IRRegCache::MAP_READ);
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_READWRITE);
+		TEST(32, R(src1), R(src1));
+		CMOVcc(32, dest, R(src2), inst.op == IROp::MovZ ? CC_Z : CC_NZ);
+		break;
+	}
+
+	case IROp::Max:
+	case IROp::Min:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		X64Reg src2 = regs_.Map(inst.src2, X64IRRegCache::MAP_READ);
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		MOV(32, R(EAX), R(src1));
+		CMP(32, R(src1), R(src2));
+		// Take src2 unless src1 wins the comparison.
+		CMOVcc(32, EAX, R(src2), inst.op == IROp::Max ? CC_LE : CC_GE);
+		MOV(32, R(dest), R(EAX));
+		break;
+	}
+
+	case IROp::MtLo:
+	case IROp::MtHi:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		MOV(32, inst.op == IROp::MtLo ? MIPSSTATE_VAR(lo) : MIPSSTATE_VAR(hi), R(src1));
+		break;
+	}
+	case IROp::MfLo:
+	case IROp::MfHi:
+	{
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		MOV(32, R(dest), inst.op == IROp::MfLo ? MIPSSTATE_VAR(lo) : MIPSSTATE_VAR(hi));
+		break;
+	}
+
+	case IROp::Mult: CompMult(inst, true, 0); break;
+	case IROp::MultU: CompMult(inst, false, 0); break;
+	case IROp::Madd: CompMult(inst, true, 1); break;
+	case IROp::MaddU: CompMult(inst, false, 1); break;
+	case IROp::Msub: CompMult(inst, true, -1); break;
+	case IROp::MsubU: CompMult(inst, false, -1); break;
+
+	case IROp::Load8:
+	case IROp::Load8Ext:
+	case IROp::Load16:
+	case IROp::Load16Ext:
+	case IROp::Load32:
+		CompLoad(inst);
+		break;
+
+	case IROp::Store8:
+	case IROp::Store16:
+	case IROp::Store32:
+		CompStore(inst);
+		break;
+
+	case IROp::LoadFloat:
+		EmitAddress(inst);
+		MOV(32, R(EAX), MComplex(MEMBASEREG, RAX, SCALE_1, 0));
+		MOV(32, FPRArg(inst.dest), R(EAX));
+		break;
+	case IROp::StoreFloat:
+		EmitAddress(inst);
+		MOV(32, R(ECX), FPRArg(inst.src3));
+		MOV(32, MComplex(MEMBASEREG, RAX, SCALE_1, 0), R(ECX));
+		break;
+	case IROp::LoadVec4:
+		EmitAddress(inst);
+		MOVUPS(XMM0, MComplex(MEMBASEREG, RAX, SCALE_1, 0));
+		MOVAPS(FPRArg(inst.dest), XMM0);
+		break;
+	case IROp::StoreVec4:
+		EmitAddress(inst);
+		MOVAPS(XMM0, FPRArg(inst.src3));
+		MOVUPS(MComplex(MEMBASEREG, RAX, SCALE_1, 0), XMM0);
+		break;
+
+	case IROp::FAdd: CompFPU3(inst, &XEmitter::ADDSS); break;
+	case IROp::FSub: CompFPU3(inst, &XEmitter::SUBSS); break;
+	case IROp::FDiv: CompFPU3(inst, &XEmitter::DIVSS); break;
+
+	case IROp::FMov:
+		MOV(32, R(EAX), FPRArg(inst.src1));
+		MOV(32, FPRArg(inst.dest), R(EAX));
+		break;
+	case IROp::FNeg:
+		MOV(32, R(EAX), FPRArg(inst.src1));
+		XOR(32, R(EAX), Imm32(0x80000000));
+		MOV(32, FPRArg(inst.dest), R(EAX));
+		break;
+	case IROp::FAbs:
+		MOV(32, R(EAX), FPRArg(inst.src1));
+		AND(32, R(EAX), Imm32(0x7FFFFFFF));
+		MOV(32, FPRArg(inst.dest), R(EAX));
+		break;
+	case IROp::FSqrt:
+		SQRTSS(XMM0, FPRArg(inst.src1));
+		MOVSS(FPRArg(inst.dest), XMM0);
+		break;
+
+	case IROp::FMovFromGPR:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		MOV(32, FPRArg(inst.dest), R(src1));
+		break;
+	}
+	case IROp::FMovToGPR:
+	{
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		MOV(32, R(dest), FPRArg(inst.src1));
+		break;
+	}
+	case IROp::FpCondToReg:
+	{
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		MOV(32, R(dest), MIPSSTATE_VAR(fpcond));
+		break;
+	}
+	case IROp::ZeroFpCond:
+		MOV(32, MIPSSTATE_VAR(fpcond), Imm32(0));
+		break;
+	case IROp::VfpuCtrlToReg:
+	{
+		X64Reg dest = regs_.Map(inst.dest, X64IRRegCache::MAP_WRITE);
+		MOV(32, R(dest), MIPSSTATE_VAR_ELEM32(vfpuCtrl[0], inst.src1));
+		break;
+	}
+	case IROp::SetCtrlVFPU:
+		MOV(32, MIPSSTATE_VAR_ELEM32(vfpuCtrl[0], inst.dest), Imm32(inst.constant));
+		break;
+	case IROp::SetCtrlVFPUReg:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		MOV(32, MIPSSTATE_VAR_ELEM32(vfpuCtrl[0], inst.dest), R(src1));
+		break;
+	}
+	case IROp::SetCtrlVFPUFReg:
+		MOV(32, R(EAX), FPRArg(inst.src1));
+		MOV(32, MIPSSTATE_VAR_ELEM32(vfpuCtrl[0], inst.dest), R(EAX));
+		break;
+
+	case IROp::Vec4Init:
+		MOV(PTRBITS, R(RAX), ImmPtr(vec4InitValues[inst.src1]));
+		MOVAPS(XMM0, MatR(RAX));
+		MOVAPS(FPRArg(inst.dest), XMM0);
+		break;
+	case IROp::Vec4Mov:
+		MOVAPS(XMM0, FPRArg(inst.src1));
+		MOVAPS(FPRArg(inst.dest), XMM0);
+		break;
+	case IROp::Vec4Add: CompVec4(inst, &XEmitter::ADDPS); break;
+	case IROp::Vec4Sub: CompVec4(inst, &XEmitter::SUBPS); break;
+	case IROp::Vec4Mul: CompVec4(inst, &XEmitter::MULPS); break;
+	case IROp::Vec4Div: CompVec4(inst, &XEmitter::DIVPS); break;
+	case IROp::Vec4Scale:
+		MOVSS(XMM1, FPRArg(inst.src2));
+		SHUFPS(XMM1, R(XMM1), 0);
+		MOVAPS(XMM0, FPRArg(inst.src1));
+		MULPS(XMM0, R(XMM1));
+		MOVAPS(FPRArg(inst.dest), XMM0);
+		break;
+	case IROp::Vec4Neg:
+	case IROp::Vec4Abs:
+		MOV(PTRBITS, R(RAX), ImmPtr(inst.op == IROp::Vec4Neg ? signBits : noSignMask));
+		MOVAPS(XMM0, FPRArg(inst.src1));
+		if (inst.op == IROp::Vec4Neg)
+			XORPS(XMM0, MatR(RAX));
+		else
+			ANDPS(XMM0, MatR(RAX));
+		MOVAPS(FPRArg(inst.dest), XMM0);
+		break;
+
+	case IROp::Downcount:
+		SUB(32, MIPSSTATE_VAR(downcount), Imm32(inst.constant));
+		break;
+	case IROp::SetPC:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		MOV(32, MIPSSTATE_VAR(pc), R(src1));
+		break;
+	}
+	case IROp::SetPCConst:
+		MOV(32, MIPSSTATE_VAR(pc), Imm32(inst.constant));
+		break;
+
+	case IROp::ExitToConst:
+		regs_.FlushAll(false);
+		WriteExit(inst.constant);
+		break;
+	case IROp::ExitToReg:
+	{
+		X64Reg src1 = regs_.Map(inst.src1, X64IRRegCache::MAP_READ);
+		MOV(32, R(EAX), R(src1));
+		regs_.FlushAll(false);
+		WriteExitEAX();
+		break;
+	}
+	case IROp::ExitToPC:
+		regs_.FlushAll(false);
+		MOV(32, R(EAX), MIPSSTATE_VAR(pc));
+		WriteExitEAX();
+		break;
+
+	// The CC passed is the one that skips the exit.
+	case IROp::ExitToConstIfEq: CompCondExit(inst, CC_NE, true); break;
+	case IROp::ExitToConstIfNeq: CompCondExit(inst, CC_E, true); break;
+	case IROp::ExitToConstIfGtZ: CompCondExit(inst, CC_LE, false); break;
+	case IROp::ExitToConstIfGeZ: CompCondExit(inst, CC_L, false); break;
+	case IROp::ExitToConstIfLtZ: CompCondExit(inst, CC_GE, false); break;
+	case IROp::ExitToConstIfLeZ: CompCondExit(inst, CC_G, false); break;
+
+	case IROp::ApplyRoundingMode:
+	case IROp::RestoreRoundingMode:
+	case IROp::UpdateRoundingMode:
+		// Not implemented by the IR interpreter either.
+		break;
+
+	default:
+		// Everything else is either rare or has tricky edge cases (FMul, Div, left/right memory ops, etc.)
+		CompGeneric(inst);
+		break;
+	}
+}
 
-}  // namespace
+}  // namespace MIPSComp
 
-#endif // PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+#endif // PPSSPP_ARCH(AMD64)
@@ -1,23 +1,151 @@
-#include "Core/MIPS/IR/IRInst.h"
+#pragma once
+
+#include "ppsspp_config.h"
+
+#if PPSSPP_ARCH(AMD64)
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include "Common/x64Emitter.h"
+#include "Core/MIPS/IR/IRInst.h"
+#include "Core/MIPS/IR/IRJit.h"
 
 namespace MIPSComp {
 
-class IRToNativeInterface {
+// Block-local register allocator for the IR GPRs (MIPS regs and IR temps.)
+// It walks the block once, and when it runs out of host registers, spills the one
+// whose next use is furthest away. Temps that are never read again are just dropped.
+class X64IRRegCache {
 public:
-	virtual ~IRToNativeInterface() {}
+	enum {
+		MAP_READ = 1,
+		MAP_WRITE = 2,
+		MAP_READWRITE = MAP_READ | MAP_WRITE,
+	};
 
-	virtual void ConvertIRToNative(const IRInst *instructions, int count, const u32 *constants) = 0;
-};
+	void Start(Gen::XEmitter *emit, const IRInst *instructions, int count);
+	void SetInstIndex(int index) { instIndex_ = index; }
 
+	static bool IsMappable(int reg);
 
-class IRToX86 : public IRToNativeInterface {
+	// Locks the host register until ReleaseSpillLocks().
+	Gen::X64Reg Map(int reg, int flags);
+	void ReleaseSpillLocks();
+
+	// Stores dirty registers but leaves the mapping alone. Used for conditional exits.
+	void WriteBackDirty(bool includeTemps);
+	// Stores dirty registers and forgets all mappings. Needed before calling into C++.
+	void FlushAll(bool includeTemps);
+
+private:
+	int NextUse(int reg) const;
+	Gen::X64Reg AllocHostReg();
+	void Release(Gen::X64Reg hostReg, bool writeBack);
+
+	struct HostReg {
+		int irReg = -1;
+		bool dirty = false;
+		bool locked = false;
+	};
+
+	Gen::XEmitter *emit_ = nullptr;
+	const IRInst *instructions_ = nullptr;
+	int count_ = 0;
+	int instIndex_ = 0;
+	HostReg hostRegs_[16];
+	Gen::X64Reg irToHost_[256];
+};
+
+// Runs the same IR as IRJit, but lowers each block to x86-64 instead of interpreting it.
+// Ops that aren't worth lowering call back into the IR interpreter one instruction at a time.
+//
+// Unless disabled, the lowering happens on a worker thread. Until a block's native code is
+// published (on the emu thread, between timeslices), it just runs on the IR interpreter.
+class X64IRJit : public IRJit, public Gen::XCodeBlock {
 public:
-	void SetCodeBlock(Gen::XCodeBlock *code) { code_ = code; }
-	virtual void ConvertIRToNative(const IRInst *instructions, int count, const u32 *constants) override;
+	X64IRJit(MIPSState *mipsState);
+	~X64IRJit();
+
+	void RunLoopUntil(u64 globalticks) override;
+	void ClearCache() override;
+
+	bool CodeInRange(const u8 *ptr) const override { return IsInSpace(ptr); }
+	bool DescribeCodePtr(const u8 *ptr, std::string &name) override;
+	const u8 *GetCrashHandler() const override { return crashHandler_; }
+
+	// For tests: compiles IR that isn't part of any block, to run with RunStandalone().
+	// The instructions must outlive the code, since ops that aren't lowered point back at them.
+	// Drops any queued background compiles, so those blocks stay on the IR interpreter.
+	const u8 *CompileStandalone(const IRInst *instructions, int count);
+	// Returns the exit PC, like IRInterpret().
+	u32 RunStandalone(const u8 *code) { return enterCode_(code); }
+
+protected:
+	bool CompileTargetBlock(IRBlock *block, int block_num, bool preload) override;
 
 private:
-	Gen::XCodeBlock *code_;
+	typedef u32 (*EnterCodeFunc)(const u8 *code);
+
+	struct AsyncJob {
+		int blockNum;
+		u64 ticket;
+		std::vector<IRInst> instructions;
+		int offset;
+	};
+	friend class X64IRCompileTask;
+
+	void GenerateFixedCode();
+	// Returns the code offset, or -1 when out of space.
+	int CompileInstructions(const IRInst *instructions, int count);
+	// Worker side: drains the queue, one job at a time.
+	void RunAsyncJobs();
+	// Emu thread: swaps in finished code for blocks whose IR hasn't changed since.
+	void PublishAsyncJobs();
+	// Drops queued jobs and waits for the one in progress, if any.
+	void CancelAsyncJobs();
+	void CompileIRInst(const IRInst &inst);
+	void CompGeneric(const IRInst &inst);
+	void CompBinary(const IRInst &inst, void (Gen::XEmitter::*arith)(int, const Gen::OpArg &, const Gen::OpArg &), bool symmetric);
+	void CompBinaryConst(const IRInst &inst, void (Gen::XEmitter::*arith)(int, const Gen::OpArg &, const Gen::OpArg &));
+	void CompShift(const IRInst &inst, void (Gen::XEmitter::*shift)(int, Gen::OpArg, Gen::OpArg));
+	void CompShiftImm(const IRInst &inst, void (Gen::XEmitter::*shift)(int, Gen::OpArg, Gen::OpArg));
+	void CompCondExit(const IRInst &inst, Gen::CCFlags skipCC, bool compareReg);
+	void CompLoad(const IRInst &inst);
+	void CompStore(const IRInst &inst);
+	void CompFPU3(const IRInst &inst, void (Gen::XEmitter::*arith)(Gen::X64Reg, Gen::OpArg));
+	void CompVec4(const IRInst &inst, void (Gen::XEmitter::*arith)(Gen::X64Reg, Gen::OpArg));
+	void CompMult(const IRInst &inst, bool isSigned, int accumulate);
+	// Leaves RAX pointing into PSP memory, ready for MComplex(MEMBASEREG, RAX, ...).
+	void EmitAddress(const IRInst &inst);
+	void WriteExit(u32 pc);
+	void WriteExitEAX();
+
+	X64IRRegCache regs_;
+
+	bool useAsyncCompile_ = false;
+	// Only touched on the emu thread. The latest ticket wins, so a stale result is just dropped.
+	u64 nextTicket_ = 0;
+	std::unordered_map<int, u64> pendingTickets_;
+	// Async code calls the IR interpreter with pointers into these, so they live until the code space is reset.
+	std::vector<std::vector<IRInst>> asyncInstructions_;
+
+	std::mutex asyncLock_;
+	std::condition_variable asyncIdle_;
+	std::deque<AsyncJob> asyncQueue_;
+	std::vector<AsyncJob> asyncDone_;
+	std::atomic<int> asyncDoneCount_{};
+	bool asyncRunning_ = false;
+
+	EnterCodeFunc enterCode_ = nullptr;
+	const u8 *exitCode_ = nullptr;
+	const u8 *crashHandler_ = nullptr;
 };
 
-}  // namespace
+}  // namespace MIPSComp
+
+#endif
@@ -351,6 +351,15 @@ const u8 *Jit::DoJit(u32 em_address, JitBlock *b) {
 
 	b->normalEntry = GetCodePtr();
 
+	if (jo.countBlockEntries) {
+		if (RipAccessible(&b->entryCount)) {
+			ADD(32, M(&b->entryCount), Imm8(1));  // rip accessible
+		} else {
+			MOV(PTRBITS, R(EAX), ImmPtr(&b->entryCount));
+			ADD(32, MatR(EAX), Imm8(1));
+		}
+	}
+
 	MIPSAnalyst::AnalysisResults analysis = MIPSAnalyst::Analyze(em_address);
 
 	gpr.Start(mips_, &js, &jo, analysis);
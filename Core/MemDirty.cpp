@@ -0,0 +1,164 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+
+#include <mutex>
+
+#if (PPSSPP_PLATFORM(LINUX) || PPSSPP_PLATFORM(ANDROID)) && PPSSPP_ARCH(64BIT)
+#define HAVE_SOFT_DIRTY
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Common/Log.h"
+#include "Core/MemDirty.h"
+#include "Core/MemMap.h"
+
+namespace Memory {
+
+#ifdef HAVE_SOFT_DIRTY
+
+// See Documentation/admin-guide/mm/soft-dirty.rst and pagemap.rst in the kernel.
+static const uint64_t PAGEMAP_SOFT_DIRTY = 1ULL << 55;
+static const uint64_t PAGEMAP_PRESENT = 1ULL << 63;
+
+static std::once_flag openOnce;
+static std::mutex probeLock;
+static bool probed = false;
+static bool available = false;
+static int pagemapFd = -1;
+static int clearRefsFd = -1;
+static uint32_t pageSize = 0;
+
+static bool ReadPagemap(const void *ptr, size_t count, std::vector<uint64_t> &entries) {
+	entries.resize(count);
+	off_t offset = (off_t)((uintptr_t)ptr / pageSize * sizeof(uint64_t));
+	size_t bytes = count * sizeof(uint64_t);
+	return pread(pagemapFd, entries.data(), bytes, offset) == (ssize_t)bytes;
+}
+
+static bool ClearSoftDirty() {
+	return pwrite(clearRefsFd, "4", 1, 0) == 1;
+}
+
+static bool IsSoftDirty(const u8 *host) {
+	std::vector<uint64_t> entries;
+	return ReadPagemap(host, 1, entries) && (entries[0] & PAGEMAP_SOFT_DIRTY) != 0;
+}
+
+static void OpenProcFiles() {
+	pageSize = (uint32_t)sysconf(_SC_PAGESIZE);
+	pagemapFd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	clearRefsFd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+}
+
+// PSP memory is a shared mapping with mirrors, which behaves differently from private memory,
+// so this checks on the first page of RAM itself.  Writing back the same value keeps it as it was.
+static bool ProbeArena() {
+	std::vector<u8 *> hosts;
+	ForEachHostMapping(PSP_GetKernelMemoryBase(), pageSize, [&](const u8 *host, u32 mappedAddress, u32 mappedSize) {
+		hosts.push_back(const_cast<u8 *>(host));
+	});
+	if (hosts.size() < 2)
+		return false;
+
+	volatile u8 *primary = hosts.front();
+	volatile u8 *mirror = hosts.back();
+	const u8 value = *primary;
+	// Kernels without soft-dirty support either reject the clear, or never set the bit.
+	bool clean = ClearSoftDirty() && !IsSoftDirty(hosts.front()) && !IsSoftDirty(hosts.back());
+	*primary = value;
+	bool dirty = IsSoftDirty(hosts.front());
+	clean = clean && ClearSoftDirty() && !IsSoftDirty(hosts.front());
+	*mirror = value;
+	dirty = dirty && IsSoftDirty(hosts.back());
+	return clean && dirty;
+}
+
+bool DirtyTrackingAvailable() {
+	std::call_once(openOnce, &OpenProcFiles);
+	if (pagemapFd < 0 || clearRefsFd < 0 || !IsActive())
+		return false;
+	// Collapsing pages of a shared mapping into a huge page drops their soft-dirty bits.
+	if (UsesHugePages())
+		return false;
+
+	std::lock_guard<std::mutex> guard(probeLock);
+	if (!probed) {
+		available = ProbeArena();
+		probed = true;
+		INFO_LOG(MEMMAP, "Soft-dirty page tracking %s", available ? "available" : "not available");
+	}
+	return available;
+}
+
+uint32_t DirtyPageSize() {
+	std::call_once(openOnce, &OpenProcFiles);
+	return pageSize;
+}
+
+bool ResetDirtyPages() {
+	return DirtyTrackingAvailable() && ClearSoftDirty();
+}
+
+bool CollectDirtyPages(uint32_t address, uint32_t size, std::vector<bool> &dirty, size_t firstIndex) {
+	if (!DirtyTrackingAvailable())
+		return false;
+	_dbg_assert_((address & (pageSize - 1)) == 0 && (size & (pageSize - 1)) == 0);
+
+	bool success = true;
+	std::vector<uint64_t> entries;
+	ForEachHostMapping(address, size, [&](const u8 *host, u32 mappedAddress, u32 mappedSize) {
+		if (!success || !ReadPagemap(host, mappedSize / pageSize, entries)) {
+			success = false;
+			return;
+		}
+		// Pages of a shared mapping lose their soft-dirty bit when the kernel unmaps them, like under
+		// memory pressure.  Callers read through the main view, so a missing page there counts as written.
+		const bool primary = host == GetPointerUnchecked(mappedAddress);
+		size_t index = firstIndex + (mappedAddress - address) / pageSize;
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if ((entries[i] & PAGEMAP_SOFT_DIRTY) || (primary && !(entries[i] & PAGEMAP_PRESENT)))
+				dirty[index + i] = true;
+		}
+	});
+	return success;
+}
+
+#else
+
+bool DirtyTrackingAvailable() {
+	return false;
+}
+
+uint32_t DirtyPageSize() {
+	return 0;
+}
+
+bool ResetDirtyPages() {
+	return false;
+}
+
+bool CollectDirtyPages(uint32_t address, uint32_t size, std::vector<bool> &dirty, size_t firstIndex) {
+	return false;
+}
+
+#endif
+
+}  // namespace Memory
@@ -0,0 +1,41 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Memory {
+
+// Tracks which pages of PSP memory have been written, by anything: the cpu, HLE, the GPU,
+// or the host OS reading files straight into it. Mirrors count as writes to the same page.
+//
+// Currently uses the kernel's soft-dirty page bits, so it only works on 64-bit Linux and
+// Android kernels built with CONFIG_MEM_SOFT_DIRTY, and not with huge pages. It's checked on
+// the mapped memory itself, so it's only available after Memory::Init(). Elsewhere, callers
+// should copy everything.
+bool DirtyTrackingAvailable();
+uint32_t DirtyPageSize();
+
+// Forgets all writes so far. Note that this affects the whole process.
+bool ResetDirtyPages();
+// Sets dirty[i] when the page at address + i * DirtyPageSize() was written since the last reset.
+// Leaves other entries alone, so several ranges can be collected into one vector.
+bool CollectDirtyPages(uint32_t address, uint32_t size, std::vector<bool> &dirty, size_t firstIndex = 0);
+
+}
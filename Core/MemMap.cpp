@@ -80,6 +80,8 @@ u32 g_PSPModel;
 
 std::recursive_mutex g_shutdownLock;
 
+static TrackedStateHook trackedStateHook;
+
 // We don't declare the IO region in here since its handled by other means.
 static MemoryView views[] =
 {
@@ -202,6 +204,9 @@ bool MemoryMap_Setup(u32 flags) {
 	base = (u8*)VirtualAllocFromApp(0, 0x10000000, MEM_RESERVE, PAGE_READWRITE);
 #else
 
+	// Has to be decided before sizes are rounded.
+	g_arena.SetHugePages(g_Config.bHugePageMemory);
+
 	// Figure out how much memory we need to allocate in total.
 	size_t total_mem = 0;
 	for (int i = 0; i < num_views; i++) {
@@ -313,6 +318,8 @@ void Reinit() {
 
 static void DoMemoryVoid(PointerWrap &p, uint32_t start, uint32_t size) {
 	uint8_t *d = GetPointer(start);
+	// This may move a growable buffer, so it has to come before grabbing the pointer.
+	p.Reserve(size);
 	uint8_t *&storage = *p.ptr;
 
 	// We only handle aligned data and sizes.
@@ -339,6 +346,31 @@ static void DoMemoryVoid(PointerWrap &p, uint32_t start, uint32_t size) {
 	storage += size;
 }
 
+void SetTrackedStateHook(TrackedStateHook hook) {
+	trackedStateHook = hook;
+}
+
+bool UsesHugePages() {
+	return g_arena.UsesHugePages();
+}
+
+void ForEachHostMapping(u32 address, u32 size, const std::function<void(const u8 *host, u32 address, u32 size)> &func) {
+	u32 groupAddress = 0;
+	for (int i = 0; i < num_views; i++) {
+		const MemoryView &view = views[i];
+		// Mirrors follow the view they mirror.
+		if (!(view.flags & MV_MIRROR_PREVIOUS))
+			groupAddress = view.virtual_address;
+		if (view.size == 0 || !*view.out_ptr || CanIgnoreView(view))
+			continue;
+
+		u32 start = std::max(address, groupAddress);
+		u32 end = std::min(address + size, groupAddress + view.size);
+		if (start < end)
+			func(*view.out_ptr + (start - groupAddress), start, end - start);
+	}
+}
+
 void DoState(PointerWrap &p) {
 	auto s = p.Section("Memory", 1, 3);
 	if (!s)
@@ -371,11 +403,17 @@ void DoState(PointerWrap &p) {
 		}
 	}
 
-	DoMemoryVoid(p, PSP_GetKernelMemoryBase(), g_MemorySize);
-	p.DoMarker("RAM");
+	if (trackedStateHook) {
+		trackedStateHook(p);
+		p.DoMarker("RAM");
+		p.DoMarker("VRAM");
+	} else {
+		DoMemoryVoid(p, PSP_GetKernelMemoryBase(), g_MemorySize);
+		p.DoMarker("RAM");
 
-	DoMemoryVoid(p, PSP_GetVidMemBase(), VRAM_SIZE);
-	p.DoMarker("VRAM");
+		DoMemoryVoid(p, PSP_GetVidMemBase(), VRAM_SIZE);
+		p.DoMarker("VRAM");
+	}
 	DoArray(p, m_pPhysicalScratchPad, SCRATCHPAD_SIZE);
 	p.DoMarker("ScratchPad");
 }
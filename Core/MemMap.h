@@ -21,6 +21,7 @@
 
 #include <cstring>
 #include <cstdint>
+#include <functional>
 #ifndef offsetof
 #include <stddef.h>
 #endif
@@ -118,6 +119,17 @@ void Clear();
 // False when shutdown has already been called.
 bool IsActive();
 
+// While set, DoState calls this instead of saving or loading RAM and VRAM.
+// Rewind and snapshots use it to keep those separately, as pages.
+typedef std::function<void(PointerWrap &p)> TrackedStateHook;
+void SetTrackedStateHook(TrackedStateHook hook);
+
+// Calls func with the host pointer of every mapping of [address, address + size), mirrors included.
+// The address passed along is where that piece starts in the non-mirrored range.
+void ForEachHostMapping(u32 address, u32 size, const std::function<void(const u8 *host, u32 address, u32 size)> &func);
+// Whether the views were asked to use transparent huge pages, see MemArena::SetHugePages().
+bool UsesHugePages();
+
 class MemoryInitedLock {
 public:
 	MemoryInitedLock();
@@ -0,0 +1,202 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/Log.h"
+#include "Common/TimeUtil.h"
+#include "Core/Config.h"
+#include "Core/Core.h"
+#include "Core/CoreParameter.h"
+#include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/Replay.h"
+#include "Core/RunAhead.h"
+#include "Core/SaveState.h"
+#include "Core/System.h"
+#include "GPU/Debugger/Record.h"
+#include "GPU/GPU.h"
+#include "GPU/GPUInterface.h"
+#include "GPU/GPUState.h"
+
+namespace RunAhead {
+
+static std::vector<u8> state;
+// Code that changed while running ahead. Blocks compiled from it are wrong once we roll back.
+static std::vector<std::pair<u32, int>> invalidatedRanges;
+
+struct RunAheadStats {
+	int frames = 0;
+	size_t stateSize = 0;
+	// Moving averages, in seconds.
+	double saveTime = 0.0;
+	double loadTime = 0.0;
+	double aheadTime = 0.0;
+	double maxSaveTime = 0.0;
+	double maxLoadTime = 0.0;
+	int failures = 0;
+};
+static RunAheadStats stats;
+
+static void UpdateAverage(double &avg, double value) {
+	const double ALPHA = 0.1;
+	avg = avg == 0.0 ? value : avg * (1.0 - ALPHA) + value * ALPHA;
+}
+
+static bool CanRunAhead() {
+	if (g_Config.iRunAheadFrames <= 0)
+		return false;
+	const CoreParameter &param = PSP_CoreParameter();
+	// Freeze-frame already loads a state every frame.
+	if (param.frozen || param.freezeNext || coreState != CORE_RUNNING)
+		return false;
+	// Replays and GE dumps record what actually happens, and other players can't be rolled back.
+	if (ReplayIsExecuting() || ReplayIsSaving() || GPURecord::IsActivePending() || g_Config.bEnableWlan)
+		return false;
+	return true;
+}
+
+static void RunOneFrame() {
+	coreState = CORE_RUNNING;
+	PSP_RunLoopWhileState();
+}
+
+void RunFrame() {
+	if (!CanRunAhead()) {
+		stats.frames = 0;
+		PSP_RunLoopWhileState();
+		return;
+	}
+
+	CoreParameter &param = PSP_CoreParameter();
+	const int frames = g_Config.iRunAheadFrames;
+
+	// The real frame. We hear it, but what it draws gets replaced by the last frame we run ahead.
+	param.presentFrame = false;
+	PSP_RunLoopWhileState();
+	param.presentFrame = true;
+	if (coreState != CORE_NEXTFRAME) {
+		// Paused, stepping, or crashed. Nothing to run ahead of.
+		return;
+	}
+
+	double start = time_now_d();
+	CChunkFileReader::Error err = SaveState::SaveToRam(state);
+	double saveTime = time_now_d() - start;
+	if (err != CChunkFileReader::ERROR_NONE) {
+		ERROR_LOG(SAVESTATE, "Run-ahead: failed to save state");
+		stats.failures++;
+		gpu->CopyDisplayToOutput(true);
+		return;
+	}
+
+	start = time_now_d();
+	param.runningAhead = true;
+	invalidatedRanges.clear();
+	for (int i = 0; i < frames; ++i) {
+		const bool last = i == frames - 1;
+		// Nobody will see the frames in between, so they're skipped like with frameskip.
+		if (last)
+			gstate_c.skipDrawReason &= ~SKIPDRAW_SKIPFRAME;
+		else
+			gstate_c.skipDrawReason |= SKIPDRAW_SKIPFRAME;
+		param.presentFrame = last;
+		RunOneFrame();
+		if (coreState != CORE_NEXTFRAME)
+			break;
+	}
+	param.presentFrame = true;
+	double aheadTime = time_now_d() - start;
+
+	if (coreState == CORE_POWERDOWN || coreState == CORE_BOOT_ERROR) {
+		param.runningAhead = false;
+		return;
+	}
+	const bool reachedEnd = coreState == CORE_NEXTFRAME;
+
+	start = time_now_d();
+	std::string errorString;
+	err = SaveState::LoadFromRam(state, &errorString);
+	double loadTime = time_now_d() - start;
+	param.runningAhead = false;
+	invalidatedRanges.clear();
+
+	if (err != CChunkFileReader::ERROR_NONE) {
+		// This shouldn't happen, but there's no good way to recover.
+		ERROR_LOG(SAVESTATE, "Run-ahead: failed to load state back (%s)", errorString.c_str());
+		Core_EnableStepping(true, "runahead.load", 0);
+		stats.failures++;
+		return;
+	}
+
+	if (!reachedEnd) {
+		if (coreState == CORE_RUNTIME_ERROR) {
+			// If it's real, we'll hit it again in a few frames.
+			Core_ResetException();
+			coreState = CORE_NEXTFRAME;
+		}
+		// Stepping (like a breakpoint) stays, but shows the real state now.
+		gpu->CopyDisplayToOutput(true);
+	}
+
+	stats.frames = frames;
+	stats.stateSize = state.size();
+	UpdateAverage(stats.saveTime, saveTime);
+	UpdateAverage(stats.loadTime, loadTime);
+	UpdateAverage(stats.aheadTime, aheadTime);
+	stats.maxSaveTime = std::max(stats.maxSaveTime, saveTime);
+	stats.maxLoadTime = std::max(stats.maxLoadTime, loadTime);
+}
+
+void Shutdown() {
+	state.clear();
+	state.shrink_to_fit();
+	invalidatedRanges.clear();
+	stats = RunAheadStats();
+}
+
+void NotifyInvalidateICache(u32 address, int length) {
+	if (PSP_CoreParameter().runningAhead)
+		invalidatedRanges.push_back(std::make_pair(address, length));
+}
+
+void RestoreJitAfterLoad() {
+	// Lock is held by the caller.
+	for (const auto &range : invalidatedRanges)
+		MIPSComp::jit->InvalidateCacheAt(range.first, range.second);
+	invalidatedRanges.clear();
+}
+
+void GetDebugStats(char *buffer, size_t bufSize) {
+	if (stats.frames == 0) {
+		snprintf(buffer, bufSize, "Run-ahead: off\n");
+		return;
+	}
+
+	snprintf(buffer, bufSize,
+		"Run-ahead: %d frames, state %0.1f MB, %d failures\n"
+		"Run-ahead save: %0.2f ms (max %0.2f), load: %0.2f ms (max %0.2f), ahead: %0.2f ms\n",
+		stats.frames, stats.stateSize / (1024.0 * 1024.0), stats.failures,
+		stats.saveTime * 1000.0, stats.maxSaveTime * 1000.0,
+		stats.loadTime * 1000.0, stats.maxLoadTime * 1000.0,
+		stats.aheadTime * 1000.0);
+}
+
+}  // namespace RunAhead
@@ -0,0 +1,44 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Run-ahead hides input lag by showing the future. Each host frame, we run the real frame,
+// save state to RAM, run g_Config.iRunAheadFrames more frames with the same input, show the
+// last one, and then load the state back. Audio comes from the real frame only.
+//
+// While frames are run ahead and rolled back, PSP_CoreParameter().runningAhead is set.
+// During that time savestate operations wait, and like freeze-frame, loading the state keeps
+// the GPU's framebuffers and caches. The jit's blocks are kept too.
+namespace RunAhead {
+
+// Replaces PSP_RunLoopWhileState() in the frontend.
+void RunFrame();
+// Frees the saved state, called on shutdown.
+void Shutdown();
+
+// Called when code may have changed, so that blocks compiled ahead can be dropped after rolling back.
+void NotifyInvalidateICache(uint32_t address, int length);
+// Called after memory is loaded back, with the jit still around.
+void RestoreJitAfterLoad();
+
+void GetDebugStats(char *buffer, size_t bufSize);
+
+}  // namespace RunAhead
@@ -16,11 +16,15 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <vector>
 #include <thread>
 #include <mutex>
 
 #include "Common/Data/Text/I18n.h"
+#include "Common/Thread/ThreadManager.h"
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/Data/Text/Parsers.h"
 
@@ -35,6 +39,7 @@
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
 #include "Core/Host.h"
+#include "Core/RunAhead.h"
 #include "Core/Screenshot.h"
 #include "Core/System.h"
 #include "Core/FileSystems/MetaFileSystem.h"
@@ -44,11 +49,13 @@
 #include "Core/HLE/ReplaceTables.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/HLE/sceUtility.h"
+#include "Core/MemDirty.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
 #include "HW/MemoryStick.h"
 #include "GPU/GPUState.h"
+#include "GPU/Common/GPUDebugInterface.h"
 
 #ifndef MOBILE_DEVICE
 #include "Core/AVIDump.h"
@@ -89,12 +96,13 @@ namespace SaveState
 		void *cbUserData;
 	};
 
-	CChunkFileReader::Error SaveToRam(std::vector<u8> &data) {
+	CChunkFileReader::Error SaveToRam(std::vector<u8> &data, std::vector<PointerWrapSectionStat> *stats) {
 		SaveStart state;
-		size_t sz = CChunkFileReader::MeasurePtr(state);
-		if (data.size() < sz)
-			data.resize(sz);
-		return CChunkFileReader::SavePtr(&data[0], state, sz);
+		size_t sz = 0;
+		CChunkFileReader::Error err = CChunkFileReader::SaveToBuffer(data, state, &sz, stats);
+		// Shrinking keeps the capacity, so the next save usually won't allocate.
+		data.resize(sz);
+		return err;
 	}
 
 	CChunkFileReader::Error LoadFromRam(std::vector<u8> &data, std::string *errorString) {
@@ -104,10 +112,19 @@ namespace SaveState
 
 	struct StateRingbuffer
 	{
+		typedef std::vector<u8> StateBuffer;
+		struct TrackedPages
+		{
+			std::vector<u32> pages;
+			std::vector<u8> data;
+		};
+
 		StateRingbuffer(int size) : first_(0), next_(0), size_(size), base_(-1)
 		{
 			states_.resize(size);
 			baseMapping_.resize(size);
+			tracked_.resize(size);
+			trackedPages_.resize(size);
 		}
 
 		CChunkFileReader::Error Save()
@@ -122,7 +139,21 @@ namespace SaveState
 			std::vector<u8> *compressBuffer = &buffer;
 			CChunkFileReader::Error err;
 
-			if (base_ == -1 || ++baseUsage_ > BASE_USAGE_INTERVAL)
+			// When we can tell which pages were written, RAM and VRAM are kept aside as pages changed since the base.
+			// That way a snapshot costs about the working set, instead of serializing and diffing all of RAM.
+			const bool tracked = Memory::DirtyTrackingAvailable();
+			bool newBase = base_ == -1 || ++baseUsage_ > BASE_USAGE_INTERVAL;
+			if (tracked && changedSinceBase_.size() != TrackedSize() / Memory::DirtyPageSize())
+				newBase = true;
+			if (tracked)
+			{
+				Memory::SetTrackedStateHook([&](PointerWrap &p) {
+					if (p.mode == PointerWrap::MODE_WRITE)
+						CaptureTracked(trackedPages_[n], newBase);
+				});
+			}
+
+			if (newBase)
 			{
 				base_ = (base_ + 1) % ARRAY_SIZE(bases_);
 				baseUsage_ = 0;
@@ -133,6 +164,13 @@ namespace SaveState
 			else
 				err = SaveToRam(buffer);
 
+			if (tracked)
+				Memory::SetTrackedStateHook(nullptr);
+			tracked_[n] = tracked;
+			// Don't diff against a base that might not have been captured.
+			if (err != CChunkFileReader::ERROR_NONE)
+				changedSinceBase_.clear();
+
 			if (err == CChunkFileReader::ERROR_NONE)
 				ScheduleCompress(&states_[n], compressBuffer, &bases_[base_]);
 			else
@@ -155,7 +193,89 @@ namespace SaveState
 
 			static std::vector<u8> buffer;
 			LockedDecompress(buffer, states_[n], bases_[baseMapping_[n]]);
-			return LoadFromRam(buffer, errorString);
+			if (!tracked_[n])
+				return LoadFromRam(buffer, errorString);
+
+			const TrackedPages &pages = trackedPages_[n];
+			const StateBuffer &base = trackedBases_[baseMapping_[n]];
+			Memory::SetTrackedStateHook([&](PointerWrap &p) {
+				if (p.mode == PointerWrap::MODE_READ)
+					RestoreTracked(p, pages, base);
+			});
+			CChunkFileReader::Error err = LoadFromRam(buffer, errorString);
+			Memory::SetTrackedStateHook(nullptr);
+			return err;
+		}
+
+		static size_t TrackedSize()
+		{
+			return Memory::g_MemorySize + Memory::VRAM_SIZE;
+		}
+
+		// RAM, then VRAM.
+		static u8 *TrackedPointer(size_t offset)
+		{
+			if (offset < Memory::g_MemorySize)
+				return Memory::GetPointerUnchecked(PSP_GetKernelMemoryBase() + (u32)offset);
+			return Memory::GetPointerUnchecked(PSP_GetVidMemBase() + (u32)(offset - Memory::g_MemorySize));
+		}
+
+		// Runs where Memory::DoState would've saved RAM and VRAM, so emuhacks and replacements are already cleared.
+		void CaptureTracked(TrackedPages &result, bool newBase)
+		{
+			const u32 pageSize = Memory::DirtyPageSize();
+			const size_t numPages = TrackedSize() / pageSize;
+			result.pages.clear();
+			result.data.clear();
+
+			if (newBase)
+			{
+				// Anything written from here on shows up in the next snapshot.
+				Memory::ResetDirtyPages();
+				StateBuffer &base = trackedBases_[base_];
+				base.resize(TrackedSize());
+				memcpy(&base[0], TrackedPointer(0), Memory::g_MemorySize);
+				memcpy(&base[Memory::g_MemorySize], TrackedPointer(Memory::g_MemorySize), Memory::VRAM_SIZE);
+				changedSinceBase_.assign(numPages, false);
+				return;
+			}
+
+			dirtyPages_.assign(numPages, false);
+			bool collected = Memory::CollectDirtyPages(PSP_GetKernelMemoryBase(), Memory::g_MemorySize, dirtyPages_, 0);
+			collected = collected && Memory::CollectDirtyPages(PSP_GetVidMemBase(), Memory::VRAM_SIZE, dirtyPages_, Memory::g_MemorySize / pageSize);
+			// Right away, so that only writes from other threads in between could slip through.
+			Memory::ResetDirtyPages();
+			if (!collected)
+				dirtyPages_.assign(numPages, true);
+
+			// Written pages may still match the base, like code pages that only had emuhacks put back.
+			const StateBuffer &base = trackedBases_[base_];
+			for (size_t i = 0; i < numPages; ++i)
+			{
+				const u8 *page = TrackedPointer(i * pageSize);
+				if (dirtyPages_[i] && !changedSinceBase_[i] && memcmp(page, &base[i * pageSize], pageSize) != 0)
+					changedSinceBase_[i] = true;
+				if (changedSinceBase_[i])
+				{
+					result.pages.push_back((u32)i);
+					result.data.insert(result.data.end(), page, page + pageSize);
+				}
+			}
+		}
+
+		void RestoreTracked(PointerWrap &p, const TrackedPages &pages, const StateBuffer &base)
+		{
+			if (base.size() != TrackedSize())
+			{
+				p.SetError(PointerWrap::ERROR_FAILURE);
+				return;
+			}
+
+			memcpy(TrackedPointer(0), &base[0], Memory::g_MemorySize);
+			memcpy(TrackedPointer(Memory::g_MemorySize), &base[Memory::g_MemorySize], Memory::VRAM_SIZE);
+			const u32 pageSize = Memory::DirtyPageSize();
+			for (size_t i = 0; i < pages.pages.size(); ++i)
+				memcpy(TrackedPointer(pages.pages[i] * pageSize), &pages.data[i * pageSize], pageSize);
 		}
 
 		void ScheduleCompress(std::vector<u8> *result, const std::vector<u8> *state, const std::vector<u8> *base)
@@ -223,6 +343,8 @@ namespace SaveState
 			std::lock_guard<std::mutex> guard(lock_);
 			first_ = 0;
 			next_ = 0;
+			// Forces a new base for the tracked pages.
+			changedSinceBase_.clear();
 		}
 
 		bool Empty() const
@@ -234,8 +356,6 @@ namespace SaveState
 		// TODO: Instead, based on size of compressed state?
 		static const int BASE_USAGE_INTERVAL;
 
-		typedef std::vector<u8> StateBuffer;
-
 		int first_;
 		int next_;
 		int size_;
@@ -246,14 +366,199 @@ namespace SaveState
 		std::mutex lock_;
 		std::thread compressThread_;
 
+		// Whether each state keeps RAM and VRAM in trackedPages_ rather than in the state itself.
+		std::vector<bool> tracked_;
+		std::vector<TrackedPages> trackedPages_;
+		StateBuffer trackedBases_[2];
+		std::vector<bool> changedSinceBase_;
+		std::vector<bool> dirtyPages_;
+
 		int base_;
 		int baseUsage_;
 	};
 
+	// Snapshots kept in memory, for automated runs that take a lot of them from one boot.
+	// RAM and VRAM are split into pages that snapshots share, so only pages written since the last
+	// snapshot (or restore) get copied. Only the rest of the state is serialized.
+	class SnapshotStore
+	{
+	public:
+		typedef std::shared_ptr<const std::vector<u8>> Page;
+
+		int Take()
+		{
+			Snapshot snapshot;
+			Memory::SetTrackedStateHook([&](PointerWrap &p) {
+				if (p.mode == PointerWrap::MODE_WRITE)
+					CapturePages(snapshot.pages);
+			});
+			CChunkFileReader::Error err = SaveToRam(snapshot.state);
+			Memory::SetTrackedStateHook(nullptr);
+			if (err != CChunkFileReader::ERROR_NONE)
+				return -1;
+
+			snapshot.state.shrink_to_fit();
+			snapshots_.push_back(std::move(snapshot));
+			return (int)snapshots_.size() - 1;
+		}
+
+		CChunkFileReader::Error Restore(int id, std::string *errorString)
+		{
+			if (id < 0 || id >= (int)snapshots_.size())
+				return CChunkFileReader::ERROR_BAD_FILE;
+
+			Snapshot &snapshot = snapshots_[id];
+			Memory::SetTrackedStateHook([&](PointerWrap &p) {
+				if (p.mode == PointerWrap::MODE_READ)
+					RestorePages(p, snapshot.pages);
+			});
+			CChunkFileReader::Error err = LoadFromRam(snapshot.state, errorString);
+			Memory::SetTrackedStateHook(nullptr);
+			return err;
+		}
+
+		void Clear()
+		{
+			snapshots_.clear();
+			live_.clear();
+			uniquePages_ = 0;
+		}
+
+		int Count() const
+		{
+			return (int)snapshots_.size();
+		}
+
+		size_t MemoryUsage() const
+		{
+			size_t total = uniquePages_ * PageSize();
+			for (const Snapshot &snapshot : snapshots_)
+				total += snapshot.state.capacity() + snapshot.pages.size() * sizeof(Page);
+			return total;
+		}
+
+	private:
+		struct Snapshot
+		{
+			std::vector<u8> state;
+			std::vector<Page> pages;
+		};
+
+		static u32 PageSize()
+		{
+			// Without dirty tracking, pages are only compared, so any size would do.
+			return Memory::DirtyTrackingAvailable() ? Memory::DirtyPageSize() : 4096;
+		}
+
+		static bool UseDirtyTracking()
+		{
+			// Rewind resets the same dirty bits, so then we'd miss writes.
+			return Memory::DirtyTrackingAvailable() && g_Config.iRewindFlipFrequency == 0;
+		}
+
+		// Which pages might not match live_ anymore.
+		void FindChangedPages(std::vector<bool> &changed, size_t numPages)
+		{
+			const bool known = live_.size() == numPages;
+			changed.assign(numPages, !known);
+			if (!known)
+				return;
+
+			const u32 pageSize = PageSize();
+			bool collected = UseDirtyTracking();
+			collected = collected && Memory::CollectDirtyPages(PSP_GetKernelMemoryBase(), Memory::g_MemorySize, changed, 0);
+			collected = collected && Memory::CollectDirtyPages(PSP_GetVidMemBase(), Memory::VRAM_SIZE, changed, Memory::g_MemorySize / pageSize);
+			if (!collected)
+				changed.assign(numPages, true);
+		}
+
+		// Runs where Memory::DoState would've saved RAM and VRAM, so emuhacks and replacements are already cleared.
+		void CapturePages(std::vector<Page> &pages)
+		{
+			const u32 pageSize = PageSize();
+			const size_t numPages = StateRingbuffer::TrackedSize() / pageSize;
+			FindChangedPages(changed_, numPages);
+			if (UseDirtyTracking())
+				Memory::ResetDirtyPages();
+
+			const bool known = live_.size() == numPages;
+			pages.resize(numPages);
+			for (size_t i = 0; i < numPages; ++i)
+			{
+				const u8 *data = StateRingbuffer::TrackedPointer(i * pageSize);
+				// Written pages often still match, like code pages that only had emuhacks put back.
+				if (known && (!changed_[i] || memcmp(live_[i]->data(), data, pageSize) == 0))
+				{
+					pages[i] = live_[i];
+				}
+				else
+				{
+					pages[i] = std::make_shared<const std::vector<u8>>(data, data + pageSize);
+					uniquePages_++;
+				}
+			}
+			live_ = pages;
+		}
+
+		void RestorePages(PointerWrap &p, const std::vector<Page> &pages)
+		{
+			const u32 pageSize = PageSize();
+			const size_t numPages = StateRingbuffer::TrackedSize() / pageSize;
+			if (pages.size() != numPages)
+			{
+				p.SetError(PointerWrap::ERROR_FAILURE);
+				return;
+			}
+
+			FindChangedPages(changed_, numPages);
+			for (size_t i = 0; i < numPages; ++i)
+			{
+				if (changed_[i] || live_[i] != pages[i])
+					memcpy(StateRingbuffer::TrackedPointer(i * pageSize), pages[i]->data(), pageSize);
+			}
+			// Our own copies don't count as changes.
+			if (UseDirtyTracking())
+				Memory::ResetDirtyPages();
+			live_ = pages;
+		}
+
+		std::vector<Snapshot> snapshots_;
+		// What RAM and VRAM held after the last take or restore, or empty if unknown.
+		std::vector<Page> live_;
+		std::vector<bool> changed_;
+		size_t uniquePages_ = 0;
+	};
+
 	static bool needsProcess = false;
 	static bool needsRestart = false;
 	static std::vector<Operation> pending;
 	static std::mutex mutex;
+
+	// A save (or its screenshot) that's been copied out of the emulator, waiting to be compressed and written.
+	struct PendingSave {
+		Path filename;
+		std::string title;
+		std::vector<u8> data;
+		size_t size = 0;
+
+		Path screenshotFilename;
+		GPUDebugBuffer screenshot;
+		u32 screenshotW = 0;
+		u32 screenshotH = 0;
+
+		Callback callback;
+		void *cbUserData = nullptr;
+		std::string successMessage;
+		std::string failureMessage;
+	};
+
+	// Pending saves are written in order on a single IO thread, so renames in callbacks don't race.
+	static std::mutex pendingSaveLock;
+	static std::condition_variable pendingSaveIdle;
+	static std::deque<PendingSave> pendingSaves;
+	static bool pendingSaveRunning = false;
+	// The last written buffer is kept, so most saves won't need to allocate.
+	static std::vector<u8> spareSaveBuffer;
 	static int screenshotFailures = 0;
 	static bool hasLoadedState = false;
 	static const int STALE_STATE_USES = 2;
@@ -268,6 +573,7 @@ namespace SaveState
 	static const int REWIND_NUM_STATES = 20;
 	static const int SCREENSHOT_FAILURE_RETRIES = 15;
 	static StateRingbuffer rewindStates(REWIND_NUM_STATES);
+	static SnapshotStore snapshots;
 	// TODO: Any reason for this to be configurable?
 	const static float rewindMaxWallFrequency = 1.0f;
 	static double rewindLastTime = 0.0f;
@@ -313,6 +619,14 @@ namespace SaveState
 			} else {
 				Memory::DoState(p);
 			}
+		} else if (MIPSComp::jit && PSP_CoreParameter().runningAhead) {
+			// Rolling back after running ahead keeps the jit's blocks. The state's memory has no emuhacks.
+			std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
+			std::vector<u32> savedBlocks;
+			savedBlocks = MIPSComp::jit->SaveAndClearEmuHackOps();
+			Memory::DoState(p);
+			MIPSComp::jit->RestoreSavedEmuHackOps(savedBlocks);
+			RunAhead::RestoreJitAfterLoad();
 		} else {
 			Memory::DoState(p);
 		}
@@ -326,6 +640,90 @@ namespace SaveState
 		pspFileSystem.DoState(p);
 	}
 
+	static void FinishPendingSave(PendingSave &save) {
+		bool success = true;
+		if (!save.screenshotFilename.empty()) {
+			if (!SaveCapturedScreenshot(save.screenshotFilename, ScreenshotFormat::JPG, save.screenshot, save.screenshotW, save.screenshotH)) {
+				ERROR_LOG(SAVESTATE, "Failed to write a screenshot for the savestate! %s", save.screenshotFilename.c_str());
+				success = false;
+			}
+		}
+		if (!save.filename.empty()) {
+			CChunkFileReader::Error result = CChunkFileReader::SaveFile(save.filename, save.title, PPSSPP_GIT_VERSION, save.data.data(), save.size);
+			if (result != CChunkFileReader::ERROR_NONE) {
+				ERROR_LOG(SAVESTATE, "Save state failure writing %s", save.filename.c_str());
+				success = false;
+			}
+		}
+
+		if (save.callback) {
+			if (success)
+				save.callback(Status::SUCCESS, save.successMessage, save.cbUserData);
+			else
+				save.callback(Status::FAILURE, save.failureMessage, save.cbUserData);
+		}
+	}
+
+	static void RunPendingSaves() {
+		std::unique_lock<std::mutex> guard(pendingSaveLock);
+		while (!pendingSaves.empty()) {
+			PendingSave save = std::move(pendingSaves.front());
+			pendingSaves.pop_front();
+			guard.unlock();
+
+			FinishPendingSave(save);
+
+			guard.lock();
+			if (save.data.capacity() > spareSaveBuffer.capacity())
+				spareSaveBuffer.swap(save.data);
+		}
+		pendingSaveRunning = false;
+		pendingSaveIdle.notify_all();
+	}
+
+	class PendingSaveTask : public Task {
+	public:
+		TaskType Type() const override {
+			return TaskType::IO_BLOCKING;
+		}
+
+		void Run() override {
+			RunPendingSaves();
+		}
+	};
+
+	static void QueuePendingSave(PendingSave &&save) {
+		std::unique_lock<std::mutex> guard(pendingSaveLock);
+		pendingSaves.push_back(std::move(save));
+		if (pendingSaveRunning)
+			return;
+		pendingSaveRunning = true;
+		guard.unlock();
+
+		if (g_threadManager.IsInitialized()) {
+			g_threadManager.EnqueueTask(new PendingSaveTask());
+		} else {
+			RunPendingSaves();
+		}
+	}
+
+	static std::vector<u8> TakeSaveBuffer() {
+		std::lock_guard<std::mutex> guard(pendingSaveLock);
+		std::vector<u8> buffer;
+		buffer.swap(spareSaveBuffer);
+		return buffer;
+	}
+
+	bool HasPendingSave() {
+		std::lock_guard<std::mutex> guard(pendingSaveLock);
+		return pendingSaveRunning;
+	}
+
+	void WaitForPendingSaves() {
+		std::unique_lock<std::mutex> guard(pendingSaveLock);
+		pendingSaveIdle.wait(guard, [] { return !pendingSaveRunning; });
+	}
+
 	void Enqueue(SaveState::Operation op)
 	{
 		std::lock_guard<std::mutex> guard(mutex);
@@ -373,6 +771,34 @@ namespace SaveState
 		return !rewindStates.Empty();
 	}
 
+	int TakeSnapshot()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		return snapshots.Take();
+	}
+
+	CChunkFileReader::Error RestoreSnapshot(int id, std::string *errorString)
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		CChunkFileReader::Error err = snapshots.Restore(id, errorString);
+		if (err == CChunkFileReader::ERROR_NONE)
+			hasLoadedState = true;
+		return err;
+	}
+
+	void ClearSnapshots()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		snapshots.Clear();
+	}
+
+	void GetSnapshotStats(int *count, size_t *bytes)
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		*count = snapshots.Count();
+		*bytes = snapshots.MemoryUsage();
+	}
+
 	// Slot utilities
 
 	std::string AppendSlotTitle(const std::string &filename, const std::string &title) {
@@ -545,6 +971,8 @@ namespace SaveState
 		Path fnUndo = GenerateSaveSlotFilename(gameFilename, slot, UNDO_STATE_EXTENSION);
 		Path shotUndo = GenerateSaveSlotFilename(gameFilename, slot, UNDO_SCREENSHOT_EXTENSION);
 		if (!fn.empty()) {
+			// The renames below expect earlier saves to be on disk already.
+			WaitForPendingSaves();
 			auto renameCallback = [=](Status status, const std::string &message, void *data) {
 				if (status != Status::FAILURE) {
 					if (g_Config.bEnableStateUndo) {
@@ -582,6 +1010,9 @@ namespace SaveState
 		Path fnUndo = GenerateSaveSlotFilename(gameFilename, slot, UNDO_STATE_EXTENSION);
 		Path shotUndo = GenerateSaveSlotFilename(gameFilename, slot, UNDO_SCREENSHOT_EXTENSION);
 
+		// The save being undone might still be on its way to disk.
+		WaitForPendingSaves();
+
 		// Do nothing if there's no undo.
 		if (File::Exists(fnUndo)) {
 			// Swap them so they can undo again to redo.  Mistakes happen.
@@ -872,6 +1303,8 @@ namespace SaveState
 			{
 			case SAVESTATE_LOAD:
 				INFO_LOG(SAVESTATE, "Loading state from '%s'", op.filename.c_str());
+				// It might've just been saved.
+				WaitForPendingSaves();
 				// Use the state's latest version as a guess for saveStateInitialGitVersion.
 				result = CChunkFileReader::Load(op.filename, &saveStateInitialGitVersion, state, &errorString);
 				if (result == CChunkFileReader::ERROR_NONE) {
@@ -914,9 +1347,24 @@ namespace SaveState
 					std::size_t lslash = title.find_last_of("/");
 					title = title.substr(lslash + 1);
 				}
-				result = CChunkFileReader::Save(op.filename, title, PPSSPP_GIT_VERSION, state);
+				{
+					// Only the copy-out happens here, compressing and writing happen in the background.
+					PendingSave save;
+					save.data = TakeSaveBuffer();
+					result = CChunkFileReader::SaveToBuffer(save.data, state, &save.size);
+					if (result == CChunkFileReader::ERROR_NONE) {
+						save.filename = op.filename;
+						save.title = title;
+						save.callback = op.callback;
+						save.cbUserData = op.cbUserData;
+						save.successMessage = slot_prefix + sc->T("Saved State");
+						save.failureMessage = i18nSaveFailure;
+						QueuePendingSave(std::move(save));
+						// The callback is called once it's written.
+						op.callback = Callback();
+					}
+				}
 				if (result == CChunkFileReader::ERROR_NONE) {
-					callbackMessage = slot_prefix + sc->T("Saved State");
 					callbackResult = Status::SUCCESS;
 #ifndef MOBILE_DEVICE
 					if (g_Config.bSaveLoadResetsAVdumping) {
@@ -979,7 +1427,9 @@ namespace SaveState
 			case SAVESTATE_SAVE_SCREENSHOT:
 			{
 				int maxRes = g_Config.iInternalResolution > 2 ? 2 : -1;
-				tempResult = TakeGameScreenshot(op.filename, ScreenshotFormat::JPG, SCREENSHOT_DISPLAY, nullptr, nullptr, maxRes);
+				// Grab it now, but leave the encoding to the save thread.
+				PendingSave save;
+				tempResult = CaptureGameScreenshot(save.screenshot, SCREENSHOT_DISPLAY, save.screenshotW, save.screenshotH, maxRes);
 				callbackResult = tempResult ? Status::SUCCESS : Status::FAILURE;
 				if (!tempResult) {
 					ERROR_LOG(SAVESTATE, "Failed to take a screenshot for the savestate! %s", op.filename.c_str());
@@ -989,6 +1439,12 @@ namespace SaveState
 					}
 				} else {
 					screenshotFailures = 0;
+					save.screenshotFilename = op.filename;
+					save.callback = op.callback;
+					save.cbUserData = op.cbUserData;
+					QueuePendingSave(std::move(save));
+					// The callback is called once it's written.
+					op.callback = Callback();
 				}
 				break;
 			}
@@ -1035,6 +1491,7 @@ namespace SaveState
 
 		std::lock_guard<std::mutex> guard(mutex);
 		rewindStates.Clear();
+		snapshots.Clear();
 
 		hasLoadedState = false;
 		saveStateGeneration = 0;
@@ -1045,7 +1502,10 @@ namespace SaveState
 
 	void Shutdown()
 	{
+		WaitForPendingSaves();
+
 		std::lock_guard<std::mutex> guard(mutex);
 		rewindStates.Clear();
+		snapshots.Clear();
 	}
 }
@@ -76,7 +76,12 @@ namespace SaveState
 	// Warning: callback will be called on a different thread.
 	void Save(const Path &filename, int slot, Callback callback = Callback(), void *cbUserData = 0);
 
-	CChunkFileReader::Error SaveToRam(std::vector<u8> &state);
+	// Saves are copied out on the emu thread, then compressed and written in the background.
+	bool HasPendingSave();
+	void WaitForPendingSaves();
+
+	// With stats, also records the size and time of each section, for profiling.
+	CChunkFileReader::Error SaveToRam(std::vector<u8> &state, std::vector<PointerWrapSectionStat> *stats = nullptr);
 	CChunkFileReader::Error LoadFromRam(std::vector<u8> &state, std::string *errorString);
 
 	// For testing / automated tests.  Runs a save state verification pass (async.)
@@ -90,6 +95,14 @@ namespace SaveState
 	// Returns true if there are rewind snapshots available.
 	bool CanRewind();
 
+	// Snapshots of the running game, kept in memory until cleared or shutdown. Must be called on the emu thread,
+	// between frames. Meant for automated runs: memory pages are shared between snapshots, so taking one mostly
+	// costs the pages written since the last one. Returns -1 on failure.
+	int TakeSnapshot();
+	CChunkFileReader::Error RestoreSnapshot(int id, std::string *errorString);
+	void ClearSnapshots();
+	void GetSnapshotStats(int *count, size_t *bytes);
+
 	// Returns true if a savestate has been used during this session.
 	bool HasLoadedState();
 
@@ -328,15 +328,14 @@ static GPUDebugBuffer ApplyRotation(const GPUDebugBuffer &buf, DisplayRotation r
 	return rotated;
 }
 
-bool TakeGameScreenshot(const Path &filename, ScreenshotFormat fmt, ScreenshotType type, int *width, int *height, int maxRes) {
+bool CaptureGameScreenshot(GPUDebugBuffer &buf, ScreenshotType type, u32 &w, u32 &h, int maxRes) {
 	if (!gpuDebug) {
 		ERROR_LOG(SYSTEM, "Can't take screenshots when GPU not running");
 		return false;
 	}
-	GPUDebugBuffer buf;
 	bool success = false;
-	u32 w = (u32)-1;
-	u32 h = (u32)-1;
+	w = (u32)-1;
+	h = (u32)-1;
 
 	if (type == SCREENSHOT_DISPLAY || type == SCREENSHOT_RENDER) {
 		success = gpuDebug->GetCurrentFramebuffer(buf, type == SCREENSHOT_RENDER ? GPU_DBG_FRAMEBUF_RENDER : GPU_DBG_FRAMEBUF_DISPLAY, maxRes);
@@ -358,19 +357,20 @@ bool TakeGameScreenshot(const Path &filename, ScreenshotFormat fmt, ScreenshotTy
 		ERROR_LOG(G3D, "Failed to obtain screenshot data.");
 		return false;
 	}
+	return true;
+}
 
+bool SaveCapturedScreenshot(const Path &filename, ScreenshotFormat fmt, const GPUDebugBuffer &buf, u32 w, u32 h, int *width, int *height) {
 	u8 *flipbuffer = nullptr;
+	const u8 *buffer = ConvertBufferToScreenshot(buf, false, flipbuffer, w, h);
+	bool success = buffer != nullptr;
 	if (success) {
-		const u8 *buffer = ConvertBufferToScreenshot(buf, false, flipbuffer, w, h);
-		success = buffer != nullptr;
-		if (success) {
-			if (width)
-				*width = w;
-			if (height)
-				*height = h;
+		if (width)
+			*width = w;
+		if (height)
+			*height = h;
 
-			success = Save888RGBScreenshot(filename, fmt, buffer, w, h);
-		}
+		success = Save888RGBScreenshot(filename, fmt, buffer, w, h);
 	}
 	delete [] flipbuffer;
 
@@ -380,6 +380,14 @@ bool TakeGameScreenshot(const Path &filename, ScreenshotFormat fmt, ScreenshotTy
 	return success;
 }
 
+bool TakeGameScreenshot(const Path &filename, ScreenshotFormat fmt, ScreenshotType type, int *width, int *height, int maxRes) {
+	GPUDebugBuffer buf;
+	u32 w, h;
+	if (!CaptureGameScreenshot(buf, type, w, h, maxRes))
+		return false;
+	return SaveCapturedScreenshot(filename, fmt, buf, w, h, width, height);
+}
+
 bool Save888RGBScreenshot(const Path &filename, ScreenshotFormat fmt, const u8 *bufferRGB888, int w, int h) {
 	if (fmt == ScreenshotFormat::PNG) {
 		png_image png;
@@ -39,5 +39,8 @@ const u8 *ConvertBufferToScreenshot(const GPUDebugBuffer &buf, bool alpha, u8 *&
 
 // Can only be used while in game.
 bool TakeGameScreenshot(const Path &filename, ScreenshotFormat fmt, ScreenshotType type, int *width = nullptr, int *height = nullptr, int maxRes = -1);
+// TakeGameScreenshot() in two steps. Capturing has to happen on the GPU thread, but the rest can be done anywhere.
+bool CaptureGameScreenshot(GPUDebugBuffer &buf, ScreenshotType type, u32 &w, u32 &h, int maxRes = -1);
+bool SaveCapturedScreenshot(const Path &filename, ScreenshotFormat fmt, const GPUDebugBuffer &buf, u32 w, u32 h, int *width = nullptr, int *height = nullptr);
 bool Save888RGBScreenshot(const Path &filename, ScreenshotFormat fmt, const u8 *bufferRGB888, int w, int h);
 bool Save8888RGBAScreenshot(const Path &filename, const u8 *bufferRGBA8888, int w, int h);
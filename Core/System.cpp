@@ -46,6 +46,7 @@
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
+#include "Core/MIPS/IR/IRJit.h"
 #include "Core/Debugger/SymbolMap.h"
 #include "Core/Host.h"
 #include "Core/System.h"
@@ -63,6 +64,7 @@
 #include "Core/FileSystems/MetaFileSystem.h"
 #include "Core/Loaders.h"
 #include "Core/PSPLoaders.h"
+#include "Core/RunAhead.h"
 #include "Core/ELF/ParamSFO.h"
 #include "Core/SaveState.h"
 #include "Common/LogManager.h"
@@ -297,6 +299,7 @@ bool CPU_Init(std::string *errorString) {
 		// We're screwed.
 		return false;
 	}
+	MIPSComp::IRJitBoot(g_paramSFO.GetDiscID());
 	mipsr4k.Reset();
 
 	host->AttemptLoadSymbolMap();
@@ -358,6 +361,8 @@ void CPU_Shutdown() {
 
 	pspFileSystem.Shutdown();
 	mipsr4k.Shutdown();
+	// After the jit is gone, so its blocks are in the disk cache.
+	MIPSComp::IRJitShutdown();
 	Memory::Shutdown();
 	HLEPlugins::Shutdown();
 
@@ -525,6 +530,7 @@ void PSP_Shutdown() {
 	Core_NotifyLifecycle(CoreLifecycle::STOPPING);
 	CPU_Shutdown();
 	GPU_Shutdown();
+	RunAhead::Shutdown();
 	g_paramSFO.Clear();
 	host->SetWindowTitle(0);
 	currentMIPS = 0;
@@ -565,7 +571,9 @@ void PSP_RunLoopWhileState() {
 }
 
 void PSP_RunLoopUntil(u64 globalticks) {
-	SaveState::Process();
+	// Savestates wait until run-ahead has rolled back to the real frame.
+	if (!PSP_CoreParameter().runningAhead)
+		SaveState::Process();
 	if (coreState == CORE_POWERDOWN || coreState == CORE_BOOT_ERROR || coreState == CORE_RUNTIME_ERROR) {
 		return;
 	} else if (coreState == CORE_STEPPING) {
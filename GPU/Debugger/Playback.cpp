@@ -47,6 +47,7 @@ static std::string lastExecFilename;
 static std::vector<Command> lastExecCommands;
 static std::vector<u8> lastExecPushbuf;
 static std::mutex executeLock;
+static std::function<bool()> replayRepeatCallback;
 
 // This class maps pushbuffer (dump data) sections to PSP memory.
 // Dumps can be larger than available PSP memory, because they include generated data too.
@@ -716,8 +717,16 @@ bool RunMountedReplay(const std::string &filename) {
 		lastExecFilename = filename;
 	}
 
-	DumpExecute executor(lastExecPushbuf, lastExecCommands);
-	return executor.Run();
+	do {
+		DumpExecute executor(lastExecPushbuf, lastExecCommands);
+		if (!executor.Run())
+			return false;
+	} while (replayRepeatCallback && replayRepeatCallback());
+	return true;
+}
+
+void SetReplayRepeatCallback(const std::function<bool()> &callback) {
+	replayRepeatCallback = callback;
 }
 
 };
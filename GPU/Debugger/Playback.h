@@ -17,10 +17,13 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 
 namespace GPURecord {
 
 bool RunMountedReplay(const std::string &filename);
+// For benchmarks.  Called after each run of a mounted replay, which runs again while it returns true.
+void SetReplayRepeatCallback(const std::function<bool()> &callback);
 
 };
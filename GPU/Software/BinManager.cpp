@@ -0,0 +1,281 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Common/MemoryUtil.h"
+#include "Common/Profiler/Profiler.h"
+#include "Common/Thread/ParallelLoop.h"
+#include "Common/Thread/ThreadUtil.h"
+#include "Common/TimeUtil.h"
+#include "Core/Config.h"
+#include "Core/ThreadPools.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/BinManager.h"
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/StageStats.h"
+
+namespace Rasterizer {
+
+// In screen coordinates, so 32 pixels.  Two quads wide, to keep the work per tile reasonable.
+static const int TILE_SHIFT = 9;
+static const int TILE_SIZE = 1 << TILE_SHIFT;
+// Drawing coordinates wrap at 1024, so this covers everything the scissor allows.
+static const int TILES_PER_ROW = 1024 * 16 / TILE_SIZE;
+static const int MAX_TILES = TILES_PER_ROW * TILES_PER_ROW;
+// Keeps memory use bounded, and lets threads get started on big scenes.
+static const size_t MAX_BINNED_TRIANGLES = 4096;
+// One being filled, the rest queued for or being drawn by the render thread.
+static const int MAX_BATCHES = 4;
+
+struct BinBatch {
+	std::vector<BinnedTriangle> triangles;
+	std::vector<int> tileItems[MAX_TILES];
+	std::vector<int> activeTiles;
+	// Where tile 0 starts, from the drawing offset when the first triangle was binned.
+	int originX = 0;
+	int originY = 0;
+};
+
+static BinBatch batches[MAX_BATCHES];
+// Only touched by the emu thread.
+static int writeBatch = 0;
+// Only touched by the render thread, or the emu thread when there's no render thread.
+static int readBatch = 0;
+// Emu thread only, whether anything was handed over since the last time we waited.
+static bool renderThreadBusy = false;
+
+static std::thread renderThread;
+static std::mutex queueLock;
+static std::condition_variable queueCond;
+static std::condition_variable doneCond;
+// Batches handed over but not yet drawn. Guarded by queueLock, as is everything below.
+static int queuedBatches = 0;
+static bool renderThreadRunning = false;
+static BinStats frameStats;
+static BinStats lastFrameStats;
+
+static void DrawTile(const BinBatch &batch, int tile) {
+	const int tileX1 = batch.originX + (tile % TILES_PER_ROW) * TILE_SIZE;
+	const int tileY1 = batch.originY + (tile / TILES_PER_ROW) * TILE_SIZE;
+	const int tileX2 = tileX1 + TILE_SIZE - 1;
+	const int tileY2 = tileY1 + TILE_SIZE - 1;
+
+	for (int index : batch.tileItems[tile]) {
+		const BinnedTriangle &tri = batch.triangles[index];
+		int x1 = std::max(tri.minX, tileX1);
+		int y1 = std::max(tri.minY, tileY1);
+		int x2 = std::min(tri.maxX, tileX2);
+		int y2 = std::min(tri.maxY, tileY2);
+
+		// Quads have to line up with the ones the whole triangle would use, or mip levels could differ.
+		int quadX1 = tri.minX + ((x1 - tri.minX) & ~31);
+		int quadY1 = tri.minY + ((y1 - tri.minY) & ~31);
+		tri.drawSlice(tri.v0, tri.v1, tri.v2, quadX1, quadY1, x2, y2, x1, y1, tri.pixelID, tri.drawPixel, tri.sampler);
+	}
+}
+
+static void DrawBatch(BinBatch &batch) {
+	PROFILE_THIS_SCOPE("bin_flush");
+	BeginCoarseDepth();
+	const int count = (int)batch.activeTiles.size();
+	const int numThreads = std::min(count, g_threadManager.GetNumLooperThreads());
+	if (numThreads <= 1) {
+		for (int tile : batch.activeTiles)
+			DrawTile(batch, tile);
+	} else {
+		// Tiles vary a lot in cost, so each thread grabs the next one when it's done.
+		StageScope waitScope(Stage::WAIT);
+		std::atomic<int> nextTile(0);
+		ParallelRangeLoop(&g_threadManager, [&](int a, int b) {
+			for (int i = nextTile++; i < count; i = nextTile++)
+				DrawTile(batch, batch.activeTiles[i]);
+		}, 0, numThreads, 1);
+	}
+
+	for (int tile : batch.activeTiles)
+		batch.tileItems[tile].clear();
+	batch.activeTiles.clear();
+	batch.triangles.clear();
+}
+
+static void RenderThreadFunc() {
+	SetCurrentThreadName("SoftGPURender");
+
+	std::unique_lock<std::mutex> guard(queueLock);
+	while (true) {
+		double start = time_now_d();
+		while (queuedBatches == 0 && renderThreadRunning)
+			queueCond.wait(guard);
+		frameStats.renderWaitTime += time_now_d() - start;
+		if (queuedBatches == 0)
+			break;
+
+		guard.unlock();
+		start = time_now_d();
+		DrawBatch(batches[readBatch]);
+		double drawTime = time_now_d() - start;
+		guard.lock();
+
+		readBatch = (readBatch + 1) % MAX_BATCHES;
+		frameStats.renderTime += drawTime;
+		queuedBatches--;
+		doneCond.notify_all();
+	}
+}
+
+static bool UseRenderThread() {
+	// Compiling more pixel or sampler functions while others run would need W^X toggling.
+	return g_Config.bSoftwareRenderingThread && !PlatformIsWXExclusive() && g_threadManager.GetNumLooperThreads() > 1;
+}
+
+// Must be called with queueLock held.
+static void WaitForQueue(std::unique_lock<std::mutex> &guard, int maxQueued) {
+	if (queuedBatches <= maxQueued)
+		return;
+	double start = time_now_d();
+	while (queuedBatches > maxQueued)
+		doneCond.wait(guard);
+	frameStats.emuWaitTime += time_now_d() - start;
+}
+
+void SubmitBins() {
+	BinBatch &batch = batches[writeBatch];
+	if (batch.triangles.empty())
+		return;
+
+	if (!UseRenderThread()) {
+		if (renderThreadBusy) {
+			// Turned off while running, keep things in order.
+			std::unique_lock<std::mutex> guard(queueLock);
+			WaitForQueue(guard, 0);
+			renderThreadBusy = false;
+		}
+		double start = time_now_d();
+		DrawBatch(batch);
+		double drawTime = time_now_d() - start;
+		std::lock_guard<std::mutex> guard(queueLock);
+		frameStats.batches++;
+		frameStats.renderTime += drawTime;
+		return;
+	}
+
+	std::unique_lock<std::mutex> guard(queueLock);
+	if (!renderThread.joinable()) {
+		renderThreadRunning = true;
+		readBatch = writeBatch;
+		renderThread = std::thread(&RenderThreadFunc);
+	}
+
+	queuedBatches++;
+	renderThreadBusy = true;
+	frameStats.batches++;
+	queueCond.notify_one();
+	writeBatch = (writeBatch + 1) % MAX_BATCHES;
+	// The next batch to fill has to be drawn and cleared first.
+	WaitForQueue(guard, MAX_BATCHES - 1);
+}
+
+void BinTriangle(const BinnedTriangle &tri) {
+	BinBatch &batch = batches[writeBatch];
+	if (batch.triangles.empty()) {
+		ScreenCoords origin = TransformUnit::DrawingToScreen(DrawingCoords(0, 0, 0));
+		batch.originX = origin.x;
+		batch.originY = origin.y;
+	}
+
+	int tx1 = std::max(0, (tri.minX - batch.originX) >> TILE_SHIFT);
+	int ty1 = std::max(0, (tri.minY - batch.originY) >> TILE_SHIFT);
+	int tx2 = std::min(TILES_PER_ROW - 1, (tri.maxX - batch.originX) >> TILE_SHIFT);
+	int ty2 = std::min(TILES_PER_ROW - 1, (tri.maxY - batch.originY) >> TILE_SHIFT);
+	if (tx2 < tx1 || ty2 < ty1)
+		return;
+
+	int index = (int)batch.triangles.size();
+	batch.triangles.push_back(tri);
+	for (int ty = ty1; ty <= ty2; ++ty) {
+		for (int tx = tx1; tx <= tx2; ++tx) {
+			int tile = ty * TILES_PER_ROW + tx;
+			if (batch.tileItems[tile].empty())
+				batch.activeTiles.push_back(tile);
+			batch.tileItems[tile].push_back(index);
+		}
+	}
+
+	if (batch.triangles.size() >= MAX_BINNED_TRIANGLES)
+		SubmitBins();
+}
+
+void FlushBins() {
+	SubmitBins();
+	if (!renderThreadBusy)
+		return;
+
+	std::unique_lock<std::mutex> guard(queueLock);
+	if (queuedBatches != 0)
+		frameStats.syncs++;
+	WaitForQueue(guard, 0);
+	renderThreadBusy = false;
+}
+
+void GetBinStats(BinStats &stats) {
+	std::lock_guard<std::mutex> guard(queueLock);
+	stats = lastFrameStats;
+}
+
+void NewBinStatsFrame() {
+	std::lock_guard<std::mutex> guard(queueLock);
+	lastFrameStats = frameStats;
+	frameStats = BinStats();
+}
+
+void ShutdownBins() {
+	if (renderThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(queueLock);
+			renderThreadRunning = false;
+			queueCond.notify_one();
+		}
+		// Draws anything still queued before exiting.
+		renderThread.join();
+	}
+
+	// Lists submit what they binned when they end, so there shouldn't be anything left.
+	for (auto &batch : batches) {
+		batch.triangles.clear();
+		batch.triangles.shrink_to_fit();
+		for (auto &items : batch.tileItems) {
+			items.clear();
+			items.shrink_to_fit();
+		}
+		batch.activeTiles.clear();
+		batch.activeTiles.shrink_to_fit();
+	}
+	writeBatch = 0;
+	readBatch = 0;
+	renderThreadBusy = false;
+	queuedBatches = 0;
+	frameStats = BinStats();
+	lastFrameStats = BinStats();
+}
+
+}  // namespace Rasterizer
@@ -0,0 +1,82 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/FuncId.h"
+#include "GPU/Software/Sampler.h"
+#include "GPU/Software/TransformUnit.h"
+
+// Triangles aren't drawn right away. Instead, they're sorted into 32x32 pixel tiles, and at the
+// next flush each tile is drawn by one thread, in the order the triangles were submitted.
+// That way the threads never touch the same pixels, and blending still happens in order.
+//
+// The binned triangles are drawn with whatever is in gstate at flush time, so anything that
+// changes how they'd draw (state, CLUT, framebuffer pointers, JIT caches) must flush first,
+// as must anything that reads what they draw.
+//
+// With g_Config.bSoftwareRenderingThread, submitted batches are drawn on a separate render
+// thread, so the emu thread can keep going until it hits one of those points.
+namespace Rasterizer {
+
+// x1/y1 is where to start stepping quads, which must stay in phase with the whole triangle.
+// Pixels before clipX1/clipY1 are skipped.
+typedef void (*DrawTriangleSliceFunc)(
+	const VertexData &v0, const VertexData &v1, const VertexData &v2,
+	int x1, int y1, int x2, int y2, int clipX1, int clipY1,
+	const PixelFuncID &pixelID,
+	const Rasterizer::SingleFunc &drawPixel,
+	const Sampler::Funcs &sampler);
+
+struct BinnedTriangle {
+	VertexData v0;
+	VertexData v1;
+	VertexData v2;
+	// Inclusive bounds in screen coordinates, already scissored.
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+	PixelFuncID pixelID;
+	SingleFunc drawPixel;
+	Sampler::Funcs sampler;
+	DrawTriangleSliceFunc drawSlice;
+};
+
+struct BinStats {
+	int batches = 0;
+	// Times the emu thread had to wait for the render thread to catch up.
+	int syncs = 0;
+	// In seconds.
+	double emuWaitTime = 0.0;
+	double renderWaitTime = 0.0;
+	double renderTime = 0.0;
+};
+
+void BinTriangle(const BinnedTriangle &tri);
+// Starts drawing everything binned so far, without waiting when there's a render thread.
+void SubmitBins();
+// Draws everything binned so far, and waits for it.
+void FlushBins();
+void ShutdownBins();
+
+// Stats are for the previous frame.
+void GetBinStats(BinStats &stats);
+void NewBinStatsFrame();
+
+}  // namespace Rasterizer
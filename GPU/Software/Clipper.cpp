@@ -22,6 +22,7 @@
 #include "GPU/Software/Clipper.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/RasterizerRectangle.h"
+#include "GPU/Software/StageStats.h"
 #include "GPU/Software/TransformUnit.h"
 
 #include "Common/Profiler/Profiler.h"
@@ -145,6 +146,7 @@ static inline bool CheckOutsideZ(ClipCoords p, int &pos, int &neg) {
 
 void ProcessRect(const VertexData& v0, const VertexData& v1)
 {
+	Rasterizer::StageScope stageScope(Rasterizer::Stage::CLIP);
 	if (!gstate.isModeThrough()) {
 		// We may discard the entire rect based on depth values.
 		int outsidePos = 0, outsideNeg = 0;
@@ -260,6 +262,7 @@ void ProcessPoint(VertexData& v0)
 
 void ProcessLine(VertexData& v0, VertexData& v1)
 {
+	Rasterizer::StageScope stageScope(Rasterizer::Stage::CLIP);
 	if (gstate.isModeThrough()) {
 		// Actually, should clip this one too so we don't need to do bounds checks in the rasterizer.
 		Rasterizer::DrawLine(v0, v1);
@@ -391,6 +394,7 @@ void ProcessTriangleInternal(VertexData &v0, VertexData &v1, VertexData &v2, con
 }
 
 void ProcessTriangle(VertexData &v0, VertexData &v1, VertexData &v2, const VertexData &provoking) {
+	Rasterizer::StageScope stageScope(Rasterizer::Stage::CLIP);
 	ProcessTriangleInternal(v0, v1, v2, provoking, false);
 }
 
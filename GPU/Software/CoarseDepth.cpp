@@ -0,0 +1,154 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <atomic>
+
+#include "Core/Config.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/SoftGpu.h"
+
+namespace Rasterizer {
+
+static const int TILE_SHIFT = 3;
+static const int TILE_SIZE = 1 << TILE_SHIFT;
+static const int TILES_PER_ROW = 1024 >> TILE_SHIFT;
+static const int MAX_TILES = TILES_PER_ROW * TILES_PER_ROW;
+
+struct CoarseDepthTile {
+	u16 minZ;
+	u16 maxZ;
+	// Only valid when this matches the current generation.
+	u32 generation;
+};
+
+static CoarseDepthTile tiles[MAX_TILES];
+// Never zero, so zero always means the tile has to be read again.
+static u32 generation = 1;
+static bool active = false;
+static const u8 *lastDepthBuf = nullptr;
+static int lastDepthStride = 0;
+static int seenInvalidations = 0;
+static std::atomic<int> invalidations;
+
+void InvalidateCoarseDepth() {
+	invalidations++;
+}
+
+static bool ColorOverlapsDepth() {
+	// Drawing can't go past the scissor, so that's as many rows as can be touched.
+	const u32 rows = gstate.getScissorY2() + 1;
+	const u32 bpp = gstate.FrameBufFormat() == GE_FORMAT_8888 ? 4 : 2;
+	// VRAM is mirrored, so compare offsets.
+	const u32 colorStart = gstate.getFrameBufAddress() & 0x001FFFFF;
+	const u32 colorEnd = colorStart + rows * gstate.FrameBufStride() * bpp;
+	const u32 depthStart = gstate.getDepthBufAddress() & 0x001FFFFF;
+	const u32 depthEnd = depthStart + rows * gstate.DepthBufStride() * 2;
+	return colorStart < depthEnd && depthStart < colorEnd;
+}
+
+void BeginCoarseDepth() {
+	const int count = invalidations.load();
+	active = g_Config.bSoftwareRenderingCoarseDepth && depthbuf.data != nullptr && !ColorOverlapsDepth();
+
+	bool changed = count != seenInvalidations || depthbuf.data != lastDepthBuf || gstate.DepthBufStride() != lastDepthStride;
+	// When not active, triangles may write depth without dirtying tiles.
+	if (changed || !active) {
+		if (++generation == 0)
+			generation = 1;
+		seenInvalidations = count;
+		lastDepthBuf = depthbuf.data;
+		lastDepthStride = gstate.DepthBufStride();
+	}
+}
+
+bool CanRejectCoarseDepth(const PixelFuncID &pixelID) {
+	// Stencil ops still apply to pixels that fail the depth test.
+	if (!active || pixelID.clearMode || pixelID.stencilTest)
+		return false;
+
+	switch (pixelID.DepthTestFunc()) {
+	case GE_COMP_NEVER:
+	case GE_COMP_EQUAL:
+	case GE_COMP_LESS:
+	case GE_COMP_LEQUAL:
+	case GE_COMP_GREATER:
+	case GE_COMP_GEQUAL:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static void ReadTile(int tile, CoarseDepthTile &t) {
+	const int x1 = (tile % TILES_PER_ROW) * TILE_SIZE;
+	const int y1 = (tile / TILES_PER_ROW) * TILE_SIZE;
+	const int stride = gstate.DepthBufStride();
+
+	u16 minZ = 0xFFFF;
+	u16 maxZ = 0;
+	for (int y = y1; y < y1 + TILE_SIZE; ++y) {
+		const u16 *row = depthbuf.Get16Ptr(x1, y, stride);
+		for (int x = 0; x < TILE_SIZE; ++x) {
+			minZ = std::min(minZ, row[x]);
+			maxZ = std::max(maxZ, row[x]);
+		}
+	}
+
+	t.minZ = minZ;
+	t.maxZ = maxZ;
+	t.generation = generation;
+}
+
+bool IsCoarseDepthTileRejected(int tile, GEComparison func, u16 minZ, u16 maxZ) {
+	if (func == GE_COMP_NEVER)
+		return true;
+
+	CoarseDepthTile &t = tiles[tile];
+	if (t.generation != generation)
+		ReadTile(tile, t);
+
+	switch (func) {
+	case GE_COMP_EQUAL:
+		return maxZ < t.minZ || minZ > t.maxZ;
+	case GE_COMP_LESS:
+		return minZ >= t.maxZ;
+	case GE_COMP_LEQUAL:
+		return minZ > t.maxZ;
+	case GE_COMP_GREATER:
+		return maxZ <= t.minZ;
+	case GE_COMP_GEQUAL:
+		return maxZ < t.minZ;
+	default:
+		return false;
+	}
+}
+
+void DirtyCoarseDepth(int x1, int y1, int x2, int y2) {
+	const int tx1 = std::max(0, x1 >> TILE_SHIFT);
+	const int ty1 = std::max(0, y1 >> TILE_SHIFT);
+	const int tx2 = std::min(TILES_PER_ROW - 1, x2 >> TILE_SHIFT);
+	const int ty2 = std::min(TILES_PER_ROW - 1, y2 >> TILE_SHIFT);
+	for (int ty = ty1; ty <= ty2; ++ty) {
+		for (int tx = tx1; tx <= tx2; ++tx)
+			tiles[ty * TILES_PER_ROW + tx].generation = 0;
+	}
+}
+
+}  // namespace Rasterizer
@@ -0,0 +1,50 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "CommonTypes.h"
+#include "GPU/ge_constants.h"
+#include "GPU/Software/FuncId.h"
+
+// Tracks the min and max depth of each 8x8 pixel tile, so triangles can skip the parts
+// that would fail the depth test for every pixel.
+//
+// Tiles are read from depth memory the first time they're needed, and read again after a
+// triangle writes depth to them.  Anything else that might change depth memory (the CPU,
+// block transfers, other primitives) has to call InvalidateCoarseDepth().
+namespace Rasterizer {
+
+// Can be called from the emu thread at any time, takes effect at the next BeginCoarseDepth().
+void InvalidateCoarseDepth();
+// Checks the depth buffer and state before drawing triangles, while none are being drawn.
+void BeginCoarseDepth();
+
+// Whether pixels failing the depth test with this ID have no other effects.
+bool CanRejectCoarseDepth(const PixelFuncID &pixelID);
+
+inline int CoarseDepthTileIndex(int x, int y) {
+	return (y >> 3) * (1024 >> 3) + (x >> 3);
+}
+
+// Whether z values within minZ-maxZ would fail the depth test for the whole tile.
+// Each tile must only be used by one thread at a time.
+bool IsCoarseDepthTileRejected(int tile, GEComparison func, u16 minZ, u16 maxZ);
+// After writing depth to drawing coordinates x1-x2, y1-y2 (inclusive.)
+void DirtyCoarseDepth(int x1, int y1, int x2, int y2);
+
+}  // namespace Rasterizer
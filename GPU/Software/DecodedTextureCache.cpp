@@ -0,0 +1,320 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/Thread/ParallelLoop.h"
+#include "Core/Config.h"
+#include "Core/MemMap.h"
+#include "Core/ThreadPools.h"
+#include "GPU/Common/TextureDecoder.h"
+#include "GPU/GPUState.h"
+#include "GPU/Math3D.h"
+#include "GPU/Software/BinManager.h"
+#include "GPU/Software/DecodedTextureCache.h"
+#include "GPU/Software/Sampler.h"
+#include "ext/xxhash.h"
+
+extern u32 clut[4096];
+
+namespace Sampler {
+
+// Keeps memory use reasonable, a full set of 512x512 textures is 1 MB each.
+static const size_t MAX_CACHE_BYTES = 32 * 1024 * 1024;
+// Textures that change this often (like videos) aren't worth decoding up front.
+static const int MAX_CHANGES = 8;
+
+struct DecodedTextureKey {
+	u32 addr[8];
+	u32 bufw[8];
+	u32 size[8];
+	u32 texmode;
+	u32 format;
+	u32 clutformat;
+	int levels;
+
+	bool operator ==(const DecodedTextureKey &other) const {
+		return memcmp(this, &other, sizeof(*this)) == 0;
+	}
+};
+
+struct CachedTexture {
+	DecodedTextureKey key;
+	DecodedTexture tex;
+	std::vector<u32> data;
+	u32 hash = 0;
+	// Hash checked in this generation.
+	u32 generation = 0;
+	int changes = 0;
+	bool usable = true;
+};
+
+static std::unordered_map<u64, std::unique_ptr<CachedTexture>> cache;
+static size_t cacheBytes = 0;
+static CachedTexture *lastEntry = nullptr;
+// Never zero, so new entries always get hashed.
+static u32 generation = 1;
+static int seenInvalidations = 0;
+static std::atomic<int> invalidations;
+
+void InvalidateDecodedTextures() {
+	invalidations++;
+}
+
+void ClearDecodedTextures() {
+	cache.clear();
+	cacheBytes = 0;
+	lastEntry = nullptr;
+}
+
+bool CanDecodeTexture(const SamplerID &id) {
+	if (!g_Config.bSoftwareRenderingTextureCache || !gstate.isTextureMapEnabled() || gstate.isModeClear())
+		return false;
+	// Nothing to gain, it's already read directly.
+	if (id.TexFmt() == GE_TFMT_8888 && !id.swizzle)
+		return false;
+	return !id.hasInvalidPtr && id.width0Shift <= 9 && id.height0Shift <= 9;
+}
+
+SamplerID DecodedSamplerID(const SamplerID &id) {
+	SamplerID decoded = id;
+	decoded.texfmt = GE_TFMT_8888;
+	decoded.clutfmt = 0;
+	decoded.swizzle = false;
+	decoded.useSharedClut = true;
+	decoded.hasClutMask = false;
+	decoded.hasClutShift = false;
+	decoded.hasClutOffset = false;
+	decoded.hasInvalidPtr = false;
+	decoded.overReadSafe = true;
+	decoded.useStandardBufw = true;
+	return decoded;
+}
+
+static void ComputeKey(DecodedTextureKey *key) {
+	memset(key, 0, sizeof(*key));
+	key->levels = gstate.isMipmapEnabled() ? gstate.getTextureMaxLevel() + 1 : 1;
+	for (int i = 0; i < key->levels; ++i) {
+		key->addr[i] = gstate.getTextureAddress(i);
+		key->bufw[i] = gstate.texbufwidth[i] & 0x00FFFFFF;
+		key->size[i] = gstate.texsize[i] & 0x00FFFFFF;
+	}
+	key->texmode = gstate.texmode & 0x00FFFFFF;
+	key->format = gstate.getTextureFormat();
+	if (gstate.isTextureFormatIndexed())
+		key->clutformat = gstate.clutformat & 0x00FFFFFF;
+}
+
+// Bytes of memory the level reads, rounded for hashing.  0 if it can't be decoded.
+static u32 LevelBytes(const DecodedTextureKey &key, int level) {
+	const GETextureFormat fmt = (GETextureFormat)key.format;
+	int w = gstate.getTextureWidth(level);
+	int h = gstate.getTextureHeight(level);
+	if (w > 512 || h > 512)
+		return 0;
+	// Swizzled textures are stored in blocks of 8 rows, and DXT in blocks of 4.
+	if (gstate.isTextureSwizzled())
+		h = (h + 7) & ~7;
+	else if (fmt >= GE_TFMT_DXT1)
+		h = (h + 3) & ~3;
+
+	u32 bytes = (GetTextureBufw(level, key.addr[level], fmt) * h * textureBitsPerPixel[fmt]) / 8;
+	bytes = (bytes + 63) & ~63;
+	if (!Memory::IsValidRange(key.addr[level], bytes))
+		return 0;
+	return bytes;
+}
+
+static bool OverlapsRenderTarget(const DecodedTextureKey &key, const u32 bytes[8]) {
+	// Drawing can't go past the scissor, so that's as many rows as can be touched.
+	const u32 rows = gstate.getScissorY2() + 1;
+	const u32 bpp = gstate.FrameBufFormat() == GE_FORMAT_8888 ? 4 : 2;
+	// VRAM is mirrored, so compare offsets.
+	const u32 colorStart = gstate.getFrameBufAddress() & 0x001FFFFF;
+	const u32 colorEnd = colorStart + rows * gstate.FrameBufStride() * bpp;
+	const u32 depthStart = gstate.getDepthBufAddress() & 0x001FFFFF;
+	const u32 depthEnd = depthStart + rows * gstate.DepthBufStride() * 2;
+
+	for (int i = 0; i < key.levels; ++i) {
+		if ((key.addr[i] & 0x0F800000) != 0x04000000)
+			continue;
+		const u32 start = key.addr[i] & 0x001FFFFF;
+		const u32 end = start + bytes[i];
+		if ((start < colorEnd && colorStart < end) || (start < depthEnd && depthStart < end))
+			return true;
+	}
+	return false;
+}
+
+static u32 HashTexture(const DecodedTextureKey &key, const u32 bytes[8]) {
+	u32 hash = 0;
+	for (int i = 0; i < key.levels; ++i)
+		hash = (hash * 11) ^ DoQuickTexHash(Memory::GetPointerUnchecked(key.addr[i]), bytes[i]);
+	if (gstate.isTextureFormatIndexed())
+		hash ^= (u32)XXH3_64bits(clut, sizeof(clut));
+	return hash;
+}
+
+static bool MakeRoom(size_t needed) {
+	if (cacheBytes + needed <= MAX_CACHE_BYTES)
+		return true;
+
+	// Binned triangles may still point at these.
+	Rasterizer::FlushBins();
+	for (auto it = cache.begin(); it != cache.end(); ) {
+		if (it->second->generation != generation) {
+			if (lastEntry == it->second.get())
+				lastEntry = nullptr;
+			cacheBytes -= it->second->data.size() * sizeof(u32);
+			it = cache.erase(it);
+		} else {
+			++it;
+		}
+	}
+	return cacheBytes + needed <= MAX_CACHE_BYTES;
+}
+
+static size_t LevelTexels(int level) {
+	// Sprites can fetch one texel past the edge, which has to stay inside the buffer.
+	return std::max(gstate.getTextureWidth(level), 4) * (gstate.getTextureHeight(level) + 2);
+}
+
+static void Decode(CachedTexture *entry, const SamplerID &id) {
+	const DecodedTextureKey &key = entry->key;
+	const GETextureFormat fmt = (GETextureFormat)key.format;
+	FetchFunc fetch = GetFetchFunc(id);
+
+	size_t offsets[8]{};
+	size_t total = 0;
+	for (int i = 0; i < key.levels; ++i) {
+		offsets[i] = total;
+		total += LevelTexels(i);
+	}
+	// Zeroed, since the padding is never written.
+	entry->data.assign(total, 0);
+
+	memset(&entry->tex, 0, sizeof(entry->tex));
+	for (int i = 0; i < key.levels; ++i) {
+		const int w = gstate.getTextureWidth(i);
+		const int h = gstate.getTextureHeight(i);
+		const int bufw = std::max(w, 4);
+		u32 *dst = &entry->data[offsets[i]];
+		entry->tex.texptr[i] = (u8 *)dst;
+		entry->tex.bufw[i] = bufw;
+
+		const u8 *src = Memory::GetPointerUnchecked(key.addr[i]);
+		const int srcBufw = GetTextureBufw(i, key.addr[i], fmt);
+		// Fetching does exactly what sampling would, so the results match.
+		ParallelRangeLoop(&g_threadManager, [=](int y1, int y2) {
+			for (int y = y1; y < y2; ++y) {
+				for (int x = 0; x < w; ++x)
+					dst[y * bufw + x] = Math3D::Vec4<int>(fetch(x, y, src, srcBufw, i)).ToRGBA();
+			}
+		}, 0, h, 32);
+	}
+}
+
+const DecodedTexture *LookupDecodedTexture(const SamplerID &id) {
+	int seen = invalidations;
+	if (seen != seenInvalidations) {
+		seenInvalidations = seen;
+		generation++;
+		if (generation == 0)
+			generation++;
+	}
+
+	DecodedTextureKey key;
+	ComputeKey(&key);
+	if (lastEntry && lastEntry->generation == generation && lastEntry->key == key)
+		return lastEntry->usable ? &lastEntry->tex : nullptr;
+
+	u32 bytes[8]{};
+	for (int i = 0; i < key.levels; ++i) {
+		bytes[i] = LevelBytes(key, i);
+		if (bytes[i] == 0)
+			return nullptr;
+	}
+	// Drawing could change it at any time.
+	if (OverlapsRenderTarget(key, bytes))
+		return nullptr;
+
+	const u64 cacheKey = XXH3_64bits(&key, sizeof(key));
+	auto it = cache.find(cacheKey);
+	CachedTexture *entry = it != cache.end() ? it->second.get() : nullptr;
+	if (entry && !(entry->key == key)) {
+		// Hash collision, just start over with this one.
+		Rasterizer::FlushBins();
+		if (lastEntry == entry)
+			lastEntry = nullptr;
+		cacheBytes -= entry->data.size() * sizeof(u32);
+		cache.erase(it);
+		entry = nullptr;
+	}
+
+	if (entry && entry->generation == generation) {
+		lastEntry = entry;
+		return entry->usable ? &entry->tex : nullptr;
+	}
+
+	const u32 hash = HashTexture(key, bytes);
+	if (entry) {
+		entry->generation = generation;
+		lastEntry = entry;
+		if (entry->hash == hash || !entry->usable) {
+			entry->hash = hash;
+			return entry->usable ? &entry->tex : nullptr;
+		}
+
+		entry->hash = hash;
+		if (++entry->changes >= MAX_CHANGES) {
+			Rasterizer::FlushBins();
+			entry->usable = false;
+			cacheBytes -= entry->data.size() * sizeof(u32);
+			entry->data.clear();
+			entry->data.shrink_to_fit();
+			return nullptr;
+		}
+
+		// Binned triangles may still be reading the old data.
+		Rasterizer::FlushBins();
+		Decode(entry, id);
+		return &entry->tex;
+	}
+
+	size_t needed = 0;
+	for (int i = 0; i < key.levels; ++i)
+		needed += LevelTexels(i) * sizeof(u32);
+	if (!MakeRoom(needed))
+		return nullptr;
+
+	entry = new CachedTexture();
+	entry->key = key;
+	entry->hash = hash;
+	entry->generation = generation;
+	cache[cacheKey].reset(entry);
+	Decode(entry, id);
+	cacheBytes += entry->data.size() * sizeof(u32);
+	lastEntry = entry;
+	return &entry->tex;
+}
+
+}  // namespace Sampler
@@ -0,0 +1,51 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+#include "GPU/Software/FuncId.h"
+
+// With g_Config.bSoftwareRenderingTextureCache, textures that are costly to sample (swizzled,
+// CLUT, 16-bit, DXT) are decoded to plain 8888 the first time they're used, so the sampler
+// can read them with the simplest fetch path.
+//
+// Each copy is checked against a hash of texture (and CLUT) memory the first time it's used
+// after InvalidateDecodedTextures(), which must be called whenever that memory might have
+// changed: the CPU running, block transfers, CLUT loads, and render target changes.
+namespace Sampler {
+
+struct DecodedTexture {
+	// Each level in 8888, with the standard bufw for its width.
+	u8 *texptr[8];
+	int bufw[8];
+};
+
+// Can be called from the emu thread at any time, takes effect at the next lookup.
+void InvalidateDecodedTextures();
+// Frees everything, anything binned must have been drawn already.
+void ClearDecodedTextures();
+
+// Whether this texture can and should be sampled from a decoded copy.
+bool CanDecodeTexture(const SamplerID &id);
+// The id to sample a decoded copy of a texture with.
+SamplerID DecodedSamplerID(const SamplerID &id);
+// Finds or makes a decoded copy of the current texture, or returns nullptr if there shouldn't be one.
+// The copy stays valid until the next lookup or clear, which flush bins before changing it.
+const DecodedTexture *LookupDecodedTexture(const SamplerID &id);
+
+}  // namespace Sampler
@@ -17,8 +17,10 @@
 
 #include <mutex>
 #include "Common/Data/Convert/ColorConv.h"
+#include "Common/TimeUtil.h"
 #include "Core/Config.h"
 #include "GPU/GPUState.h"
+#include "GPU/Software/BinManager.h"
 #include "GPU/Software/DrawPixel.h"
 #include "GPU/Software/FuncId.h"
 #include "GPU/Software/Rasterizer.h"
@@ -36,6 +38,7 @@ void Init() {
 }
 
 void Shutdown() {
+	ShutdownBins();
 	delete jitCache;
 	jitCache = nullptr;
 }
@@ -483,6 +486,14 @@ SingleFunc GetSingleFunc(const PixelFuncID &id) {
 	return jitCache->GenericSingle(id);
 }
 
+void PrecompileSingleFunc(const PixelFuncID &id) {
+	jitCache->Precompile(id);
+}
+
+void GetPixelJitStats(JitCacheStats &stats) {
+	stats = jitCache->GetStats();
+}
+
 SingleFunc PixelJitCache::GenericSingle(const PixelFuncID &id) {
 	if (id.clearMode) {
 		switch (id.fbFormat) {
@@ -574,25 +585,57 @@ SingleFunc PixelJitCache::GetSingle(const PixelFuncID &id) {
 
 	auto it = cache_.find(id);
 	if (it != cache_.end()) {
+		stats_.hits++;
 		return it->second;
 	}
+	stats_.misses++;
 
 	// x64 is typically 200-500 bytes, but let's be safe.
 	if (GetSpaceLeft() < 65536) {
+		// Binned triangles may still point at the old code.
+		FlushBins();
 		Clear();
 	}
 
 #if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
 	if (g_Config.bSoftwareRenderingJit) {
-		addresses_[id] = GetCodePointer();
-		SingleFunc func = CompileSingle(id);
-		cache_[id] = func;
-		return func;
+		// If queued, the generic version draws until it's ready.
+		if (QueueJitCompile(id))
+			return nullptr;
+		return CompileAndCache(id);
 	}
 #endif
 	return nullptr;
 }
 
+void PixelJitCache::Precompile(const PixelFuncID &id) {
+	std::lock_guard<std::mutex> guard(jitCacheLock);
+	// Only the emu thread can clear, since that needs to flush bins first.
+	if (cache_.find(id) != cache_.end() || GetSpaceLeft() < 65536)
+		return;
+
+#if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
+	CompileAndCache(id);
+#endif
+}
+
+#if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
+SingleFunc PixelJitCache::CompileAndCache(const PixelFuncID &id) {
+	double start = time_now_d();
+	addresses_[id] = GetCodePointer();
+	SingleFunc func = CompileSingle(id);
+	cache_[id] = func;
+	stats_.compiled++;
+	stats_.compileTime += time_now_d() - start;
+	return func;
+}
+#endif
+
+JitCacheStats PixelJitCache::GetStats() {
+	std::lock_guard<std::mutex> guard(jitCacheLock);
+	return stats_;
+}
+
 void ComputePixelBlendState(PixelBlendState &state, const PixelFuncID &id) {
 	switch (id.AlphaBlendEq()) {
 	case GE_BLENDMODE_MUL_AND_ADD:
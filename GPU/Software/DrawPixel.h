@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include "GPU/Math3D.h"
 #include "GPU/Software/FuncId.h"
+#include "GPU/Software/JitWarmup.h"
 #include "GPU/Software/RasterizerRegCache.h"
 
 namespace Rasterizer {
@@ -37,6 +38,9 @@ namespace Rasterizer {
 
 typedef void (SOFTRAST_CALL *SingleFunc)(int x, int y, int z, int fog, Vec4IntArg color_in, const PixelFuncID &pixelID);
 SingleFunc GetSingleFunc(const PixelFuncID &id);
+// For the warmup thread, compiles the function if there's room.
+void PrecompileSingleFunc(const PixelFuncID &id);
+void GetPixelJitStats(JitCacheStats &stats);
 
 void Init();
 void Shutdown();
@@ -59,11 +63,15 @@ class PixelJitCache : public Rasterizer::CodeBlock {
 	// Returns a pointer to the code to run.
 	SingleFunc GetSingle(const PixelFuncID &id);
 	SingleFunc GenericSingle(const PixelFuncID &id);
+	void Precompile(const PixelFuncID &id);
 	void Clear();
+	JitCacheStats GetStats();
 
 	std::string DescribeCodePtr(const u8 *ptr);
 
 private:
+	// Must be called with the cache locked.
+	SingleFunc CompileAndCache(const PixelFuncID &id);
 	SingleFunc CompileSingle(const PixelFuncID &id);
 
 	void Describe(const std::string &message);
@@ -108,6 +116,7 @@ class PixelJitCache : public Rasterizer::CodeBlock {
 	std::unordered_map<PixelFuncID, const u8 *> addresses_;
 	std::unordered_map<const u8 *, std::string> descriptions_;
 	RegCache regCache_;
+	JitCacheStats stats_;
 
 #if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
 	void Discard();
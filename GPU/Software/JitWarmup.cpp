@@ -0,0 +1,263 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "ext/xxhash.h"
+#include "Common/File/FileUtil.h"
+#include "Common/File/Path.h"
+#include "Common/Log.h"
+#include "Common/MemoryUtil.h"
+#include "Common/Thread/ThreadUtil.h"
+#include "Core/Config.h"
+#include "Core/ELF/ParamSFO.h"
+#include "Core/System.h"
+#include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/JitWarmup.h"
+#include "GPU/Software/Sampler.h"
+
+namespace Rasterizer {
+
+static const u32 JIT_CACHE_MAGIC = 0x4A544653;  // "SFTJ"
+// Bump when PixelFuncID or SamplerID change meaning.
+static const u32 JIT_CACHE_VERSION = 1;
+// Far more than games use, just keeps the file and warmup time bounded.
+static const size_t MAX_SAVED_IDS = 4096;
+
+struct JitCacheHeader {
+	u32 magic;
+	u32 version;
+	u32 numPixelIDs;
+	u32 numSamplerIDs;
+	u64 buildHash;
+};
+
+// Not a thread pool task, since it can wait on the jit cache locks, which are held while
+// the bins (and their thread pool tasks) are flushed.
+static std::thread warmupThread;
+static std::mutex warmupLock;
+static std::condition_variable warmupCond;
+// Guarded by warmupLock, as is everything below.
+static bool warmupRunning = false;
+static std::deque<PixelFuncID> pixelQueue;
+static std::deque<SamplerID> samplerQueue;
+// Queued or being compiled, so repeated misses don't queue them again.
+static std::unordered_set<u64> pendingPixelIDs;
+static std::unordered_set<u32> pendingSamplerIDs;
+static std::vector<u64> seenPixelIDs;
+static std::vector<u32> seenSamplerIDs;
+static std::unordered_set<u64> seenPixelSet;
+static std::unordered_set<u32> seenSamplerSet;
+static Path cachePath;
+
+static bool CanCompileAsync() {
+#if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
+	// Can't write code while other code in the same space is running if W^X is enforced.
+	return g_Config.bSoftwareRenderingAsyncJit && g_Config.bSoftwareRenderingJit && !PlatformIsWXExclusive();
+#else
+	return false;
+#endif
+}
+
+static void WarmupThreadFunc() {
+	SetCurrentThreadName("SoftJitWarmup");
+
+	std::unique_lock<std::mutex> guard(warmupLock);
+	while (true) {
+		while (pixelQueue.empty() && samplerQueue.empty() && warmupRunning)
+			warmupCond.wait(guard);
+		if (!warmupRunning)
+			break;
+
+		// Compiling takes the cache's lock, so never hold ours meanwhile.
+		if (!pixelQueue.empty()) {
+			PixelFuncID id = pixelQueue.front();
+			pixelQueue.pop_front();
+			guard.unlock();
+			PrecompileSingleFunc(id);
+			guard.lock();
+			pendingPixelIDs.erase(id.fullKey);
+		} else {
+			SamplerID id = samplerQueue.front();
+			samplerQueue.pop_front();
+			guard.unlock();
+			Sampler::PrecompileFunc(id);
+			guard.lock();
+			pendingSamplerIDs.erase(id.fullKey);
+		}
+	}
+}
+
+// Must be called with warmupLock held.
+static void RecordPixelID(u64 key) {
+	if (seenPixelIDs.size() < MAX_SAVED_IDS && seenPixelSet.insert(key).second)
+		seenPixelIDs.push_back(key);
+}
+
+static void RecordSamplerID(u32 key) {
+	if (seenSamplerIDs.size() < MAX_SAVED_IDS && seenSamplerSet.insert(key).second)
+		seenSamplerIDs.push_back(key);
+}
+
+static void LoadJitCache(const Path &filename) {
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f)
+		return;
+
+	JitCacheHeader header{};
+	bool success = fread(&header, sizeof(header), 1, f) == 1;
+	success = success && header.magic == JIT_CACHE_MAGIC && header.version == JIT_CACHE_VERSION;
+	// Other builds may have changed what the IDs mean.
+	success = success && header.buildHash == XXH3_64bits(PPSSPP_GIT_VERSION, strlen(PPSSPP_GIT_VERSION));
+	success = success && header.numPixelIDs <= MAX_SAVED_IDS && header.numSamplerIDs <= MAX_SAVED_IDS;
+
+	std::vector<u64> pixelKeys(success ? header.numPixelIDs : 0);
+	std::vector<u32> samplerKeys(success ? header.numSamplerIDs : 0);
+	success = success && fread(pixelKeys.data(), sizeof(u64), pixelKeys.size(), f) == pixelKeys.size();
+	success = success && fread(samplerKeys.data(), sizeof(u32), samplerKeys.size(), f) == samplerKeys.size();
+	fclose(f);
+
+	if (!success) {
+		WARN_LOG(G3D, "Incompatible software renderer jit cache - rebuilding.");
+		File::Delete(filename);
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(warmupLock);
+	for (u64 key : pixelKeys)
+		RecordPixelID(key);
+	for (u32 key : samplerKeys)
+		RecordSamplerID(key);
+	INFO_LOG(G3D, "Loaded software renderer jit cache with %d pixel and %d sampler funcs.", (int)header.numPixelIDs, (int)header.numSamplerIDs);
+}
+
+static void SaveJitCache(const Path &filename) {
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f)
+		return;
+
+	JitCacheHeader header{};
+	header.magic = JIT_CACHE_MAGIC;
+	header.version = JIT_CACHE_VERSION;
+	header.numPixelIDs = (u32)seenPixelIDs.size();
+	header.numSamplerIDs = (u32)seenSamplerIDs.size();
+	header.buildHash = XXH3_64bits(PPSSPP_GIT_VERSION, strlen(PPSSPP_GIT_VERSION));
+
+	bool writeFailed = fwrite(&header, sizeof(header), 1, f) != 1;
+	writeFailed = writeFailed || fwrite(seenPixelIDs.data(), sizeof(u64), seenPixelIDs.size(), f) != seenPixelIDs.size();
+	writeFailed = writeFailed || fwrite(seenSamplerIDs.data(), sizeof(u32), seenSamplerIDs.size(), f) != seenSamplerIDs.size();
+	fclose(f);
+
+	if (writeFailed) {
+		ERROR_LOG(G3D, "Failed to write software renderer jit cache, disk full?");
+		File::Delete(filename);
+	} else {
+		NOTICE_LOG(G3D, "Saved %d pixel and %d sampler funcs to the software renderer jit cache", (int)header.numPixelIDs, (int)header.numSamplerIDs);
+	}
+}
+
+void StartJitWarmup() {
+	std::string discID = g_paramSFO.GetDiscID();
+	if (!discID.empty()) {
+		File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
+		cachePath = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".softjitcache");
+		LoadJitCache(cachePath);
+	}
+
+	if (!CanCompileAsync())
+		return;
+
+	std::lock_guard<std::mutex> guard(warmupLock);
+	for (u64 key : seenPixelIDs) {
+		PixelFuncID id;
+		id.fullKey = key;
+		pixelQueue.push_back(id);
+		pendingPixelIDs.insert(key);
+	}
+	for (u32 key : seenSamplerIDs) {
+		SamplerID id;
+		id.fullKey = key;
+		samplerQueue.push_back(id);
+		pendingSamplerIDs.insert(key);
+	}
+	warmupRunning = true;
+	warmupThread = std::thread(&WarmupThreadFunc);
+}
+
+void StopJitWarmup() {
+	{
+		std::lock_guard<std::mutex> guard(warmupLock);
+		warmupRunning = false;
+		pixelQueue.clear();
+		samplerQueue.clear();
+		pendingPixelIDs.clear();
+		pendingSamplerIDs.clear();
+		warmupCond.notify_one();
+	}
+	// Finishes whatever it's compiling first.
+	if (warmupThread.joinable())
+		warmupThread.join();
+
+	if (cachePath.Valid() && (!seenPixelIDs.empty() || !seenSamplerIDs.empty()))
+		SaveJitCache(cachePath);
+	cachePath = Path();
+	seenPixelIDs.clear();
+	seenSamplerIDs.clear();
+	seenPixelSet.clear();
+	seenSamplerSet.clear();
+}
+
+bool QueueJitCompile(const PixelFuncID &id) {
+	std::lock_guard<std::mutex> guard(warmupLock);
+	RecordPixelID(id.fullKey);
+	if (!warmupRunning || !CanCompileAsync())
+		return false;
+
+	if (pendingPixelIDs.insert(id.fullKey).second) {
+		pixelQueue.push_back(id);
+		warmupCond.notify_one();
+	}
+	return true;
+}
+
+bool QueueJitCompile(const SamplerID &id) {
+	std::lock_guard<std::mutex> guard(warmupLock);
+	RecordSamplerID(id.fullKey);
+	if (!warmupRunning || !CanCompileAsync())
+		return false;
+
+	if (pendingSamplerIDs.insert(id.fullKey).second) {
+		samplerQueue.push_back(id);
+		warmupCond.notify_one();
+	}
+	return true;
+}
+
+int GetPendingJitCompiles() {
+	std::lock_guard<std::mutex> guard(warmupLock);
+	return (int)(pixelQueue.size() + samplerQueue.size());
+}
+
+}  // namespace Rasterizer
@@ -0,0 +1,49 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "GPU/Software/FuncId.h"
+
+// With g_Config.bSoftwareRenderingAsyncJit, pixel and sampler functions missing from the jit
+// caches are compiled on a worker thread, and the draw that needed them uses the C++ versions.
+//
+// The IDs each game uses are also saved to <discID>.softjitcache in the app cache directory,
+// and compiled on the worker when the game starts again, before they're needed.
+namespace Rasterizer {
+
+struct JitCacheStats {
+	int hits = 0;
+	int misses = 0;
+	int compiled = 0;
+	// In seconds.
+	double compileTime = 0.0;
+};
+
+// Loads the IDs saved for the current game, and starts compiling them.  Call after the caches exist.
+void StartJitWarmup();
+// Waits for the worker and saves the IDs seen.  Call before the caches are freed.
+void StopJitWarmup();
+
+// Called on a cache miss, with that cache's lock held.  Returns true if the ID was queued
+// for the worker, and false if it should be compiled right away.
+bool QueueJitCompile(const PixelFuncID &id);
+bool QueueJitCompile(const SamplerID &id);
+// How many IDs are waiting for the worker.
+int GetPendingJitCompiles();
+
+}  // namespace Rasterizer
@@ -33,10 +33,14 @@
 #include "GPU/GPUState.h"
 
 #include "GPU/Common/TextureDecoder.h"
+#include "GPU/Software/BinManager.h"
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/DecodedTextureCache.h"
 #include "GPU/Software/DrawPixel.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
 #include "GPU/Software/SoftGpu.h"
+#include "GPU/Software/StageStats.h"
 
 #if defined(_M_SSE)
 #include <emmintrin.h>
@@ -564,6 +568,7 @@ static inline void ApplyTexturing(Sampler::Funcs sampler, Vec4<int> *prim_color,
 	CalculateSamplingParams(ds, dt, maxTexLevel, level, levelFrac, bilinear);
 
 	PROFILE_THIS_SCOPE("sampler");
+	StageScope stageScope(Stage::SAMPLER);
 	for (int i = 0; i < 4; ++i) {
 		if (mask[i] >= 0)
 			prim_color[i] = ApplyTexturing(s[i], t[i], ((x & 15) + 1) / 2, ((y & 15) + 1) / 2, ToVec4IntArg(prim_color[i]), texptr, texbufw, level, levelFrac, bilinear, sampler);
@@ -741,11 +746,12 @@ static inline Vec4<float> EdgeRecip(const Vec4<int> &w0, const Vec4<int> &w1, co
 template <bool clearMode, bool useSSE4>
 void DrawTriangleSlice(
 	const VertexData& v0, const VertexData& v1, const VertexData& v2,
-	int x1, int y1, int x2, int y2,
+	int x1, int y1, int x2, int y2, int clipX1, int clipY1,
 	const PixelFuncID &pixelID,
 	const Rasterizer::SingleFunc &drawPixel,
 	const Sampler::Funcs &sampler)
 {
+	StageScope stageScope(Stage::RASTER);
 	Vec4<int> bias0 = Vec4<int>::AssignToAll(IsRightSideOrFlatBottomLine(v0.screenpos.xy(), v1.screenpos.xy(), v2.screenpos.xy()) ? -1 : 0);
 	Vec4<int> bias1 = Vec4<int>::AssignToAll(IsRightSideOrFlatBottomLine(v1.screenpos.xy(), v2.screenpos.xy(), v0.screenpos.xy()) ? -1 : 0);
 	Vec4<int> bias2 = Vec4<int>::AssignToAll(IsRightSideOrFlatBottomLine(v2.screenpos.xy(), v0.screenpos.xy(), v1.screenpos.xy()) ? -1 : 0);
@@ -759,7 +765,12 @@ void DrawTriangleSlice(
 		maxTexLevel = 0;
 	}
 
-	if (gstate.isTextureMapEnabled() && !clearMode) {
+	if (gstate.isTextureMapEnabled() && !clearMode && sampler.decoded) {
+		for (int i = 0; i <= maxTexLevel; i++) {
+			texbufw[i] = sampler.decoded->bufw[i];
+			texptr[i] = sampler.decoded->texptr[i];
+		}
+	} else if (gstate.isTextureMapEnabled() && !clearMode) {
 		GETextureFormat texfmt = gstate.getTextureFormat();
 		for (int i = 0; i <= maxTexLevel; i++) {
 			u32 texaddr = gstate.getTextureAddress(i);
@@ -790,6 +801,13 @@ void DrawTriangleSlice(
 	const bool flatColor1 = flatColorAll || (v0.color1 == v1.color1 && v0.color1 == v2.color1);
 	const bool noFog = clearMode || !gstate.isFogEnabled() || (v0.fogdepth >= 1.0f && v1.fogdepth >= 1.0f && v2.fogdepth >= 1.0f);
 
+	// Interpolated z can round a bit either way, and must not wrap around.
+	const int minZ = std::min(std::min(v0.screenpos.z, v1.screenpos.z), v2.screenpos.z) - (flatZ ? 0 : 1);
+	const int maxZ = std::max(std::max(v0.screenpos.z, v1.screenpos.z), v2.screenpos.z) + (flatZ ? 0 : 1);
+	const bool coarseDepth = !clearMode && minZ >= 0 && maxZ <= 0xFFFF && CanRejectCoarseDepth(pixelID);
+	int lastCoarseTile = -1;
+	bool lastCoarseRejected = false;
+
 #if defined(SOFTGPU_MEMORY_TAGGING_DETAILED) || defined(SOFTGPU_MEMORY_TAGGING_BASIC)
 	uint32_t bpp = gstate.FrameBufFormat() == GE_FORMAT_8888 ? 4 : 2;
 	DisplayList currentList{};
@@ -832,8 +850,27 @@ void DrawTriangleSlice(
 			scissor_mask = scissor_mask + scissor_step,
 			p.x = (p.x + 2) & 0x3FF) {
 
+			const bool clipped = curX < clipX1 || curY < clipY1;
+			// Tiles of quads on odd coordinates aren't checked, they can straddle two.
+			// Clipped quads are skipped too, they may be in another thread's tile.
+			if (coarseDepth && !clipped && (p.x & 7) != 7 && (p.y & 7) != 7) {
+				int tile = CoarseDepthTileIndex(p.x, p.y);
+				if (tile != lastCoarseTile) {
+					lastCoarseTile = tile;
+					lastCoarseRejected = IsCoarseDepthTileRejected(tile, pixelID.DepthTestFunc(), minZ, maxZ);
+				}
+				if (lastCoarseRejected)
+					continue;
+			}
+
 			// If p is on or inside all edges, render pixel
 			Vec4<int> mask = MakeMask(w0, w1, w2, bias0, bias1, bias2, scissor_mask);
+			if (clipped) {
+				// Part of this quad belongs to the tile before, which draws it.
+				Vec4<int> clipX = Vec4<int>::AssignToAll((int)(curX - clipX1)) + Vec4<int>(0, 16, 0, 16);
+				Vec4<int> clipY = Vec4<int>::AssignToAll((int)(curY - clipY1)) + Vec4<int>(0, 0, 16, 16);
+				mask = mask | clipX | clipY;
+			}
 			if (AnyMask<useSSE4>(mask)) {
 				Vec4<float> wsum_recip = EdgeRecip(w0, w1, w2);
 
@@ -909,11 +946,14 @@ void DrawTriangleSlice(
 				}
 
 				PROFILE_THIS_SCOPE("draw_tri_px");
+				StageScope pixelScope(Stage::PIXEL);
 				DrawingCoords subp = p;
+				int drawn = 0;
 				for (int i = 0; i < 4; ++i) {
 					if (mask[i] < 0) {
 						continue;
 					}
+					drawn++;
 					subp.x = p.x + (i & 1);
 					subp.y = p.y + (i / 2);
 
@@ -928,10 +968,18 @@ void DrawTriangleSlice(
 					}
 #endif
 				}
+				AddStagePixels(drawn);
 			}
 		}
 	}
 
+	if (pixelID.depthWrite) {
+		// Only pixels from clipX1/clipY1 to x2/y2 were drawn, so this stays within our tile.
+		DrawingCoords dirty1 = TransformUnit::ScreenToDrawing(ScreenCoords(clipX1, clipY1, 0));
+		DrawingCoords dirty2 = TransformUnit::ScreenToDrawing(ScreenCoords(x2, y2, 0));
+		DirtyCoarseDepth(dirty1.x, dirty1.y, dirty2.x, dirty2.y);
+	}
+
 #if !defined(SOFTGPU_MEMORY_TAGGING_DETAILED) && defined(SOFTGPU_MEMORY_TAGGING_BASIC)
 	for (int y = minY; y <= maxY; y += 16) {
 		DrawingCoords p = TransformUnit::ScreenToDrawing(ScreenCoords(minX, y, 0));
@@ -951,6 +999,7 @@ void DrawTriangleSlice(
 void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData& v2)
 {
 	PROFILE_THIS_SCOPE("draw_tri");
+	StageScope stageScope(Stage::RASTER);
 
 	Vec2<int> d01((int)v0.screenpos.x - (int)v1.screenpos.x, (int)v0.screenpos.y - (int)v1.screenpos.y);
 	Vec2<int> d02((int)v0.screenpos.x - (int)v2.screenpos.x, (int)v0.screenpos.y - (int)v2.screenpos.y);
@@ -979,10 +1028,6 @@ void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData&
 	if (maxX < minX || maxY < minY)
 		return;
 
-	// 32 because we do two pixels at once, and we don't want overlap.
-	int rangeY = (maxY - minY + 31) / 32;
-	int rangeX = (maxX - minX + 31) / 32;
-
 	PixelFuncID pixelID;
 	ComputePixelFuncID(&pixelID);
 	Rasterizer::SingleFunc drawPixel = Rasterizer::GetSingleFunc(pixelID);
@@ -992,8 +1037,6 @@ void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData&
 		(gstate.isModeClear() ? &DrawTriangleSlice<true, true> : &DrawTriangleSlice<false, true>) :
 		(gstate.isModeClear() ? &DrawTriangleSlice<true, false> : &DrawTriangleSlice<false, false>);
 
-	const int MIN_LINES_PER_THREAD = 4;
-
 	const uint32_t renderTarget = gstate.getFrameBufAddress() & 0x0FFFFFFF;
 	bool selfRender = (gstate.getTextureAddress(0) & 0x0FFFFFFF) == renderTarget;
 	if (gstate.isMipmapEnabled()) {
@@ -1001,27 +1044,25 @@ void DrawTriangle(const VertexData& v0, const VertexData& v1, const VertexData&
 			selfRender = selfRender || (gstate.getTextureAddress(i) & 0x0FFFFFFF) == renderTarget;
 	}
 
-	if (rangeY >= 12 && rangeX >= rangeY * 4 && !selfRender) {
-		auto bound = [&](int a, int b) -> void {
-			int x1 = minX + a * 16 * 2;
-			int x2 = std::min(maxX, minX + b * 16 * 2 - 1);
-			drawSlice(v0, v1, v2, x1, minY, x2, maxY, pixelID, drawPixel, sampler);
-		};
-		ParallelRangeLoop(&g_threadManager, bound, 0, rangeX, MIN_LINES_PER_THREAD);
-	} else if (rangeY >= 12 && rangeX >= 12 && !selfRender) {
-		auto bound = [&](int a, int b) -> void {
-			int y1 = minY + a * 16 * 2;
-			int y2 = std::min(maxY, minY + b * 16 * 2 - 1);
-			drawSlice(v0, v1, v2, minX, y1, maxX, y2, pixelID, drawPixel, sampler);
-		};
-		ParallelRangeLoop(&g_threadManager, bound, 0, rangeY, MIN_LINES_PER_THREAD);
-	} else {
-		drawSlice(v0, v1, v2, minX, minY, maxX, maxY, pixelID, drawPixel, sampler);
+	if (selfRender) {
+		// Reads pixels other tiles may write, so this has to happen in order, on its own.
+		FlushBins();
+		BeginCoarseDepth();
+		drawSlice(v0, v1, v2, minX, minY, maxX, maxY, minX, minY, pixelID, drawPixel, sampler);
+		return;
 	}
+
+	BinnedTriangle tri{ v0, v1, v2, minX, minY, maxX, maxY, pixelID, drawPixel, sampler, drawSlice };
+	BinTriangle(tri);
 }
 
 void DrawPoint(const VertexData &v0)
 {
+	StageScope stageScope(Stage::RASTER);
+	FlushBins();
+	// This may write depth without updating the coarse depth tiles.
+	InvalidateCoarseDepth();
+
 	ScreenCoords pos = v0.screenpos;
 	Vec4<int> prim_color = v0.color0;
 	Vec3<int> sec_color = v0.color1;
@@ -1051,7 +1092,12 @@ void DrawPoint(const VertexData &v0)
 			maxTexLevel = 0;
 		}
 
-		if (gstate.isTextureMapEnabled() && !pixelID.clearMode) {
+		if (sampler.decoded) {
+			for (int i = 0; i <= maxTexLevel; i++) {
+				texbufw[i] = sampler.decoded->bufw[i];
+				texptr[i] = sampler.decoded->texptr[i];
+			}
+		} else if (gstate.isTextureMapEnabled() && !pixelID.clearMode) {
 			GETextureFormat texfmt = gstate.getTextureFormat();
 			for (int i = 0; i <= maxTexLevel; i++) {
 				u32 texaddr = gstate.getTextureAddress(i);
@@ -1078,6 +1124,7 @@ void DrawPoint(const VertexData &v0)
 		bool bilinear;
 		CalculateSamplingParams(0.0f, 0.0f, maxTexLevel, texLevel, texLevelFrac, bilinear);
 		PROFILE_THIS_SCOPE("sampler");
+		StageScope samplerScope(Stage::SAMPLER);
 		prim_color = ApplyTexturingSingle(s, t, pos.x, pos.y, ToVec4IntArg(prim_color), texptr, texbufw, texLevel, texLevelFrac, bilinear, sampler);
 	}
 
@@ -1095,7 +1142,9 @@ void DrawPoint(const VertexData &v0)
 	}
 
 	PROFILE_THIS_SCOPE("draw_px");
+	StageScope pixelScope(Stage::PIXEL);
 	drawPixel(p.x, p.y, z, fog, ToVec4IntArg(prim_color), pixelID);
+	AddStagePixels(1);
 
 #if defined(SOFTGPU_MEMORY_TAGGING_DETAILED) || defined(SOFTGPU_MEMORY_TAGGING_BASIC)
 	uint32_t bpp = gstate.FrameBufFormat() == GE_FORMAT_8888 ? 4 : 2;
@@ -1117,6 +1166,12 @@ void DrawPoint(const VertexData &v0)
 
 void ClearRectangle(const VertexData &v0, const VertexData &v1)
 {
+	// Parallel, but timed as a whole here since it's just filling memory.
+	StageScope stageScope(Stage::RASTER);
+	FlushBins();
+	// This may write depth without updating the coarse depth tiles.
+	InvalidateCoarseDepth();
+
 	int minX = std::min(v0.screenpos.x, v1.screenpos.x) & ~0xF;
 	int minY = std::min(v0.screenpos.y, v1.screenpos.y) & ~0xF;
 	int maxX = (std::max(v0.screenpos.x, v1.screenpos.x) + 0xF) & ~0xF;
@@ -1137,6 +1192,7 @@ void ClearRectangle(const VertexData &v0, const VertexData &v1)
 	const int w = (maxX - minX) / 16;
 	if (w <= 0)
 		return;
+	AddStagePixels(w * std::max(0, pend.y - pprime.y));
 
 #if defined(SOFTGPU_MEMORY_TAGGING_DETAILED) || defined(SOFTGPU_MEMORY_TAGGING_BASIC)
 	DisplayList currentList{};
@@ -1300,6 +1356,11 @@ void ClearRectangle(const VertexData &v0, const VertexData &v1)
 
 void DrawLine(const VertexData &v0, const VertexData &v1)
 {
+	StageScope stageScope(Stage::RASTER);
+	FlushBins();
+	// This may write depth without updating the coarse depth tiles.
+	InvalidateCoarseDepth();
+
 	// TODO: Use a proper line drawing algorithm that handles fractional endpoints correctly.
 	Vec3<int> a(v0.screenpos.x, v0.screenpos.y, v0.screenpos.z);
 	Vec3<int> b(v1.screenpos.x, v1.screenpos.y, v0.screenpos.z);
@@ -1343,7 +1404,13 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 		maxTexLevel = 0;
 	}
 
-	if (gstate.isTextureMapEnabled() && !pixelID.clearMode) {
+	Sampler::Funcs sampler = Sampler::GetFuncs();
+	if (gstate.isTextureMapEnabled() && !pixelID.clearMode && sampler.decoded) {
+		for (int i = 0; i <= maxTexLevel; i++) {
+			texbufw[i] = sampler.decoded->bufw[i];
+			texptr[i] = sampler.decoded->texptr[i];
+		}
+	} else if (gstate.isTextureMapEnabled() && !pixelID.clearMode) {
 		GETextureFormat texfmt = gstate.getTextureFormat();
 		for (int i = 0; i <= maxTexLevel; i++) {
 			u32 texaddr = gstate.getTextureAddress(i);
@@ -1351,8 +1418,6 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 			texptr[i] = Memory::GetPointer(texaddr);
 		}
 	}
-
-	Sampler::Funcs sampler = Sampler::GetFuncs();
 	Rasterizer::SingleFunc drawPixel = Rasterizer::GetSingleFunc(pixelID);
 
 #if defined(SOFTGPU_MEMORY_TAGGING_DETAILED) || defined(SOFTGPU_MEMORY_TAGGING_BASIC)
@@ -1427,6 +1492,7 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 				}
 
 				PROFILE_THIS_SCOPE("sampler");
+				StageScope samplerScope(Stage::SAMPLER);
 				prim_color = ApplyTexturingSingle(s, t, x, y, ToVec4IntArg(prim_color), texptr, texbufw, texLevel, texLevelFrac, texBilinear, sampler);
 			}
 
@@ -1436,8 +1502,10 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 			ScreenCoords pprime = ScreenCoords((int)x, (int)y, (int)z);
 
 			PROFILE_THIS_SCOPE("draw_px");
+			StageScope pixelScope(Stage::PIXEL);
 			DrawingCoords p = TransformUnit::ScreenToDrawing(pprime);
 			drawPixel(p.x, p.y, z, fog, ToVec4IntArg(prim_color), pixelID);
+			AddStagePixels(1);
 
 #if defined(SOFTGPU_MEMORY_TAGGING_DETAILED) || defined(SOFTGPU_MEMORY_TAGGING_BASIC)
 			uint32_t bpp = gstate.FrameBufFormat() == GE_FORMAT_8888 ? 4 : 2;
@@ -1459,6 +1527,8 @@ void DrawLine(const VertexData &v0, const VertexData &v1)
 
 bool GetCurrentStencilbuffer(GPUDebugBuffer &buffer)
 {
+	FlushBins();
+
 	int w = gstate.getRegionX2() - gstate.getRegionX1() + 1;
 	int h = gstate.getRegionY2() - gstate.getRegionY1() + 1;
 	buffer.Allocate(w, h, GPU_DBG_FORMAT_8BIT);
@@ -1475,6 +1545,8 @@ bool GetCurrentStencilbuffer(GPUDebugBuffer &buffer)
 
 bool GetCurrentTexture(GPUDebugBuffer &buffer, int level)
 {
+	FlushBins();
+
 	if (!gstate.isTextureMapEnabled()) {
 		return false;
 	}
@@ -16,10 +16,14 @@
 #include "GPU/GPUState.h"
 
 #include "GPU/Common/TextureCacheCommon.h"
+#include "GPU/Software/BinManager.h"
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/DecodedTextureCache.h"
 #include "GPU/Software/DrawPixel.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
 #include "GPU/Software/SoftGpu.h"
+#include "GPU/Software/StageStats.h"
 
 #if defined(_M_SSE)
 #include <emmintrin.h>
@@ -78,6 +82,12 @@ static inline Vec4IntResult SOFTRAST_CALL ModulateRGBA(Vec4IntArg prim_in, Vec4I
 }
 
 void DrawSprite(const VertexData& v0, const VertexData& v1) {
+	// The sampler and pixel work is fused and parallel, so it's all timed here.
+	StageScope stageScope(Stage::RASTER);
+	// Sprites draw right away, so anything binned before has to go first.
+	FlushBins();
+	InvalidateCoarseDepth();
+
 	const u8 *texptr = nullptr;
 
 	GETextureFormat texfmt = gstate.getTextureFormat();
@@ -88,7 +98,12 @@ void DrawSprite(const VertexData& v0, const VertexData& v1) {
 
 	// These look at gstate.
 	SamplerID samplerID;
-	ComputeSamplerID(&samplerID);
+	// Fetching doesn't wrap or clamp, but RectangleFastPath() only sends sprites inside the texture.
+	const Sampler::DecodedTexture *decoded = Sampler::ComputeSamplerIDWithCache(&samplerID);
+	if (decoded) {
+		texptr = decoded->texptr[0];
+		texbufw = decoded->bufw[0];
+	}
 	PixelFuncID pixelID;
 	ComputePixelFuncID(&pixelID);
 
@@ -255,6 +270,7 @@ void DrawSprite(const VertexData& v0, const VertexData& v1) {
 			}, pos0.y, pos1.y, MIN_LINES_PER_THREAD);
 		}
 	}
+	AddStagePixels(std::max(0, pos1.x - pos0.x) * std::max(0, pos1.y - pos0.y));
 
 #if defined(SOFTGPU_MEMORY_TAGGING_BASIC) || defined(SOFTGPU_MEMORY_TAGGING_DETAILED)
 	uint32_t bpp = pixelID.FBFormat() == GE_FORMAT_8888 ? 4 : 2;
@@ -20,10 +20,14 @@
 #include <mutex>
 #include "Common/Data/Convert/ColorConv.h"
 #include "Common/StringUtils.h"
+#include "Common/TimeUtil.h"
 #include "Core/Config.h"
 #include "Core/Reporting.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "GPU/GPUState.h"
+#include "GPU/Software/BinManager.h"
+#include "GPU/Software/DecodedTextureCache.h"
+#include "GPU/Software/JitWarmup.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/RasterizerRegCache.h"
 #include "GPU/Software/Sampler.h"
@@ -51,6 +55,7 @@ void Init() {
 }
 
 void Shutdown() {
+	ClearDecodedTextures();
 	delete jitCache;
 	jitCache = nullptr;
 }
@@ -94,6 +99,36 @@ FetchFunc GetFetchFunc(SamplerID id) {
 	return &SampleFetch;
 }
 
+void PrecompileFunc(const SamplerID &id) {
+	jitCache->Precompile(id);
+}
+
+void GetJitStats(Rasterizer::JitCacheStats &stats) {
+	stats = jitCache->GetStats();
+}
+
+const DecodedTexture *ComputeSamplerIDWithCache(SamplerID *id) {
+	ComputeSamplerID(id);
+	if (!CanDecodeTexture(*id))
+		return nullptr;
+
+	// The C++ fallbacks read the format from gstate, so decoded copies need all of these jitted.
+	SamplerID decodedID = DecodedSamplerID(*id);
+	SamplerID nearestID = decodedID;
+	nearestID.linear = false;
+	SamplerID linearID = decodedID;
+	linearID.linear = true;
+	SamplerID fetchID = decodedID;
+	fetchID.fetch = true;
+	if (!jitCache->GetNearest(nearestID) || !jitCache->GetLinear(linearID) || !jitCache->GetFetch(fetchID))
+		return nullptr;
+
+	const DecodedTexture *decoded = LookupDecodedTexture(*id);
+	if (decoded)
+		*id = decodedID;
+	return decoded;
+}
+
 SamplerJitCache::SamplerJitCache()
 #if PPSSPP_ARCH(ARM64)
  : fp(this)
@@ -171,75 +206,77 @@ std::string SamplerJitCache::DescribeCodePtr(const u8 *ptr) {
 }
 
 NearestFunc SamplerJitCache::GetNearest(const SamplerID &id) {
-	std::lock_guard<std::mutex> guard(jitCacheLock);
-
-	auto it = cache_.find(id);
-	if (it != cache_.end()) {
-		return (NearestFunc)it->second;
-	}
+	return (NearestFunc)GetByID(id);
+}
 
-	// TODO: What should be the min size?  Can we even hit this?
-	if (GetSpaceLeft() < 16384) {
-		Clear();
-	}
+LinearFunc SamplerJitCache::GetLinear(const SamplerID &id) {
+	return (LinearFunc)GetByID(id);
+}
 
-#if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
-	if (g_Config.bSoftwareRenderingJit) {
-		addresses_[id] = GetCodePointer();
-		NearestFunc func = CompileNearest(id);
-		cache_[id] = (NearestFunc)func;
-		return func;
-	}
-#endif
-	return nullptr;
+FetchFunc SamplerJitCache::GetFetch(const SamplerID &id) {
+	return (FetchFunc)GetByID(id);
 }
 
-LinearFunc SamplerJitCache::GetLinear(const SamplerID &id) {
+NearestFunc SamplerJitCache::GetByID(const SamplerID &id) {
 	std::lock_guard<std::mutex> guard(jitCacheLock);
 
 	auto it = cache_.find(id);
 	if (it != cache_.end()) {
-		return (LinearFunc)it->second;
+		stats_.hits++;
+		return it->second;
 	}
+	stats_.misses++;
 
 	// TODO: What should be the min size?  Can we even hit this?
 	if (GetSpaceLeft() < 16384) {
+		// Binned triangles may still point at the old code.
+		Rasterizer::FlushBins();
 		Clear();
 	}
 
 #if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
 	if (g_Config.bSoftwareRenderingJit) {
-		addresses_[id] = GetCodePointer();
-		LinearFunc func = CompileLinear(id);
-		cache_[id] = (NearestFunc)func;
-		return func;
+		// If queued, the C++ version samples until it's ready.
+		if (Rasterizer::QueueJitCompile(id))
+			return nullptr;
+		return CompileAndCache(id);
 	}
 #endif
 	return nullptr;
 }
 
-FetchFunc SamplerJitCache::GetFetch(const SamplerID &id) {
+void SamplerJitCache::Precompile(const SamplerID &id) {
 	std::lock_guard<std::mutex> guard(jitCacheLock);
+	// Only the emu thread can clear, since that needs to flush bins first.
+	if (cache_.find(id) != cache_.end() || GetSpaceLeft() < 16384)
+		return;
 
-	auto it = cache_.find(id);
-	if (it != cache_.end()) {
-		return (FetchFunc)it->second;
-	}
-
-	// TODO: What should be the min size?  Can we even hit this?
-	if (GetSpaceLeft() < 16384) {
-		Clear();
-	}
+#if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
+	CompileAndCache(id);
+#endif
+}
 
 #if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
-	if (g_Config.bSoftwareRenderingJit) {
-		addresses_[id] = GetCodePointer();
-		FetchFunc func = CompileFetch(id);
-		cache_[id] = (NearestFunc)func;
-		return func;
-	}
+NearestFunc SamplerJitCache::CompileAndCache(const SamplerID &id) {
+	double start = time_now_d();
+	addresses_[id] = GetCodePointer();
+	NearestFunc func;
+	if (id.fetch)
+		func = (NearestFunc)CompileFetch(id);
+	else if (id.linear)
+		func = (NearestFunc)CompileLinear(id);
+	else
+		func = CompileNearest(id);
+	cache_[id] = func;
+	stats_.compiled++;
+	stats_.compileTime += time_now_d() - start;
+	return func;
+}
 #endif
-	return nullptr;
+
+Rasterizer::JitCacheStats SamplerJitCache::GetStats() {
+	std::lock_guard<std::mutex> guard(jitCacheLock);
+	return stats_;
 }
 
 template <unsigned int texel_size_bits>
@@ -22,6 +22,7 @@
 #include <unordered_map>
 #include "GPU/Math3D.h"
 #include "GPU/Software/FuncId.h"
+#include "GPU/Software/JitWarmup.h"
 #include "GPU/Software/RasterizerRegCache.h"
 
 namespace Sampler {
@@ -42,14 +43,26 @@ NearestFunc GetNearestFunc(SamplerID id);
 typedef Rasterizer::Vec4IntResult (SOFTRAST_CALL *LinearFunc)(float s, float t, int x, int y, Rasterizer::Vec4IntArg prim_color, const u8 *const *tptr, const int *bufw, int level, int levelFrac);
 LinearFunc GetLinearFunc(SamplerID id);
 
+// For the warmup thread, compiles the function the id's flags select if there's room.
+void PrecompileFunc(const SamplerID &id);
+void GetJitStats(Rasterizer::JitCacheStats &stats);
+
+struct DecodedTexture;
+
+// Like ComputeSamplerID(), but switches to a decoded copy of the texture when there's one to use.
+// Then the id is for the copy, and its levels must be sampled instead of texture memory.
+const DecodedTexture *ComputeSamplerIDWithCache(SamplerID *id);
+
 struct Funcs {
 	NearestFunc nearest;
 	LinearFunc linear;
+	// If set, where to read texture levels from.
+	const DecodedTexture *decoded;
 };
 static inline Funcs GetFuncs() {
 	Funcs f;
 	SamplerID id;
-	ComputeSamplerID(&id);
+	f.decoded = ComputeSamplerIDWithCache(&id);
 	f.nearest = GetNearestFunc(id);
 	f.linear = GetLinearFunc(id);
 	return f;
@@ -68,11 +81,17 @@ class SamplerJitCache : public Rasterizer::CodeBlock {
 	NearestFunc GetNearest(const SamplerID &id);
 	LinearFunc GetLinear(const SamplerID &id);
 	FetchFunc GetFetch(const SamplerID &id);
+	void Precompile(const SamplerID &id);
 	void Clear();
+	Rasterizer::JitCacheStats GetStats();
 
 	std::string DescribeCodePtr(const u8 *ptr);
 
 private:
+	// The kind of function is picked by the linear and fetch flags in the id.
+	NearestFunc GetByID(const SamplerID &id);
+	// Must be called with the cache locked.
+	NearestFunc CompileAndCache(const SamplerID &id);
 	FetchFunc CompileFetch(const SamplerID &id);
 	NearestFunc CompileNearest(const SamplerID &id);
 	LinearFunc CompileLinear(const SamplerID &id);
@@ -138,6 +157,7 @@ class SamplerJitCache : public Rasterizer::CodeBlock {
 	std::unordered_map<SamplerID, const u8 *> addresses_;
 	std::unordered_map<const u8 *, std::string> descriptions_;
 	Rasterizer::RegCache regCache_;
+	Rasterizer::JitCacheStats stats_;
 };
 
 #if defined(__clang__) || defined(__GNUC__)
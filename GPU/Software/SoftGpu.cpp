@@ -36,7 +36,11 @@
 #include "Common/Profiler/Profiler.h"
 #include "Common/GPU/thin3d.h"
 
+#include "GPU/Software/BinManager.h"
+#include "GPU/Software/CoarseDepth.h"
+#include "GPU/Software/DecodedTextureCache.h"
 #include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/JitWarmup.h"
 #include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
 #include "GPU/Software/SoftGpu.h"
@@ -69,6 +73,7 @@ SoftGPU::SoftGPU(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 
 	Rasterizer::Init();
 	Sampler::Init();
+	Rasterizer::StartJitWarmup();
 	drawEngine_ = new SoftwareDrawEngine();
 	drawEngine_->Init();
 	drawEngineCommon_ = drawEngine_;
@@ -108,6 +113,7 @@ SoftGPU::~SoftGPU() {
 		delete presentation_;
 	}
 
+	Rasterizer::StopJitWarmup();
 	Sampler::Shutdown();
 	Rasterizer::Shutdown();
 }
@@ -272,6 +278,7 @@ void SoftGPU::CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight) {
 }
 
 void SoftGPU::CopyDisplayToOutput(bool reallyDirty) {
+	Rasterizer::FlushBins();
 	// The display always shows 480x272.
 	CopyToCurrentFboFromDisplayRam(FB_WIDTH, FB_HEIGHT);
 	framebufferDirty_ = false;
@@ -293,6 +300,81 @@ void SoftGPU::Resized() {
 	}
 }
 
+// Binned triangles draw with gstate as it is when they're flushed.
+// These don't affect how they draw, so they can change without flushing.
+static bool CmdAffectsBinnedDraws(u32 cmd) {
+	switch (cmd) {
+	case GE_CMD_NOP:
+	case GE_CMD_VADDR:
+	case GE_CMD_IADDR:
+	case GE_CMD_PRIM:
+	case GE_CMD_BEZIER:
+	case GE_CMD_SPLINE:
+	case GE_CMD_BOUNDINGBOX:
+	case GE_CMD_JUMP:
+	case GE_CMD_BJUMP:
+	case GE_CMD_CALL:
+	case GE_CMD_RET:
+	case GE_CMD_BASE:
+	case GE_CMD_VERTEXTYPE:
+	case GE_CMD_OFFSETADDR:
+	case GE_CMD_ORIGIN:
+	case GE_CMD_CULLFACEENABLE:
+	case GE_CMD_CULL:
+	case GE_CMD_PATCHDIVISION:
+	case GE_CMD_PATCHPRIMITIVE:
+	case GE_CMD_PATCHFACING:
+	case GE_CMD_PATCHCULLENABLE:
+	case GE_CMD_WORLDMATRIXNUMBER:
+	case GE_CMD_WORLDMATRIXDATA:
+	case GE_CMD_VIEWMATRIXNUMBER:
+	case GE_CMD_VIEWMATRIXDATA:
+	case GE_CMD_PROJMATRIXNUMBER:
+	case GE_CMD_PROJMATRIXDATA:
+	case GE_CMD_TGENMATRIXNUMBER:
+	case GE_CMD_TGENMATRIXDATA:
+	case GE_CMD_BONEMATRIXNUMBER:
+	case GE_CMD_BONEMATRIXDATA:
+	case GE_CMD_MORPHWEIGHT0: case GE_CMD_MORPHWEIGHT1: case GE_CMD_MORPHWEIGHT2: case GE_CMD_MORPHWEIGHT3:
+	case GE_CMD_MORPHWEIGHT4: case GE_CMD_MORPHWEIGHT5: case GE_CMD_MORPHWEIGHT6: case GE_CMD_MORPHWEIGHT7:
+	case GE_CMD_VIEWPORTXSCALE: case GE_CMD_VIEWPORTYSCALE: case GE_CMD_VIEWPORTZSCALE:
+	case GE_CMD_VIEWPORTXCENTER: case GE_CMD_VIEWPORTYCENTER: case GE_CMD_VIEWPORTZCENTER:
+	case GE_CMD_TEXSCALEU: case GE_CMD_TEXSCALEV: case GE_CMD_TEXOFFSETU: case GE_CMD_TEXOFFSETV:
+	case GE_CMD_LIGHTINGENABLE:
+	case GE_CMD_LIGHTENABLE0: case GE_CMD_LIGHTENABLE1: case GE_CMD_LIGHTENABLE2: case GE_CMD_LIGHTENABLE3:
+	case GE_CMD_REVERSENORMAL:
+	case GE_CMD_MATERIALUPDATE: case GE_CMD_MATERIALEMISSIVE: case GE_CMD_MATERIALAMBIENT: case GE_CMD_MATERIALDIFFUSE:
+	case GE_CMD_MATERIALSPECULAR: case GE_CMD_MATERIALALPHA: case GE_CMD_MATERIALSPECULARCOEF:
+	case GE_CMD_AMBIENTCOLOR: case GE_CMD_AMBIENTALPHA:
+	case GE_CMD_LIGHTMODE:
+	case GE_CMD_LIGHTTYPE0: case GE_CMD_LIGHTTYPE1: case GE_CMD_LIGHTTYPE2: case GE_CMD_LIGHTTYPE3:
+	case GE_CMD_LX0: case GE_CMD_LY0: case GE_CMD_LZ0: case GE_CMD_LX1: case GE_CMD_LY1: case GE_CMD_LZ1:
+	case GE_CMD_LX2: case GE_CMD_LY2: case GE_CMD_LZ2: case GE_CMD_LX3: case GE_CMD_LY3: case GE_CMD_LZ3:
+	case GE_CMD_LDX0: case GE_CMD_LDY0: case GE_CMD_LDZ0: case GE_CMD_LDX1: case GE_CMD_LDY1: case GE_CMD_LDZ1:
+	case GE_CMD_LDX2: case GE_CMD_LDY2: case GE_CMD_LDZ2: case GE_CMD_LDX3: case GE_CMD_LDY3: case GE_CMD_LDZ3:
+	case GE_CMD_LKA0: case GE_CMD_LKB0: case GE_CMD_LKC0: case GE_CMD_LKA1: case GE_CMD_LKB1: case GE_CMD_LKC1:
+	case GE_CMD_LKA2: case GE_CMD_LKB2: case GE_CMD_LKC2: case GE_CMD_LKA3: case GE_CMD_LKB3: case GE_CMD_LKC3:
+	case GE_CMD_LKS0: case GE_CMD_LKS1: case GE_CMD_LKS2: case GE_CMD_LKS3:
+	case GE_CMD_LKO0: case GE_CMD_LKO1: case GE_CMD_LKO2: case GE_CMD_LKO3:
+	case GE_CMD_LAC0: case GE_CMD_LDC0: case GE_CMD_LSC0: case GE_CMD_LAC1: case GE_CMD_LDC1: case GE_CMD_LSC1:
+	case GE_CMD_LAC2: case GE_CMD_LDC2: case GE_CMD_LSC2: case GE_CMD_LAC3: case GE_CMD_LDC3: case GE_CMD_LSC3:
+	// Only used once TRANSFERSTART or LOADCLUT happen, and those always flush.
+	case GE_CMD_CLUTADDR:
+	case GE_CMD_CLUTADDRUPPER:
+	case GE_CMD_TRANSFERSRC:
+	case GE_CMD_TRANSFERSRCW:
+	case GE_CMD_TRANSFERDST:
+	case GE_CMD_TRANSFERDSTW:
+	case GE_CMD_TRANSFERSRCPOS:
+	case GE_CMD_TRANSFERDSTPOS:
+	case GE_CMD_TRANSFERSIZE:
+		return false;
+
+	default:
+		return true;
+	}
+}
+
 void SoftGPU::FastRunLoop(DisplayList &list) {
 	PROFILE_THIS_SCOPE("soft_runloop");
 	for (; downcount > 0; --downcount) {
@@ -300,6 +382,8 @@ void SoftGPU::FastRunLoop(DisplayList &list) {
 		u32 cmd = op >> 24;
 
 		u32 diff = op ^ gstate.cmdmem[cmd];
+		if (diff != 0 && CmdAffectsBinnedDraws(cmd))
+			Rasterizer::FlushBins();
 		gstate.cmdmem[cmd] = op;
 		ExecuteOp(op, diff);
 
@@ -307,6 +391,59 @@ void SoftGPU::FastRunLoop(DisplayList &list) {
 	}
 }
 
+void SoftGPU::PreExecuteOp(u32 op, u32 diff) {
+	if (diff != 0 && CmdAffectsBinnedDraws(op >> 24))
+		Rasterizer::FlushBins();
+}
+
+void SoftGPU::FinishDeferred() {
+	// With a render thread, this keeps drawing while the CPU runs. The CPU has to sync
+	// (or at least invalidate) before it touches memory the triangles use or draw to.
+	Rasterizer::SubmitBins();
+}
+
+void SoftGPU::BeginFrame() {
+	Rasterizer::NewBinStatsFrame();
+	GPUCommon::BeginFrame();
+}
+
+bool SoftGPU::InterpretList(DisplayList &list) {
+	// The CPU may have written to depth or texture memory since we last ran.
+	Rasterizer::InvalidateCoarseDepth();
+	Sampler::InvalidateDecodedTextures();
+	return GPUCommon::InterpretList(list);
+}
+
+void SoftGPU::InterruptEnd(int listid) {
+	// Might restore the list's context into gstate.
+	Rasterizer::FlushBins();
+	GPUCommon::InterruptEnd(listid);
+}
+
+int SoftGPU::ListSync(int listid, int mode) {
+	Rasterizer::FlushBins();
+	return GPUCommon::ListSync(listid, mode);
+}
+
+u32 SoftGPU::DrawSync(int mode) {
+	Rasterizer::FlushBins();
+	return GPUCommon::DrawSync(mode);
+}
+
+void SoftGPU::DoState(PointerWrap &p) {
+	Rasterizer::FlushBins();
+	GPUCommon::DoState(p);
+	Rasterizer::InvalidateCoarseDepth();
+	Sampler::InvalidateDecodedTextures();
+}
+
+bool SoftGPU::BusyDrawing() {
+	// Only asked before gstate is saved or restored from outside a list, so finish drawing first.
+	// The render thread isn't visible to the game, so it doesn't count as busy.
+	Rasterizer::FlushBins();
+	return GPUCommon::BusyDrawing();
+}
+
 void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 	u32 cmd = op >> 24;
 	u32 data = op & 0xFFFFFF;
@@ -547,21 +684,28 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 		break;
 
 	case GE_CMD_SCISSOR1:
+		break;
+
 	case GE_CMD_SCISSOR2:
+		// Decoded textures are only checked against the parts of the render target drawing can reach.
+		if (diff)
+			Sampler::InvalidateDecodedTextures();
 		break;
 
 	case GE_CMD_MINZ:
 		break;
 
 	case GE_CMD_FRAMEBUFPTR:
-		fb.data = Memory::GetPointer(gstate.getFrameBufAddress());
-		break;
-
 	case GE_CMD_FRAMEBUFWIDTH:
 		fb.data = Memory::GetPointer(gstate.getFrameBufAddress());
+		// Textures inside the old render target may have been drawn to.
+		if (diff)
+			Sampler::InvalidateDecodedTextures();
 		break;
 
 	case GE_CMD_FRAMEBUFPIXFORMAT:
+		if (diff)
+			Sampler::InvalidateDecodedTextures();
 		break;
 
 	case GE_CMD_TEXADDR0:
@@ -590,6 +734,8 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 
 	case GE_CMD_LOADCLUT:
 		{
+			Rasterizer::FlushBins();
+			Sampler::InvalidateDecodedTextures();
 			u32 clutAddr = gstate.getClutAddress();
 			u32 clutTotalBytes = gstate.getClutLoadBytes();
 
@@ -620,6 +766,9 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 
 	case GE_CMD_TRANSFERSTART:
 		{
+			Rasterizer::FlushBins();
+			Rasterizer::InvalidateCoarseDepth();
+			Sampler::InvalidateDecodedTextures();
 			u32 srcBasePtr = gstate.getTransferSrcAddress();
 			u32 srcStride = gstate.getTransferSrcStride();
 
@@ -670,11 +819,10 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 		break;
 
 	case GE_CMD_ZBUFPTR:
-		depthbuf.data = Memory::GetPointer(gstate.getDepthBufAddress());
-		break;
-
 	case GE_CMD_ZBUFWIDTH:
 		depthbuf.data = Memory::GetPointer(gstate.getDepthBufAddress());
+		if (diff)
+			Sampler::InvalidateDecodedTextures();
 		break;
 
 	case GE_CMD_AMBIENTCOLOR:
@@ -861,6 +1009,13 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 		}
 		break;
 
+	case GE_CMD_END:
+		// Finishing the list may restore its context into gstate.
+		if (currentList && currentList->context.IsValid())
+			Rasterizer::FlushBins();
+		GPUCommon::ExecuteOp(op, diff);
+		break;
+
 	default:
 		GPUCommon::ExecuteOp(op, diff);
 		break;
@@ -868,12 +1023,31 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff) {
 }
 
 void SoftGPU::GetStats(char *buffer, size_t bufsize) {
-	snprintf(buffer, bufsize, "SoftGPU: (N/A)");
+	Rasterizer::BinStats stats;
+	Rasterizer::GetBinStats(stats);
+	Rasterizer::JitCacheStats pixelJit;
+	Rasterizer::GetPixelJitStats(pixelJit);
+	Rasterizer::JitCacheStats samplerJit;
+	Sampler::GetJitStats(samplerJit);
+	snprintf(buffer, bufsize,
+		"SoftGPU: %d batches, %d syncs (render thread %s)\n"
+		"Draw: %0.2f ms, emu waiting: %0.2f ms, render waiting: %0.2f ms\n"
+		"Pixel jit: %d hits, %d misses, %d compiled in %0.2f ms\n"
+		"Sampler jit: %d hits, %d misses, %d compiled in %0.2f ms\n"
+		"Jit compiles queued: %d\n",
+		stats.batches, stats.syncs, g_Config.bSoftwareRenderingThread ? "on" : "off",
+		stats.renderTime * 1000.0, stats.emuWaitTime * 1000.0, stats.renderWaitTime * 1000.0,
+		pixelJit.hits, pixelJit.misses, pixelJit.compiled, pixelJit.compileTime * 1000.0,
+		samplerJit.hits, samplerJit.misses, samplerJit.compiled, samplerJit.compileTime * 1000.0,
+		Rasterizer::GetPendingJitCompiles());
 }
 
 void SoftGPU::InvalidateCache(u32 addr, int size, GPUInvalidationType type)
 {
-	// Nothing to invalidate.
+	// The CPU may be about to use or change this memory.
+	Rasterizer::FlushBins();
+	Rasterizer::InvalidateCoarseDepth();
+	Sampler::InvalidateDecodedTextures();
 }
 
 void SoftGPU::NotifyVideoUpload(u32 addr, int size, int width, int format)
@@ -883,6 +1057,7 @@ void SoftGPU::NotifyVideoUpload(u32 addr, int size, int width, int format)
 
 bool SoftGPU::PerformMemoryCopy(u32 dest, u32 src, int size)
 {
+	Rasterizer::FlushBins();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	GPURecord::NotifyMemcpy(dest, src, size);
@@ -893,6 +1068,7 @@ bool SoftGPU::PerformMemoryCopy(u32 dest, u32 src, int size)
 
 bool SoftGPU::PerformMemorySet(u32 dest, u8 v, int size)
 {
+	Rasterizer::FlushBins();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	GPURecord::NotifyMemset(dest, v, size);
@@ -903,6 +1079,7 @@ bool SoftGPU::PerformMemorySet(u32 dest, u8 v, int size)
 
 bool SoftGPU::PerformMemoryDownload(u32 dest, int size)
 {
+	Rasterizer::FlushBins();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	return false;
@@ -910,6 +1087,7 @@ bool SoftGPU::PerformMemoryDownload(u32 dest, int size)
 
 bool SoftGPU::PerformMemoryUpload(u32 dest, int size)
 {
+	Rasterizer::FlushBins();
 	// Nothing to update.
 	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	GPURecord::NotifyUpload(dest, size);
@@ -931,6 +1109,8 @@ bool SoftGPU::FramebufferDirty() {
 }
 
 bool SoftGPU::GetCurrentFramebuffer(GPUDebugBuffer &buffer, GPUDebugFramebufferType type, int maxRes) {
+	Rasterizer::FlushBins();
+
 	int x1 = gstate.getRegionX1();
 	int y1 = gstate.getRegionY1();
 	int x2 = gstate.getRegionX2() + 1;
@@ -967,6 +1147,8 @@ bool SoftGPU::GetOutputFramebuffer(GPUDebugBuffer &buffer) {
 
 bool SoftGPU::GetCurrentDepthbuffer(GPUDebugBuffer &buffer)
 {
+	Rasterizer::FlushBins();
+
 	const int w = gstate.getRegionX2() - gstate.getRegionX1() + 1;
 	const int h = gstate.getRegionY2() - gstate.getRegionY1() + 1;
 	buffer.Allocate(w, h, GPU_DBG_FORMAT_16BIT);
@@ -65,6 +65,14 @@ class SoftGPU : public GPUCommon {
 	void CheckGPUFeatures() override {}
 	void InitClear() override {}
 	void ExecuteOp(u32 op, u32 diff) override;
+	void PreExecuteOp(u32 op, u32 diff) override;
+
+	bool InterpretList(DisplayList &list) override;
+	void InterruptEnd(int listid) override;
+	int ListSync(int listid, int mode) override;
+	u32 DrawSync(int mode) override;
+	void DoState(PointerWrap &p) override;
+	bool BusyDrawing() override;
 
 	void SetDisplayFramebuffer(u32 framebuf, u32 stride, GEBufferFormat format) override;
 	void CopyDisplayToOutput(bool reallyDirty) override;
@@ -105,6 +113,8 @@ class SoftGPU : public GPUCommon {
 
 protected:
 	void FastRunLoop(DisplayList &list) override;
+	void FinishDeferred() override;
+	void BeginFrame() override;
 	void CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight);
 	void ConvertTextureDescFrom16(Draw::TextureDesc &desc, int srcwidth, int srcheight, u8 *overrideData = nullptr);
 
@@ -0,0 +1,112 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "Common/TimeUtil.h"
+#include "GPU/Software/StageStats.h"
+
+namespace Rasterizer {
+
+std::atomic<bool> stageStatsEnabled;
+
+struct ThreadStageStats;
+
+static std::mutex statsLock;
+// Guarded by statsLock.
+static std::vector<ThreadStageStats *> statsThreads;
+// From threads that have exited.
+static StageStats exitedStats;
+
+static void AddStats(StageStats &dest, const StageStats &src) {
+	for (int i = 0; i < (int)Stage::COUNT; ++i)
+		dest.time[i] += src.time[i];
+	dest.pixels += src.pixels;
+}
+
+// Each thread adds to its own, so scopes don't need to lock.
+struct ThreadStageStats {
+	ThreadStageStats() {
+		std::lock_guard<std::mutex> guard(statsLock);
+		statsThreads.push_back(this);
+	}
+	~ThreadStageStats() {
+		std::lock_guard<std::mutex> guard(statsLock);
+		AddStats(exitedStats, stats);
+		statsThreads.erase(std::find(statsThreads.begin(), statsThreads.end(), this));
+	}
+
+	StageStats stats;
+	StageScope *current = nullptr;
+};
+
+static thread_local ThreadStageStats threadStats;
+
+void StageScope::Begin(Stage stage) {
+	stage_ = stage;
+	active_ = true;
+	nested_ = 0.0;
+	parent_ = threadStats.current;
+	threadStats.current = this;
+	start_ = time_now_d();
+}
+
+void StageScope::End() {
+	double elapsed = time_now_d() - start_;
+	threadStats.stats.time[(int)stage_] += elapsed - nested_;
+	if (parent_)
+		parent_->nested_ += elapsed;
+	threadStats.current = parent_;
+}
+
+void AddStagePixelsInternal(int count) {
+	threadStats.stats.pixels += count;
+}
+
+void SetStageStatsEnabled(bool enabled) {
+	stageStatsEnabled = enabled;
+}
+
+void ResetStageStats() {
+	std::lock_guard<std::mutex> guard(statsLock);
+	for (ThreadStageStats *thread : statsThreads)
+		thread->stats = StageStats();
+	exitedStats = StageStats();
+}
+
+void GetStageStats(StageStats &stats) {
+	std::lock_guard<std::mutex> guard(statsLock);
+	stats = exitedStats;
+	for (const ThreadStageStats *thread : statsThreads)
+		AddStats(stats, thread->stats);
+}
+
+const char *GetStageName(Stage stage) {
+	switch (stage) {
+	case Stage::TRANSFORM: return "transform";
+	case Stage::CLIP: return "clip";
+	case Stage::RASTER: return "raster";
+	case Stage::PIXEL: return "pixel";
+	case Stage::SAMPLER: return "sampler";
+	case Stage::WAIT: return "wait";
+	default: return "unknown";
+	}
+}
+
+}  // namespace Rasterizer
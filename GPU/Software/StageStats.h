@@ -0,0 +1,88 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <atomic>
+#include "Common/CommonTypes.h"
+
+// Optional timing of each stage of the software renderer, for benchmarks.
+//
+// Stages are timed with scopes, which may nest: each stage only gets the time not spent in
+// scopes inside it.  Times are summed over all threads, so drawing on several threads can
+// add up to more than the wall time.  Timing is per quad at the finest, which slows drawing
+// down noticeably, so it's off unless enabled.
+namespace Rasterizer {
+
+enum class Stage {
+	TRANSFORM,
+	CLIP,
+	RASTER,
+	PIXEL,
+	SAMPLER,
+	// Waiting for other threads to draw.
+	WAIT,
+
+	COUNT,
+};
+
+struct StageStats {
+	// In seconds.
+	double time[(int)Stage::COUNT]{};
+	// Pixels passed to pixel funcs, before depth or alpha tests.
+	s64 pixels = 0;
+};
+
+extern std::atomic<bool> stageStatsEnabled;
+
+class StageScope {
+public:
+	StageScope(Stage stage) {
+		if (stageStatsEnabled.load(std::memory_order_relaxed))
+			Begin(stage);
+	}
+	~StageScope() {
+		if (active_)
+			End();
+	}
+
+private:
+	void Begin(Stage stage);
+	void End();
+
+	Stage stage_;
+	bool active_ = false;
+	double start_;
+	// Time spent in scopes inside this one.
+	double nested_;
+	StageScope *parent_;
+};
+
+void AddStagePixelsInternal(int count);
+inline void AddStagePixels(int count) {
+	if (stageStatsEnabled.load(std::memory_order_relaxed))
+		AddStagePixelsInternal(count);
+}
+
+// Only change these while nothing is drawing.
+void SetStageStatsEnabled(bool enabled);
+void ResetStageStats();
+void GetStageStats(StageStats &stats);
+
+const char *GetStageName(Stage stage);
+
+}  // namespace Rasterizer
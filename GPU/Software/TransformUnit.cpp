@@ -28,10 +28,12 @@
 #include "GPU/Common/VertexDecoderCommon.h"
 #include "GPU/Common/SplineCommon.h"
 #include "GPU/Debugger/Debugger.h"
+#include "GPU/Software/BinManager.h"
 #include "GPU/Software/TransformUnit.h"
 #include "GPU/Software/Clipper.h"
 #include "GPU/Software/Lighting.h"
 #include "GPU/Software/RasterizerRectangle.h"
+#include "GPU/Software/StageStats.h"
 
 #define TRANSFORM_BUF_SIZE (65536 * 48)
 
@@ -55,6 +57,7 @@ SoftwareDrawEngine::~SoftwareDrawEngine() {
 }
 
 void SoftwareDrawEngine::DispatchFlush() {
+	Rasterizer::FlushBins();
 }
 
 void SoftwareDrawEngine::DispatchSubmitPrim(void *verts, void *inds, GEPrimitiveType prim, int vertexCount, u32 vertTypeID, int cullMode, int *bytesRead) {
@@ -83,23 +86,7 @@ ClipCoords TransformUnit::ViewToClip(const ViewCoords &coords) {
 	return Vec3ByMatrix44(coords, gstate.projMatrix);
 }
 
-static inline ScreenCoords ClipToScreenInternal(const ClipCoords& coords, bool *outside_range_flag) {
-	ScreenCoords ret;
-
-	// Parameters here can seem invalid, but the PSP is fine with negative viewport widths etc.
-	// The checking that OpenGL and D3D do is actually quite superflous as the calculations still "work"
-	// with some pretty crazy inputs, which PSP games are happy to do at times.
-	float xScale = gstate.getViewportXScale();
-	float xCenter = gstate.getViewportXCenter();
-	float yScale = gstate.getViewportYScale();
-	float yCenter = gstate.getViewportYCenter();
-	float zScale = gstate.getViewportZScale();
-	float zCenter = gstate.getViewportZCenter();
-
-	float x = coords.x * xScale / coords.w + xCenter;
-	float y = coords.y * yScale / coords.w + yCenter;
-	float z = coords.z * zScale / coords.w + zCenter;
-
+static inline ScreenCoords ClipToScreenInternal(float x, float y, float z, const ClipCoords &coords, bool *outside_range_flag) {
 	// Account for rounding for X and Y.
 	// TODO: Validate actual rounding range.
 	const float SCREEN_BOUND = 4095.0f + (15.5f / 16.0f);
@@ -124,6 +111,24 @@ static inline ScreenCoords ClipToScreenInternal(const ClipCoords& coords, bool *
 	return ScreenCoords(x * 16.0f + 0.375f, y * 16.0f + 0.375f, z);
 }
 
+static inline ScreenCoords ClipToScreenInternal(const ClipCoords& coords, bool *outside_range_flag) {
+	// Parameters here can seem invalid, but the PSP is fine with negative viewport widths etc.
+	// The checking that OpenGL and D3D do is actually quite superflous as the calculations still "work"
+	// with some pretty crazy inputs, which PSP games are happy to do at times.
+	float xScale = gstate.getViewportXScale();
+	float xCenter = gstate.getViewportXCenter();
+	float yScale = gstate.getViewportYScale();
+	float yCenter = gstate.getViewportYCenter();
+	float zScale = gstate.getViewportZScale();
+	float zCenter = gstate.getViewportZCenter();
+
+	float x = coords.x * xScale / coords.w + xCenter;
+	float y = coords.y * yScale / coords.w + yCenter;
+	float z = coords.z * zScale / coords.w + zCenter;
+
+	return ClipToScreenInternal(x, y, z, coords, outside_range_flag);
+}
+
 ScreenCoords TransformUnit::ClipToScreen(const ClipCoords& coords)
 {
 	return ClipToScreenInternal(coords, nullptr);
@@ -148,10 +153,8 @@ ScreenCoords TransformUnit::DrawingToScreen(const DrawingCoords& coords)
 	return ret;
 }
 
-VertexData TransformUnit::ReadVertex(VertexReader &vreader, bool &outside_range_flag) {
-	PROFILE_THIS_SCOPE("read_vert");
-	VertexData vertex;
-
+// Reads everything but the transformed position, and returns the (skinned) model position.
+static ModelCoords ReadModelVertex(VertexReader &vreader, VertexData &vertex) {
 	ModelCoords pos;
 	// VertexDecoder normally scales z, but we want it unscaled.
 	vreader.ReadPosThroughZ16(pos.AsArray());
@@ -204,72 +207,88 @@ VertexData TransformUnit::ReadVertex(VertexReader &vreader, bool &outside_range_
 		vertex.color1 = Vec3<int>(0, 0, 0);
 	}
 
-	if (!gstate.isModeThrough()) {
-		vertex.modelpos = pos;
-		vertex.worldpos = WorldCoords(TransformUnit::ModelToWorld(vertex.modelpos));
-		ModelCoords viewpos = TransformUnit::WorldToView(vertex.worldpos);
-		vertex.clippos = ClipCoords(TransformUnit::ViewToClip(viewpos));
-		if (gstate.isFogEnabled()) {
-			float fog_end = getFloat24(gstate.fog1);
-			float fog_slope = getFloat24(gstate.fog2);
-			// Same fixup as in ShaderManagerGLES.cpp
-			if (my_isnanorinf(fog_end)) {
-				// Not really sure what a sensible value might be, but let's try 64k.
-				fog_end = std::signbit(fog_end) ? -65535.0f : 65535.0f;
-			}
-			if (my_isnanorinf(fog_slope)) {
-				fog_slope = std::signbit(fog_slope) ? -65535.0f : 65535.0f;
-			}
-			vertex.fogdepth = (viewpos.z + fog_end) * fog_slope;
-		} else {
-			vertex.fogdepth = 1.0f;
-		}
-		vertex.screenpos = ClipToScreenInternal(vertex.clippos, &outside_range_flag);
+	return pos;
+}
 
-		if (vreader.hasNormal()) {
-			vertex.worldnormal = TransformUnit::ModelToWorldNormal(vertex.normal);
-			vertex.worldnormal.NormalizeOr001();
-		} else {
-			vertex.worldnormal = Vec3<float>(0.0f, 0.0f, 1.0f);
-		}
+static inline float CalcFogDepth(float viewZ) {
+	if (!gstate.isFogEnabled())
+		return 1.0f;
 
-		// Time to generate some texture coords.  Lighting will handle shade mapping.
-		if (gstate.getUVGenMode() == GE_TEXMAP_TEXTURE_MATRIX) {
-			Vec3f source;
-			switch (gstate.getUVProjMode()) {
-			case GE_PROJMAP_POSITION:
-				source = vertex.modelpos;
-				break;
+	float fog_end = getFloat24(gstate.fog1);
+	float fog_slope = getFloat24(gstate.fog2);
+	// Same fixup as in ShaderManagerGLES.cpp
+	if (my_isnanorinf(fog_end)) {
+		// Not really sure what a sensible value might be, but let's try 64k.
+		fog_end = std::signbit(fog_end) ? -65535.0f : 65535.0f;
+	}
+	if (my_isnanorinf(fog_slope)) {
+		fog_slope = std::signbit(fog_slope) ? -65535.0f : 65535.0f;
+	}
+	return (viewZ + fog_end) * fog_slope;
+}
 
-			case GE_PROJMAP_UV:
-				source = Vec3f(vertex.texturecoords, 0.0f);
-				break;
+// Everything after the position transform: normals, texture coordinate generation, and lighting.
+static void ProcessTransformedVertex(VertexReader &vreader, VertexData &vertex) {
+	if (vreader.hasNormal()) {
+		vertex.worldnormal = TransformUnit::ModelToWorldNormal(vertex.normal);
+		vertex.worldnormal.NormalizeOr001();
+	} else {
+		vertex.worldnormal = Vec3<float>(0.0f, 0.0f, 1.0f);
+	}
 
-			case GE_PROJMAP_NORMALIZED_NORMAL:
-				source = vertex.normal.NormalizedOr001(cpu_info.bSSE4_1);
-				break;
+	// Time to generate some texture coords.  Lighting will handle shade mapping.
+	if (gstate.getUVGenMode() == GE_TEXMAP_TEXTURE_MATRIX) {
+		Vec3f source;
+		switch (gstate.getUVProjMode()) {
+		case GE_PROJMAP_POSITION:
+			source = vertex.modelpos;
+			break;
 
-			case GE_PROJMAP_NORMAL:
-				source = vertex.normal;
-				break;
+		case GE_PROJMAP_UV:
+			source = Vec3f(vertex.texturecoords, 0.0f);
+			break;
 
-			default:
-				source = Vec3f::AssignToAll(0.0f);
-				ERROR_LOG_REPORT(G3D, "Software: Unsupported UV projection mode %x", gstate.getUVProjMode());
-				break;
-			}
+		case GE_PROJMAP_NORMALIZED_NORMAL:
+			source = vertex.normal.NormalizedOr001(cpu_info.bSSE4_1);
+			break;
+
+		case GE_PROJMAP_NORMAL:
+			source = vertex.normal;
+			break;
 
-			// TODO: What about uv scale and offset?
-			Vec3<float> stq = Vec3ByMatrix43(source, gstate.tgenMatrix);
-			float z_recip = 1.0f / stq.z;
-			vertex.texturecoords = Vec2f(stq.x * z_recip, stq.y * z_recip);
-		} else if (gstate.getUVGenMode() == GE_TEXMAP_ENVIRONMENT_MAP) {
-			Lighting::GenerateLightST(vertex);
+		default:
+			source = Vec3f::AssignToAll(0.0f);
+			ERROR_LOG_REPORT(G3D, "Software: Unsupported UV projection mode %x", gstate.getUVProjMode());
+			break;
 		}
 
-		PROFILE_THIS_SCOPE("light");
-		if (gstate.isLightingEnabled())
-			Lighting::Process(vertex, vreader.hasColor0());
+		// TODO: What about uv scale and offset?
+		Vec3<float> stq = Vec3ByMatrix43(source, gstate.tgenMatrix);
+		float z_recip = 1.0f / stq.z;
+		vertex.texturecoords = Vec2f(stq.x * z_recip, stq.y * z_recip);
+	} else if (gstate.getUVGenMode() == GE_TEXMAP_ENVIRONMENT_MAP) {
+		Lighting::GenerateLightST(vertex);
+	}
+
+	PROFILE_THIS_SCOPE("light");
+	if (gstate.isLightingEnabled())
+		Lighting::Process(vertex, vreader.hasColor0());
+}
+
+VertexData TransformUnit::ReadVertex(VertexReader &vreader, bool &outside_range_flag) {
+	PROFILE_THIS_SCOPE("read_vert");
+	VertexData vertex;
+
+	ModelCoords pos = ReadModelVertex(vreader, vertex);
+	if (!gstate.isModeThrough()) {
+		vertex.modelpos = pos;
+		vertex.worldpos = WorldCoords(TransformUnit::ModelToWorld(vertex.modelpos));
+		ModelCoords viewpos = TransformUnit::WorldToView(vertex.worldpos);
+		vertex.clippos = ClipCoords(TransformUnit::ViewToClip(viewpos));
+		vertex.fogdepth = CalcFogDepth(viewpos.z);
+		vertex.screenpos = ClipToScreenInternal(vertex.clippos, &outside_range_flag);
+
+		ProcessTransformedVertex(vreader, vertex);
 	} else {
 		vertex.screenpos.x = (int)(pos[0] * 16) + gstate.getOffsetX16();
 		vertex.screenpos.y = (int)(pos[1] * 16) + gstate.getOffsetY16();
@@ -281,6 +300,149 @@ VertexData TransformUnit::ReadVertex(VertexReader &vreader, bool &outside_range_
 	return vertex;
 }
 
+bool TransformUnit::IsTriangleCulled(u8 c0, u8 c1, u8 c2) {
+	const u8 any = c0 | c1 | c2;
+	const u8 all = c0 & c1 & c2;
+	if (any & (OUTCODE_DEPTH_POS | OUTCODE_DEPTH_NEG)) {
+		// Same as the clipper: without depth clamp, one vertex outside is enough.
+		if (!gstate.isDepthClampEnabled() || (all & (OUTCODE_DEPTH_POS | OUTCODE_DEPTH_NEG)) != 0)
+			return true;
+	}
+	return (any & OUTCODE_NEAR) == 0 && (all & OUTCODE_SCISSOR) != 0;
+}
+
+#if defined(_M_SSE)
+// x, y, and z each hold one component of four vertices.
+static inline void Vec3ByMatrix43SoA(__m128 &x, __m128 &y, __m128 &z, const float m[12]) {
+	// Same order of operations as Vec3ByMatrix43(), so results match exactly.
+	__m128 outX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), x), _mm_mul_ps(_mm_set1_ps(m[3]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[6]), z), _mm_set1_ps(m[9])));
+	__m128 outY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[1]), x), _mm_mul_ps(_mm_set1_ps(m[4]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[7]), z), _mm_set1_ps(m[10])));
+	__m128 outZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2]), x), _mm_mul_ps(_mm_set1_ps(m[5]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[8]), z), _mm_set1_ps(m[11])));
+	x = outX;
+	y = outY;
+	z = outZ;
+}
+
+static inline void Vec3ByMatrix44SoA(__m128 &x, __m128 &y, __m128 &z, __m128 &w, const float m[16]) {
+	__m128 outX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), x), _mm_mul_ps(_mm_set1_ps(m[4]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[8]), z), _mm_set1_ps(m[12])));
+	__m128 outY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[1]), x), _mm_mul_ps(_mm_set1_ps(m[5]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[9]), z), _mm_set1_ps(m[13])));
+	__m128 outZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2]), x), _mm_mul_ps(_mm_set1_ps(m[6]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[10]), z), _mm_set1_ps(m[14])));
+	__m128 outW = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[3]), x), _mm_mul_ps(_mm_set1_ps(m[7]), y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[11]), z), _mm_set1_ps(m[15])));
+	x = outX;
+	y = outY;
+	z = outZ;
+	w = outW;
+}
+#endif
+
+void TransformUnit::TransformPositions(VertexData *verts, u8 *outcodes, int count) {
+	const int scissorX1 = TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX1(), gstate.getScissorY1(), 0)).x;
+	const int scissorY1 = TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX1(), gstate.getScissorY1(), 0)).y;
+	const int scissorX2 = TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX2(), gstate.getScissorY2(), 0)).x + 15;
+	const int scissorY2 = TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX2(), gstate.getScissorY2(), 0)).y + 15;
+
+	auto calcOutcode = [&](const VertexData &vertex, bool outside) {
+		u8 code = outside ? OUTCODE_RANGE : 0;
+		if (vertex.clippos.z < -vertex.clippos.w)
+			code |= OUTCODE_NEAR;
+
+		constexpr float outsideValue = 1.000030517578125f;
+		float z = vertex.clippos.z / vertex.clippos.w;
+		if (z >= outsideValue)
+			code |= OUTCODE_DEPTH_POS;
+		else if (-z >= outsideValue)
+			code |= OUTCODE_DEPTH_NEG;
+
+		if ((vertex.screenpos.x | 0xF) < scissorX1)
+			code |= OUTCODE_LEFT;
+		if ((vertex.screenpos.x & ~0xF) > scissorX2)
+			code |= OUTCODE_RIGHT;
+		if ((vertex.screenpos.y | 0xF) < scissorY1)
+			code |= OUTCODE_TOP;
+		if ((vertex.screenpos.y & ~0xF) > scissorY2)
+			code |= OUTCODE_BOTTOM;
+		return code;
+	};
+
+	int i = 0;
+#if defined(_M_SSE)
+	const __m128 xScale = _mm_set1_ps(gstate.getViewportXScale());
+	const __m128 xCenter = _mm_set1_ps(gstate.getViewportXCenter());
+	const __m128 yScale = _mm_set1_ps(gstate.getViewportYScale());
+	const __m128 yCenter = _mm_set1_ps(gstate.getViewportYCenter());
+	const __m128 zScale = _mm_set1_ps(gstate.getViewportZScale());
+	const __m128 zCenter = _mm_set1_ps(gstate.getViewportZCenter());
+
+	for (; i + 4 <= count; i += 4) {
+		VertexData *v = verts + i;
+		__m128 x = v[0].modelpos.vec;
+		__m128 y = v[1].modelpos.vec;
+		__m128 z = v[2].modelpos.vec;
+		__m128 w = v[3].modelpos.vec;
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		Vec3ByMatrix43SoA(x, y, z, gstate.worldMatrix);
+		__m128 worldX = x, worldY = y, worldZ = z, worldW = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(worldX, worldY, worldZ, worldW);
+		v[0].worldpos = WorldCoords(worldX);
+		v[1].worldpos = WorldCoords(worldY);
+		v[2].worldpos = WorldCoords(worldZ);
+		v[3].worldpos = WorldCoords(worldW);
+
+		Vec3ByMatrix43SoA(x, y, z, gstate.viewMatrix);
+		float viewZ[4];
+		_mm_storeu_ps(viewZ, z);
+
+		Vec3ByMatrix44SoA(x, y, z, w, gstate.projMatrix);
+		float screenX[4], screenY[4], screenZ[4];
+		_mm_storeu_ps(screenX, _mm_add_ps(_mm_div_ps(_mm_mul_ps(x, xScale), w), xCenter));
+		_mm_storeu_ps(screenY, _mm_add_ps(_mm_div_ps(_mm_mul_ps(y, yScale), w), yCenter));
+		_mm_storeu_ps(screenZ, _mm_add_ps(_mm_div_ps(_mm_mul_ps(z, zScale), w), zCenter));
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		v[0].clippos = ClipCoords(x);
+		v[1].clippos = ClipCoords(y);
+		v[2].clippos = ClipCoords(z);
+		v[3].clippos = ClipCoords(w);
+
+		for (int j = 0; j < 4; ++j) {
+			bool outside = false;
+			v[j].fogdepth = CalcFogDepth(viewZ[j]);
+			v[j].screenpos = ClipToScreenInternal(screenX[j], screenY[j], screenZ[j], v[j].clippos, &outside);
+			outcodes[i + j] = calcOutcode(v[j], outside);
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		VertexData &vertex = verts[i];
+		vertex.worldpos = WorldCoords(TransformUnit::ModelToWorld(vertex.modelpos));
+		ModelCoords viewpos = TransformUnit::WorldToView(vertex.worldpos);
+		vertex.clippos = ClipCoords(TransformUnit::ViewToClip(viewpos));
+		vertex.fogdepth = CalcFogDepth(viewpos.z);
+
+		bool outside = false;
+		vertex.screenpos = ClipToScreenInternal(vertex.clippos, &outside);
+		outcodes[i] = calcOutcode(vertex, outside);
+	}
+}
+
+void TransformUnit::ReadVertices(VertexReader &vreader, int count) {
+	PROFILE_THIS_SCOPE("read_verts");
+	if ((int)transformed_.size() < count) {
+		transformed_.resize(count);
+		outcodes_.resize(count);
+	}
+
+	for (int i = 0; i < count; ++i) {
+		vreader.Goto(i);
+		transformed_[i].modelpos = ReadModelVertex(vreader, transformed_[i]);
+	}
+	TransformPositions(&transformed_[0], &outcodes_[0], count);
+	for (int i = 0; i < count; ++i) {
+		ProcessTransformedVertex(vreader, transformed_[i]);
+	}
+}
+
 #define START_OPEN_U 1
 #define END_OPEN_U 2
 #define START_OPEN_V 4
@@ -305,6 +467,9 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 		return;
 	}
 
+	// Clipping and drawing have their own scopes, so this ends up being decoding and transform.
+	Rasterizer::StageScope stageScope(Rasterizer::Stage::TRANSFORM);
+
 	u16 index_lower_bound = 0;
 	u16 index_upper_bound = vertex_count - 1;
 	IndexConverter ConvertIndex(vertex_type, indices);
@@ -336,23 +501,41 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 	default: vtcs_per_prim = 0; break;
 	}
 
-	// TODO: Do this in two passes - first process the vertices (before indexing/stripping),
-	// then resolve the indices. This lets us avoid transforming shared vertices twice.
+	// For triangles, transform each vertex in the index range once up front.  That way vertices shared
+	// between triangles aren't transformed again, and their outcodes let us skip triangles early.
+	// Not worth it if most of the range isn't used, and continuing a primitive keeps reading one by one.
+	const int batch_count = index_upper_bound - index_lower_bound + 1;
+	const bool useBatch = !gstate.isModeThrough() && data_index == 0 && vertex_count >= 3 && batch_count <= vertex_count &&
+		(prim_type == GE_PRIM_TRIANGLES || prim_type == GE_PRIM_TRIANGLE_STRIP || prim_type == GE_PRIM_TRIANGLE_FAN);
+	if (useBatch)
+		ReadVertices(vreader, batch_count);
 
 	bool outside_range_flag = false;
+	// Only set for vertices from the batch, otherwise zero which never culls.
+	u8 outcodes[3]{};
+	auto readVertex = [&](int vtx, int slot) {
+		const int index = indices ? ConvertIndex(vtx) - index_lower_bound : vtx;
+		if (useBatch) {
+			data[slot] = transformed_[index];
+			outcodes[slot] = outcodes_[index];
+			if (outcodes[slot] & OUTCODE_RANGE)
+				outside_range_flag = true;
+		} else {
+			vreader.Goto(index);
+			data[slot] = ReadVertex(vreader, outside_range_flag);
+		}
+	};
+	auto processTriangle = [&](int i0, int i1, int i2, int provoking) {
+		if (!IsTriangleCulled(outcodes[i0], outcodes[i1], outcodes[i2]))
+			Clipper::ProcessTriangle(data[i0], data[i1], data[i2], data[provoking]);
+	};
 	switch (prim_type) {
 	case GE_PRIM_POINTS:
 	case GE_PRIM_LINES:
 	case GE_PRIM_TRIANGLES:
 		{
 			for (int vtx = 0; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(ConvertIndex(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
-				data[data_index++] = ReadVertex(vreader, outside_range_flag);
+				readVertex(vtx, data_index++);
 				if (data_index < vtcs_per_prim) {
 					// Keep reading.  Note: an incomplete prim will stay read for GE_PRIM_KEEP_PREVIOUS.
 					continue;
@@ -370,12 +553,12 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 				case GE_PRIM_TRIANGLES:
 				{
 					if (!gstate.isCullEnabled() || gstate.isModeClear()) {
-						Clipper::ProcessTriangle(data[0], data[1], data[2], data[2]);
-						Clipper::ProcessTriangle(data[2], data[1], data[0], data[2]);
+						processTriangle(0, 1, 2, 2);
+						processTriangle(2, 1, 0, 2);
 					} else if (!gstate.getCullMode()) {
-						Clipper::ProcessTriangle(data[2], data[1], data[0], data[2]);
+						processTriangle(2, 1, 0, 2);
 					} else {
-						Clipper::ProcessTriangle(data[0], data[1], data[2], data[2]);
+						processTriangle(0, 1, 2, 2);
 					}
 					break;
 				}
@@ -494,14 +677,8 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 
 			outside_range_flag = false;
 			for (int vtx = 0; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(ConvertIndex(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
 				int provoking_index = (data_index++) % 3;
-				data[provoking_index] = ReadVertex(vreader, outside_range_flag);
+				readVertex(vtx, provoking_index);
 				if (outside_range_flag) {
 					// Drop all primitives containing the current vertex
 					skip_count = 2;
@@ -515,14 +692,14 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 				}
 
 				if (!gstate.isCullEnabled() || gstate.isModeClear()) {
-					Clipper::ProcessTriangle(data[0], data[1], data[2], data[provoking_index]);
-					Clipper::ProcessTriangle(data[2], data[1], data[0], data[provoking_index]);
+					processTriangle(0, 1, 2, provoking_index);
+					processTriangle(2, 1, 0, provoking_index);
 				} else if ((!gstate.getCullMode()) ^ ((data_index - 1) % 2)) {
 					// We need to reverse the vertex order for each second primitive,
 					// but we additionally need to do that for every primitive if CCW cullmode is used.
-					Clipper::ProcessTriangle(data[2], data[1], data[0], data[provoking_index]);
+					processTriangle(2, 1, 0, provoking_index);
 				} else {
-					Clipper::ProcessTriangle(data[0], data[1], data[2], data[provoking_index]);
+					processTriangle(0, 1, 2, provoking_index);
 				}
 			}
 			break;
@@ -537,12 +714,7 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 
 			// Only read the central vertex if we're not continuing.
 			if (data_index == 0) {
-				if (indices) {
-					vreader.Goto(ConvertIndex(0) - index_lower_bound);
-				} else {
-					vreader.Goto(0);
-				}
-				data[0] = ReadVertex(vreader, outside_range_flag);
+				readVertex(0, 0);
 				data_index++;
 				start_vtx = 1;
 
@@ -570,14 +742,8 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 
 			outside_range_flag = false;
 			for (int vtx = start_vtx; vtx < vertex_count; ++vtx) {
-				if (indices) {
-					vreader.Goto(ConvertIndex(vtx) - index_lower_bound);
-				} else {
-					vreader.Goto(vtx);
-				}
-
 				int provoking_index = 2 - ((data_index++) % 2);
-				data[provoking_index] = ReadVertex(vreader, outside_range_flag);
+				readVertex(vtx, provoking_index);
 				if (outside_range_flag) {
 					// Drop all primitives containing the current vertex
 					skip_count = 2;
@@ -591,14 +757,14 @@ void TransformUnit::SubmitPrimitive(void* vertices, void* indices, GEPrimitiveTy
 				}
 
 				if (!gstate.isCullEnabled() || gstate.isModeClear()) {
-					Clipper::ProcessTriangle(data[0], data[1], data[2], data[provoking_index]);
-					Clipper::ProcessTriangle(data[2], data[1], data[0], data[provoking_index]);
+					processTriangle(0, 1, 2, provoking_index);
+					processTriangle(2, 1, 0, provoking_index);
 				} else if ((!gstate.getCullMode()) ^ ((data_index - 1) % 2)) {
 					// We need to reverse the vertex order for each second primitive,
 					// but we additionally need to do that for every primitive if CCW cullmode is used.
-					Clipper::ProcessTriangle(data[2], data[1], data[0], data[provoking_index]);
+					processTriangle(2, 1, 0, provoking_index);
 				} else {
-					Clipper::ProcessTriangle(data[0], data[1], data[2], data[provoking_index]);
+					processTriangle(0, 1, 2, provoking_index);
 				}
 			}
 			break;
@@ -134,7 +134,36 @@ class TransformUnit {
 	bool GetCurrentSimpleVertices(int count, std::vector<GPUDebugVertex> &vertices, std::vector<u16> &indices);
 	VertexData ReadVertex(VertexReader &vreader, bool &outside_range_flag);
 
+	enum : u8 {
+		// Outside the range the PSP draws, which drops any primitive using the vertex.
+		OUTCODE_RANGE = 0x01,
+		// Beyond the scissor, on the drawing grid DrawTriangle() snaps the bounds to.
+		OUTCODE_LEFT = 0x02,
+		OUTCODE_RIGHT = 0x04,
+		OUTCODE_TOP = 0x08,
+		OUTCODE_BOTTOM = 0x10,
+		OUTCODE_SCISSOR = OUTCODE_LEFT | OUTCODE_RIGHT | OUTCODE_TOP | OUTCODE_BOTTOM,
+		// Needs clipping, so the screen position isn't what gets drawn.
+		OUTCODE_NEAR = 0x20,
+		// Outside the depth range, as checked by the clipper.
+		OUTCODE_DEPTH_POS = 0x40,
+		OUTCODE_DEPTH_NEG = 0x80,
+	};
+
+	// Transforms the model positions of verts to screen space, four at a time where possible.
+	// Matches ReadVertex() for the positions, and sets an outcode for each vertex.
+	static void TransformPositions(VertexData *verts, u8 *outcodes, int count);
+	// Whether the clipper and rasterizer would draw nothing of this triangle, in either winding.
+	static bool IsTriangleCulled(u8 c0, u8 c1, u8 c2);
+
 	u8 *decoded_;
+
+private:
+	// Transforms the first count decoded vertices into transformed_, with outcodes for culling.
+	void ReadVertices(VertexReader &vreader, int count);
+
+	std::vector<VertexData> transformed_;
+	std::vector<u8> outcodes_;
 };
 
 class SoftwareDrawEngine : public DrawEngineCommon {
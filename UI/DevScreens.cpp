@@ -369,6 +369,10 @@ static const JitDisableFlag jitDisableFlags[] = {
 	{ MIPSComp::JitDisable::LSU_VFPU, "LSU_VFPU" },
 	{ MIPSComp::JitDisable::SIMD, "SIMD" },
 	{ MIPSComp::JitDisable::BLOCKLINK, "Block Linking" },
+	{ MIPSComp::JitDisable::IR_TRACES, "IR superblock traces" },
+	{ MIPSComp::JitDisable::IR_DISK_CACHE, "IR disk cache" },
+	{ MIPSComp::JitDisable::IR_TIERING, "IR hot block recompile" },
+	{ MIPSComp::JitDisable::IR_ASYNC_COMPILE, "IR background compile" },
 	{ MIPSComp::JitDisable::POINTERIFY, "Pointerify" },
 	{ MIPSComp::JitDisable::STATIC_ALLOC, "Static regalloc" },
 	{ MIPSComp::JitDisable::CACHE_POINTERS, "Cached pointers" },
@@ -393,6 +397,9 @@ void JitDebugScreen::CreateViews() {
 	topbar->Add(new Choice(di->T("Enable All")))->OnClick.Handle(this, &JitDebugScreen::OnEnableAll);
 
 	vert->Add(topbar);
+	// Used for the hottest blocks in the jit stats. The IR jit always counts.
+	vert->Add(new CheckBox(&g_Config.bBlockEntryCounters, dev->T("Count JIT block entries")));
+	vert->Add(new CheckBox(&g_Config.bIRHotBlockRecompile, dev->T("Recompile hot IR blocks (experimental)")));
 	vert->Add(new ItemHeader(dev->T("Disabled JIT functionality")));
 
 	for (auto flag : jitDisableFlags) {
@@ -952,6 +959,22 @@ UI::EventReturn JitCompareScreen::OnShowStats(UI::EventParams &e) {
 		}
 		ctr++;
 	}
+
+	if (!bcStats.hotBlocks.empty())
+		NOTICE_LOG(JIT, "Hottest blocks:");
+	for (const BlockCacheHotBlock &hot : bcStats.hotBlocks) {
+		NOTICE_LOG(JIT, "%08x-%08x: %u entries", hot.startAddress, hot.startAddress + hot.size, hot.entryCount);
+	}
+
+	std::vector<std::pair<std::string, BlockCacheFallbackStat>> fallbacks(bcStats.fallbacks.begin(), bcStats.fallbacks.end());
+	std::sort(fallbacks.begin(), fallbacks.end(), [](const auto &a, const auto &b) {
+		return a.second.executions > b.second.executions;
+	});
+	if (!fallbacks.empty())
+		NOTICE_LOG(JIT, "Interpreter fallbacks:");
+	for (const auto &fallback : fallbacks) {
+		NOTICE_LOG(JIT, "%s: %d sites, %llu block entries", fallback.first.c_str(), fallback.second.sites, (unsigned long long)fallback.second.executions);
+	}
 	return UI::EVENT_DONE;
 }
 
@@ -55,6 +55,7 @@ using namespace std::placeholders;
 #include "Core/KeyMap.h"
 #include "Core/MemFault.h"
 #include "Core/Reporting.h"
+#include "Core/RunAhead.h"
 #include "Core/System.h"
 #include "GPU/GPUState.h"
 #include "GPU/GPUInterface.h"
@@ -1123,6 +1124,7 @@ static const char *CPUCoreAsString(int core) {
 	case 0: return "Interpreter";
 	case 1: return "JIT";
 	case 2: return "IR Interpreter";
+	case 3: return "IR JIT";
 	default: return "N/A";
 	}
 }
@@ -1265,6 +1267,20 @@ static void DrawFPS(UIContext *ctx, const Bounds &bounds) {
 	ctx->RebindTexture();
 }
 
+static void DrawSavePending(UIContext *ctx, const Bounds &bounds) {
+	FontID ubuntu24("UBUNTU24");
+	auto sc = GetI18NCategory("Screen");
+
+	ctx->Flush();
+	ctx->BindFontTexture();
+	ctx->Draw()->SetFontScale(0.7f, 0.7f);
+	ctx->Draw()->DrawText(ubuntu24, sc->T("Saving state..."), bounds.x2() - 8, bounds.y2() - 8, 0xc0000000, ALIGN_BOTTOMRIGHT);
+	ctx->Draw()->DrawText(ubuntu24, sc->T("Saving state..."), bounds.x2() - 10, bounds.y2() - 10, 0xFFFFFFFF, ALIGN_BOTTOMRIGHT);
+	ctx->Draw()->SetFontScale(1.0f, 1.0f);
+	ctx->Flush();
+	ctx->RebindTexture();
+}
+
 static void DrawFrameTimes(UIContext *ctx, const Bounds &bounds) {
 	FontID ubuntu24("UBUNTU24");
 	int valid, pos;
@@ -1375,7 +1391,8 @@ void EmuScreen::render() {
 
 	PSP_BeginHostFrame();
 
-	PSP_RunLoopWhileState();
+	// Same as PSP_RunLoopWhileState() unless run-ahead is enabled.
+	RunAhead::RunFrame();
 
 	// Hopefully coreState is now CORE_NEXTFRAME
 	switch (coreState) {
@@ -1489,6 +1506,10 @@ void EmuScreen::renderUI() {
 		DrawFrameTimes(ctx, ctx->GetLayoutBounds());
 	}
 
+	if (SaveState::HasPendingSave() && !invalid_) {
+		DrawSavePending(ctx, ctx->GetLayoutBounds());
+	}
+
 #if !PPSSPP_PLATFORM(UWP)
 	if (g_Config.iGPUBackend == (int)GPUBackend::VULKAN && g_Config.bShowAllocatorDebug) {
 		DrawAllocatorVis(ctx, gpu);
@@ -0,0 +1,191 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "headless/Benchmark.h"
+#include "Common/Data/Format/JSONWriter.h"
+#include "Common/File/FileUtil.h"
+#include "Common/MemArena.h"
+#include "Common/TimeUtil.h"
+#include "GPU/Debugger/Playback.h"
+#include "GPU/Software/StageStats.h"
+
+struct DumpBenchmarkResult {
+	std::string filename;
+	// In seconds, for each timed run.
+	std::vector<double> frameTimes;
+	double instrumentedTime = 0.0;
+	Rasterizer::StageStats stages;
+	bool complete = false;
+};
+
+static std::vector<DumpBenchmarkResult> results;
+static DumpBenchmarkResult current;
+static int benchRuns = 0;
+static int runsDone = 0;
+static double runStart = 0.0;
+
+// Run 0 loads the dump and compiles everything, 1 to benchRuns are timed, and the last one
+// is only for stage stats, which slow drawing down.
+static bool ReplayDone() {
+	double now = time_now_d();
+	int run = runsDone++;
+	if (run >= 1 && run <= benchRuns)
+		current.frameTimes.push_back(now - runStart);
+
+	if (run == benchRuns + 1) {
+		current.instrumentedTime = now - runStart;
+		Rasterizer::GetStageStats(current.stages);
+		Rasterizer::SetStageStatsEnabled(false);
+		current.complete = true;
+		return false;
+	}
+
+	if (run == benchRuns) {
+		Rasterizer::ResetStageStats();
+		Rasterizer::SetStageStatsEnabled(true);
+	}
+	runStart = time_now_d();
+	return true;
+}
+
+void BeginDumpBenchmark(int runs) {
+	current = DumpBenchmarkResult();
+	benchRuns = runs;
+	runsDone = 0;
+	GPURecord::SetReplayRepeatCallback(&ReplayDone);
+}
+
+void EndDumpBenchmark(const Path &filename) {
+	GPURecord::SetReplayRepeatCallback(nullptr);
+	// In case the replay failed partway.
+	Rasterizer::SetStageStatsEnabled(false);
+
+	current.filename = filename.ToString();
+	results.push_back(current);
+	current = DumpBenchmarkResult();
+}
+
+static void WriteResult(json::JsonWriter &writer, const DumpBenchmarkResult &result) {
+	writer.pushDict();
+	writer.writeString("file", result.filename);
+	if (!result.complete || result.frameTimes.empty()) {
+		writer.writeString("error", "Not a GE dump, or the replay failed");
+		writer.pop();
+		return;
+	}
+
+	std::vector<double> sorted = result.frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0.0;
+	for (double t : sorted)
+		total += t;
+	const size_t count = sorted.size();
+	const double median = count & 1 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) * 0.5;
+
+	writer.writeInt("runs", (int)count);
+	writer.pushDict("frame_ms");
+	writer.writeFloat("min", sorted.front() * 1000.0);
+	writer.writeFloat("median", median * 1000.0);
+	writer.writeFloat("mean", total / count * 1000.0);
+	writer.writeFloat("max", sorted.back() * 1000.0);
+	writer.pushArray("runs");
+	for (double t : result.frameTimes)
+		writer.writeFloat(t * 1000.0);
+	writer.pop();
+	writer.pop();
+
+	// Pixels don't depend on timing, so the instrumented run's count applies to all of them.
+	writer.writeFloat("pixels_per_frame", (double)result.stages.pixels);
+	writer.writeFloat("pixels_per_second", median > 0.0 ? result.stages.pixels / median : 0.0);
+
+	// Summed over all threads, so these can add up to more than the instrumented frame time.
+	writer.pushDict("stages_ms");
+	writer.writeFloat("instrumented_frame", result.instrumentedTime * 1000.0);
+	for (int i = 0; i < (int)Rasterizer::Stage::COUNT; ++i)
+		writer.writeFloat(Rasterizer::GetStageName((Rasterizer::Stage)i), result.stages.time[i] * 1000.0);
+	writer.pop();
+
+	writer.pop();
+}
+
+bool WriteDumpBenchmarks(const Path &filename) {
+	json::JsonWriter writer(json::JsonWriter::PRETTY);
+	writer.beginArray();
+	for (const DumpBenchmarkResult &result : results)
+		WriteResult(writer, result);
+	writer.end();
+	results.clear();
+
+	if (filename.empty()) {
+		printf("%s\n", writer.str().c_str());
+		return true;
+	}
+
+	std::string json = writer.str() + "\n";
+	if (!File::WriteStringToFile(true, json, filename)) {
+		fprintf(stderr, "Failed to write benchmark results to %s\n", filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+static void BenchmarkMemArenaPages(bool hugePages) {
+	const size_t SIZE = 0x02000000;
+	const int ACCESSES = 16 * 1024 * 1024;
+
+	MemArena arena;
+	bool usingHugePages = arena.SetHugePages(hugePages);
+	u8 *view = nullptr, *mirror = nullptr;
+	if (arena.GrabMemSpace(arena.roundup(SIZE))) {
+		view = (u8 *)arena.CreateView(0, SIZE);
+		mirror = (u8 *)arena.CreateView(0, SIZE);
+	}
+	if (!view || !mirror) {
+		fprintf(stderr, "MemArena: failed to map %s pages\n", hugePages ? "huge" : "normal");
+		return;
+	}
+
+	// Fault everything in first, that's not what's measured.
+	memset(view, 0, SIZE);
+
+	u32 seed = 0x12345678;
+	u32 sum = 0;
+	double st = time_now_d();
+	for (int i = 0; i < ACCESSES; ++i) {
+		seed = seed * 1103515245 + 12345;
+		u32 offset = (seed >> 4) & (SIZE - 4);
+		sum += *(u32 *)(view + offset);
+		*(u32 *)(mirror + (offset ^ 0x00100000)) = sum;
+	}
+	double elapsed = time_now_d() - st;
+	printf("MemArena: %s pages, %d random accesses in %0.2f ms (sum %08x)\n", usingHugePages ? "huge" : "normal", ACCESSES, elapsed * 1000.0, sum);
+
+	arena.ReleaseView(mirror, SIZE);
+	arena.ReleaseView(view, SIZE);
+	arena.ReleaseSpace();
+}
+
+void BenchmarkMemArena() {
+	BenchmarkMemArenaPages(false);
+	BenchmarkMemArenaPages(true);
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "Common/File/Path.h"
+
+// With --gebench=N, each GE dump (.ppdmp) is replayed once to warm up, N times timed, and
+// once more with the software renderer's stage timing on.  The results for all dumps are
+// written as JSON at the end, to a file with --gebench-out= since stdout also gets test output.
+
+// Call before running each dump.
+void BeginDumpBenchmark(int runs);
+// Call after each dump has run, even if it failed.
+void EndDumpBenchmark(const Path &filename);
+// Writes to stdout if filename is empty.
+bool WriteDumpBenchmarks(const Path &filename);
+
+// With --bench, times random access across a RAM sized arena with normal and huge pages.
+// That's where TLB misses hurt, and what --hugepages is for.
+void BenchmarkMemArena();
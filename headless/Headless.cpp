@@ -3,6 +3,7 @@
 // To build on non-windows systems, just run CMake in the SDL directory, it will build both a normal ppsspp and the headless version.
 
 #include "ppsspp_config.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <limits>
@@ -34,6 +35,7 @@
 #include "Log.h"
 #include "LogManager.h"
 
+#include "Benchmark.h"
 #include "Compare.h"
 #include "StubHost.h"
 #if defined(_WIN32)
@@ -130,8 +132,17 @@ int printUsage(const char *progname, const char *reason)
 	fprintf(stderr, "  -v, --verbose         show the full passed/failed result\n");
 	fprintf(stderr, "  -i                    use the interpreter\n");
 	fprintf(stderr, "  --ir                  use ir interpreter\n");
+	fprintf(stderr, "  --irjit               use ir with the native jit backend\n");
 	fprintf(stderr, "  -j                    use jit (default)\n");
 	fprintf(stderr, "  -c, --compare         compare with output in file.expected\n");
+	fprintf(stderr, "  --bench               print how long each test took to run, and time memory access\n");
+	fprintf(stderr, "  --gebench=N           replay .ppdmp GE dumps N times with the software renderer,\n");
+	fprintf(stderr, "                        and print frame and stage timings as JSON\n");
+	fprintf(stderr, "  --gebench-out=FILE    write the --gebench JSON to FILE instead of stdout\n");
+	fprintf(stderr, "  --hugepages           back PSP memory with huge pages, if possible\n");
+	fprintf(stderr, "  --branches=N          after the test, run it N more times from a snapshot\n");
+	fprintf(stderr, "  --branch-frame=N      take that snapshot after N frames (default 1)\n");
+	fprintf(stderr, "  --state-stats         print each savestate section's size and time at that frame\n");
 	fprintf(stderr, "\nSee headless.txt for details.\n");
 
 	return 1;
@@ -151,6 +162,28 @@ static HeadlessHost *getHost(GPUCore gpuCore) {
 	}
 }
 
+// With --branches, the test runs again from a snapshot taken after branchFrame frames.
+static int branchFrame = 1;
+static int numBranches = 0;
+// With --state-stats, a savestate's sections are measured at branchFrame too.
+static bool stateStats = false;
+
+static void PrintStateStats(int frame) {
+	std::vector<u8> state;
+	std::vector<PointerWrapSectionStat> stats;
+	double st = time_now_d();
+	if (SaveState::SaveToRam(state, &stats) != CChunkFileReader::ERROR_NONE) {
+		fprintf(stderr, "Failed to save state for stats at frame %d\n", frame);
+		return;
+	}
+	fprintf(stderr, "Savestate at frame %d: %d bytes in %0.2f ms\n", frame, (int)state.size(), (time_now_d() - st) * 1000.0);
+	for (const PointerWrapSectionStat &stat : stats) {
+		// Deeper ones are mostly kernel objects, there are lots of them.
+		if (stat.depth <= 1)
+			fprintf(stderr, "  %*s%s: %d bytes in %0.3f ms\n", stat.depth * 2, "", stat.title, (int)stat.bytes, stat.seconds * 1000.0);
+	}
+}
+
 bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool autoCompare, bool verbose, double timeout)
 {
 	// Kinda ugly, trying to guesstimate the test name from filename...
@@ -188,30 +221,76 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool
 	if (coreParameter.graphicsContext && coreParameter.graphicsContext->GetDrawContext())
 		coreParameter.graphicsContext->GetDrawContext()->BeginFrame();
 
-	coreState = coreParameter.startBreak ? CORE_STEPPING : CORE_RUNNING;
-	while (coreState == CORE_RUNNING || coreState == CORE_STEPPING)
-	{
-		int blockTicks = usToCycles(1000000 / 10);
-		PSP_RunLoopFor(blockTicks);
+	// When branching, the rest of the test is run again from a snapshot, without booting again.
+	int snapshot = -1;
+	size_t snapshotOutputSize = 0;
+	int frames = 0;
+	int branch = 0;
 
-		// If we were rendering, this might be a nice time to do something about it.
-		if (coreState == CORE_NEXTFRAME) {
-			coreState = CORE_RUNNING;
-			headlessHost->SwapBuffers();
+	coreState = coreParameter.startBreak ? CORE_STEPPING : CORE_RUNNING;
+	while (true) {
+		while (coreState == CORE_RUNNING || coreState == CORE_STEPPING)
+		{
+			int blockTicks = usToCycles(1000000 / 10);
+			PSP_RunLoopFor(blockTicks);
+
+			// If we were rendering, this might be a nice time to do something about it.
+			if (coreState == CORE_NEXTFRAME) {
+				coreState = CORE_RUNNING;
+				headlessHost->SwapBuffers();
+				++frames;
+				if (stateStats && frames == branchFrame)
+					PrintStateStats(frames);
+				if (numBranches > 0 && snapshot == -1 && frames == branchFrame) {
+					double st = time_now_d();
+					snapshot = SaveState::TakeSnapshot();
+					snapshotOutputSize = output.size();
+					if (snapshot == -1)
+						fprintf(stderr, "Failed to take a snapshot at frame %d\n", frames);
+					else
+						fprintf(stderr, "Snapshot at frame %d took %0.2f ms\n", frames, (time_now_d() - st) * 1000.0);
+				}
+			}
+			if (coreState == CORE_STEPPING && !coreParameter.startBreak) {
+				break;
+			}
+			if (time_now_d() > deadline) {
+				// Don't compare, print the output at least up to this point, and bail.
+				printf("%s", output.c_str());
+				passed = false;
+
+				host->SendDebugOutput("TIMEOUT\n");
+				TeamCityPrint("testFailed name='%s' message='Test timeout'", currentTestName.c_str());
+				GitHubActionsPrint("error", "Test timeout for %s", currentTestName.c_str());
+				Core_Stop();
+			}
 		}
-		if (coreState == CORE_STEPPING && !coreParameter.startBreak) {
+
+		if (!passed || snapshot == -1 || branch >= numBranches)
 			break;
-		}
-		if (time_now_d() > deadline) {
-			// Don't compare, print the output at least up to this point, and bail.
-			printf("%s", output.c_str());
+
+		// Each branch has to match on its own.
+		headlessHost->FlushDebugOutput();
+		if (autoCompare && !CompareOutput(coreParameter.fileToStart, output, verbose)) {
 			passed = false;
+			break;
+		}
 
-			host->SendDebugOutput("TIMEOUT\n");
-			TeamCityPrint("testFailed name='%s' message='Test timeout'", currentTestName.c_str());
-			GitHubActionsPrint("error", "Test timeout for %s", currentTestName.c_str());
-			Core_Stop();
+		double st = time_now_d();
+		std::string errorString;
+		if (SaveState::RestoreSnapshot(snapshot, &errorString) != CChunkFileReader::ERROR_NONE) {
+			fprintf(stderr, "Failed to restore snapshot: %s\n", errorString.c_str());
+			printf("TESTERROR\n");
+			passed = false;
+			break;
 		}
+		++branch;
+		fprintf(stderr, "Branch %d: restored snapshot in %0.2f ms\n", branch, (time_now_d() - st) * 1000.0);
+
+		output.resize(snapshotOutputSize);
+		deadline = time_now_d() + timeout;
+		Core_ResetException();
+		coreState = CORE_RUNNING;
 	}
 	PSP_EndHostFrame();
 
@@ -241,6 +320,10 @@ int main(int argc, const char* argv[])
 	bool fullLog = false;
 	bool autoCompare = false;
 	bool verbose = false;
+	bool bench = false;
+	int geBenchRuns = 0;
+	const char *geBenchOut = nullptr;
+	bool hugePages = false;
 	const char *stateToLoad = 0;
 	GPUCore gpuCore = GPUCORE_SOFTWARE;
 	CPUCore cpuCore = CPUCore::JIT;
@@ -274,10 +357,20 @@ int main(int argc, const char* argv[])
 			cpuCore = CPUCore::JIT;
 		else if (!strcmp(argv[i], "--ir"))
 			cpuCore = CPUCore::IR_JIT;
+		else if (!strcmp(argv[i], "--irjit"))
+			cpuCore = CPUCore::JIT_IR;
 		else if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--compare"))
 			autoCompare = true;
 		else if (!strcmp(argv[i], "-v") || !strcmp(argv[i], "--verbose"))
 			verbose = true;
+		else if (!strcmp(argv[i], "--bench"))
+			bench = true;
+		else if (!strncmp(argv[i], "--gebench=", strlen("--gebench=")) && strlen(argv[i]) > strlen("--gebench="))
+			geBenchRuns = std::max(1, (int)strtoul(argv[i] + strlen("--gebench="), NULL, 10));
+		else if (!strncmp(argv[i], "--gebench-out=", strlen("--gebench-out=")) && strlen(argv[i]) > strlen("--gebench-out="))
+			geBenchOut = argv[i] + strlen("--gebench-out=");
+		else if (!strcmp(argv[i], "--hugepages"))
+			hugePages = true;
 		else if (!strncmp(argv[i], "--graphics=", strlen("--graphics=")) && strlen(argv[i]) > strlen("--graphics="))
 		{
 			const char *gpuName = argv[i] + strlen("--graphics=");
@@ -310,6 +403,12 @@ int main(int argc, const char* argv[])
 			debuggerPort = (int)strtoul(argv[i] + strlen("--debugger="), NULL, 10);
 		else if (!strcmp(argv[i], "--teamcity"))
 			teamCityMode = true;
+		else if (!strncmp(argv[i], "--branches=", strlen("--branches=")) && strlen(argv[i]) > strlen("--branches="))
+			numBranches = (int)strtoul(argv[i] + strlen("--branches="), NULL, 10);
+		else if (!strncmp(argv[i], "--branch-frame=", strlen("--branch-frame=")) && strlen(argv[i]) > strlen("--branch-frame="))
+			branchFrame = std::max(1, (int)strtoul(argv[i] + strlen("--branch-frame="), NULL, 10));
+		else if (!strcmp(argv[i], "--state-stats"))
+			stateStats = true;
 		else if (!strncmp(argv[i], "--state=", strlen("--state=")) && strlen(argv[i]) > strlen("--state="))
 			stateToLoad = argv[i] + strlen("--state=");
 		else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
@@ -331,6 +430,9 @@ int main(int argc, const char* argv[])
 
 	if (testFilenames.empty())
 		return printUsage(argv[0], argc <= 1 ? NULL : "No executables specified");
+	// Only the software renderer has stage timing.
+	if (geBenchRuns > 0)
+		gpuCore = GPUCORE_SOFTWARE;
 
 	LogManager::Init(&g_Config.bEnableLogging);
 	LogManager *logman = LogManager::GetInstance();
@@ -396,6 +498,9 @@ int main(int argc, const char* argv[])
 	g_Config.bSoftwareSkinning = true;
 	g_Config.bVertexDecoderJit = true;
 	g_Config.bSoftwareRenderingJit = true;
+	g_Config.bSoftwareRenderingThread = false;
+	// Otherwise timed runs might still be drawing without the jit.
+	g_Config.bSoftwareRenderingAsyncJit = false;
 	g_Config.bBlockTransferGPU = true;
 	g_Config.iSplineBezierQuality = 2;
 	g_Config.bHighQualityDepth = true;
@@ -407,6 +512,7 @@ int main(int argc, const char* argv[])
 	g_Config.iFirmwareVersion = PSP_DEFAULT_FIRMWARE;
 	g_Config.iPSPModel = PSP_MODEL_SLIM;
 	g_Config.iGlobalVolume = VOLUME_FULL;
+	g_Config.bHugePageMemory = hugePages;
 	g_Config.iReverbVolume = VOLUME_FULL;
 
 #ifdef _WIN32
@@ -453,6 +559,9 @@ int main(int argc, const char* argv[])
 	if (stateToLoad != NULL)
 		SaveState::Load(Path(stateToLoad), -1);
 
+	if (bench)
+		BenchmarkMemArena();
+
 	std::vector<std::string> failedTests;
 	std::vector<std::string> passedTests;
 	for (size_t i = 0; i < testFilenames.size(); ++i)
@@ -460,7 +569,14 @@ int main(int argc, const char* argv[])
 		coreParameter.fileToStart = Path(testFilenames[i]);
 		if (autoCompare)
 			printf("%s:\n", coreParameter.fileToStart.c_str());
+		double startTime = time_now_d();
+		if (geBenchRuns > 0)
+			BeginDumpBenchmark(geBenchRuns);
 		bool passed = RunAutoTest(headlessHost, coreParameter, autoCompare, verbose, timeout);
+		if (geBenchRuns > 0)
+			EndDumpBenchmark(coreParameter.fileToStart);
+		if (bench)
+			printf("%s: %0.3f seconds\n", coreParameter.fileToStart.c_str(), time_now_d() - startTime);
 		if (autoCompare)
 		{
 			std::string testName = GetTestName(coreParameter.fileToStart);
@@ -486,6 +602,9 @@ int main(int argc, const char* argv[])
 		}
 	}
 
+	if (geBenchRuns > 0)
+		WriteDumpBenchmarks(geBenchOut ? Path(std::string(geBenchOut)) : Path());
+
 	if (debuggerPort > 0) {
 		ShutdownWebServer();
 	}
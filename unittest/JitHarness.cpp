@@ -16,21 +16,35 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include "ppsspp_config.h"
 
+#include "Common/StringUtils.h"
 #include "Common/System/NativeApp.h"
 #include "Common/System/System.h"
 #include "Common/TimeUtil.h"
+#include "Core/Config.h"
 #include "Core/ConfigValues.h"
+#include "Core/Debugger/Breakpoints.h"
 #include "Core/Debugger/SymbolMap.h"
+#include "Core/Host.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "Core/MIPS/IR/IRFrontend.h"
+#include "Core/MIPS/IR/IRInterpreter.h"
+#include "Core/MIPS/IR/IRJit.h"
+#include "Core/MIPS/IR/IRPassSimplify.h"
 #include "Core/MIPS/MIPSCodeUtils.h"
 #include "Core/MIPS/MIPSDebugInterface.h"
 #include "Core/MIPS/MIPSAsm.h"
 #include "Core/MIPS/MIPSTables.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
+#if PPSSPP_ARCH(AMD64)
+#include "Core/MIPS/x86/IRToX86.h"
+#endif
 #include "Core/MemMap.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
@@ -203,3 +217,885 @@ bool TestJit() {
 
 	return jit_speed >= interp_speed;
 }
+
+// Breakpoints and break ops pause through the host.
+class JitHarnessHost : public Host {
+public:
+	bool InitGraphics(std::string *error_string, GraphicsContext **ctx) override { return false; }
+	void ShutdownGraphics() override {}
+	void InitSound() override {}
+	void ShutdownSound() override {}
+};
+
+// Memory that IR test blocks load from and store to.
+static const u32 IR_TEST_MEM = 0x08900000;
+static const u32 IR_TEST_MEM_SIZE = 256;
+
+// Everything a block can change, for comparing the ways of running it.  IR temps are left out,
+// since they don't need to survive past the end of the block.
+struct IRTestState {
+	u32 r[32];
+	u32 f[32];
+	u32 v[128];
+	u32 vfpuCtrl[16];
+	u32 pc;
+	u32 lo;
+	u32 hi;
+	u32 fpcond;
+	int downcount;
+	CoreState coreState;
+	u8 mem[IR_TEST_MEM_SIZE];
+};
+
+static void SaveIRTestState(IRTestState &state) {
+	memcpy(state.r, currentMIPS->r, sizeof(state.r));
+	memcpy(state.f, currentMIPS->fi, sizeof(state.f));
+	memcpy(state.v, currentMIPS->vi, sizeof(state.v));
+	memcpy(state.vfpuCtrl, currentMIPS->vfpuCtrl, sizeof(state.vfpuCtrl));
+	state.pc = currentMIPS->pc;
+	state.lo = currentMIPS->lo;
+	state.hi = currentMIPS->hi;
+	state.fpcond = currentMIPS->fpcond;
+	state.downcount = currentMIPS->downcount;
+	state.coreState = coreState;
+	memcpy(state.mem, Memory::GetPointer(IR_TEST_MEM), IR_TEST_MEM_SIZE);
+}
+
+static void LoadIRTestState(const IRTestState &state) {
+	memcpy(currentMIPS->r, state.r, sizeof(state.r));
+	memcpy(currentMIPS->fi, state.f, sizeof(state.f));
+	memcpy(currentMIPS->vi, state.v, sizeof(state.v));
+	memcpy(currentMIPS->vfpuCtrl, state.vfpuCtrl, sizeof(state.vfpuCtrl));
+	currentMIPS->pc = state.pc;
+	currentMIPS->lo = state.lo;
+	currentMIPS->hi = state.hi;
+	currentMIPS->fpcond = state.fpcond;
+	currentMIPS->downcount = state.downcount;
+	coreState = state.coreState;
+	memcpy(Memory::GetPointer(IR_TEST_MEM), state.mem, IR_TEST_MEM_SIZE);
+}
+
+static bool CompareIRTestState(const char *test, const char *how, const IRTestState &expected, const IRTestState &actual) {
+	const char *diff = nullptr;
+	if (memcmp(expected.r, actual.r, sizeof(expected.r)) != 0)
+		diff = "GPRs";
+	else if (memcmp(expected.f, actual.f, sizeof(expected.f)) != 0)
+		diff = "FPRs";
+	else if (memcmp(expected.v, actual.v, sizeof(expected.v)) != 0)
+		diff = "VFPU registers";
+	else if (memcmp(expected.vfpuCtrl, actual.vfpuCtrl, sizeof(expected.vfpuCtrl)) != 0)
+		diff = "VFPU control registers";
+	else if (expected.pc != actual.pc)
+		diff = "exit PC";
+	else if (expected.lo != actual.lo || expected.hi != actual.hi)
+		diff = "lo/hi";
+	else if (expected.fpcond != actual.fpcond)
+		diff = "fpcond";
+	else if (expected.downcount != actual.downcount)
+		diff = "downcount";
+	else if (expected.coreState != actual.coreState)
+		diff = "core state";
+	else if (memcmp(expected.mem, actual.mem, sizeof(expected.mem)) != 0)
+		diff = "memory";
+
+	if (diff)
+		printf("ERROR: %s: %s gave different %s than IRInterpret.\n", test, how, diff);
+	return diff == nullptr;
+}
+
+static void SeedIRTestState(IRTestState &state) {
+	SaveIRTestState(state);
+	for (int i = 1; i < 32; ++i)
+		state.r[i] = 0x00010203 * i + 7;
+	for (int i = 0; i < 32; ++i) {
+		float value = 1.0f + i * 0.5f;
+		memcpy(&state.f[i], &value, sizeof(value));
+	}
+	for (int i = 0; i < 128; ++i) {
+		float value = -2.0f + i * 0.375f;
+		memcpy(&state.v[i], &value, sizeof(value));
+	}
+	for (u32 i = 0; i < IR_TEST_MEM_SIZE / 4; ++i) {
+		float value = 0.5f + i * 0.75f;
+		memcpy(&state.mem[i * 4], &value, sizeof(value));
+	}
+	state.pc = 0x08804000;
+	state.lo = 0x11111111;
+	state.hi = 0x22222222;
+	state.fpcond = 0;
+	state.downcount = 100;
+	state.coreState = CORE_RUNNING;
+}
+
+static IRInst MakeIRInst(IROp op, u8 dest, u8 src1 = 0, u8 src2 = 0, u32 constant = 0) {
+	IRInst inst;
+	inst.op = op;
+	inst.dest = dest;
+	inst.src1 = src1;
+	inst.src2 = src2;
+	inst.constant = constant;
+	return inst;
+}
+
+struct IRRunMethod {
+	const char *name;
+	// Returns the exit PC.
+	std::function<u32(const std::vector<IRInst> &)> run;
+};
+
+// Runs the IR from the same state with IRInterpret and each other method, and checks they agree.
+static bool CompareIRRuns(const char *test, const std::vector<IRInst> &instructions, const IRTestState &initial, const std::vector<IRRunMethod> &methods) {
+	LoadIRTestState(initial);
+	currentMIPS->pc = IRInterpret(currentMIPS, &instructions[0], (int)instructions.size());
+	IRTestState expected;
+	SaveIRTestState(expected);
+
+	bool match = true;
+	for (const IRRunMethod &method : methods) {
+		LoadIRTestState(initial);
+		currentMIPS->pc = method.run(instructions);
+		IRTestState actual;
+		SaveIRTestState(actual);
+		match = CompareIRTestState(test, method.name, expected, actual) && match;
+	}
+	return match;
+}
+
+// Hand written IR for what the dispatch block doesn't cover: Vec4 ops and the ways to exit.
+// FPR numbers index mips->f, so 32 and up are VFPU registers.
+static bool TestIRCases(const std::vector<IRRunMethod> &methods) {
+	IRTestState initial;
+	SeedIRTestState(initial);
+	bool match = true;
+
+	std::vector<IRInst> vec4 = {
+		MakeIRInst(IROp::SetConst, 1, 0, 0, IR_TEST_MEM),
+		MakeIRInst(IROp::LoadVec4, 32, 1, 0, 0),
+		MakeIRInst(IROp::LoadVec4, 36, 1, 0, 16),
+		MakeIRInst(IROp::Vec4Add, 40, 32, 36),
+		MakeIRInst(IROp::Vec4Sub, 44, 40, 36),
+		MakeIRInst(IROp::Vec4Mul, 48, 44, 32),
+		MakeIRInst(IROp::Vec4Div, 52, 48, 36),
+		MakeIRInst(IROp::Vec4Scale, 56, 52, 33),
+		MakeIRInst(IROp::Vec4Neg, 60, 56),
+		MakeIRInst(IROp::Vec4Abs, 64, 60),
+		MakeIRInst(IROp::Vec4Init, 68, (u8)Vec4Init::Set_0010),
+		MakeIRInst(IROp::Vec4Init, 72, (u8)Vec4Init::AllMinusONE),
+		MakeIRInst(IROp::Vec4Mov, 76, 64),
+		MakeIRInst(IROp::Vec4Add, 32, 32, 32),
+		MakeIRInst(IROp::Vec4Dot, 80, 36, 40),
+		MakeIRInst(IROp::Vec4Shuffle, 84, 36, 0x1B),
+		MakeIRInst(IROp::StoreVec4, 76, 1, 0, 32),
+		MakeIRInst(IROp::StoreVec4, 68, 1, 0, 48),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x08804100),
+	};
+	match = CompareIRRuns("Vec4", vec4, initial, methods) && match;
+
+	std::vector<IRInst> fpu = {
+		MakeIRInst(IROp::FAdd, 0, 1, 2),
+		MakeIRInst(IROp::FSub, 3, 0, 5),
+		MakeIRInst(IROp::FDiv, 4, 3, 1),
+		MakeIRInst(IROp::FAbs, 6, 3),
+		MakeIRInst(IROp::FSqrt, 7, 6),
+		MakeIRInst(IROp::FNeg, 8, 7),
+		MakeIRInst(IROp::FMov, 9, 8),
+		MakeIRInst(IROp::FMovToGPR, 10, 9),
+		MakeIRInst(IROp::FMovFromGPR, 11, 2),
+		MakeIRInst(IROp::Mult, 0, 10, 3),
+		MakeIRInst(IROp::Madd, 0, 4, 5),
+		MakeIRInst(IROp::MfHi, 12),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x08804200),
+	};
+	match = CompareIRRuns("FPU", fpu, initial, methods) && match;
+
+	// The not taken exit has to leave the registers mapped, and the taken one has to store them.
+	std::vector<IRInst> downcount = {
+		MakeIRInst(IROp::AddConst, 2, 2, 0, 1),
+		MakeIRInst(IROp::Downcount, 0, 0, 0, 200),
+		MakeIRInst(IROp::ExitToConstIfNeq, 0, 3, 3, 0x08804300),
+		MakeIRInst(IROp::AddConst, 3, 2, 0, 5),
+		MakeIRInst(IROp::ExitToConstIfGeZ, 0, 0, 0, 0x08804304),
+		MakeIRInst(IROp::SetConst, 2, 0, 0, 0xDEADBEEF),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x08804308),
+	};
+	match = CompareIRRuns("Downcount and conditional exits", downcount, initial, methods) && match;
+
+	std::vector<IRInst> syscall = {
+		MakeIRInst(IROp::SetConst, 4, 0, 0, 0x1234),
+		MakeIRInst(IROp::SetPCConst, 0, 0, 0, 0x08804400),
+		MakeIRInst(IROp::Downcount, 0, 0, 0, 10),
+		MakeIRInst(IROp::Syscall, 0, 0, 0, MIPS_MAKE_SYSCALL("UnitTestFakeSyscalls", "UnitTestTerminator")),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x08804404),
+	};
+	match = CompareIRRuns("Syscall", syscall, initial, methods) && match;
+
+	JitHarnessHost harnessHost;
+	host = &harnessHost;
+
+	const u32 breakpointAddr = 0x08804500;
+	std::vector<IRInst> breakpoint = {
+		MakeIRInst(IROp::SetConst, 5, 0, 0, 1),
+		MakeIRInst(IROp::SetPCConst, 0, 0, 0, breakpointAddr),
+		MakeIRInst(IROp::Breakpoint, 0),
+		MakeIRInst(IROp::SetConst, 5, 0, 0, 2),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, breakpointAddr + 4),
+	};
+	match = CompareIRRuns("Breakpoint not hit", breakpoint, initial, methods) && match;
+	CBreakPoints::AddBreakPoint(breakpointAddr);
+	match = CompareIRRuns("Breakpoint", breakpoint, initial, methods) && match;
+	CBreakPoints::ClearAllBreakPoints();
+
+	std::vector<IRInst> breakOp = {
+		MakeIRInst(IROp::SetConst, 6, 0, 0, 3),
+		MakeIRInst(IROp::SetPCConst, 0, 0, 0, 0x08804600),
+		MakeIRInst(IROp::Break, 0),
+		MakeIRInst(IROp::SetConst, 6, 0, 0, 4),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x08804608),
+	};
+	match = CompareIRRuns("Break", breakOp, initial, methods) && match;
+
+	host = nullptr;
+	return match;
+}
+
+static u32 RunIRThreaded(const std::vector<IRInst> &instructions) {
+	std::vector<IRThreadedInst> threaded;
+	threaded.resize(instructions.size() + 1);
+	IRLowerThreaded(&instructions[0], (int)instructions.size(), &threaded[0]);
+	return IRInterpretThreaded(currentMIPS, &threaded[0]);
+}
+
+bool TestIRDispatch() {
+	SetupJitHarness();
+	InitIR();
+
+	u32 startAddr = PSP_GetUserMemoryBase();
+	u32 addr = startAddr;
+
+	// A mix of the ops that dominate typical game blocks. Loads and stores use separate
+	// areas so that each run sees the same memory.
+	static const char *lines[] = {
+		"addiu r2, r2, 1",
+		"lw r3, 0(r1)",
+		"addu r4, r3, r2",
+		"sw r4, 64(r1)",
+		"sll r5, r4, 2",
+		"xor r6, r5, r2",
+		"slt r7, r6, r4",
+		"or r8, r7, r5",
+		"subu r9, r8, r6",
+		"andi r10, r9, 0xFF",
+		"srl r11, r9, 3",
+		"sh r10, 68(r1)",
+		"lbu r12, 4(r1)",
+		"ori r13, r12, 0x10",
+		"mult r13, r11",
+		"mflo r14",
+	};
+
+	bool compileSuccess = MIPSAsm::MipsAssembleOpcode("lui r1, 0x0890", currentDebugMIPS, addr);
+	addr += 4;
+	for (int i = 0; i < 8; ++i) {
+		for (size_t j = 0; j < ARRAY_SIZE(lines); ++j) {
+			if (!MIPSAsm::MipsAssembleOpcode(lines[j], currentDebugMIPS, addr)) {
+				printf("ERROR: %ls\n", MIPSAsm::GetAssembleError().c_str());
+				compileSuccess = false;
+			}
+			addr += 4;
+		}
+	}
+	compileSuccess = compileSuccess && MIPSAsm::MipsAssembleOpcode("jr r31", currentDebugMIPS, addr);
+	compileSuccess = compileSuccess && MIPSAsm::MipsAssembleOpcode("nop", currentDebugMIPS, addr + 4);
+	if (!compileSuccess) {
+		DestroyJitHarness();
+		return false;
+	}
+
+	// Record the block the same way IRJit would.
+	MIPSComp::IRFrontend frontend(true);
+	IROptions opts{};
+	frontend.SetOptions(opts);
+	std::vector<IRInst> instructions;
+	u32 mipsBytes;
+	frontend.DoJit(startAddr, instructions, mipsBytes, false);
+
+	const int count = (int)instructions.size();
+	std::vector<IRThreadedInst> threaded;
+	threaded.resize(count + 1);
+	IRLowerThreaded(&instructions[0], count, &threaded[0]);
+
+	const int runs = 100000;
+	IRTestState initial;
+	SaveIRTestState(initial);
+
+	double st = time_now_d();
+	for (int i = 0; i < runs; ++i)
+		currentMIPS->pc = IRInterpret(currentMIPS, &instructions[0], count);
+	double switchTime = time_now_d() - st;
+	IRTestState expected;
+	SaveIRTestState(expected);
+
+	LoadIRTestState(initial);
+	st = time_now_d();
+	for (int i = 0; i < runs; ++i)
+		currentMIPS->pc = IRInterpretThreaded(currentMIPS, &threaded[0]);
+	double threadedTime = time_now_d() - st;
+
+	IRTestState actual;
+	SaveIRTestState(actual);
+	bool match = CompareIRTestState("IR block", "Threaded dispatch", expected, actual);
+
+	std::vector<IRRunMethod> methods;
+	methods.push_back({ "Threaded dispatch", &RunIRThreaded });
+
+	double perInst = 1000000000.0 / ((double)runs * count);
+	printf("IR block: %d MIPS ops, %d IR ops\n", mipsBytes / 4, count);
+	printf("Switch dispatch:   %.2f ns/op\n", switchTime * perInst);
+	printf("Threaded dispatch: %.2f ns/op\n", threadedTime * perInst);
+
+#if PPSSPP_ARCH(AMD64)
+	std::unique_ptr<MIPSComp::X64IRJit> nativeJit(new MIPSComp::X64IRJit(currentMIPS));
+	const u8 *nativeCode = nativeJit->CompileStandalone(&instructions[0], count);
+	if (nativeCode) {
+		LoadIRTestState(initial);
+		st = time_now_d();
+		for (int i = 0; i < runs; ++i)
+			currentMIPS->pc = nativeJit->RunStandalone(nativeCode);
+		double nativeTime = time_now_d() - st;
+
+		SaveIRTestState(actual);
+		match = CompareIRTestState("IR block", "X64IRJit", expected, actual) && match;
+		printf("X64IRJit:          %.2f ns/op\n", nativeTime * perInst);
+	} else {
+		printf("ERROR: X64IRJit failed to compile the IR block.\n");
+		match = false;
+	}
+
+	MIPSComp::X64IRJit *jit = nativeJit.get();
+	methods.push_back({ "X64IRJit", [jit](const std::vector<IRInst> &insts) {
+		const u8 *code = jit->CompileStandalone(&insts[0], (int)insts.size());
+		return code ? jit->RunStandalone(code) : 0;
+	} });
+#endif
+
+	match = TestIRCases(methods) && match;
+
+#if PPSSPP_ARCH(AMD64)
+	nativeJit.reset();
+#endif
+	DestroyJitHarness();
+	return match;
+}
+
+// MIPSAsm doesn't know the VFPU, so these are encoded by hand.  Size is 0-3 for .s to .q.
+static u32 MakeVFPUOp(u32 base, int size, int vd, int vs, int vt) {
+	return base | (vt << 16) | ((size & 2) << 14) | (vs << 8) | ((size & 1) << 7) | vd;
+}
+
+struct VFPUTestCase {
+	const char *name;
+	std::vector<u32> ops;
+	// False for the prefixed forms that the frontend hands to the interpreter.
+	bool lowered;
+};
+
+// Runs the ops as one IR block and one at a time through the interpreter, and checks that
+// the VFPU registers match exactly.
+static bool CompareVFPUCase(const VFPUTestCase &test, const IRTestState &initial) {
+	const u32 startAddr = PSP_GetUserMemoryBase();
+	u32 endAddr = startAddr;
+	for (u32 op : test.ops) {
+		Memory::Write_U32(op, endAddr);
+		endAddr += 4;
+	}
+	Memory::Write_U32(MIPS_MAKE_JR_RA(), endAddr);
+	Memory::Write_U32(MIPS_MAKE_NOP(), endAddr + 4);
+
+	MIPSComp::IRFrontend frontend(true);
+	IROptions opts{};
+	frontend.SetOptions(opts);
+	std::vector<IRInst> instructions;
+	u32 mipsBytes;
+	frontend.DoJit(startAddr, instructions, mipsBytes, false);
+
+	bool lowered = std::none_of(instructions.begin(), instructions.end(), [](const IRInst &inst) {
+		return inst.op == IROp::Interpret;
+	});
+	if (lowered != test.lowered) {
+		printf("ERROR: %s: expected the IR frontend to %s.\n", test.name, test.lowered ? "lower it" : "fall back to the interpreter");
+		return false;
+	}
+
+	LoadIRTestState(initial);
+	IRInterpret(currentMIPS, &instructions[0], (int)instructions.size());
+	IRTestState ir;
+	SaveIRTestState(ir);
+
+	LoadIRTestState(initial);
+	currentMIPS->pc = startAddr;
+	while (currentMIPS->pc < endAddr)
+		MIPSInterpret(Memory::Read_Instruction(currentMIPS->pc));
+	IRTestState interp;
+	SaveIRTestState(interp);
+
+	for (int i = 0; i < 128; ++i) {
+		if (ir.v[i] != interp.v[i]) {
+			printf("ERROR: %s: v[%d] is %08x from IR, but %08x from the interpreter.\n", test.name, i, ir.v[i], interp.v[i]);
+			return false;
+		}
+	}
+	for (int i = 0; i < 16; ++i) {
+		if (ir.vfpuCtrl[i] != interp.vfpuCtrl[i]) {
+			printf("ERROR: %s: vfpuCtrl[%d] is %08x from IR, but %08x from the interpreter.\n", test.name, i, ir.vfpuCtrl[i], interp.vfpuCtrl[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+// The matrix and cross product lowerings in IRCompVFPU claim to round exactly like the
+// interpreter, including when d overlaps s or t.
+bool TestIRVFPU() {
+	SetupJitHarness();
+	InitIR();
+
+	const u32 vpfxs = 0xDC000000;
+	const u32 vpfxt = 0xDD000000;
+	const u32 vpfxd = 0xDE000000;
+	const u32 vcrs = 0x66800000;
+	const u32 vdet = 0x67000000;
+	const u32 vmmul = 0xF0000000;
+	const u32 vtfm4 = 0xF1800000;
+	const u32 vqmul = 0xF2800000;
+
+	const int P = 1, T = 2, Q = 3;
+	const int M000 = 0, M100 = 4, M200 = 8, E000 = 0x20, E100 = 0x24;
+	const int C000 = 0, C100 = 4, C200 = 8, C700 = 28, C710 = 29;
+	const int S000 = 0, S100 = 4, S700 = 28;
+
+	// Negates x, otherwise passthrough.
+	const u32 negateX = 0x100E4;
+	// For vdet: swaps x and y, and negates the new x.
+	const u32 swapNegateX = 0x100E1;
+	// Saturates x to [0:1] and y to [-1:1], and masks z.
+	const u32 saturate = 0x40D;
+
+	const std::vector<VFPUTestCase> cases = {
+		{ "vmmul.q M000, M000, M100", { MakeVFPUOp(vmmul, Q, M000, M000, M100) }, true },
+		{ "vmmul.q E000, M000, M000", { MakeVFPUOp(vmmul, Q, E000, M000, M000) }, true },
+		{ "vmmul.q M100, M000, M100", { MakeVFPUOp(vmmul, Q, M100, M000, M100) }, true },
+		{ "vmmul.t M100, M000, M100", { MakeVFPUOp(vmmul, T, M100, M000, M100) }, true },
+		{ "vmmul.t M000, M000, M100", { MakeVFPUOp(vmmul, T, M000, M000, M100) }, true },
+		{ "vmmul.p M000, M000, M000", { MakeVFPUOp(vmmul, P, M000, M000, M000) }, true },
+		{ "vmmul.q M000, E000, M100", { MakeVFPUOp(vmmul, Q, M000, E000, M100) }, false },
+		{ "vpfxs + vmmul.q", { vpfxs | negateX, MakeVFPUOp(vmmul, Q, M000, M100, M200) }, false },
+
+		{ "vtfm4.q C000, M100, C200", { MakeVFPUOp(vtfm4, Q, C000, M100, C200) }, true },
+		{ "vhtfm4.t C000, M100, C200", { MakeVFPUOp(vtfm4, T, C000, M100, C200) }, true },
+		{ "vtfm4.q C200, M100, C200", { MakeVFPUOp(vtfm4, Q, C200, M100, C200) }, true },
+		{ "vhtfm4.t C200, M100, C200", { MakeVFPUOp(vtfm4, T, C200, M100, C200) }, true },
+		{ "vtfm4.q C100, M100, C000", { MakeVFPUOp(vtfm4, Q, C100, M100, C000) }, true },
+		{ "vtfm4.q C000, E100, C200", { MakeVFPUOp(vtfm4, Q, C000, E100, C200) }, true },
+		{ "vpfxt + vtfm4.q", { vpfxt | negateX, MakeVFPUOp(vtfm4, Q, C000, M100, C200) }, false },
+
+		{ "vcrs.t C000, C100, C200", { MakeVFPUOp(vcrs, T, C000, C100, C200) }, true },
+		{ "vcrs.t C100, C100, C200", { MakeVFPUOp(vcrs, T, C100, C100, C200) }, true },
+		{ "vcrs.t C000, C000, C000", { MakeVFPUOp(vcrs, T, C000, C000, C000) }, true },
+		{ "vpfxd + vcrs.t", { vpfxd | saturate, MakeVFPUOp(vcrs, T, C000, C100, C200) }, true },
+		{ "vpfxs + vcrs.t", { vpfxs | negateX, MakeVFPUOp(vcrs, T, C000, C100, C200) }, false },
+
+		{ "vdet.p S000, C100, C200", { MakeVFPUOp(vdet, P, S000, C100, C200) }, true },
+		{ "vdet.p S100, C100, C200", { MakeVFPUOp(vdet, P, S100, C100, C200) }, true },
+		// -0.0 - +0.0, which the +0.0 add has to make positive.
+		{ "vdet.p S700, C700, C710", { MakeVFPUOp(vdet, P, S700, C700, C710) }, true },
+		{ "vpfxs + vdet.p", { vpfxs | swapNegateX, MakeVFPUOp(vdet, P, S000, C100, C200) }, true },
+		{ "vpfxd + vdet.p", { vpfxd | saturate, MakeVFPUOp(vdet, P, S000, C100, C200) }, true },
+		{ "vpfxt + vdet.p", { vpfxt | negateX, MakeVFPUOp(vdet, P, S000, C100, C200) }, false },
+
+		{ "vqmul.q C000, C100, C200", { MakeVFPUOp(vqmul, Q, C000, C100, C200) }, true },
+		{ "vqmul.q C100, C100, C200", { MakeVFPUOp(vqmul, Q, C100, C100, C200) }, true },
+		{ "vqmul.q C200, C100, C200", { MakeVFPUOp(vqmul, Q, C200, C100, C200) }, true },
+		{ "vqmul.q C000, C000, C000", { MakeVFPUOp(vqmul, Q, C000, C000, C000) }, true },
+		{ "vcrsp.t C000, C000, C100", { MakeVFPUOp(vqmul, T, C000, C000, C100) }, true },
+		{ "vpfxs + vqmul.q", { vpfxs | negateX, MakeVFPUOp(vqmul, Q, C000, C100, C200) }, false },
+	};
+
+	IRTestState initial;
+	SeedIRTestState(initial);
+	initial.vfpuCtrl[VFPU_CTRL_SPREFIX] = 0xE4;
+	initial.vfpuCtrl[VFPU_CTRL_TPREFIX] = 0xE4;
+	initial.vfpuCtrl[VFPU_CTRL_DPREFIX] = 0;
+	// C700 and C710 for the signed zero vdet.
+	static const float zeroDet[8] = { -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+	memcpy(&initial.v[112], zeroDet, sizeof(zeroDet));
+
+	bool match = true;
+	for (const VFPUTestCase &test : cases)
+		match = CompareVFPUCase(test, initial) && match;
+
+	DestroyJitHarness();
+	return match;
+}
+
+// Runs the program from the start until it calls UnitTestTerminator.
+static void RunTraceProgram(u32 startAddr, u32 regs[32]) {
+	memset(currentMIPS->r, 0, sizeof(currentMIPS->r));
+	currentMIPS->pc = startAddr;
+	coreState = CORE_RUNNING;
+	while (coreState == CORE_RUNNING)
+		mipsr4k.RunLoopUntil(1000000);
+	memcpy(regs, currentMIPS->r, sizeof(currentMIPS->r));
+}
+
+static bool CompareTraceRegs(const char *test, const u32 expected[32], const u32 actual[32]) {
+	for (int i = 0; i < 32; ++i) {
+		if (expected[i] != actual[i]) {
+			printf("ERROR: %s: r%d is %08x, but %08x with traces off.\n", test, i, actual[i], expected[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Superblock traces in IRJit have to give the same results as running their blocks one at a
+// time, including when they leave early through a side exit, and after a member is overwritten.
+bool TestIRTraces() {
+	SetupJitHarness();
+
+	// loop jumps to sideBranch, which usually falls through to tail, which branches back to
+	// loop.  So the trace is loop + sideBranch + tail, and exits early to side every 16th time.
+	const u32 startAddr = PSP_GetUserMemoryBase();
+	const u32 loopAddr = startAddr + 24;
+	const u32 sideBranchAddr = loopAddr + 16;
+	const u32 tailAddr = sideBranchAddr + 12;
+	const u32 sideAddr = tailAddr + 24;
+	const u32 modifiedAddr = tailAddr + 4;
+
+	// Assembled first to get the encoding, the program then overwrites it.
+	bool assembled = MIPSAsm::MipsAssembleOpcode("subu r3, r6, r2", currentDebugMIPS, modifiedAddr);
+	const u32 modifiedOp = Memory::Read_U32(modifiedAddr);
+
+	const std::string lines[] = {
+		"addiu r2, r0, 0",
+		"addiu r3, r0, 1",
+		"addiu r4, r0, 1000",
+		"addiu r7, r0, 0",
+		// Jumping lets loop count its exits from the first iteration, so it becomes the trace head.
+		StringFromFormat("j 0x%08x", loopAddr),
+		"nop",
+		// loop
+		"addiu r2, r2, 1",
+		"addu r3, r3, r2",
+		StringFromFormat("j 0x%08x", sideBranchAddr),
+		"nop",
+		// sideBranch
+		"andi r5, r2, 15",
+		StringFromFormat("beq r5, r0, 0x%08x", sideAddr),
+		"nop",
+		// tail
+		"sll r6, r3, 1",
+		"xor r3, r6, r2",
+		StringFromFormat("bne r2, r4, 0x%08x", loopAddr),
+		"nop",
+		"",
+		"nop",
+		// side
+		"addiu r7, r7, 1",
+		StringFromFormat("j 0x%08x", tailAddr),
+		"nop",
+	};
+
+	u32 addr = startAddr;
+	for (const std::string &line : lines) {
+		if (line.empty()) {
+			Memory::Write_U32(MIPS_MAKE_SYSCALL("UnitTestFakeSyscalls", "UnitTestTerminator"), addr);
+		} else if (!MIPSAsm::MipsAssembleOpcode(line.c_str(), currentDebugMIPS, addr)) {
+			printf("ERROR: %ls\n", MIPSAsm::GetAssembleError().c_str());
+			assembled = false;
+		}
+		addr += 4;
+	}
+	const u32 originalOp = Memory::Read_U32(modifiedAddr);
+	if (!assembled) {
+		DestroyJitHarness();
+		return false;
+	}
+
+	// Blocks one at a time first, for both versions of tail.  ClearCache() takes the emuhacks out.
+	const uint32_t oldDisableFlags = g_Config.uJitDisableFlags;
+	g_Config.uJitDisableFlags = oldDisableFlags | (uint32_t)MIPSComp::JitDisable::IR_TRACES;
+	mipsr4k.UpdateCore(CPUCore::IR_JIT);
+	u32 expected[32], expectedModified[32], actual[32];
+	RunTraceProgram(startAddr, expected);
+	MIPSComp::jit->ClearCache();
+	Memory::Write_U32(modifiedOp, modifiedAddr);
+	RunTraceProgram(startAddr, expectedModified);
+	MIPSComp::jit->ClearCache();
+	Memory::Write_U32(originalOp, modifiedAddr);
+	mipsr4k.UpdateCore(CPUCore::INTERPRETER);
+
+	g_Config.uJitDisableFlags = oldDisableFlags & ~(uint32_t)MIPSComp::JitDisable::IR_TRACES;
+	mipsr4k.UpdateCore(CPUCore::IR_JIT);
+	RunTraceProgram(startAddr, actual);
+	bool match = CompareTraceRegs("Trace with side exits", expected, actual);
+
+	MIPSComp::IRBlockCache *cache = static_cast<MIPSComp::IRBlockCache *>(MIPSComp::jit->GetBlockCacheDebugInterface());
+	const int traceNum = cache->GetBlockNumAt(loopAddr);
+	const MIPSComp::IRBlock *trace = cache->GetBlock(traceNum);
+	if (!trace || !trace->IsTrace() || trace->GetTraceRanges().size() != 2) {
+		printf("ERROR: Expected a trace of three blocks at %08x.\n", loopAddr);
+		match = false;
+	} else {
+		// Like a game loading new code over tail.
+		Memory::Write_U32(modifiedOp, modifiedAddr);
+		currentMIPS->InvalidateICache(modifiedAddr, 4);
+		if (cache->GetBlock(traceNum)->IsValid()) {
+			printf("ERROR: Overwriting a block in a trace didn't invalidate the trace.\n");
+			match = false;
+		}
+		RunTraceProgram(startAddr, actual);
+		match = CompareTraceRegs("Trace after invalidation", expectedModified, actual) && match;
+	}
+
+	MIPSComp::jit->ClearCache();
+	mipsr4k.UpdateCore(CPUCore::INTERPRETER);
+	g_Config.uJitDisableFlags = oldDisableFlags;
+	DestroyJitHarness();
+	return match;
+}
+
+static u32 RunIRPass(IRPassFunc pass, const std::vector<IRInst> &instructions) {
+	IRWriter in, out;
+	for (const IRInst &inst : instructions)
+		in.Write(inst);
+	IROptions opts{};
+	opts.unalignedLoadStore = true;
+	pass(in, out, opts);
+	return IRInterpret(currentMIPS, &out.GetInstructions()[0], (int)out.GetInstructions().size());
+}
+
+static u32 RunIROptimizeHotBlock(const std::vector<IRInst> &instructions) {
+	MIPSComp::IRFrontend frontend(true);
+	IROptions opts{};
+	opts.unalignedLoadStore = true;
+	frontend.SetOptions(opts);
+	std::vector<IRInst> optimized = instructions;
+	frontend.OptimizeHotBlock(optimized);
+	return IRInterpret(currentMIPS, &optimized[0], (int)optimized.size());
+}
+
+// Checks the pass does something with the case, so it's not trivially equivalent.
+static bool ExpectIRPassChanges(const char *test, const char *name, IRPassFunc pass, const std::vector<IRInst> &instructions) {
+	IRWriter in, out;
+	for (const IRInst &inst : instructions)
+		in.Write(inst);
+	IROptions opts{};
+	opts.unalignedLoadStore = true;
+	pass(in, out, opts);
+	const std::vector<IRInst> &result = out.GetInstructions();
+	if (result.size() == instructions.size() && memcmp(&result[0], &instructions[0], sizeof(IRInst) * result.size()) == 0) {
+		printf("ERROR: %s: %s didn't change anything.\n", test, name);
+		return false;
+	}
+	return true;
+}
+
+// The passes hot IR blocks get recompiled with must not change what a block does.
+bool TestIRLoadStorePasses() {
+	SetupJitHarness();
+	InitIR();
+
+	const std::vector<IRRunMethod> methods = {
+		{ "ReorderLoadStore", [](const std::vector<IRInst> &insts) { return RunIRPass(&ReorderLoadStore, insts); } },
+		{ "MergeLoadStore", [](const std::vector<IRInst> &insts) { return RunIRPass(&MergeLoadStore, insts); } },
+		{ "OptimizeHotBlock", &RunIROptimizeHotBlock },
+	};
+
+	IRTestState initial;
+	SeedIRTestState(initial);
+	bool match = true;
+
+	// Loads and stores off the same base get sorted by offset, past the other ops.
+	std::vector<IRInst> sorted = {
+		MakeIRInst(IROp::SetConst, 1, 0, 0, IR_TEST_MEM),
+		MakeIRInst(IROp::Load32, 2, 1, 0, 8),
+		MakeIRInst(IROp::AddConst, 5, 6, 0, 1),
+		MakeIRInst(IROp::Load32, 3, 1, 0, 0),
+		MakeIRInst(IROp::Load32, 4, 1, 0, 4),
+		MakeIRInst(IROp::Store32, 2, 1, 0, 20),
+		MakeIRInst(IROp::Xor, 7, 5, 3),
+		MakeIRInst(IROp::Store32, 3, 1, 0, 16),
+		MakeIRInst(IROp::Store32, 4, 1, 0, 12),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x08804700),
+	};
+	match = ExpectIRPassChanges("Sorted loads and stores", "ReorderLoadStore", &ReorderLoadStore, sorted) && match;
+	match = CompareIRRuns("Sorted loads and stores", sorted, initial, methods) && match;
+
+	// A load that replaces the base, or a reg used after, can't move.
+	std::vector<IRInst> baseLoad = {
+		MakeIRInst(IROp::SetConst, 1, 0, 0, IR_TEST_MEM),
+		MakeIRInst(IROp::Load32, 2, 1, 0, 8),
+		MakeIRInst(IROp::Load32, 1, 1, 0, 0),
+		MakeIRInst(IROp::Load32, 3, 1, 0, 4),
+		MakeIRInst(IROp::SetConst, 1, 0, 0, IR_TEST_MEM),
+		MakeIRInst(IROp::Add, 4, 2, 3),
+		MakeIRInst(IROp::Load32, 4, 1, 0, 12),
+		MakeIRInst(IROp::Load32, 5, 1, 0, 4),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x08804704),
+	};
+	match = CompareIRRuns("Load into its base", baseLoad, initial, methods) && match;
+
+	// Unaligned stores that partly overlap have to stay in order, but the others can still sort.
+	std::vector<IRInst> overlapping = {
+		MakeIRInst(IROp::SetConst, 1, 0, 0, IR_TEST_MEM),
+		MakeIRInst(IROp::Store16, 2, 1, 0, 3),
+		MakeIRInst(IROp::Store16, 3, 1, 0, 2),
+		MakeIRInst(IROp::Store32, 4, 1, 0, 10),
+		MakeIRInst(IROp::Store32, 5, 1, 0, 8),
+		MakeIRInst(IROp::Store32, 6, 1, 0, 24),
+		MakeIRInst(IROp::Store32, 7, 1, 0, 20),
+		MakeIRInst(IROp::Store32, 8, 1, 0, 24),
+		MakeIRInst(IROp::Load32, 9, 1, 0, 6),
+		MakeIRInst(IROp::Load16, 10, 1, 0, 9),
+		MakeIRInst(IROp::Store8, 11, 1, 0, 1),
+		MakeIRInst(IROp::Store8, 12, 1, 0, 0),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x08804708),
+	};
+	match = ExpectIRPassChanges("Overlapping stores", "ReorderLoadStore", &ReorderLoadStore, overlapping) && match;
+	match = CompareIRRuns("Overlapping stores", overlapping, initial, methods) && match;
+
+	// Zero stores to neighbouring bytes and halves become wider stores.
+	std::vector<IRInst> merged = {
+		MakeIRInst(IROp::SetConst, 1, 0, 0, IR_TEST_MEM),
+		MakeIRInst(IROp::Store8, MIPS_REG_ZERO, 1, 0, 8),
+		MakeIRInst(IROp::Store8, MIPS_REG_ZERO, 1, 0, 9),
+		MakeIRInst(IROp::Store8, MIPS_REG_ZERO, 1, 0, 10),
+		MakeIRInst(IROp::Store8, MIPS_REG_ZERO, 1, 0, 11),
+		MakeIRInst(IROp::Store16, MIPS_REG_ZERO, 1, 0, 14),
+		MakeIRInst(IROp::Store16, MIPS_REG_ZERO, 1, 0, 16),
+		MakeIRInst(IROp::Store8, MIPS_REG_ZERO, 1, 0, 21),
+		MakeIRInst(IROp::Store8, MIPS_REG_ZERO, 1, 0, 22),
+		MakeIRInst(IROp::Store8, MIPS_REG_ZERO, 1, 0, 23),
+		// Not zero, so these stay as they are.
+		MakeIRInst(IROp::Store8, 2, 1, 0, 24),
+		MakeIRInst(IROp::Store8, 2, 1, 0, 25),
+		MakeIRInst(IROp::Load32, 3, 1, 0, 20),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x0880470C),
+	};
+	match = ExpectIRPassChanges("Merged zero stores", "MergeLoadStore", &MergeLoadStore, merged) && match;
+	match = CompareIRRuns("Merged zero stores", merged, initial, methods) && match;
+
+	// Loads right after a store to the same place use the stored register instead.
+	std::vector<IRInst> forwarding = {
+		MakeIRInst(IROp::SetConst, 1, 0, 0, IR_TEST_MEM),
+		MakeIRInst(IROp::Store32, 2, 1, 0, 8),
+		MakeIRInst(IROp::Load32, 3, 1, 0, 8),
+		MakeIRInst(IROp::Store32, 4, 1, 0, 12),
+		MakeIRInst(IROp::Load32, 4, 1, 0, 12),
+		MakeIRInst(IROp::StoreFloat, 2, 1, 0, 16),
+		MakeIRInst(IROp::LoadFloat, 3, 1, 0, 16),
+		MakeIRInst(IROp::Store32, 5, 1, 0, 20),
+		MakeIRInst(IROp::LoadFloat, 4, 1, 0, 20),
+		MakeIRInst(IROp::StoreFloat, 5, 1, 0, 24),
+		MakeIRInst(IROp::Load32, 6, 1, 0, 24),
+		// Same base but another offset, so this has to really load.  Forwarding used to compare src2.
+		MakeIRInst(IROp::Store32, 7, 1, 0, 28),
+		MakeIRInst(IROp::Load32, 8, 1, 0, 32),
+		MakeIRInst(IROp::StoreFloat, 6, 1, 0, 36),
+		MakeIRInst(IROp::LoadFloat, 7, 1, 0, 40),
+		MakeIRInst(IROp::ExitToConst, 0, 0, 0, 0x08804710),
+	};
+	match = ExpectIRPassChanges("Store to load forwarding", "MergeLoadStore", &MergeLoadStore, forwarding) && match;
+	match = CompareIRRuns("Store to load forwarding", forwarding, initial, methods) && match;
+
+	DestroyJitHarness();
+	return match;
+}
+
+// Adds a block of two MIPS ops at addr to the cache, where the IR just sets v0 to value.
+static void AddDiskCacheTestBlock(MIPSComp::IRDiskCache &cache, u32 addr, u32 value) {
+	Memory::Write_U32(value, addr);
+	Memory::Write_U32(0, addr + 4);
+	MIPSComp::IRBlock block(addr);
+	block.SetInstructions({ MakeIRInst(IROp::SetConst, MIPS_REG_V0, 0, 0, value), MakeIRInst(IROp::ExitToConst, 0, 0, 0, addr + 8) });
+	block.SetOriginalSize(8);
+	block.UpdateHash();
+	cache.Add(block);
+}
+
+// Checks what the cache has for the code currently at addr.
+static bool ExpectDiskCacheBlock(const char *test, const MIPSComp::IRDiskCache &cache, u32 addr, bool found, u32 value = 0) {
+	std::vector<IRInst> instructions;
+	u32 mipsBytes = 0;
+	bool result = cache.Find(addr, instructions, mipsBytes);
+	if (result != found) {
+		printf("ERROR: %s: block %s\n", test, found ? "not found" : "unexpectedly found");
+		return false;
+	}
+	if (found && (mipsBytes != 8 || instructions.size() != 2 || instructions[0].op != IROp::SetConst || instructions[0].constant != value)) {
+		printf("ERROR: %s: wrong block found\n", test);
+		return false;
+	}
+	return true;
+}
+
+// The IR block cache has to round trip, reject files from other builds or disable flags,
+// and only keep a few variants per address.
+bool TestIRDiskCache() {
+	SetupJitHarness();
+
+	const u32 addr = IR_TEST_MEM;
+	const u32 flags = (uint32_t)MIPSComp::JitDisable::IR_TRACES;
+	const u64 buildHash = MIPSComp::IRDiskCache::GetBuildHash();
+	bool match = true;
+
+	MIPSComp::IRDiskCache saved;
+	AddDiskCacheTestBlock(saved, addr, 0x1234);
+	AddDiskCacheTestBlock(saved, addr + 0x100, 0x5678);
+	const std::string data = saved.SaveToString(flags, buildHash);
+
+	MIPSComp::IRDiskCache loaded;
+	if (!loaded.LoadFromString(data, flags, buildHash) || loaded.GetNumBlocks() != 2) {
+		printf("ERROR: IR disk cache didn't load what it saved\n");
+		match = false;
+	}
+	match = ExpectDiskCacheBlock("Round trip", loaded, addr + 0x100, true, 0x5678) && match;
+	match = ExpectDiskCacheBlock("Round trip", loaded, addr, true, 0x1234) && match;
+
+	// The code changed since it was saved.
+	Memory::Write_U32(0x4321, addr);
+	match = ExpectDiskCacheBlock("Changed code", loaded, addr, false) && match;
+	Memory::Write_U32(0x1234, addr);
+
+	if (loaded.LoadFromString(data, flags, buildHash + 1) || loaded.GetNumBlocks() != 0) {
+		printf("ERROR: IR disk cache loaded a file from another build\n");
+		match = false;
+	}
+	if (loaded.LoadFromString(data, flags | (uint32_t)MIPSComp::JitDisable::IR_TIERING, buildHash) || loaded.GetNumBlocks() != 0) {
+		printf("ERROR: IR disk cache loaded a file with other disable flags\n");
+		match = false;
+	}
+	if (loaded.LoadFromString(data.substr(0, data.size() - 1), flags, buildHash) || loaded.GetNumBlocks() != 0) {
+		printf("ERROR: IR disk cache loaded a truncated file\n");
+		match = false;
+	}
+	match = ExpectDiskCacheBlock("Rejected file", loaded, addr, false) && match;
+
+	// Like an overlay loading different code over the same address again and again.
+	MIPSComp::IRDiskCache variants;
+	for (int i = 0; i <= MIPSComp::IR_DISK_CACHE_MAX_VARIANTS; ++i)
+		AddDiskCacheTestBlock(variants, addr, 0x100 + i);
+	// Adding one that's already there shouldn't grow it.
+	AddDiskCacheTestBlock(variants, addr, 0x100 + MIPSComp::IR_DISK_CACHE_MAX_VARIANTS);
+	if (variants.GetNumBlocks() != MIPSComp::IR_DISK_CACHE_MAX_VARIANTS) {
+		printf("ERROR: IR disk cache kept %d variants, expected %d\n", variants.GetNumBlocks(), MIPSComp::IR_DISK_CACHE_MAX_VARIANTS);
+		match = false;
+	}
+	Memory::Write_U32(0x100, addr);
+	match = ExpectDiskCacheBlock("Oldest variant", variants, addr, false) && match;
+	Memory::Write_U32(0x101, addr);
+	match = ExpectDiskCacheBlock("Second variant", variants, addr, true, 0x101) && match;
+
+	DestroyJitHarness();
+	return match;
+}
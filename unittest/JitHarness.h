@@ -18,3 +18,8 @@
 #pragma once
 
 bool TestJit();
+bool TestIRDispatch();
+bool TestIRVFPU();
+bool TestIRTraces();
+bool TestIRLoadStorePasses();
+bool TestIRDiskCache();
@@ -0,0 +1,119 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <vector>
+
+#include "Common/TimeUtil.h"
+#include "Core/CoreTiming.h"
+#include "Core/MIPS/MIPS.h"
+
+#include "unittest/UnitTest.h"
+
+static std::vector<u64> firedEvents;
+static int fireCount;
+
+static void RecordCallback(u64 userdata, int cyclesLate) {
+	firedEvents.push_back(userdata);
+}
+
+static void CountCallback(u64 userdata, int cyclesLate) {
+	fireCount++;
+}
+
+static void RunCycles(int cycles) {
+	currentMIPS->downcount -= cycles;
+	CoreTiming::Advance();
+}
+
+static bool TestEventOrder() {
+	int recordEvent = CoreTiming::RegisterEvent("RecordEvent", &RecordCallback);
+	firedEvents.clear();
+
+	// Equal times must fire in the order they were scheduled.
+	CoreTiming::ScheduleEvent(1000, recordEvent, 3);
+	CoreTiming::ScheduleEvent(500, recordEvent, 1);
+	CoreTiming::ScheduleEvent(1000, recordEvent, 4);
+	CoreTiming::ScheduleEvent(500, recordEvent, 2);
+	CoreTiming::ScheduleEvent(2000, recordEvent, 5);
+	CoreTiming::ScheduleEvent(1500, recordEvent, 99);
+	CoreTiming::ScheduleEvent(3000, recordEvent, 6);
+	EXPECT_TRUE(CoreTiming::IsScheduled(recordEvent));
+
+	s64 left = CoreTiming::UnscheduleEvent(recordEvent, 99);
+	EXPECT_EQ_INT((int)left, 1500);
+	EXPECT_EQ_INT((int)CoreTiming::UnscheduleEvent(recordEvent, 99), 0);
+
+	RunCycles(2000);
+	static const u64 expected[] = { 1, 2, 3, 4, 5 };
+	EXPECT_EQ_INT((int)firedEvents.size(), (int)ARRAY_SIZE(expected));
+	for (size_t i = 0; i < ARRAY_SIZE(expected); ++i) {
+		EXPECT_EQ_INT((int)firedEvents[i], (int)expected[i]);
+	}
+
+	CoreTiming::RemoveEvent(recordEvent);
+	EXPECT_FALSE(CoreTiming::IsScheduled(recordEvent));
+	RunCycles(2000);
+	EXPECT_EQ_INT((int)firedEvents.size(), (int)ARRAY_SIZE(expected));
+	return true;
+}
+
+// Kernel alarms, vtimers and thread delays mostly get scheduled and then cancelled again.
+static bool TestEventChurn() {
+	const int NUM_KEYS = 512;
+	const int ITERATIONS = 200000;
+
+	int countEvent = CoreTiming::RegisterEvent("CountEvent", &CountCallback);
+	fireCount = 0;
+
+	u32 seed = 0x12345678;
+	auto nextRandom = [&]() {
+		seed = seed * 1103515245 + 12345;
+		return seed >> 8;
+	};
+
+	for (int i = 0; i < NUM_KEYS; ++i) {
+		CoreTiming::ScheduleEvent(10000 + nextRandom() % 100000, countEvent, i);
+	}
+
+	double st = time_now_d();
+	for (int i = 0; i < ITERATIONS; ++i) {
+		u64 key = nextRandom() % NUM_KEYS;
+		CoreTiming::UnscheduleEvent(countEvent, key);
+		CoreTiming::ScheduleEvent(10000 + nextRandom() % 100000, countEvent, key);
+		if ((i & 63) == 0)
+			RunCycles(200);
+	}
+	double elapsed = time_now_d() - st;
+	printf("CoreTiming churn: %d keys, %d reschedules in %0.2f ms (%0.1f ns each), %d fired\n", NUM_KEYS, ITERATIONS, elapsed * 1000.0, elapsed * 1e9 / ITERATIONS, fireCount);
+
+	CoreTiming::RemoveEvent(countEvent);
+	EXPECT_FALSE(CoreTiming::IsScheduled(countEvent));
+	return true;
+}
+
+bool TestCoreTiming() {
+	MIPSState *oldMIPS = currentMIPS;
+	currentMIPS = &mipsr4k;
+	CoreTiming::Init();
+
+	bool success = TestEventOrder() && TestEventChurn();
+
+	CoreTiming::Shutdown();
+	currentMIPS = oldMIPS;
+	return success;
+}
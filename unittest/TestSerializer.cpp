@@ -0,0 +1,242 @@
+// Copyright (c) 2021- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Common/CommonWindows.h"
+#include "Common/CPUDetect.h"
+#include "Common/File/FileUtil.h"
+#include "Common/File/Path.h"
+#include "Common/Serialize/Serializer.h"
+#include "Common/Serialize/SerializeFuncs.h"
+#include "Common/StringUtils.h"
+#include "Common/Thread/ThreadManager.h"
+
+#include "unittest/UnitTest.h"
+
+// Roughly shaped like a real savestate: a few big memory blocks, and lots of small kernel objects.
+struct FakeKernelObject {
+	std::string name;
+	u32 uid;
+	u32 attr;
+	u32 waitingThreads[8];
+
+	void DoState(PointerWrap &p) {
+		auto s = p.Section("KernelObject", 1);
+		if (!s)
+			return;
+		Do(p, name);
+		Do(p, uid);
+		Do(p, attr);
+		DoArray(p, waitingThreads, ARRAY_SIZE(waitingThreads));
+	}
+};
+
+struct FakeState {
+	std::vector<u64> events;
+	std::vector<u8> ram;
+	std::vector<u8> vram;
+	std::vector<FakeKernelObject> objects;
+	u32 gstate[512];
+
+	void Init(u32 seed) {
+		auto nextRandom = [&]() {
+			seed = seed * 1103515245 + 12345;
+			return seed >> 8;
+		};
+
+		events.resize(64);
+		for (auto &ev : events)
+			ev = nextRandom();
+		ram.resize(32 * 1024 * 1024);
+		for (size_t i = 0; i < ram.size(); i += 4096)
+			ram[i] = (u8)nextRandom();
+		vram.resize(2 * 1024 * 1024);
+		vram[vram.size() - 1] = (u8)nextRandom();
+		objects.resize(2000);
+		for (size_t i = 0; i < objects.size(); ++i) {
+			objects[i].name = StringFromFormat("object %d", (int)i);
+			objects[i].uid = nextRandom();
+			objects[i].attr = nextRandom();
+			for (u32 &t : objects[i].waitingThreads)
+				t = nextRandom();
+		}
+		for (u32 &reg : gstate)
+			reg = nextRandom();
+	}
+
+	void DoState(PointerWrap &p) {
+		auto s = p.Section("FakeState", 1);
+		if (!s)
+			return;
+
+		{
+			auto s2 = p.Section("CoreTiming", 1);
+			if (s2)
+				Do(p, events);
+		}
+		{
+			auto s2 = p.Section("Memory", 1);
+			if (s2) {
+				DoArray(p, &ram[0], (int)ram.size());
+				DoArray(p, &vram[0], (int)vram.size());
+			}
+		}
+		{
+			auto s2 = p.Section("Kernel", 1);
+			if (s2) {
+				int count = (int)objects.size();
+				Do(p, count);
+				if (p.mode == PointerWrap::MODE_READ)
+					objects.resize(count);
+				for (auto &obj : objects)
+					obj.DoState(p);
+			}
+		}
+		{
+			auto s2 = p.Section("GPU", 1);
+			if (s2)
+				DoArray(p, gstate, ARRAY_SIZE(gstate));
+		}
+	}
+
+	bool Matches(const FakeState &other) const {
+		if (events != other.events || ram != other.ram || vram != other.vram || objects.size() != other.objects.size())
+			return false;
+		for (size_t i = 0; i < objects.size(); ++i) {
+			const FakeKernelObject &a = objects[i];
+			const FakeKernelObject &b = other.objects[i];
+			if (a.name != b.name || a.uid != b.uid || a.attr != b.attr || memcmp(a.waitingThreads, b.waitingThreads, sizeof(a.waitingThreads)) != 0)
+				return false;
+		}
+		return memcmp(gstate, other.gstate, sizeof(gstate)) == 0;
+	}
+};
+
+static bool TestSaveMatchesTwoPass(FakeState &state) {
+	// This is how saves used to work, with a fresh buffer each time.
+	size_t twoPassSize = CChunkFileReader::MeasurePtr(state);
+	std::vector<u8> twoPass(twoPassSize);
+	EXPECT_TRUE(CChunkFileReader::SavePtr(&twoPass[0], state, twoPassSize) == CChunkFileReader::ERROR_NONE);
+
+	std::vector<u8> onePass;
+	size_t onePassSize = 0;
+	// The first save grows the buffer, afterward it's reused.
+	EXPECT_TRUE(CChunkFileReader::SaveToBuffer(onePass, state, &onePassSize) == CChunkFileReader::ERROR_NONE);
+	const u8 *firstData = onePass.data();
+	EXPECT_TRUE(CChunkFileReader::SaveToBuffer(onePass, state, &onePassSize) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(onePass.data() == firstData);
+
+	EXPECT_EQ_INT((int)onePassSize, (int)twoPassSize);
+	EXPECT_TRUE(onePass.size() >= onePassSize);
+	EXPECT_TRUE(memcmp(&onePass[0], &twoPass[0], onePassSize) == 0);
+
+	// Memory is fixed size, like the real thing. Everything else should get overwritten.
+	FakeState loaded;
+	loaded.Init(0x87654321);
+	std::string errorString;
+	EXPECT_TRUE(CChunkFileReader::LoadPtr(&onePass[0], loaded, &errorString) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(loaded.Matches(state));
+	return true;
+}
+
+static bool TestSectionStats(FakeState &state) {
+	std::vector<u8> buffer;
+	std::vector<PointerWrapSectionStat> stats;
+	PointerWrap p(buffer);
+	p.SetSectionStats(&stats);
+	state.DoState(p);
+	size_t total = p.GetGrowOffset();
+
+	// The outer section, four subsections, and each kernel object.
+	EXPECT_EQ_INT((int)stats.size(), 5 + (int)state.objects.size());
+	EXPECT_EQ_INT((int)stats[0].depth, 0);
+	EXPECT_EQ_INT((int)stats[0].bytes, (int)total);
+	EXPECT_EQ_INT((int)stats[1].depth, 1);
+	EXPECT_TRUE(stats[2].bytes > state.ram.size() + state.vram.size());
+	for (const auto &stat : stats) {
+		EXPECT_TRUE(stat.bytes <= total);
+		EXPECT_TRUE(stat.seconds >= 0.0);
+	}
+
+	// Should be the same through SaveToBuffer, and not change what's saved.
+	std::vector<PointerWrapSectionStat> bufferStats;
+	std::vector<u8> withStats;
+	std::vector<u8> withoutStats;
+	size_t withSize = 0, withoutSize = 0;
+	EXPECT_TRUE(CChunkFileReader::SaveToBuffer(withStats, state, &withSize, &bufferStats) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(CChunkFileReader::SaveToBuffer(withoutStats, state, &withoutSize) == CChunkFileReader::ERROR_NONE);
+	EXPECT_EQ_INT((int)bufferStats.size(), (int)stats.size());
+	EXPECT_EQ_INT((int)withSize, (int)withoutSize);
+	EXPECT_TRUE(memcmp(&withStats[0], &withoutStats[0], withSize) == 0);
+	return true;
+}
+
+static Path TempFilePath(const char *filename) {
+#ifdef _WIN32
+	wchar_t tempDir[MAX_PATH];
+	if (GetTempPathW(MAX_PATH, tempDir) != 0)
+		return Path(std::wstring(tempDir)) / filename;
+#else
+	const char *tempDir = getenv("TMPDIR");
+	if (tempDir && tempDir[0])
+		return Path(tempDir) / filename;
+#endif
+	return Path("/tmp") / filename;
+}
+
+static bool TestFileRoundTrip(FakeState &state) {
+	const Path filename = TempFilePath("ppsspp_serializer_test.ppst");
+
+	EXPECT_TRUE(CChunkFileReader::Save(filename, "Test", "v0.0", state) == CChunkFileReader::ERROR_NONE);
+
+	std::string title;
+	EXPECT_TRUE(CChunkFileReader::GetFileTitle(filename, &title) == CChunkFileReader::ERROR_NONE);
+	EXPECT_EQ_STR(title, std::string("Test"));
+
+	FakeState loaded;
+	loaded.Init(0x87654321);
+	std::string gitVersion;
+	std::string failureReason;
+	bool loadedOk = CChunkFileReader::Load(filename, &gitVersion, loaded, &failureReason) == CChunkFileReader::ERROR_NONE;
+	File::Delete(filename);
+
+	EXPECT_TRUE(loadedOk);
+	EXPECT_TRUE(loaded.Matches(state));
+	EXPECT_EQ_STR(gitVersion, std::string("v0.0"));
+	return true;
+}
+
+bool TestSerializer() {
+	FakeState state;
+	state.Init(0x12345678);
+
+	// Compression uses the thread manager if it's available.
+	bool ownThreads = !g_threadManager.IsInitialized();
+	if (ownThreads)
+		g_threadManager.Init(cpu_info.num_cores, cpu_info.logical_cpu_count);
+
+	bool success = TestSaveMatchesTwoPass(state) && TestSectionStats(state) && TestFileRoundTrip(state);
+
+	if (ownThreads)
+		g_threadManager.Teardown();
+	return success;
+}
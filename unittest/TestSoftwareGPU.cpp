@@ -0,0 +1,327 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Common/Data/Random/Rng.h"
+#include "GPU/Common/VertexDecoderCommon.h"
+#include "GPU/GPU.h"
+#include "GPU/GPUState.h"
+#include "GPU/Software/TransformUnit.h"
+
+#include "unittest/UnitTest.h"
+
+// Offset so drawing coordinates start at 0 with a viewport centered at 2048.
+static const int OFFSET_X = 2048 - 240;
+static const int OFFSET_Y = 2048 - 136;
+
+static void SetupTransformState(bool depthClamp, int scissorX1, int scissorY1, int scissorX2, int scissorY2) {
+	memset(&gstate, 0, sizeof(gstate));
+	gstate.vertType = GE_VTYPE_POS_FLOAT;
+	gstate.depthClampEnable = depthClamp ? 1 : 0;
+	gstate.viewportxscale = toFloat24(240.0f);
+	gstate.viewportxcenter = toFloat24(2048.0f);
+	gstate.viewportyscale = toFloat24(-136.0f);
+	gstate.viewportycenter = toFloat24(2048.0f);
+	gstate.viewportzscale = toFloat24(-32767.5f);
+	gstate.viewportzcenter = toFloat24(32767.5f);
+	gstate.offsetx = OFFSET_X << 4;
+	gstate.offsety = OFFSET_Y << 4;
+	gstate.scissor1 = scissorX1 | (scissorY1 << 10);
+	gstate.scissor2 = scissorX2 | (scissorY2 << 10);
+	// So fog depth gets compared too.
+	gstate.fogEnable = 1;
+	gstate.fog1 = toFloat24(100.0f);
+	gstate.fog2 = toFloat24(0.01f);
+
+	static const float identity43[12] = { 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0 };
+	static const float identity44[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	memcpy(gstate.worldMatrix, identity43, sizeof(identity43));
+	memcpy(gstate.viewMatrix, identity43, sizeof(identity43));
+	memcpy(gstate.projMatrix, identity44, sizeof(identity44));
+}
+
+static void SetupPerspective(float nearZ, float farZ) {
+	float *m = gstate.projMatrix;
+	memset(m, 0, sizeof(gstate.projMatrix));
+	m[0] = 1.0f;
+	m[5] = 1.0f;
+	m[10] = -(farZ + nearZ) / (farZ - nearZ);
+	m[11] = -1.0f;
+	m[14] = -2.0f * farZ * nearZ / (farZ - nearZ);
+}
+
+// What the clipper and DrawTriangle() reject outright, worked out from the scalar path's vertices.
+// Triangles that need clipping at the near plane change shape, so only the depth check counts for those.
+static bool ScalarTriangleRejected(const VertexData &v0, const VertexData &v1, const VertexData &v2, bool *nearClip) {
+	const VertexData *v[3] = { &v0, &v1, &v2 };
+	bool clipZ = false;
+	int outsidePos = 0, outsideNeg = 0;
+	*nearClip = false;
+	for (int i = 0; i < 3; ++i) {
+		const ClipCoords &c = v[i]->clippos;
+		clipZ = clipZ || c.z > c.w || c.z < -c.w;
+		*nearClip = *nearClip || c.z < -c.w;
+		float z = c.z / c.w;
+		if (z >= 1.000030517578125f)
+			outsidePos++;
+		else if (-z >= 1.000030517578125f)
+			outsideNeg++;
+	}
+	if (clipZ) {
+		if (outsidePos + outsideNeg > 0 && !gstate.isDepthClampEnabled())
+			return true;
+		if (outsidePos >= 3 || outsideNeg >= 3)
+			return true;
+	}
+	if (*nearClip)
+		return false;
+
+	int minX = std::min(std::min(v0.screenpos.x, v1.screenpos.x), v2.screenpos.x) & ~0xF;
+	int minY = std::min(std::min(v0.screenpos.y, v1.screenpos.y), v2.screenpos.y) & ~0xF;
+	int maxX = std::max(std::max(v0.screenpos.x, v1.screenpos.x), v2.screenpos.x) | 0xF;
+	int maxY = std::max(std::max(v0.screenpos.y, v1.screenpos.y), v2.screenpos.y) | 0xF;
+	ScreenCoords scissorTL = TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX1(), gstate.getScissorY1(), 0));
+	ScreenCoords scissorBR = TransformUnit::DrawingToScreen(DrawingCoords(gstate.getScissorX2(), gstate.getScissorY2(), 0));
+	minX = std::max(minX, scissorTL.x);
+	maxX = std::min(maxX, scissorBR.x + 15);
+	minY = std::max(minY, scissorTL.y);
+	maxY = std::min(maxY, scissorBR.y + 15);
+	return maxX < minX || maxY < minY;
+}
+
+struct TransformCheckCounts {
+	int culled = 0;
+	int drawn = 0;
+	int nearClipped = 0;
+};
+
+// Runs positions through both ReadVertex() and TransformPositions(), and checks they agree on
+// each vertex, and that only triangles that would draw nothing are kept from the clipper.
+static bool CheckTransformPaths(const std::vector<Vec3f> &positions, const std::vector<int> &tris, TransformCheckCounts &counts) {
+	const int count = (int)positions.size();
+	std::vector<float> data;
+	for (const Vec3f &pos : positions) {
+		data.push_back(pos.x);
+		data.push_back(pos.y);
+		data.push_back(pos.z);
+	}
+
+	DecVtxFormat fmt{};
+	fmt.posfmt = DEC_FLOAT_3;
+	fmt.posoff = 0;
+	fmt.stride = 12;
+	VertexReader vreader((u8 *)&data[0], fmt, GE_VTYPE_POS_FLOAT);
+
+	TransformUnit transformUnit;
+	std::vector<VertexData> scalar(count);
+	std::vector<bool> scalarOutside(count);
+	for (int i = 0; i < count; ++i) {
+		bool outside = false;
+		vreader.Goto(i);
+		scalar[i] = transformUnit.ReadVertex(vreader, outside);
+		scalarOutside[i] = outside;
+	}
+
+	std::vector<VertexData> batch(count);
+	std::vector<u8> outcodes(count);
+	for (int i = 0; i < count; ++i)
+		batch[i].modelpos = positions[i];
+	TransformUnit::TransformPositions(&batch[0], &outcodes[0], count);
+
+	for (int i = 0; i < count; ++i) {
+		const VertexData &a = batch[i];
+		const VertexData &b = scalar[i];
+		EXPECT_TRUE(a.worldpos.x == b.worldpos.x && a.worldpos.y == b.worldpos.y && a.worldpos.z == b.worldpos.z);
+		EXPECT_TRUE(a.clippos.x == b.clippos.x && a.clippos.y == b.clippos.y && a.clippos.z == b.clippos.z && a.clippos.w == b.clippos.w);
+		EXPECT_EQ_INT(a.screenpos.x, b.screenpos.x);
+		EXPECT_EQ_INT(a.screenpos.y, b.screenpos.y);
+		EXPECT_EQ_INT((int)a.screenpos.z, (int)b.screenpos.z);
+		EXPECT_EQ_FLOAT(a.fogdepth, b.fogdepth);
+		EXPECT_EQ_INT((outcodes[i] & TransformUnit::OUTCODE_RANGE) != 0, (bool)scalarOutside[i]);
+		EXPECT_EQ_INT((outcodes[i] & TransformUnit::OUTCODE_NEAR) != 0, b.clippos.z < -b.clippos.w);
+	}
+
+	for (size_t t = 0; t + 3 <= tris.size(); t += 3) {
+		const int i0 = tris[t], i1 = tris[t + 1], i2 = tris[t + 2];
+		// Both paths drop these before the clipper, checked per vertex above.
+		if (scalarOutside[i0] || scalarOutside[i1] || scalarOutside[i2])
+			continue;
+
+		bool nearClip = false;
+		bool rejected = ScalarTriangleRejected(scalar[i0], scalar[i1], scalar[i2], &nearClip);
+		bool culled = TransformUnit::IsTriangleCulled(outcodes[i0], outcodes[i1], outcodes[i2]);
+		if (nearClip) {
+			// Might not catch everything, but must never cull something the clipper would draw.
+			EXPECT_TRUE(!culled || rejected);
+			counts.nearClipped++;
+		} else {
+			EXPECT_EQ_INT(culled, rejected);
+		}
+		if (culled)
+			counts.culled++;
+		else
+			counts.drawn++;
+	}
+	return true;
+}
+
+static bool TestTransformRandom() {
+	static const int scissors[2][4] = {
+		{ 0, 0, 479, 271 },
+		{ 100, 50, 299, 199 },
+	};
+
+	GMRng rng;
+	for (int clamp = 0; clamp < 2; ++clamp) {
+		for (int s = 0; s < 2; ++s) {
+			rng.Init(0x1234 + clamp * 2 + s);
+			SetupTransformState(clamp != 0, scissors[s][0], scissors[s][1], scissors[s][2], scissors[s][3]);
+
+			// A bit of rotation and scale, so every matrix element matters.
+			float angle = rng.F() * 6.0f;
+			float *world = gstate.worldMatrix;
+			world[0] = cosf(angle);
+			world[1] = sinf(angle);
+			world[2] = 0.1f;
+			world[3] = -sinf(angle);
+			world[4] = cosf(angle) * 1.2f;
+			world[5] = -0.1f;
+			world[6] = 0.05f;
+			world[7] = 0.02f;
+			world[8] = 0.9f;
+			world[9] = rng.F() * 10.0f - 5.0f;
+			world[10] = rng.F() * 10.0f - 5.0f;
+			world[11] = 0.0f;
+			// Some end up behind the camera or past the far plane.
+			gstate.viewMatrix[11] = -60.0f;
+			SetupPerspective(1.0f, 100.0f);
+
+			// Not a multiple of four, so the scalar tail runs too.
+			std::vector<Vec3f> positions(103);
+			for (Vec3f &pos : positions)
+				pos = Vec3f(rng.F() * 160.0f - 80.0f, rng.F() * 160.0f - 80.0f, rng.F() * 160.0f - 80.0f);
+			std::vector<int> tris(3000);
+			for (int &index : tris)
+				index = rng.R32() % positions.size();
+
+			TransformCheckCounts counts;
+			RET(CheckTransformPaths(positions, tris, counts));
+			EXPECT_TRUE(counts.culled > 0);
+			EXPECT_TRUE(counts.drawn > 0);
+			EXPECT_TRUE(counts.nearClipped > 0);
+		}
+	}
+	return true;
+}
+
+static bool TestTransformNearPlane() {
+	SetupTransformState(false, 100, 50, 299, 199);
+	SetupPerspective(1.0f, 100.0f);
+
+	// All left of the scissor, but the last one is in front of the near plane.
+	std::vector<Vec3f> positions = {
+		Vec3f(-20.0f, 0.0f, -10.0f),
+		Vec3f(-20.0f, 1.0f, -10.0f),
+		Vec3f(-1.0f, 0.0f, -0.5f),
+		Vec3f(-19.0f, 0.0f, -10.0f),
+	};
+	TransformCheckCounts counts;
+	RET(CheckTransformPaths(positions, { 0, 1, 2 }, counts));
+	EXPECT_EQ_INT(counts.culled, 0);
+	EXPECT_EQ_INT(counts.nearClipped, 1);
+
+	counts = TransformCheckCounts();
+	RET(CheckTransformPaths(positions, { 0, 1, 3 }, counts));
+	EXPECT_EQ_INT(counts.culled, 1);
+	return true;
+}
+
+static bool TestTransformDepthClamp() {
+	// Far plane at 100, so 150 is past it.
+	std::vector<Vec3f> positions = {
+		Vec3f(0.0f, 0.0f, -150.0f),
+		Vec3f(1.0f, 0.0f, -150.0f),
+		Vec3f(0.0f, 1.0f, -150.0f),
+		Vec3f(1.0f, 0.0f, -50.0f),
+		Vec3f(0.0f, 1.0f, -50.0f),
+	};
+	const std::vector<int> allOutside = { 0, 1, 2 };
+	const std::vector<int> oneOutside = { 0, 3, 4 };
+
+	for (int clamp = 0; clamp < 2; ++clamp) {
+		SetupTransformState(clamp != 0, 0, 0, 479, 271);
+		SetupPerspective(1.0f, 100.0f);
+
+		TransformCheckCounts counts;
+		RET(CheckTransformPaths(positions, allOutside, counts));
+		EXPECT_EQ_INT(counts.culled, 1);
+
+		counts = TransformCheckCounts();
+		RET(CheckTransformPaths(positions, oneOutside, counts));
+		// Only dropped without depth clamp, otherwise it's drawn with clamped depth.
+		EXPECT_EQ_INT(counts.culled, clamp ? 0 : 1);
+	}
+	return true;
+}
+
+static bool TestTransformScissorEdges() {
+	const int x1 = 100, y1 = 50, x2 = 299, y2 = 199;
+	SetupTransformState(false, x1, y1, x2, y2);
+
+	// With the identity matrices, drawing coordinates map straight to model positions.
+	auto modelX = [](float x) { return (OFFSET_X + x - 2048.0f) / 240.0f; };
+	auto modelY = [](float y) { return (OFFSET_Y + y - 2048.0f) / -136.0f; };
+
+	// Move a triangle across each scissor edge in steps smaller than a subpixel.
+	for (int edge = 0; edge < 4; ++edge) {
+		std::vector<Vec3f> positions;
+		std::vector<int> tris;
+		for (int step = -64; step <= 64; ++step) {
+			float d = step / 32.0f;
+			// The nearest vertex to the edge is always the first.
+			float xs[3], ys[3];
+			switch (edge) {
+			case 0: xs[0] = x1 + d; xs[1] = xs[2] = x1 + d - 3.0f; ys[0] = ys[1] = 100.0f; ys[2] = 110.0f; break;
+			case 1: xs[0] = x2 + 1 + d; xs[1] = xs[2] = x2 + 1 + d + 3.0f; ys[0] = ys[1] = 100.0f; ys[2] = 110.0f; break;
+			case 2: ys[0] = y1 + d; ys[1] = ys[2] = y1 + d - 3.0f; xs[0] = xs[1] = 150.0f; xs[2] = 160.0f; break;
+			default: ys[0] = y2 + 1 + d; ys[1] = ys[2] = y2 + 1 + d + 3.0f; xs[0] = xs[1] = 150.0f; xs[2] = 160.0f; break;
+			}
+			for (int i = 0; i < 3; ++i) {
+				tris.push_back((int)positions.size());
+				positions.push_back(Vec3f(modelX(xs[i]), modelY(ys[i]), 0.5f));
+			}
+		}
+
+		TransformCheckCounts counts;
+		RET(CheckTransformPaths(positions, tris, counts));
+		EXPECT_TRUE(counts.culled > 0);
+		EXPECT_TRUE(counts.drawn > 0);
+	}
+	return true;
+}
+
+bool TestSoftwareGPU() {
+	GPUgstate saved = gstate;
+	bool success = TestTransformRandom() && TestTransformNearPlane() && TestTransformDepthClamp() && TestTransformScissorEdges();
+	gstate = saved;
+	return success;
+}
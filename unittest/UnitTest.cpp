@@ -43,6 +43,7 @@
 #include "Common/Data/Text/Parsers.h"
 #include "Common/Data/Text/WrapText.h"
 #include "Common/Data/Encoding/Utf8.h"
+#include "Common/File/FileUtil.h"
 #include "Common/File/Path.h"
 #include "Common/Input/InputState.h"
 #include "Common/Math/math_util.h"
@@ -54,8 +55,10 @@
 #include "Common/BitScan.h"
 #include "Common/CPUDetect.h"
 #include "Common/Log.h"
+#include "Common/MemArena.h"
 #include "Core/Config.h"
 #include "Core/FileSystems/ISOFileSystem.h"
+#include "Core/MemDirty.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
 #include "GPU/Common/TextureDecoder.h"
@@ -533,6 +536,65 @@ bool TestCLZ() {
 	return true;
 }
 
+#if PPSSPP_PLATFORM(LINUX)
+// How much of the mapping that contains ptr is mapped with huge pages, from /proc/self/smaps.
+static uint64_t HugePageMappedBytes(const void *ptr) {
+	std::string smaps;
+	if (!File::ReadFileToString(true, Path("/proc/self/smaps"), smaps))
+		return 0;
+
+	std::istringstream lines(smaps);
+	std::string line;
+	bool inMapping = false;
+	uint64_t bytes = 0;
+	while (std::getline(lines, line)) {
+		unsigned long long start, end, kb;
+		if (sscanf(line.c_str(), "%llx-%llx ", &start, &end) == 2)
+			inMapping = (uintptr_t)ptr >= start && (uintptr_t)ptr < end;
+		else if (inMapping && (sscanf(line.c_str(), "ShmemPmdMapped: %llu kB", &kb) == 1 || sscanf(line.c_str(), "FilePmdMapped: %llu kB", &kb) == 1))
+			bytes += kb * 1024;
+	}
+	return bytes;
+}
+#endif
+
+static bool TestMemArenaPages(bool hugePages) {
+	const size_t SIZE = 0x02000000;
+
+	MemArena arena;
+	bool usingHugePages = arena.SetHugePages(hugePages);
+	EXPECT_TRUE(arena.GrabMemSpace(arena.roundup(SIZE)));
+	u8 *view = (u8 *)arena.CreateView(0, SIZE);
+	u8 *mirror = (u8 *)arena.CreateView(0, SIZE);
+	EXPECT_TRUE(view != nullptr && mirror != nullptr);
+
+	// Mirrors have to keep working either way, in both directions.
+	for (size_t i = 0; i < SIZE; i += 4096)
+		view[i] = (u8)(i >> 12);
+	for (size_t i = 0; i < SIZE; i += 4096)
+		EXPECT_EQ_INT(mirror[i], (u8)(i >> 12));
+	for (size_t i = 2048; i < SIZE; i += 4096)
+		mirror[i] = (u8)~(i >> 12);
+	for (size_t i = 2048; i < SIZE; i += 4096)
+		EXPECT_EQ_INT(view[i], (u8)~(i >> 12));
+
+#if PPSSPP_PLATFORM(LINUX)
+	// The kernel allowed them, but can still fall back to normal pages when it has no free huge ones.
+	if (usingHugePages && HugePageMappedBytes(view) == 0)
+		printf("MemArena: huge pages allowed, but the kernel used normal pages (accepted)\n");
+#endif
+
+	arena.ReleaseView(mirror, SIZE);
+	arena.ReleaseView(view, SIZE);
+	arena.ReleaseSpace();
+	return true;
+}
+
+static bool TestMemArena() {
+	// Huge pages fall back to normal ones if the system doesn't allow them, so both should pass.
+	return TestMemArenaPages(false) && TestMemArenaPages(true);
+}
+
 static bool TestMemMap() {
 	Memory::g_MemorySize = Memory::RAM_DOUBLE_SIZE;
 
@@ -587,6 +649,51 @@ static bool TestMemMap() {
 	return true;
 }
 
+static bool TestMemDirty() {
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	EXPECT_TRUE(Memory::Init());
+	if (!Memory::DirtyTrackingAvailable()) {
+		// Accepted, snapshots compare every page then.
+		printf("MemDirty: soft-dirty tracking not available here, skipping\n");
+		Memory::Shutdown();
+		return true;
+	}
+
+	const u32 pageSize = Memory::DirtyPageSize();
+	const size_t ramPages = Memory::g_MemorySize / pageSize;
+	const size_t numPages = ramPages + Memory::VRAM_SIZE / pageSize;
+	auto collect = [&](std::vector<bool> &dirty) {
+		dirty.assign(numPages, false);
+		return Memory::CollectDirtyPages(PSP_GetKernelMemoryBase(), Memory::g_MemorySize, dirty, 0) &&
+			Memory::CollectDirtyPages(PSP_GetVidMemBase(), Memory::VRAM_SIZE, dirty, ramPages);
+	};
+
+	// Like snapshots do when they copy a base, so no page starts out unmapped.
+	u32 sum = 0;
+	for (u32 offset = 0; offset < Memory::g_MemorySize; offset += pageSize)
+		sum += Memory::Read_U8(PSP_GetKernelMemoryBase() + offset);
+	for (u32 offset = 0; offset < Memory::VRAM_SIZE; offset += pageSize)
+		sum += Memory::Read_U8(PSP_GetVidMemBase() + offset);
+
+	std::vector<bool> dirty;
+	EXPECT_TRUE(Memory::ResetDirtyPages());
+	// Through the main view, the uncached RAM mirror, and a VRAM mirror.
+	Memory::Write_U32(sum, PSP_GetKernelMemoryBase() + 3 * pageSize);
+	*(volatile u32 *)(Memory::base + 0x40000000 + PSP_GetKernelMemoryBase() + 7 * pageSize) = 1;
+	*(volatile u32 *)(Memory::base + PSP_GetVidMemBase() + 0x00200000 + 2 * pageSize) = 2;
+	EXPECT_TRUE(collect(dirty));
+	for (size_t i = 0; i < numPages; ++i)
+		EXPECT_EQ_INT((int)dirty[i], (int)(i == 3 || i == 7 || i == ramPages + 2));
+
+	EXPECT_TRUE(Memory::ResetDirtyPages());
+	EXPECT_TRUE(collect(dirty));
+	for (size_t i = 0; i < numPages; ++i)
+		EXPECT_FALSE(dirty[i]);
+
+	Memory::Shutdown();
+	return true;
+}
+
 static bool TestPath() {
 	// Also test the Path class while we're at it.
 	Path path("/asdf/jkl/");
@@ -753,6 +860,9 @@ bool TestArm64Emitter();
 bool TestX64Emitter();
 bool TestShaderGenerators();
 bool TestThreadManager();
+bool TestCoreTiming();
+bool TestSerializer();
+bool TestSoftwareGPU();
 
 TestItem availableTests[] = {
 #if PPSSPP_ARCH(ARM64) || PPSSPP_ARCH(AMD64) || PPSSPP_ARCH(X86)
@@ -771,15 +881,25 @@ TestItem availableTests[] = {
 	TEST_ITEM(MathUtil),
 	TEST_ITEM(Parsers),
 	TEST_ITEM(Jit),
+	TEST_ITEM(IRDispatch),
+	TEST_ITEM(IRVFPU),
+	TEST_ITEM(IRTraces),
+	TEST_ITEM(IRLoadStorePasses),
+	TEST_ITEM(IRDiskCache),
 	TEST_ITEM(MatrixTranspose),
 	TEST_ITEM(ParseLBN),
 	TEST_ITEM(QuickTexHash),
 	TEST_ITEM(CLZ),
 	TEST_ITEM(MemMap),
+	TEST_ITEM(MemArena),
+	TEST_ITEM(MemDirty),
 	TEST_ITEM(ShaderGenerators),
+	TEST_ITEM(SoftwareGPU),
 	TEST_ITEM(Path),
 	TEST_ITEM(AndroidContentURI),
 	TEST_ITEM(ThreadManager),
+	TEST_ITEM(CoreTiming),
+	TEST_ITEM(Serializer),
 	TEST_ITEM(WrapText),
 };
 